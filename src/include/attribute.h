@@ -251,6 +251,7 @@ typedef struct ecl_attribute_def ecl_attribute_def;
 #define ATR_VFLAG_TARGET 0x20		 /* target of indirect resource  */
 #define ATR_VFLAG_HOOK 0x40		 /* value set by a hook script   */
 #define ATR_VFLAG_IN_EXECVNODE_FLAG 0x80 /* resource key value pair was found in execvnode */
+#define ATR_VFLAG_DBSAVE 0x100		 /* modified, save to the database pending */
 
 #define ATR_MOD_MCACHE (ATR_VFLAG_MODIFY | ATR_VFLAG_MODCACHE)
 #define ATR_SET_MOD_MCACHE (ATR_VFLAG_SET | ATR_MOD_MCACHE)
@@ -598,6 +599,8 @@ extern int action_resc_resv(attribute *pattr, void *pobject, int actmode);
 /* Functions used to save and recover the attributes from the database */
 extern int encode_single_attr_db(attribute_def *padef, attribute *pattr, pbs_db_attr_list_t *db_attr_list);
 extern int encode_attr_db(attribute_def *padef, attribute *pattr, int numattr, pbs_db_attr_list_t *db_attr_list, int all);
+extern void defer_attr_db(attribute_def *padef, attribute *pattr, int numattr, int all);
+extern void restore_attr_db(attribute *pattr, int numattr);
 extern int decode_attr_db(void *parent, pbs_list_head *attr_list,
 			  void *padef_idx, attribute_def *padef, attribute *pattr, int limit, int unknown);
 
@@ -293,6 +293,7 @@ struct rq_register_sched {
  */
 struct batch_request {
 	pbs_list_link rq_link;		   /* linkage of all requests */
+	pbs_list_link rq_statlink;	   /* linkage of deferred status requests */
 	struct batch_request *rq_parentbr; /* parent request for job array request */
 	int rq_refct;			   /* reference count - child requests */
 	int rq_type;			   /* type of request */
@@ -309,6 +310,7 @@ struct batch_request {
 	int prot;			   /* PROT_TCP or PROT_TPP */
 	int tpp_ack;			   /* send acks for this tpp stream? */
 	char *tppcmd_msgid;		   /* msg id for tpp commands */
+	struct stat_cache_ent *rq_statcache; /* cached status reply, see stat_cache.c */
 	struct batch_reply rq_reply;	   /* the reply area for this request */
 	union indep_request {
 		struct rq_register_sched rq_register_sched;
@@ -234,6 +234,7 @@ int dis_getc(int);
 int dis_gets(int, char *, size_t);
 int dis_puts(int, const char *, size_t);
 int dis_flush(int);
+size_t dis_peek_writebuf(int, char **);
 void dis_setup_chan(int, pbs_tcp_chan_t *(*) (int) );
 void dis_destroy_chan(int);
 
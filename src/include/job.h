@@ -493,6 +493,15 @@ struct job {
 	int ji_discarding;		   /* discarding job */
 	struct batch_request *ji_prunreq;  /* outstanding runjob request */
 	pbs_list_head ji_svrtask;	   /* links to svr work_task list */
+	pbs_list_link ji_dirtylink;	   /* links to jobs with a database save pending */
+	pbs_list_link ji_statelink;	   /* links to jobs in same state in server */
+	pbs_list_link ji_qstatelink;	   /* links to jobs in same state in queue */
+	pbs_list_link ji_ownerlink;	   /* links to jobs of same owner */
+	pbs_list_link ji_arraylink;	   /* links to array parent jobs */
+	struct owner_jobs *ji_idxowner;	   /* owner list holding ji_ownerlink */
+	struct pbs_queue *ji_idxque;	   /* queue holding ji_qstatelink */
+	int ji_idxstate;		   /* state list holding ji_statelink */
+	unsigned long long ji_enqseq;	   /* enqueue order, orders equal qrank */
 	struct pbs_queue *ji_qhdr;	   /* current queue header */
 	struct resc_resv *ji_myResv;	   /* !=0 job belongs to a reservation, see also, attribute JOB_ATR_myResv */
 
@@ -527,6 +536,9 @@ struct job {
 	int preempt_order_index;
 	struct work_task *ji_prov_startjob_task;
 
+	u_Long ji_chgseq;   /* change sequence of last differing sched status */
+	u_Long ji_stathash; /* hash of last status sent to a scheduler */
+
 #endif /* END SERVER ONLY */
 
 	/*
@@ -1034,6 +1046,7 @@ long long get_jattr_ll(const job *pjob, int attr_idx);
 svrattrl *get_jattr_usr_encoded(const job *pjob, int attr_idx);
 svrattrl *get_jattr_priv_encoded(const job *pjob, int attr_idx);
 void set_job_state(job *pjob, char val);
+extern void (*job_state_hook)(job *pjob);
 void set_job_substate(job *pjob, long val);
 int set_jattr_str_slim(job *pjob, int attr_idx, char *val, char *rscn);
 int set_jattr_l_slim(job *pjob, int attr_idx, long val, enum batch_op op);
@@ -1070,6 +1083,7 @@ extern int job_save_fs(job *);
 
 extern job *job_recov_db(char *, job *pjob);
 extern int job_save_db(job *);
+extern void job_save_db_cancel(job *);
 
 #define job_save job_save_db
 #define job_recov job_recov_db
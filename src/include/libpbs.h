@@ -339,6 +339,8 @@ int PBSD_jobfile(int, int, char *, char *, enum job_file, int, char **);
 int PBSD_status_put(int, int, const char *, struct attrl *, const char *, int, char **);
 int PBSD_select_put(int, int, struct attropl *, struct attrl *, const char *);
 char **PBSD_select_get(int);
+int PBSD_asyrunjob_ack_put(int, const char *, const char *, const char *);
+int PBSD_asyrunjob_ack_get(int);
 struct batch_reply *PBSD_rdrpy(int);
 struct batch_reply *PBSD_rdrpy_sock(int, int *, int prot);
 void PBSD_FreeReply(struct batch_reply *);
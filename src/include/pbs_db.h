@@ -345,6 +345,33 @@ int pbs_db_disconnect(void *conn);
  */
 int pbs_db_save_obj(void *conn, pbs_db_obj_info_t *obj, int savetype);
 
+/**
+ * @brief
+ *	Start a transaction, so that the following saves are committed together
+ *
+ * @param[in]	conn - Connected database handle
+ *
+ * @return      int
+ * @retval      -1  - Failure
+ * @retval       0  - success
+ *
+ */
+int pbs_db_begin_trx(void *conn);
+
+/**
+ * @brief
+ *	End the transaction started with pbs_db_begin_trx
+ *
+ * @param[in]	conn - Connected database handle
+ * @param[in]	commit - 1 to commit, 0 to roll back
+ *
+ * @return      int
+ * @retval      -1  - Failure, nothing was committed
+ * @retval       0  - success
+ *
+ */
+int pbs_db_end_trx(void *conn, int commit);
+
 /**
  * @brief
  *	Delete an existing object from the database
@@ -305,6 +305,7 @@ extern "C" {
 #define ATTR_license_max "pbs_license_max"
 #define ATTR_license_linger "pbs_license_linger_time"
 #define ATTR_license_count "license_count"
+#define ATTR_db_save_stats "db_save_stats"
 #define ATTR_job_sort_formula "job_sort_formula"
 #define ATTR_EligibleTimeEnable "eligible_time_enable"
 #define ATTR_resv_retry_time "reserve_retry_time"
@@ -323,6 +324,7 @@ extern "C" {
 #define ATTR_sync_mom_hookfiles_timeout "sync_mom_hookfiles_timeout"
 #define ATTR_max_job_sequence_id "max_job_sequence_id"
 #define ATTR_has_runjob_hook "has_runjob_hook"
+#define ATTR_change_sequence "change_sequence"
 #define ATTR_acl_krb_realm_enable "acl_krb_realm_enable"
 #define ATTR_acl_krb_realms "acl_krb_realms"
 #define ATTR_acl_krb_submit_realms "acl_krb_submit_realms"
@@ -362,6 +364,7 @@ extern "C" {
 #define ATTR_sched_preempt_sort "preempt_sort"
 #define ATTR_sched_server_dyn_res_alarm "server_dyn_res_alarm"
 #define ATTR_job_run_wait "job_run_wait"
+#define ATTR_last_cycle_profile "last_cycle_profile"
 
 /* additional node "attributes" names */
 
@@ -45,6 +45,7 @@ extern "C" {
 
 #include "attribute.h"
 #include "server_limits.h"
+#include "Long.h"
 
 #define QTYPE_Unset 0
 #define QTYPE_Execution 1
@@ -86,6 +87,12 @@ struct pbs_queue {
 	int qu_numjobs;			 /* current numb jobs in queue */
 	int qu_njstate[PBS_NUMJOBSTATE]; /* # of jobs per state */
 
+	pbs_list_head qu_jobstidx[JOB_IDX_NSTATE]; /* jobs in this queue by state */
+	int qu_jobstct[JOB_IDX_NSTATE];		   /* # of jobs in each qu_jobstidx */
+
+	u_Long qu_chgseq;   /* change sequence of last differing sched status */
+	u_Long qu_stathash; /* hash of last status sent to a scheduler */
+
 	/* the queue attributes */
 
 	attribute qu_attr[QA_ATR_LAST];
@@ -58,6 +58,7 @@ extern "C" {
 #ifndef _RESV_NODE_H
 #include "resv_node.h"
 #endif
+#include "Long.h"
 
 #define JOB_OBJECT 1
 #define RESC_RESV_OBJECT 2
@@ -169,6 +170,8 @@ struct resc_resv {
 							 * reservation or a standing reservation occurrence
 							 */
 
+	pbs_list_link ri_dirtylink; /* links to resvs with a database save pending */
+
 	pbs_list_head ri_svrtask; /* place to keep work_task struct that
 							 * are "attached" to this reservation
 							 */
@@ -203,6 +206,9 @@ struct resc_resv {
 	int req_sched_count;
 	int rep_sched_count;
 
+	u_Long ri_chgseq;   /* change sequence of last differing sched status */
+	u_Long ri_stathash; /* hash of last status sent to a scheduler */
+
 	/*
 	 * fixed size internal data - maintained via "quick save"
 	 * some of the items are copies of attributes, if so this
@@ -307,6 +313,7 @@ extern long determine_resv_retry(resc_resv *presv);
 
 extern resc_resv *resv_recov_db(char *resvid, resc_resv *presv);
 extern int resv_save_db(resc_resv *presv);
+extern void resv_save_db_cancel(resc_resv *presv);
 extern void pbsd_init_resv(resc_resv *presv, int type);
 
 attribute *get_rattr(const resc_resv *presv, int attr_idx);
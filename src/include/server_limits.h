@@ -58,6 +58,7 @@ extern "C" {
 #define PBS_RESVBASE 11 /* basename size for job file, 10 = 14 -3   */
 /* where 14 is max file name, 3 for suffix - ".RF" */
 #define PBS_NUMJOBSTATE 10 /* TQHWREXBMF */
+#define JOB_IDX_NSTATE (PBS_NUMJOBSTATE + 1) /* job state lists, last for other states */
 
 #ifdef NAS		   /* localmod 083 */
 #define PBS_MAX_HOPCOUNT 3 /* limit on number of routing hops per job */
@@ -72,6 +73,9 @@ extern "C" {
 #define PBS_NET_RETRY_LIMIT 14400   /* Max retry time */
 #define PBS_SCHEDULE_CYCLE 600	    /* re-schedule even if no change, 10 min   */
 #define PBS_RESTAT_JOB 30	    /* ask mom for status only once in 30 sec  */
+#define PBS_DEFER_STAT_MSEC 50	    /* time spent per pass on held back status */
+#define PBS_STAT_CACHE_SLOTS 8	    /* status replies kept for repeated queries */
+#define PBS_STAT_CACHE_TTL 1	    /* max age in sec of a cached status reply */
 #define PBS_STAGEFAIL_WAIT 1800	    /* retry time after stage in failuere */
 #define PBS_MAX_ARRAY_JOB_DFL 10000 /* default max size of an array job */
 
@@ -53,6 +53,7 @@ extern "C" {
 #include "resource.h"
 #include "pbs_sched.h"
 #include "pbs_entlim.h"
+#include "Long.h"
 
 extern int check_num_cpus(void);
 extern int chk_hold_priv(long, int);
@@ -134,6 +135,16 @@ extern int make_schedselect(attribute *, resource *, pbs_queue *, attribute *);
 extern long long get_next_svr_sequence_id(void);
 extern int compare_obj_hash(void *, int, void *);
 extern void panic_stop_db();
+extern void db_save_flush(void);
+extern void update_db_save_stats(void);
+extern int serve_deferred_stats(void);
+extern void stat_cache_invalidate(void);
+extern int stat_cache_readonly(int);
+extern int stat_cache_reply(struct batch_request *);
+extern int stat_cache_encode(int, struct batch_request *);
+extern void stat_cache_store(struct batch_request *);
+extern void stat_cache_release(struct batch_request *);
+extern int job_index_init(void);
 extern void free_db_attr_list(pbs_db_attr_list_t *);
 extern bool delete_pending_arrayjobs(struct batch_request *);
 
@@ -191,6 +202,10 @@ extern void complete_running(job *);
 extern void am_jobs_add(job *);
 extern int was_job_alteredmoved(job *);
 extern void check_failed_attempts(job *);
+extern void job_index_add(job *);
+extern void job_index_remove(job *);
+extern void job_index_unqueue(job *);
+extern void job_index_swap(job *, job *);
 #endif
 #ifdef _QUEUE_H
 extern int check_entity_ct_limit_max(job *, pbs_queue *);
@@ -263,6 +278,9 @@ extern void req_reservationOccurrenceEnd(struct batch_request *);
 extern void req_failover(struct batch_request *);
 extern int put_failover(int, struct batch_request *);
 extern void set_last_used_time_node(void *, int);
+extern u_Long stat_chgseq(void);
+extern int get_stat_delta(struct batch_request *, u_Long *);
+extern int status_delta(struct brp_status *, u_Long, u_Long *, u_Long *);
 
 #endif /* _BATCH_REQUEST_H */
 
@@ -385,6 +403,7 @@ struct stat_cntl {
 extern int status_job(job *, struct batch_request *, svrattrl *, pbs_list_head *, int *, int);
 extern int status_subjob(job *, struct batch_request *, svrattrl *, int, pbs_list_head *, int *, int);
 extern int stat_to_mom(job *, struct stat_cntl *);
+extern int job_index_plan(pbs_queue *, struct select_list *, int, int, job ***, int *);
 
 #endif /* STAT_CNTL */
 #ifdef __cplusplus
@@ -79,6 +79,8 @@ struct work_task {
 	pbs_list_link wt_linkevent;	     /* link to event type work list */
 	pbs_list_link wt_linkobj;	     /* link to others of same object */
 	pbs_list_link wt_linkobj2;	     /* link to another set of similarity */
+	pbs_list_link wt_linkparm;	     /* link in the index by wt_parm1 */
+	int wt_onlist;			     /* which work list wt_linkevent is on */
 	long wt_event;			     /* event id: time, pid, socket, ... */
 	char *wt_event2;		     /* if replies on the same handle, then additional distinction */
 	enum work_type wt_type;		     /* type of event */
@@ -99,6 +101,7 @@ extern void delete_task_by_parm1_func(void *parm1, void (*func)(struct work_task
 extern int has_task_by_parm1(void *parm1);
 extern time_t default_next_task(void);
 extern struct work_task *find_work_task(enum work_type, void *, void *);
+extern void (*dispatch_task_hook)(void);
 
 #ifdef __cplusplus
 }
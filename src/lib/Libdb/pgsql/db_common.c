@@ -891,6 +891,69 @@ pbs_db_save_obj(void *conn, pbs_db_obj_info_t *obj, int savetype)
 	return (db_fn_arr[obj->pbs_db_obj_type].pbs_db_save_obj(conn, obj, savetype));
 }
 
+/**
+ * @brief
+ *	Start a transaction.  Saves made until pbs_db_end_trx() are committed
+ *	(and flushed to disk) once, instead of once per statement.
+ *
+ * @param[in]	conn - Connected database handle
+ *
+ * @return      Error code
+ * @retval	-1  - Failure
+ * @retval	 0  - Success
+ *
+ */
+int
+pbs_db_begin_trx(void *conn)
+{
+	if (conn_trx->conn_trx_nest++ > 0)
+		return 0;
+
+	conn_trx->conn_trx_rollback = 0;
+	if (db_execute_str(conn, "BEGIN") == -1) {
+		conn_trx->conn_trx_nest = 0;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief
+ *	End a transaction started with pbs_db_begin_trx().  A nested end only
+ *	records a rollback request; the outermost end commits or rolls back.
+ *
+ * @param[in]	conn - Connected database handle
+ * @param[in]	commit - 1 to commit, 0 to roll back
+ *
+ * @return      Error code
+ * @retval	-1  - Failure, the transaction was rolled back
+ * @retval	 0  - Success
+ *
+ */
+int
+pbs_db_end_trx(void *conn, int commit)
+{
+	if (conn_trx->conn_trx_nest == 0)
+		return -1;
+
+	if (!commit)
+		conn_trx->conn_trx_rollback = 1;
+
+	if (--conn_trx->conn_trx_nest > 0)
+		return 0;
+
+	/* a COMMIT of a failed transaction would quietly roll back */
+	if (conn_trx->conn_trx_rollback ||
+	    PQtransactionStatus((PGconn *) conn) == PQTRANS_INERROR) {
+		db_execute_str(conn, "ROLLBACK");
+		return -1;
+	}
+
+	if (db_execute_str(conn, "COMMIT") == -1)
+		return -1;
+	return 0;
+}
+
 /**
  * @brief
  *	Delete attributes of an object from the database
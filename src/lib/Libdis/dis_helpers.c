@@ -808,6 +808,36 @@ dis_flush(int fd)
 	return 0;
 }
 
+/**
+ * @brief
+ * 	dis_peek_writebuf - get the data put into the write buffer since
+ *	it was last flushed, without the packet header
+ *
+ * @param[in] fd - file descriptor
+ * @param[out] data - set to the start of the data
+ *
+ * @return size_t
+ *
+ * @retval number of bytes of data, 0 if none
+ *
+ * @par Side Effects:
+ *	None
+ *
+ * @par MT-safe: Yes
+ *
+ */
+size_t
+dis_peek_writebuf(int fd, char **data)
+{
+	pbs_dis_buf_t *tp = dis_get_writebuf(fd);
+
+	*data = NULL;
+	if (tp == NULL || tp->tdis_len <= PKT_HDR_SZ)
+		return 0;
+	*data = tp->tdis_data + PKT_HDR_SZ;
+	return tp->tdis_len - PKT_HDR_SZ;
+}
+
 /**
  * @brief
  * 	dis_destroy_chan - release structures associated with fd
@@ -50,7 +50,7 @@
 #include "pbs_ecl.h"
 
 /**
- * @brief	Inner function for __pbs_runjob, __pbs_asynrunjob and __pbs_asynrunjob_ack
+ * @brief	encode and send a run job request without reading the reply
  *
  * @param[in] c - connection handle
  * @param[in] jobid- job identifier
@@ -61,28 +61,15 @@
  * @return      int
  * @retval      0       success
  * @retval      !0      error
+ *
+ * @par MT-safe: No - the caller must hold the connection lock
  */
 static int
-__runjob_inner(int c, const char *jobid, const char *location, const char *extend, int req_type)
+__runjob_send(int c, const char *jobid, const char *location, const char *extend, int req_type)
 {
 	int rc = 0;
 	unsigned long resch = 0;
 
-	if ((jobid == NULL) || (*jobid == '\0'))
-		return (pbs_errno = PBSE_IVALREQ);
-
-	if (location == NULL)
-		location = "";
-
-	/* initialize the thread context data, if not already initialized */
-	if (pbs_client_thread_init_thread_context() != 0)
-		return pbs_errno;
-
-	/* lock pthread mutex here for this connection */
-	/* blocking call, waits for mutex release */
-	if (pbs_client_thread_lock_connection(c) != 0)
-		return pbs_errno;
-
 	/* setup DIS support routines for following DIS calls */
 
 	DIS_tcp_funcs();
@@ -96,13 +83,49 @@ __runjob_inner(int c, const char *jobid, const char *location, const char *exten
 			pbs_errno = PBSE_SYSTEM;
 		else
 			pbs_errno = PBSE_PROTOCOL;
-
-		pbs_client_thread_unlock_connection(c);
 		return pbs_errno;
 	}
 
-	if (dis_flush(c)) {
-		pbs_errno = PBSE_PROTOCOL;
+	if (dis_flush(c))
+		return (pbs_errno = PBSE_PROTOCOL);
+
+	return 0;
+}
+
+/**
+ * @brief	Inner function for __pbs_runjob, __pbs_asynrunjob and __pbs_asynrunjob_ack
+ *
+ * @param[in] c - connection handle
+ * @param[in] jobid- job identifier
+ * @param[in] location - string of vnodes/resources to be allocated to the job
+ * @param[in] extend - extend string for encoding req
+ * @param[in] req_type - one of PBS_BATCH_RunJob, PBS_BATCH_AsyrunJob or PBS_BATCH_AsyrunJob_ack
+ *
+ * @return      int
+ * @retval      0       success
+ * @retval      !0      error
+ */
+static int
+__runjob_inner(int c, const char *jobid, const char *location, const char *extend, int req_type)
+{
+	int rc = 0;
+
+	if ((jobid == NULL) || (*jobid == '\0'))
+		return (pbs_errno = PBSE_IVALREQ);
+
+	if (location == NULL)
+		location = "";
+
+	/* initialize the thread context data, if not already initialized */
+	if (pbs_client_thread_init_thread_context() != 0)
+		return pbs_errno;
+
+	/* lock pthread mutex here for this connection */
+	/* blocking call, waits for mutex release */
+	if (pbs_client_thread_lock_connection(c) != 0)
+		return pbs_errno;
+
+	if (__runjob_send(c, jobid, location, extend, req_type) != 0) {
 		pbs_client_thread_unlock_connection(c);
 		return pbs_errno;
 	}
@@ -123,6 +146,84 @@ __runjob_inner(int c, const char *jobid, const char *location, const char *exten
 	return rc;
 }
 
+/**
+ * @brief
+ *	-send an acknowledged async run job request without waiting for the
+ *	acknowledgement.  This lets a caller keep several run job requests in
+ *	flight on one connection.  Every successful call must be matched by
+ *	a call to PBSD_asyrunjob_ack_get(), in the same order, before any
+ *	other request which reads a reply is sent on the connection.
+ *
+ * @param[in] c - connection handle
+ * @param[in] jobid- job identifier
+ * @param[in] location - string of vnodes/resources to be allocated to the job
+ * @param[in] extend - extend string for encoding req
+ *
+ * @return      int
+ * @retval      0       success
+ * @retval      !0      error
+ *
+ */
+int
+PBSD_asyrunjob_ack_put(int c, const char *jobid, const char *location, const char *extend)
+{
+	if ((jobid == NULL) || (*jobid == '\0'))
+		return (pbs_errno = PBSE_IVALREQ);
+
+	if (location == NULL)
+		location = "";
+
+	if (pbs_client_thread_init_thread_context() != 0)
+		return pbs_errno;
+
+	if (pbs_client_thread_lock_connection(c) != 0)
+		return pbs_errno;
+
+	if (__runjob_send(c, jobid, location, extend, PBS_BATCH_AsyrunJob_ack) != 0) {
+		pbs_client_thread_unlock_connection(c);
+		return pbs_errno;
+	}
+
+	if (pbs_client_thread_unlock_connection(c) != 0)
+		return pbs_errno;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *	-read the acknowledgement of the oldest run job request sent with
+ *	PBSD_asyrunjob_ack_put()
+ *
+ * @param[in] c - connection handle
+ *
+ * @return      int
+ * @retval      0       the server accepted the request
+ * @retval      !0      error from the server, or PBSE_PROTOCOL
+ *
+ */
+int
+PBSD_asyrunjob_ack_get(int c)
+{
+	struct batch_reply *reply;
+	int rc;
+
+	if (pbs_client_thread_init_thread_context() != 0)
+		return pbs_errno;
+
+	if (pbs_client_thread_lock_connection(c) != 0)
+		return pbs_errno;
+
+	reply = PBSD_rdrpy(c);
+	rc = get_conn_errno(c);
+	PBSD_FreeReply(reply);
+
+	if (pbs_client_thread_unlock_connection(c) != 0)
+		return pbs_errno;
+
+	return rc;
+}
+
 /**
  * @brief
  *	-send async run job batch request.
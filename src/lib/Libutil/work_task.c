@@ -41,6 +41,18 @@
  * @file	work_task.c
  * @brief
  * work_task.c - contains functions to deal with the server's task list
+ *
+ * @par
+ *	Timed tasks are kept on a hashed timing wheel of one second slots,
+ *	a task going on the slot of wt_event modulo TIMED_WHEEL_SLOTS; tasks
+ *	further out than the wheel wait on their slot for later rounds.  As
+ *	time passes, default_next_task() moves the tasks of each passed slot
+ *	which are due onto task_list_timed, which thus only holds due tasks,
+ *	in time order.  Adding or removing a timed task does not depend on
+ *	how many there are.
+ *
+ *	All tasks are also indexed by wt_parm1 so that find_work_task() and
+ *	delete_task_by_parm1_func() need not walk the work lists.
  */
 #include <pbs_config.h> /* the master config generated by configure */
 
@@ -63,6 +75,179 @@ extern pbs_list_head task_list_event;	   /* list of tasks responding to an event
 extern int svr_delay_entry;
 extern time_t time_now;
 
+void (*dispatch_task_hook)(void) = NULL; /* called as each task is dispatched */
+
+#define TIMED_WHEEL_SLOTS 4096 /* must be a power of 2 */
+#define TASK_PARM_BUCKETS 4096 /* must be a power of 2 */
+
+/* values of wt_onlist, used as bits to select lists */
+#define TASKS_IMMED 0x1
+#define TASKS_INTERLEAVE 0x2
+#define TASKS_TIMED 0x4
+#define TASKS_EVENT 0x8
+
+static pbs_list_head timed_wheel[TIMED_WHEEL_SLOTS];
+static pbs_list_head task_parm_idx[TASK_PARM_BUCKETS];
+static time_t wheel_tick;	/* last second whose slot has been moved */
+static int task_lists_ready = 0;
+
+#define WHEEL_SLOT(t) (&timed_wheel[(t) & (TIMED_WHEEL_SLOTS - 1)])
+#define PARM_HASH(p) ((int) (((size_t) (p) >> 4) & (TASK_PARM_BUCKETS - 1)))
+
+/**
+ * @brief
+ *	Set up the timing wheel and the index on first use.
+ */
+static void
+init_task_lists(void)
+{
+	int i;
+
+	for (i = 0; i < TIMED_WHEEL_SLOTS; i++)
+		CLEAR_HEAD(timed_wheel[i]);
+	for (i = 0; i < TASK_PARM_BUCKETS; i++)
+		CLEAR_HEAD(task_parm_idx[i]);
+	wheel_tick = time(NULL);
+	task_lists_ready = 1;
+}
+
+/**
+ * @brief
+ *	Put a task that is due on task_list_timed, keeping the list in
+ *	time order.  It normally goes at the end.
+ *
+ * @param[in]	ptask	- the task
+ */
+static void
+link_due(struct work_task *ptask)
+{
+	struct work_task *pold;
+
+	pold = (struct work_task *) GET_PRIOR(task_list_timed);
+	while (pold && pold->wt_event > ptask->wt_event)
+		pold = (struct work_task *) GET_PRIOR(pold->wt_linkevent);
+	if (pold)
+		insert_link(&pold->wt_linkevent, &ptask->wt_linkevent, ptask,
+			    LINK_INSET_AFTER);
+	else
+		insert_link(&task_list_timed, &ptask->wt_linkevent, ptask,
+			    LINK_INSET_AFTER);
+}
+
+/**
+ * @brief
+ *	Put a timed task on the slot of the wheel for its time, or on
+ *	task_list_timed if that slot has already been passed.
+ *
+ * @param[in]	ptask	- the task
+ */
+static void
+link_timed(struct work_task *ptask)
+{
+	ptask->wt_onlist = TASKS_TIMED;
+	if (ptask->wt_event > wheel_tick)
+		append_link(WHEEL_SLOT(ptask->wt_event), &ptask->wt_linkevent, ptask);
+	else
+		link_due(ptask);
+}
+
+/**
+ * @brief
+ *	Move the due tasks of the slot for second 'tick' to task_list_timed.
+ *
+ * @param[in]	tick	- the second
+ * @param[in]	upto	- tasks with a time up to this are due
+ */
+static void
+move_due(time_t tick, time_t upto)
+{
+	struct work_task *ptask;
+	struct work_task *pnext;
+
+	for (ptask = (struct work_task *) GET_NEXT(*WHEEL_SLOT(tick)); ptask; ptask = pnext) {
+		pnext = (struct work_task *) GET_NEXT(ptask->wt_linkevent);
+		if (ptask->wt_event <= upto) {
+			delete_link(&ptask->wt_linkevent);
+			link_due(ptask);
+		}
+	}
+}
+
+/**
+ * @brief
+ *	Turn the wheel up to the given time, moving the tasks which have
+ *	become due to task_list_timed.
+ *
+ * @param[in]	now	- the current time
+ */
+static void
+advance_wheel(time_t now)
+{
+	time_t tick;
+
+	if (now - wheel_tick > TIMED_WHEEL_SLOTS) {
+		/* a full turn or more was missed, sweep every slot once */
+		for (tick = 0; tick < TIMED_WHEEL_SLOTS; tick++)
+			move_due(tick, now - TIMED_WHEEL_SLOTS);
+		wheel_tick = now - TIMED_WHEEL_SLOTS;
+	}
+	while (wheel_tick < now) {
+		wheel_tick++;
+		move_due(wheel_tick, wheel_tick);
+	}
+}
+
+/**
+ * @brief
+ *	Is any task due at the given (future) second?
+ *
+ * @param[in]	when	- the second
+ *
+ * @return int
+ * @retval 1 a task is due then
+ * @retval 0 none
+ */
+static int
+due_at(time_t when)
+{
+	struct work_task *ptask;
+
+	for (ptask = (struct work_task *) GET_NEXT(*WHEEL_SLOT(when)); ptask;
+	     ptask = (struct work_task *) GET_NEXT(ptask->wt_linkevent)) {
+		if (ptask->wt_event <= when)
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief
+ *	Does a task match a search by the work list it is on, its wt_parm1
+ *	and its wt_func?  A task taken off its work list matches no search.
+ *
+ * @param[in]	ptask	- the task
+ * @param[in]	lists	- TASKS_* bits of the lists searched
+ * @param[in]	parm1	- wt_parm1 to match, NULL matches any
+ * @param[in]	func	- wt_func to match, NULL matches any
+ *
+ * @return int
+ * @retval 1 match
+ * @retval 0 no match
+ */
+static int
+task_matches(struct work_task *ptask, int lists, void *parm1, void *func)
+{
+	if (ptask->wt_linkevent.ll_next == &ptask->wt_linkevent)
+		return 0;
+	if ((ptask->wt_onlist & lists) == 0)
+		return 0;
+	if (parm1 && (ptask->wt_parm1 != parm1))
+		return 0;
+	if (func && ((void *) ptask->wt_func != func))
+		return 0;
+	return 1;
+}
+
 /**
  *
  * @brief
@@ -85,7 +270,9 @@ struct work_task *
 set_task(enum work_type type, long event_id, void (*func)(struct work_task *), void *parm)
 {
 	struct work_task *pnew;
-	struct work_task *pold;
+
+	if (!task_lists_ready)
+		init_task_lists();
 
 	pnew = (struct work_task *) malloc(sizeof(struct work_task));
 	if (pnew == NULL)
@@ -93,6 +280,7 @@ set_task(enum work_type type, long event_id, void (*func)(struct work_task *), v
 	CLEAR_LINK(pnew->wt_linkevent);
 	CLEAR_LINK(pnew->wt_linkobj);
 	CLEAR_LINK(pnew->wt_linkobj2);
+	CLEAR_LINK(pnew->wt_linkparm);
 	pnew->wt_event = event_id;
 	pnew->wt_event2 = NULL;
 	pnew->wt_type = type;
@@ -103,24 +291,19 @@ set_task(enum work_type type, long event_id, void (*func)(struct work_task *), v
 	pnew->wt_aux = 0;
 	pnew->wt_aux2 = 0;
 
-	if (type == WORK_Immed)
+	if (type == WORK_Immed) {
+		pnew->wt_onlist = TASKS_IMMED;
 		append_link(&task_list_immed, &pnew->wt_linkevent, pnew);
-	else if (type == WORK_Interleave)
+	} else if (type == WORK_Interleave) {
+		pnew->wt_onlist = TASKS_INTERLEAVE;
 		append_link(&task_list_interleave, &pnew->wt_linkevent, pnew);
-	else if (type == WORK_Timed) {
-		pold = (struct work_task *) GET_NEXT(task_list_timed);
-		while (pold) {
-			if (pold->wt_event > pnew->wt_event)
-				break;
-			pold = (struct work_task *) GET_NEXT(pold->wt_linkevent);
-		}
-		if (pold)
-			insert_link(&pold->wt_linkevent, &pnew->wt_linkevent, pnew,
-				    LINK_INSET_BEFORE);
-		else
-			append_link(&task_list_timed, &pnew->wt_linkevent, pnew);
-	} else
+	} else if (type == WORK_Timed)
+		link_timed(pnew);
+	else {
+		pnew->wt_onlist = TASKS_EVENT;
 		append_link(&task_list_event, &pnew->wt_linkevent, pnew);
+	}
+	append_link(&task_parm_idx[PARM_HASH(parm)], &pnew->wt_linkparm, pnew);
 	return (pnew);
 }
 
@@ -139,25 +322,23 @@ set_task(enum work_type type, long event_id, void (*func)(struct work_task *), v
 int
 convert_work_task(struct work_task *ptask, enum work_type wtype)
 {
-	pbs_list_head *list;
-
 	if (!ptask)
 		return -1;
 
+	delete_link(&ptask->wt_linkevent);
 	switch (wtype) {
 		case WORK_Immed:
-			list = &task_list_immed;
+			ptask->wt_onlist = TASKS_IMMED;
+			append_link(&task_list_immed, &ptask->wt_linkevent, ptask);
 			break;
 		case WORK_Timed:
-			list = &task_list_timed;
+			link_timed(ptask);
 			break;
 		default:
-			list = &task_list_event;
+			ptask->wt_onlist = TASKS_EVENT;
+			append_link(&task_list_event, &ptask->wt_linkevent, ptask);
 	}
 
-	delete_link(&ptask->wt_linkevent);
-	append_link(list, &ptask->wt_linkevent, ptask);
-
 	return 0;
 }
 
@@ -180,6 +361,9 @@ dispatch_task(struct work_task *ptask)
 	delete_link(&ptask->wt_linkevent);
 	delete_link(&ptask->wt_linkobj);
 	delete_link(&ptask->wt_linkobj2);
+	delete_link(&ptask->wt_linkparm);
+	if (dispatch_task_hook)
+		dispatch_task_hook();
 	if (ptask->wt_func)
 		ptask->wt_func(ptask); /* dispatch process function */
 	(void) free(ptask);
@@ -199,38 +383,43 @@ delete_task(struct work_task *ptask)
 	delete_link(&ptask->wt_linkobj);
 	delete_link(&ptask->wt_linkobj2);
 	delete_link(&ptask->wt_linkevent);
+	delete_link(&ptask->wt_linkparm);
 	(void) free(ptask);
 }
 
 /**
  * @brief
- *	Check if some task in the specified task list
+ *	Check if some task on one of the specified work lists
  *	has a wt_parm1 matching 'parm1'
  *	and wt_func matching 'func'
  *
- * @param[in]	task_list - header of task list to be searched
- * @param[in]	parm1	- parameter being matched.
- * @param[in]	func	- function being matched.
+ * @param[in]	lists	- TASKS_* bits of the work lists to be searched
+ * @param[in]	parm1	- parameter being matched. NULL to ignore this field.
+ * @param[in]	func	- function being matched. NULL to ignore this field.
  *
  * @return work task
  * @retval	!NULL if 'parm1' and 'func' was matched
  * @retval	NULL otherwise
  */
 static struct work_task *
-find_worktask_by_parm_func(pbs_list_head task_list, void *parm1, void *func)
+find_worktask_by_parm_func(int lists, void *parm1, void *func)
 {
 	struct work_task *ptask;
-	struct work_task *ptask_next;
-
-	for (ptask = GET_NEXT(task_list); ptask; ptask = ptask_next) {
-		ptask_next = GET_NEXT(ptask->wt_linkevent);
+	int first = 0;
+	int last = TASK_PARM_BUCKETS - 1;
+	int i;
 
-		if (parm1 && (ptask->wt_parm1 != parm1))
-			continue;
-		if (func && (ptask->wt_func != func))
-			continue;
+	if (!task_lists_ready)
+		return NULL;
 
-		return ptask;
+	if (parm1)
+		first = last = PARM_HASH(parm1);
+	for (i = first; i <= last; i++) {
+		for (ptask = (struct work_task *) GET_NEXT(task_parm_idx[i]); ptask;
+		     ptask = (struct work_task *) GET_NEXT(ptask->wt_linkparm)) {
+			if (task_matches(ptask, lists, parm1, func))
+				return ptask;
+		}
 	}
 
 	return NULL;
@@ -254,27 +443,18 @@ find_worktask_by_parm_func(pbs_list_head task_list, void *parm1, void *func)
 struct work_task *
 find_work_task(enum work_type wtype, void *parm1, void *func)
 {
-	struct work_task *ptask;
-
-	if (wtype == -1 || wtype == WORK_Immed) {
-		ptask = find_worktask_by_parm_func(task_list_immed, parm1, func);
-		if (ptask)
-			return ptask;
-	}
-
-	if (wtype == -1 || wtype == WORK_Timed) {
-		ptask = find_worktask_by_parm_func(task_list_timed, parm1, func);
-		if (ptask)
-			return ptask;
-	}
-
-	if (wtype == -1 || (wtype != WORK_Timed && wtype != WORK_Immed)) {
-		ptask = find_worktask_by_parm_func(task_list_event, parm1, func);
-		if (ptask)
-			return ptask;
-	}
-
-	return NULL;
+	int lists;
+
+	if (wtype == -1)
+		lists = TASKS_IMMED | TASKS_TIMED | TASKS_EVENT;
+	else if (wtype == WORK_Immed)
+		lists = TASKS_IMMED;
+	else if (wtype == WORK_Timed)
+		lists = TASKS_TIMED;
+	else
+		lists = TASKS_EVENT;
+
+	return find_worktask_by_parm_func(lists, parm1, func);
 }
 
 /**
@@ -297,19 +477,20 @@ delete_task_by_parm1_func(void *parm1, void (*func)(struct work_task *), enum wt
 {
 	struct work_task *ptask;
 	struct work_task *ptask_next;
-	pbs_list_head task_lists[] = {task_list_event, task_list_timed, task_list_immed};
+	int first = 0;
+	int last = TASK_PARM_BUCKETS - 1;
 	int i;
 
-	if (parm1 == NULL && func == NULL)
+	if ((parm1 == NULL && func == NULL) || !task_lists_ready)
 		return;
 
-	for (i = 0; i < 3; i++) {
-		for (ptask = (struct work_task *) GET_NEXT(task_lists[i]); ptask; ptask = ptask_next) {
-			ptask_next = (struct work_task *) GET_NEXT(ptask->wt_linkevent);
+	if (parm1)
+		first = last = PARM_HASH(parm1);
+	for (i = first; i <= last; i++) {
+		for (ptask = (struct work_task *) GET_NEXT(task_parm_idx[i]); ptask; ptask = ptask_next) {
+			ptask_next = (struct work_task *) GET_NEXT(ptask->wt_linkparm);
 
-			if ((parm1 != NULL) && (ptask->wt_parm1 != parm1))
-				continue;
-			if ((func != NULL) && (ptask->wt_func != func))
+			if (!task_matches(ptask, TASKS_IMMED | TASKS_TIMED | TASKS_EVENT, parm1, (void *) func))
 				continue;
 
 			delete_task(ptask);
@@ -400,6 +581,10 @@ default_next_task(void)
 		tilwhen = 0;
 	}
 
+	if (!task_lists_ready)
+		init_task_lists();
+	advance_wheel(time_now);
+
 	while ((ptask = (struct work_task *) GET_NEXT(task_list_timed)) != NULL) {
 		if ((delay = ptask->wt_event - time_now) > 0) {
 			if (tilwhen > delay)
@@ -410,5 +595,13 @@ default_next_task(void)
 		}
 	}
 
+	/* the rest are on the wheel, only the next tilwhen seconds matter */
+	for (delay = 1; delay < tilwhen; delay++) {
+		if (due_at(time_now + delay)) {
+			tilwhen = delay;
+			break;
+		}
+	}
+
 	return (tilwhen);
 }
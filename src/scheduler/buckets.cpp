@@ -42,6 +42,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <functional>
+#include <unordered_map>
 #include "data_types.h"
 #include "pbs_bitmap.h"
 #include "node_info.h"
@@ -55,6 +57,7 @@
 #include "sort.h"
 #include "node_partition.h"
 #include "check.h"
+#include "cycle_prof.h"
 #include <log.h>
 #include "pbs_internal.h"
 
@@ -75,14 +78,12 @@ new_bucket_bitpool()
 		free_bucket_bitpool(bp);
 		return NULL;
 	}
-	bp->truth_ct = 0;
 
 	bp->working = pbs_bitmap_alloc(NULL, 1);
 	if (bp->working == NULL) {
 		free_bucket_bitpool(bp);
 		return NULL;
 	}
-	bp->working_ct = 0;
 
 	return bp;
 }
@@ -112,13 +113,11 @@ dup_bucket_bitpool(bucket_bitpool *obp)
 		free_bucket_bitpool(nbp);
 		return NULL;
 	}
-	nbp->truth_ct = obp->truth_ct;
 
 	if (pbs_bitmap_assign(nbp->working, obp->working) == 0) {
 		free_bucket_bitpool(nbp);
 		return NULL;
 	}
-	nbp->working_ct = obp->working_ct;
 
 	return nbp;
 }
@@ -344,6 +343,56 @@ find_node_bucket_ind(node_bucket **buckets, schd_resource *rl, queue_info *qinfo
 	return -1;
 }
 
+/**
+ * @brief hash a node's resources, queue, and priority into a bucket key
+ *
+ * @par
+ *	Nodes which would land in the same bucket have the same key.  Unset
+ *	booleans are false, so only true booleans are hashed.  The terms of
+ *	each resource are added up so the order of the resource list and of
+ *	string array values doesn't matter.
+ *
+ * @param[in] policy - policy info
+ * @param[in] rl - the resource list of the node
+ * @param[in] qinfo - the queue of the node
+ * @param[in] priority - the priority of the node
+ *
+ * @return size_t
+ * @retval bucket key of the node
+ */
+static size_t
+node_bucket_key(status *policy, schd_resource *rl, queue_info *qinfo, int priority)
+{
+	std::hash<std::string> str_hash;
+	size_t key;
+	schd_resource *res;
+
+	key = std::hash<queue_info *>()(qinfo) * 31 + std::hash<int>()(priority);
+
+	for (res = rl; res != NULL; res = res->next) {
+		size_t val = 0;
+
+		if (res->type.is_boolean) {
+			if (res->avail == 0)
+				continue;
+		} else if (policy->resdef_to_check_no_hostvnode.find(res->def) == policy->resdef_to_check_no_hostvnode.end())
+			continue;
+
+		if (res->def->type.is_string) {
+			int i;
+
+			if (res->str_avail != NULL)
+				for (i = 0; res->str_avail[i] != NULL; i++)
+					val += str_hash(res->str_avail[i]);
+		} else
+			val = std::hash<sch_resource_t>()(res->avail);
+
+		key += (std::hash<resdef *>()(res->def) ^ val) * 0x9e3779b97f4a7c15ULL;
+	}
+
+	return key;
+}
+
 /**
  * @brief create a name for a node bucket based on resource names, priority, and queue
  *
@@ -413,6 +462,7 @@ create_node_buckets(status *policy, node_info **nodes, std::vector<queue_info *>
 	node_bucket **buckets = NULL;
 	node_bucket **tmp;
 	int node_ct;
+	std::unordered_map<size_t, int> bkt_by_key;
 
 	if (policy == NULL || nodes == NULL || queues.empty())
 		return NULL;
@@ -427,7 +477,8 @@ create_node_buckets(status *policy, node_info **nodes, std::vector<queue_info *>
 
 	for (i = 0; i < node_ct; i++) {
 		node_bucket *nb = NULL;
-		int bkt_ind;
+		int bkt_ind = -1;
+		size_t key;
 		queue_info *qinfo = NULL;
 		int node_ind = nodes[i]->node_ind;
 
@@ -437,7 +488,19 @@ create_node_buckets(status *policy, node_info **nodes, std::vector<queue_info *>
 		if (!nodes[i]->queue_name.empty())
 			qinfo = find_queue_info(queues, nodes[i]->queue_name);
 
-		bkt_ind = find_node_bucket_ind(buckets, nodes[i]->res, qinfo, nodes[i]->priority);
+		/* Nodes with the same key as an earlier node go in its bucket.
+		 * The bucket is still checked to guard against hash collisions.
+		 */
+		key = node_bucket_key(policy, nodes[i]->res, qinfo, nodes[i]->priority);
+		auto kb = bkt_by_key.find(key);
+		if (kb != bkt_by_key.end()) {
+			node_bucket *kbkt = buckets[kb->second];
+			if (kbkt->queue == qinfo && kbkt->priority == nodes[i]->priority &&
+			    compare_resource_avail_list(kbkt->res_spec, nodes[i]->res))
+				bkt_ind = kb->second;
+		}
+		if (bkt_ind == -1)
+			bkt_ind = find_node_bucket_ind(buckets, nodes[i]->res, qinfo, nodes[i]->priority);
 		if (flags & UPDATE_BUCKET_IND) {
 			if (bkt_ind == -1)
 				nodes[i]->bucket_ind = j;
@@ -473,10 +536,6 @@ create_node_buckets(status *policy, node_info **nodes, std::vector<queue_info *>
 				if (cur_res->type.is_consumable)
 					cur_res->assigned = 0;
 
-			buckets[j]->busy_later_pool->truth_ct = 0;
-			buckets[j]->free_pool->truth_ct = 0;
-			buckets[j]->busy_pool->truth_ct = 0;
-
 			buckets[j]->total = 0;
 
 			buckets[j]->name = create_node_bucket_name(policy, buckets[j]);
@@ -488,21 +547,20 @@ create_node_buckets(status *policy, node_info **nodes, std::vector<queue_info *>
 				log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_NODE, LOG_DEBUG, __func__, "Created node bucket %s", buckets[j]->name);
 
 			nb = buckets[j];
+			bkt_ind = j;
 			j++;
 		}
+		bkt_by_key[key] = bkt_ind;
 		pbs_bitmap_bit_on(nb->bkt_nodes, node_ind);
 		nb->total++;
 		if (nodes[i]->is_free && nodes[i]->num_jobs == 0 && nodes[i]->num_run_resv == 0) {
 			if (nodes[i]->node_events != NULL) {
 				pbs_bitmap_bit_on(nb->busy_later_pool->truth, node_ind);
-				nb->busy_later_pool->truth_ct++;
 			} else {
 				pbs_bitmap_bit_on(nb->free_pool->truth, node_ind);
-				nb->free_pool->truth_ct++;
 			}
 		} else {
 			pbs_bitmap_bit_on(nb->busy_pool->truth, node_ind);
-			nb->busy_pool->truth_ct++;
 		}
 	}
 
@@ -594,7 +652,7 @@ log_chunk_map_array(resource_resv *resresv, chunk_map **cmap)
 		for (j = 0; cmap[i]->bkt_cnts[j] != NULL; j++) {
 			int chunk_count;
 			node_bucket_count *nbc = cmap[i]->bkt_cnts[j];
-			chunk_count = (nbc->bkt->free_pool->truth_ct + nbc->bkt->busy_later_pool->truth_ct) * nbc->chunk_count;
+			chunk_count = (pbs_bitmap_count(nbc->bkt->free_pool->truth) + pbs_bitmap_count(nbc->bkt->busy_later_pool->truth)) * nbc->chunk_count;
 			log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_JOB, LOG_DEBUG, resresv->name, "Bucket %s can fit %d chunks", nbc->bkt->name, chunk_count);
 			total_chunks += chunk_count;
 		}
@@ -617,13 +675,8 @@ set_working_bucket_to_truth(node_bucket *nb)
 		return;
 
 	pbs_bitmap_assign(nb->busy_pool->working, nb->busy_pool->truth);
-	nb->busy_pool->working_ct = nb->busy_pool->truth_ct;
-
 	pbs_bitmap_assign(nb->busy_later_pool->working, nb->busy_later_pool->truth);
-	nb->busy_later_pool->working_ct = nb->busy_later_pool->truth_ct;
-
 	pbs_bitmap_assign(nb->free_pool->working, nb->free_pool->truth);
-	nb->free_pool->working_ct = nb->free_pool->truth_ct;
 }
 
 /**
@@ -641,15 +694,15 @@ bucket_match(chunk_map **cmap, resource_resv *resresv, schd_error *err)
 	int i;
 	int j;
 	int k;
-	static pbs_bitmap *zeromap = NULL;
+	static pbs_bitmap *picked = NULL;
 	server_info *sinfo;
 
 	if (cmap == NULL || resresv == NULL || resresv->select == NULL)
 		return 0;
 
-	if (zeromap == NULL) {
-		zeromap = pbs_bitmap_alloc(NULL, 1);
-		if (zeromap == NULL)
+	if (picked == NULL) {
+		picked = pbs_bitmap_alloc(NULL, 1);
+		if (picked == NULL)
 			return 0;
 	}
 
@@ -657,10 +710,9 @@ bucket_match(chunk_map **cmap, resource_resv *resresv, schd_error *err)
 
 	for (i = 0; cmap[i] != NULL; i++) {
 		if (cmap[i]->bkt_cnts != NULL) {
-			for (j = 0; cmap[i]->bkt_cnts[j] != NULL; j++) {
+			for (j = 0; cmap[i]->bkt_cnts[j] != NULL; j++)
 				set_working_bucket_to_truth(cmap[i]->bkt_cnts[j]->bkt);
-				pbs_bitmap_assign(cmap[i]->node_bits, zeromap);
-			}
+			pbs_bitmap_clear_range(cmap[i]->node_bits, 0, cmap[i]->node_bits->num_bits);
 		}
 	}
 
@@ -670,10 +722,29 @@ bucket_match(chunk_map **cmap, resource_resv *resresv, schd_error *err)
 		if (cmap[i]->bkt_cnts == NULL)
 			break;
 
+		/* Chunks can only be placed on nodes in the free and busy later pools.
+		 * If there aren't enough of them, don't bother walking the nodes.
+		 * With an aoe the walk can set err, so it is always done.
+		 */
+		if (resresv->aoename == NULL) {
+			long can_fit = 0;
+
+			for (j = 0; cmap[i]->bkt_cnts[j] != NULL; j++) {
+				node_bucket *bkt = cmap[i]->bkt_cnts[j]->bkt;
+				can_fit += (pbs_bitmap_count(bkt->free_pool->working) +
+					    pbs_bitmap_count(bkt->busy_later_pool->working)) *
+					   cmap[i]->bkt_cnts[j]->chunk_count;
+			}
+			if (can_fit < num_chunks_needed)
+				return 0;
+		}
+
 		for (j = 0; cmap[i]->bkt_cnts[j] != NULL && num_chunks_needed > 0; j++) {
 			node_bucket *bkt = cmap[i]->bkt_cnts[j]->bkt;
 			int chunks_added = 0;
 
+			pbs_bitmap_clear_range(picked, 0, picked->num_bits);
+
 			for (k = pbs_bitmap_first_on_bit(bkt->busy_later_pool->working);
 			     num_chunks_needed > chunks_added && k >= 0;
 			     k = pbs_bitmap_next_on_bit(bkt->busy_later_pool->working, k)) {
@@ -686,11 +757,7 @@ bucket_match(chunk_map **cmap, resource_resv *resresv, schd_error *err)
 						}
 				}
 				if (node_can_fit_job_time(k, resresv)) {
-					pbs_bitmap_bit_off(bkt->busy_later_pool->working, k);
-					bkt->busy_later_pool->working_ct--;
-					pbs_bitmap_bit_on(bkt->busy_pool->working, k);
-					bkt->busy_pool->working_ct++;
-					pbs_bitmap_bit_on(cmap[i]->node_bits, k);
+					pbs_bitmap_bit_on(picked, k);
 					chunks_added += cmap[i]->bkt_cnts[j]->chunk_count;
 				}
 			}
@@ -706,16 +773,18 @@ bucket_match(chunk_map **cmap, resource_resv *resresv, schd_error *err)
 							continue;
 						}
 				}
-				pbs_bitmap_bit_off(bkt->free_pool->working, k);
-				bkt->free_pool->working_ct--;
-				pbs_bitmap_bit_on(bkt->busy_pool->working, k);
-				bkt->busy_pool->working_ct++;
-				pbs_bitmap_bit_on(cmap[i]->node_bits, k);
+				pbs_bitmap_bit_on(picked, k);
 				chunks_added += cmap[i]->bkt_cnts[j]->chunk_count;
 			}
 
-			if (chunks_added > 0)
+			if (chunks_added > 0) {
+				/* The picked nodes are now busy and allocated to the chunk */
+				pbs_bitmap_andnot(bkt->busy_later_pool->working, picked);
+				pbs_bitmap_andnot(bkt->free_pool->working, picked);
+				pbs_bitmap_or(bkt->busy_pool->working, picked);
+				pbs_bitmap_or(cmap[i]->node_bits, picked);
 				num_chunks_needed -= chunks_added;
+			}
 		}
 		/* Couldn't find buckets to satisfy all the chunks */
 		if (num_chunks_needed > 0)
@@ -1060,6 +1129,7 @@ find_correct_buckets(status *policy, node_bucket **buckets, resource_resv *resre
 std::vector<nspec *>
 check_node_buckets(status *policy, server_info *sinfo, queue_info *qinfo, resource_resv *resresv, schd_error *err)
 {
+	prof_timer timer(PROF_BUCKET_MATCH);
 	node_partition **nodepart = NULL;
 
 	if (policy == NULL || sinfo == NULL || resresv == NULL || err == NULL)
@@ -100,6 +100,7 @@
 #include "resource.h"
 #include "buckets.h"
 #include "pbs_bitmap.h"
+#include "cycle_prof.h"
 
 /**
  *
@@ -690,6 +691,7 @@ std::vector<nspec *>
 is_ok_to_run(status *policy, server_info *sinfo,
 	     queue_info *qinfo, resource_resv *resresv, unsigned int flags, schd_error *perr)
 {
+	prof_timer timer(PROF_IS_OK_TO_RUN);
 	enum sched_error_code rc = SE_NONE; /* Return Code */
 	schd_resource *res = NULL;	    /* resource list to check */
 	int endtime = 0;		    /* end time of job if started now */
@@ -1939,7 +1941,7 @@ get_resresv_spec(resource_resv *resresv, selspec **spec, place **pl)
 	static place place_spec;
 	if (resresv->is_job && resresv->job != NULL) {
 		if (resresv->execselect != NULL) {
-			*spec = resresv->execselect;
+			*spec = resresv->execselect.get();
 			place_spec = *resresv->place_spec;
 
 			/* Placement was handled the first time.  Don't let it get in the way */
@@ -1947,8 +1949,8 @@ get_resresv_spec(resource_resv *resresv, selspec **spec, place **pl)
 			place_spec.free = 1;
 			*pl = &place_spec;
 		} else {
-			*pl = resresv->place_spec;
-			*spec = resresv->select;
+			*pl = resresv->place_spec.get();
+			*spec = resresv->select.get();
 		}
 	} else if (resresv->is_resv && resresv->resv != NULL) {
 		/* The execselect should be used when the resv is running.  We can't
@@ -1957,9 +1959,9 @@ get_resresv_spec(resource_resv *resresv, selspec **spec, place **pl)
 		 */
 		if (resresv->resv->is_running)
 
-			*spec = resresv->execselect;
+			*spec = resresv->execselect.get();
 		else
-			*spec = resresv->select;
+			*spec = resresv->select.get();
 		place_spec = *resresv->place_spec;
 		*pl = &place_spec;
 	}
@@ -94,6 +94,16 @@
  */
 #define SHRINK_MAX_RETRY 5
 
+/* fewest future end events for which calc_run_time() bounds a job's
+ * start time before it searches for it
+ */
+#define SIM_BOUND_MIN_EVENTS 64
+
+/* most cycles an equivalence class's can-not-run verdict is carried over
+ * before it is derived again
+ */
+#define EC_VERDICT_MAX_CYCLES 10
+
 /* parsing -
  * names that appear on the left hand side in the sched config file
  */
@@ -162,6 +172,10 @@
 #define PARSE_UPDATE_COMMENTS "update_comments"
 #define PARSE_RESV_CONFIRM_IGNORE "resv_confirm_ignore"
 #define PARSE_ALLOW_AOE_CALENDAR "allow_aoe_calendar"
+#define PARSE_STATE_FEED_RESYNC "state_feed_resync"
+#define PARSE_RUNJOB_PIPELINE_DEPTH "runjob_pipeline_depth"
+#define PARSE_CYCLE_PROFILE "cycle_profile"
+#define PARSE_CAPTURE_FILE "capture_file"
 
 /* deprecated */
 #define PARSE_STRICT_FIFO "strict_fifo"
@@ -169,7 +169,10 @@ enum thread_task_type {
 	TS_FREE_ND_INFO,
 	TS_DUP_RESRESV,
 	TS_QUERY_JOB_INFO,
-	TS_FREE_RESRESV
+	TS_FREE_RESRESV,
+	TS_EVAL_FORMULA,
+	TS_SORT_KEYS,
+	TS_START_TIME_BOUND
 };
 
 /* return codes for is_ok_to_run_* functions
@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file    cycle_prof.cpp
+ *
+ * @brief
+ * 		cycle_prof.cpp - per-phase timing of a scheduling cycle
+ *
+ *	The phases of a cycle are timed by prof_timer objects placed at the top
+ *	of the functions which implement them.  Every thread keeps its own
+ *	counters, keyed by the call path of nested timers.  At the end of the
+ *	cycle the counters of all threads are summed into a report giving, for
+ *	each phase, the number of calls, the total time and the self time (the
+ *	total less the time spent in nested phases).  The self time of each
+ *	call path is reported in the folded stack format used by flame graph
+ *	tools ("calendar;is_ok_to_run;bucket_match").
+ *
+ *	The report is logged and appended as one JSON line to cycle_prof.json
+ *	in sched_priv.  So it can be read with pbs_statsched or qmgr, it is
+ *	also set in the scheduler's last_cycle_profile attribute, at most once
+ *	every PROF_PUBLISH_INTERVAL seconds to spare the server a manager
+ *	request every cycle.
+ *
+ * Functions included are:
+ * 	prof_timer::start()
+ * 	prof_timer::stop()
+ * 	cycle_prof_begin()
+ * 	cycle_prof_end()
+ * 	cycle_prof_reset()
+ *
+ */
+#include <pbs_config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <pbs_ifl.h>
+#include <log.h>
+#include "cycle_prof.h"
+#include "constant.h"
+#include "data_types.h"
+#include "globals.h"
+#include "replay.h"
+
+#define PROF_FILE "cycle_prof.json"
+#define PROF_FILE_OLD "cycle_prof.json.1"
+#define PROF_FILE_MAX (10 * 1024 * 1024) /* rotate the file past 10MB */
+#define PROF_PUBLISH_INTERVAL 60	 /* seconds between last_cycle_profile updates */
+
+/* call paths are stored as numbers, one digit of this base per level */
+#define PROF_PATH_BASE (PROF_NUM_PHASES + 1)
+#define PROF_PATH_MAX (ULLONG_MAX / PROF_PATH_BASE)
+
+static const char *prof_phase_names[PROF_NUM_PHASES] = {
+	"query_server",
+	"sort_jobs",
+	"create_placement_sets",
+	"bucket_match",
+	"is_ok_to_run",
+	"calendar",
+	"run_job"};
+
+/* self time and calls of one call path */
+struct prof_path_stat {
+	double self;
+	long calls;
+};
+
+/* counters of one thread */
+struct prof_thread_data {
+	unsigned long long path = 0;	   /* call path of the running timer */
+	double child = 0;		   /* time spent in timers nested in it */
+	int depth[PROF_NUM_PHASES] = {};   /* running timers of each phase */
+	double total[PROF_NUM_PHASES] = {}; /* time of the outermost calls */
+	std::unordered_map<unsigned long long, prof_path_stat> paths;
+};
+
+bool cycle_prof_enabled = false;
+
+static std::mutex prof_threads_lock;
+static std::vector<prof_thread_data *> prof_threads;
+static thread_local prof_thread_data *prof_td = NULL;
+static struct timespec prof_cycle_begin;
+static time_t prof_published; /* when last_cycle_profile was last set */
+
+/**
+ * @brief	return the seconds between two timespecs
+ */
+static inline double
+prof_elapsed(const struct timespec &from, const struct timespec &to)
+{
+	return (to.tv_sec - from.tv_sec) + (to.tv_nsec - from.tv_nsec) / 1e9;
+}
+
+/**
+ * @brief	return the counters of the calling thread, creating them on
+ *		the thread's first timer
+ */
+static prof_thread_data *
+prof_thread(void)
+{
+	if (prof_td == NULL) {
+		prof_td = new prof_thread_data();
+		std::lock_guard<std::mutex> lock(prof_threads_lock);
+		prof_threads.push_back(prof_td);
+	}
+	return prof_td;
+}
+
+/**
+ * @brief	start timing a call of a phase
+ *
+ * @param[in]	ph	-	the phase
+ */
+void
+prof_timer::start(prof_phase ph)
+{
+	prof_thread_data *td = prof_thread();
+
+	running = true;
+	phase = ph;
+	parent_path = td->path;
+	parent_child = td->child;
+	/* past the maximum depth, charge the time to the enclosing path */
+	if (td->path < PROF_PATH_MAX)
+		td->path = td->path * PROF_PATH_BASE + ph + 1;
+	td->child = 0;
+	td->depth[ph]++;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+}
+
+/**
+ * @brief	stop timing and charge the call to its phase and call path
+ */
+void
+prof_timer::stop()
+{
+	struct timespec end;
+	prof_thread_data *td = prof_td;
+	double elapsed;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = prof_elapsed(begin, end);
+
+	/* recursive calls are already counted in the outermost one */
+	if (--td->depth[phase] == 0)
+		td->total[phase] += elapsed;
+
+	prof_path_stat &ps = td->paths[td->path];
+	ps.self += elapsed - td->child;
+	ps.calls++;
+
+	td->path = parent_path;
+	td->child = parent_child + elapsed;
+}
+
+/**
+ * @brief	reset the counters of all threads at the start of a cycle
+ *
+ * @note	worker threads are idle between cycles, so their counters
+ *		can be cleared from the main thread
+ */
+void
+cycle_prof_begin(void)
+{
+	cycle_prof_enabled = conf.cycle_profile;
+	if (!cycle_prof_enabled)
+		return;
+
+	std::lock_guard<std::mutex> lock(prof_threads_lock);
+	for (auto td : prof_threads) {
+		td->path = 0;
+		td->child = 0;
+		for (int i = 0; i < PROF_NUM_PHASES; i++) {
+			td->depth[i] = 0;
+			td->total[i] = 0;
+		}
+		td->paths.clear();
+	}
+	clock_gettime(CLOCK_MONOTONIC, &prof_cycle_begin);
+}
+
+/**
+ * @brief	convert a call path into its folded stack name
+ *
+ * @param[in]	path	-	the call path
+ * @param[out]	leaf	-	the innermost phase of the path
+ *
+ * @return	std::string
+ */
+static std::string
+prof_path_name(unsigned long long path, int *leaf)
+{
+	std::vector<int> phases;
+	std::string name;
+
+	for (; path != 0; path /= PROF_PATH_BASE)
+		phases.push_back(path % PROF_PATH_BASE - 1);
+	*leaf = phases.front();
+	for (auto it = phases.rbegin(); it != phases.rend(); ++it) {
+		if (!name.empty())
+			name += ';';
+		name += prof_phase_names[*it];
+	}
+	return name;
+}
+
+/**
+ * @brief	append one report line to cycle_prof.json, first moving the
+ *		file aside if it has grown past PROF_FILE_MAX
+ *
+ * @param[in]	line	-	the JSON report
+ */
+static void
+prof_write_file(const std::string &line)
+{
+	struct stat sb;
+	FILE *fp;
+
+	if (stat(PROF_FILE, &sb) == 0 && sb.st_size >= PROF_FILE_MAX)
+		rename(PROF_FILE, PROF_FILE_OLD);
+
+	if ((fp = fopen(PROF_FILE, "a")) == NULL) {
+		log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_WARNING, __func__,
+			   "Can not open %s", PROF_FILE);
+		return;
+	}
+	fprintf(fp, "%s\n", line.c_str());
+	fclose(fp);
+}
+
+/**
+ * @brief	set the next cycle's profile in last_cycle_profile without
+ *		waiting for PROF_PUBLISH_INTERVAL to pass.  Called when the
+ *		configuration is read.
+ */
+void
+cycle_prof_reset(void)
+{
+	prof_published = 0;
+}
+
+/**
+ * @brief	report the profile of the cycle which just ended
+ *
+ *	The report is logged and appended to cycle_prof.json.  It is set in
+ *	the scheduler's last_cycle_profile attribute if PROF_PUBLISH_INTERVAL
+ *	seconds have passed since it was last set.
+ *
+ * @param[in]	pbs_sd	-	connection descriptor to the server
+ */
+void
+cycle_prof_end(int pbs_sd)
+{
+	struct timespec end;
+	double total[PROF_NUM_PHASES] = {};
+	double self[PROF_NUM_PHASES] = {};
+	long calls[PROF_NUM_PHASES] = {};
+	std::map<std::string, double> stacks;
+	std::string phases;
+	std::string report;
+	std::string value;
+	std::string log_msg;
+	char buf[256];
+	struct attropl attr;
+	time_t now;
+
+	if (!cycle_prof_enabled)
+		return;
+	cycle_prof_enabled = false;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	{
+		std::lock_guard<std::mutex> lock(prof_threads_lock);
+		for (auto td : prof_threads) {
+			for (int i = 0; i < PROF_NUM_PHASES; i++)
+				total[i] += td->total[i];
+			for (const auto &p : td->paths) {
+				int leaf;
+				std::string name = prof_path_name(p.first, &leaf);
+
+				self[leaf] += p.second.self;
+				calls[leaf] += p.second.calls;
+				stacks[name] += p.second.self;
+			}
+		}
+	}
+
+	for (int i = 0; i < PROF_NUM_PHASES; i++) {
+		snprintf(buf, sizeof(buf), "%s\"%s\":{\"calls\":%ld,\"total\":%.6f,\"self\":%.6f}",
+			 i == 0 ? "" : ",", prof_phase_names[i], calls[i], total[i], self[i]);
+		phases += buf;
+		snprintf(buf, sizeof(buf), " %s=%.3fs/%ld", prof_phase_names[i], total[i], calls[i]);
+		log_msg += buf;
+	}
+	now = time(NULL);
+	snprintf(buf, sizeof(buf), "{\"time\":%ld,\"cycle\":%.6f,\"phases\":{",
+		 static_cast<long>(now), prof_elapsed(prof_cycle_begin, end));
+	report = buf + phases + "}";
+
+	log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+		   "Cycle profile: cycle=%.3fs%s", prof_elapsed(prof_cycle_begin, end), log_msg.c_str());
+
+	/* the attribute gets the per phase summary, the file the stacks too */
+	value = report + "}";
+	report += ",\"stacks\":{";
+	for (auto it = stacks.begin(); it != stacks.end(); ++it) {
+		if (it != stacks.begin())
+			report += ',';
+		snprintf(buf, sizeof(buf), "%.6f", it->second);
+		report += "\"" + it->first + "\":" + buf;
+	}
+	report += "}}";
+	prof_write_file(report);
+
+	if (pbs_sd != SIMULATE_SD && !got_sigpipe && !replay_active() &&
+	    (prof_published == 0 || now - prof_published >= PROF_PUBLISH_INTERVAL)) {
+		prof_published = now;
+		attr.name = const_cast<char *>(ATTR_last_cycle_profile);
+		attr.resource = NULL;
+		attr.value = const_cast<char *>(value.c_str());
+		attr.op = SET;
+		attr.next = NULL;
+		if (pbs_manager(pbs_sd, MGR_CMD_SET, MGR_OBJ_SCHED, const_cast<char *>(sc_name), &attr, NULL) != 0)
+			log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_WARNING, __func__,
+				   "Failed to set %s at the server", ATTR_last_cycle_profile);
+	}
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+#ifndef _CYCLE_PROF_H
+#define _CYCLE_PROF_H
+
+#include <time.h>
+
+/* phases of a scheduling cycle timed by the cycle profiler */
+enum prof_phase {
+	PROF_QUERY_SERVER,
+	PROF_SORT_JOBS,
+	PROF_PLACEMENT_SETS,
+	PROF_BUCKET_MATCH,
+	PROF_IS_OK_TO_RUN,
+	PROF_CALENDAR,
+	PROF_RUN_JOB,
+	PROF_NUM_PHASES
+};
+
+/* set for the cycle when the cycle_profile sched_config option is on */
+extern bool cycle_prof_enabled;
+
+/*
+ * prof_timer - time the enclosing scope as one call of a phase
+ *
+ *	Timers nest.  The time spent in an inner timer is charged to the inner
+ *	phase and taken off the self time of the outer one.  Counters are kept
+ *	per thread, so timers are safe in worker threads.
+ */
+class prof_timer
+{
+public:
+	explicit prof_timer(prof_phase phase)
+	{
+		if (cycle_prof_enabled)
+			start(phase);
+		else
+			running = false;
+	}
+	~prof_timer()
+	{
+		if (running)
+			stop();
+	}
+	prof_timer(const prof_timer &) = delete;
+	prof_timer &operator=(const prof_timer &) = delete;
+
+private:
+	void start(prof_phase phase);
+	void stop();
+
+	bool running;
+	prof_phase phase;
+	struct timespec begin;
+	unsigned long long parent_path; /* call path of the enclosing timer */
+	double parent_child;		/* child time of the enclosing timer */
+};
+
+/*
+ *	cycle_prof_begin - reset the counters at the start of a cycle
+ */
+void cycle_prof_begin(void);
+
+/*
+ *	cycle_prof_end - report the cycle's profile to the log, the
+ *			 cycle_prof.json file and the scheduler object
+ */
+void cycle_prof_end(int pbs_sd);
+
+/*
+ *	cycle_prof_reset - set the next profile in last_cycle_profile
+ *			   without waiting for the publish interval
+ */
+void cycle_prof_reset(void);
+
+#endif /* _CYCLE_PROF_H */
@@ -53,6 +53,8 @@
 #ifndef	_DATA_TYPES_H
 #define	_DATA_TYPES_H
 
+#include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -128,7 +130,6 @@ typedef struct bucket_bitpool bucket_bitpool;
 typedef struct chunk_map chunk_map;
 typedef struct node_bucket_count node_bucket_count;
 typedef struct preempt_job_st preempt_job_st;
-typedef struct th_task_info th_task_info;
 typedef struct th_data_nd_eligible th_data_nd_eligible;
 typedef struct th_data_dup_nd_info th_data_dup_nd_info;
 typedef struct th_data_query_ninfo th_data_query_ninfo;
@@ -167,13 +168,6 @@ typedef sch_resource_t usage_t;
 typedef void event_ptr_t;
 typedef int (*event_func_t)(event_ptr_t*, void *);
 
-struct th_task_info
-{
-	int task_id;							/* task id, should be set by main thread */
-	enum thread_task_type task_type;		/* task type */
-	void *thread_data;					/* data for the worker thread to execute the task */
-};
-
 struct th_data_nd_eligible
 {
 	resource_resv *resresv;
@@ -802,9 +796,12 @@ class resource_resv
 	time_t min_duration;		/* minimum duration of STF job */
 
 	resource_req *resreq;		/* list of resources requested */
-	selspec *select;		/* select spec */
-	selspec *execselect;		/* select spec from exec_vnode and resv_nodes */
-	place *place_spec;		/* placement spec */
+	/* The specs are not changed once queried and are shared between
+	 * a resource_resv and its copies in duplicated server_info's
+	 */
+	std::shared_ptr<selspec> select;	/* select spec */
+	std::shared_ptr<selspec> execselect;	/* select spec from exec_vnode and resv_nodes */
+	std::shared_ptr<place> place_spec;	/* placement spec */
 
 	server_info *server;		/* pointer to server which owns res resv */
 	node_info **ninfo_arr; 		/* nodes belonging to res resv */
@@ -864,6 +861,10 @@ struct schd_resource
 	resdef *def;			/* resource definition */
 
 	struct schd_resource *next;	/* next resource in list */
+
+	/* only set on the head of an indexed list, @see index_resource_list() */
+	struct schd_resource **index;	/* resources of the list by resdef id */
+	int index_len;			/* number of entries in index */
 };
 
 struct resource_req
@@ -883,7 +884,8 @@ class resdef
 	const std::string name;	/* name of resource */
 	resource_type type;	/* resource type */
 	unsigned int flags;	/* resource flags (see pbs_ifl.h) */
-	resdef(char *rname, unsigned int rflags, resource_type rtype) : name(rname), type(rtype), flags(rflags) {}
+	int id;			/* dense index of the resource, set in update_resource_defs() */
+	resdef(char *rname, unsigned int rflags, resource_type rtype) : name(rname), type(rtype), flags(rflags), id(-1) {}
 };
 
 class prev_job_info
@@ -929,6 +931,7 @@ class fairshare_head
 	public:
 	group_info *root;			/* root of fairshare tree */
 	time_t last_decay;			/* last time tree was decayed */
+	std::unordered_map<std::string, group_info *> gindex;	/* entity name to node in the tree */
 	fairshare_head();
 	fairshare_head(fairshare_head&);
 	fairshare_head& operator=(fairshare_head&);
@@ -973,6 +976,8 @@ class group_info
 struct resresv_set
 {
 	bool can_not_run:1;		/* set can not run */
+	bool carry:1;			/* can_not_run holds next cycle if the universe doesn't change */
+	int carried;			/* number of cycles can_not_run was carried over */
 	schd_error *err;		/* reason why set can not run*/
 	char *user;			/* user of set, can be NULL */
 	char *group;			/* group of set, can be NULL */
@@ -987,6 +992,7 @@ struct node_partition
 {
 	bool ok_break:1;	/* OK to break up chunks on this node part */
 	bool excl:1;		/* partition should be allocated exclusively */
+	bool stale:1;		/* a node changed since the metadata was last computed */
 	char *name;		/* res_name=res_val */
 	/* name of resource and value which define the node partition */
 	resdef *def;
@@ -1127,6 +1133,9 @@ class nspec
 	 */
 	nspec(const nspec&) = delete;
 	nspec &operator=(const nspec &) = delete;
+	/* nspecs come from an obj_pool, there are several per job per cycle */
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr);
 };
 
 struct nameval
@@ -1166,6 +1175,7 @@ struct config
 	bool node_sort_unused:1;	/* node sorting by unused/assigned is used */
 	bool resv_conf_ignore:1;	/* if we want to ignore dedicated time when confirming reservations.  Move to enum if ever expanded */
 	bool allow_aoe_calendar:1;	/* allow jobs requesting aoe in calendar*/
+	bool cycle_profile:1;		/* time the phases of each cycle */
 #ifdef NAS /* localmod 034 */
 	bool prime_sto:1;	/* shares_track_only--no enforce shares */
 	bool non_prime_sto:1;
@@ -1188,12 +1198,15 @@ struct config
 	int unknown_shares;			/* unknown group shares */
 	int max_preempt_attempts;		/* max num of preempt attempts per cyc*/
 	int max_jobs_to_check;			/* max number of jobs to check in cyc*/
+	int state_feed_resync;			/* cycles between full server queries */
+	int runjob_pipeline_depth;		/* max unacknowledged runjob requests */
 	std::string ded_prefix;			/* prefix to dedicated queues */
 	std::string pt_prefix;			/* prefix to primetime queues */
 	std::string npt_prefix;			/* prefix to non primetime queues */
 	std::string fairshare_res;		/* resource to calc fairshare usage */
 	float fairshare_decay_factor;		/* decay factor used when decaying fairshare tree */
 	std::string fairshare_ent;			/* job attribute to use as fs entity */
+	std::string capture_file;		/* file to capture each cycle to */
 	std::unordered_set<std::string> res_to_check;		/* the resources schedule on */
 	std::unordered_set<resdef *> resdef_to_check;		/* the res to schedule on in def form */
 	std::unordered_set<std::string> ignore_res;		/* resources - unset implies infinite */
@@ -1232,6 +1245,9 @@ struct event_list
 	timed_event *next_event;	/* the next event to be performed */
 	timed_event *first_run_event;	/* The first run event in the calendar */
 	time_t *current_time;		/* [reference] current time in the calendar */
+	/* indexes into events, kept up to date by add_event() and delete_event() */
+	std::map<time_t, std::pair<timed_event *, timed_event *>> by_time; /* first and last event at each time */
+	std::unordered_multimap<std::string, timed_event *> by_name;
 };
 
 struct timed_event
@@ -1254,9 +1270,7 @@ struct te_list {
 
 struct bucket_bitpool {
 	pbs_bitmap *truth;		/* The actual bits.  This only changes if the bitmaps are changing */
-	int truth_ct;			/* number of 1 bits in truth bitmap*/
 	pbs_bitmap *working;		/* Used for short lived operations.  Usually truth is copied into working. */
-	int working_ct;			/* number of 1 bits in working bitmap */
 };
 
 struct node_bucket {
@@ -1287,6 +1301,15 @@ struct resresv_filter {
 	schd_error *err;		/* reason why set can not run*/
 };
 
+/* what find_jobs_to_preempt() learns about the high priority job while
+ * it selects preemption candidates.  None of it changes as it simulates
+ * preempting jobs.
+ */
+struct preempt_cand_cache {
+	std::vector<signed char> node_fits;	/* by node_ind: -1 unknown, 1 if a chunk of the job fits on the node */
+	std::unordered_set<int> failed;		/* ranks of jobs which previously failed to be preempted */
+};
+
 class sched_exception: public std::exception
 {
 	public:
@@ -58,6 +58,7 @@
  * 	decay_fairshare_tree()
  * 	compare_path()
  * 	print_fairshare()
+ * 	index_group_info()
  * 	write_usage()
  * 	rec_write_usage()
  * 	read_usage()
@@ -75,6 +76,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <math.h>
+#include <unistd.h>
 
 #include <log.h>
 
@@ -123,44 +126,83 @@ add_child(group_info *ginfo, group_info *parent)
  * 		add a ginfo to the "unknown" group
  *
  * @param[in]	ginfo	-	ginfo to add
- * @param[in]	root	-	root of fairshare tree
+ * @param[in]	fhead	-	fairshare tree
  *
  * @return	nothing
  *
  */
 void
-add_unknown(group_info *ginfo, group_info *root)
+add_unknown(group_info *ginfo, fairshare_head *fhead)
 {
 	group_info *unknown; /* ptr to the "unknown" group */
 
-	unknown = find_group_info("unknown", root);
+	unknown = find_group_info(UNKNOWN_GROUP_NAME, fhead);
 	add_child(ginfo, unknown);
+	index_group_info(ginfo, fhead);
 	calc_fair_share_perc(unknown->child, UNSPECIFIED);
 }
 
 /**
  * @brief
- *		find_group_info - recursive function to find a group_info in the
- *			  resgroup tree
+ *		index_group_info - add a group_info to the name index of the
+ *			  fairshare tree.  Names are unique in the tree, so the
+ *			  first group_info indexed under a name is kept.
+ *
+ * @param[in]	ginfo	-	the ginfo to index
+ * @param[in]	fhead	-	the fairshare tree ginfo is part of
+ *
+ * @return	nothing
+ *
+ */
+void
+index_group_info(group_info *ginfo, fairshare_head *fhead)
+{
+	if (ginfo == NULL || fhead == NULL)
+		return;
+
+	fhead->gindex.emplace(ginfo->name, ginfo);
+}
+
+/**
+ * @brief
+ *		index the group_infos of a subtree.  Siblings are walked
+ *		iteratively so a wide group does not recurse once per entity.
  *
- * @param[in]	name	-	name of the ginfo to find
  * @param[in]	root	-	the root of the current sub-tree
+ * @param[in]	fhead	-	the fairshare tree to index into
+ *
+ * @return	nothing
+ */
+static void
+index_fairshare_tree(group_info *root, fairshare_head *fhead)
+{
+	for (group_info *g = root; g != NULL; g = g->sibling) {
+		index_group_info(g, fhead);
+		index_fairshare_tree(g->child, fhead);
+	}
+}
+
+/**
+ * @brief
+ *		find_group_info - find a group_info in the resgroup tree by name
+ *
+ * @param[in]	name	-	name of the ginfo to find
+ * @param[in]	fhead	-	the fairshare tree
  *
  * @return	the found group_info or NULL
  *
  */
 group_info *
-find_group_info(const std::string &name, group_info *root)
+find_group_info(const std::string &name, fairshare_head *fhead)
 {
-	group_info *ginfo; /* the found group */
-	if (root == NULL || name == root->name)
-		return root;
+	if (fhead == NULL)
+		return NULL;
 
-	ginfo = find_group_info(name, root->sibling);
-	if (ginfo == NULL)
-		ginfo = find_group_info(name, root->child);
+	auto it = fhead->gindex.find(name);
+	if (it == fhead->gindex.end())
+		return NULL;
 
-	return ginfo;
+	return it->second;
 }
 
 /**
@@ -170,27 +212,27 @@ find_group_info(const std::string &name, group_info *root)
  *			  add it to the "unknown" group
  *
  * @param[in]	name	-	name of the ginfo to find
- * @param[in]	root	-	root of the fairshare tree
+ * @param[in]	fhead	-	the fairshare tree
  *
  * @return	the found ginfo or the newly allocated ginfo
  *
  */
 group_info *
-find_alloc_ginfo(const std::string &name, group_info *root)
+find_alloc_ginfo(const std::string &name, fairshare_head *fhead)
 {
 	group_info *ginfo; /* the found group or allocated group */
 
-	if (root == NULL)
+	if (fhead == NULL || fhead->root == NULL)
 		return NULL;
 
-	ginfo = find_group_info(name, root);
+	ginfo = find_group_info(name, fhead);
 
 	if (ginfo == NULL) {
 		if ((ginfo = new group_info(name)) == NULL)
 			return NULL;
 
 		ginfo->shares = 1;
-		add_unknown(ginfo, root);
+		add_unknown(ginfo, fhead);
 	}
 	return ginfo;
 }
@@ -200,7 +242,7 @@ find_alloc_ginfo(const std::string &name, group_info *root)
  * 		parse the resource group file
  *
  * @param[in]	fname	-	name of the file
- * @param[in]	root	-	root of fairshare tree
+ * @param[in]	fhead	-	fairshare tree
  *
  * @return	success/failure
  *
@@ -213,7 +255,7 @@ find_alloc_ginfo(const std::string &name, group_info *root)
  *
  */
 int
-parse_group(const char *fname, group_info *root)
+parse_group(const char *fname, fairshare_head *fhead)
 {
 	group_info *ginfo;     /* ptr to parent group */
 	group_info *new_ginfo; /* used to add each new group */
@@ -249,7 +291,7 @@ parse_group(const char *fname, group_info *root)
 			if (nametok == NULL || cgrouptok == NULL ||
 			    grouptok == NULL || sharestok == NULL) {
 				error = 1;
-			} else if (find_group_info(nametok, root) != NULL) {
+			} else if (find_group_info(nametok, fhead) != NULL) {
 				error = 1;
 				sprintf(log_buffer, "entity %s is not unique", nametok);
 				fprintf(stderr, "%s\n", log_buffer);
@@ -257,9 +299,9 @@ parse_group(const char *fname, group_info *root)
 					  "fairshare", log_buffer);
 			} else {
 				if (!strcmp(grouptok, "root"))
-					ginfo = find_group_info(FAIRSHARE_ROOT_NAME, root);
+					ginfo = find_group_info(FAIRSHARE_ROOT_NAME, fhead);
 				else
-					ginfo = find_group_info(grouptok, root);
+					ginfo = find_group_info(grouptok, fhead);
 
 				if (ginfo != NULL) {
 					shares = strtol(sharestok, &endp, 10);
@@ -272,6 +314,7 @@ parse_group(const char *fname, group_info *root)
 							new_ginfo->cresgroup = cgroup;
 							new_ginfo->shares = shares;
 							add_child(new_ginfo, ginfo);
+							index_group_info(new_ginfo, fhead);
 						} else
 							error = 1;
 					} else
@@ -337,6 +380,8 @@ preload_tree()
 	unknown->cresgroup = 1;
 	unknown->parent = root;
 	add_child(unknown, root);
+	index_group_info(root, head);
+	index_group_info(unknown, head);
 	return head;
 }
 
@@ -442,23 +487,35 @@ update_usage_on_run(resource_resv *resresv)
  *		decay_fairshare_tree - decay the usage information kept in the fair
  *			       share tree
  *
+ * @par
+ *		Several decays are applied in one walk of the tree by using
+ *		fairshare_decay_factor^ndecays.  Since the decay factor is at most 1,
+ *		this is the same as decaying ndecays times with the usage clamped
+ *		to FAIRSHARE_MIN_USAGE after each decay.
+ *
  * @param[in,out]	root	-	the root of the fairshare tree
+ * @param[in]	ndecays	-	the number of decays to apply
  *
  * @return nothing
  *
  */
 void
-decay_fairshare_tree(group_info *root)
+decay_fairshare_tree(group_info *root, int ndecays)
 {
-	if (root == NULL)
+	double factor;
+
+	if (root == NULL || ndecays <= 0)
 		return;
 
-	decay_fairshare_tree(root->sibling);
-	decay_fairshare_tree(root->child);
+	factor = pow(conf.fairshare_decay_factor, ndecays);
 
-	root->usage *= conf.fairshare_decay_factor;
-	if (root->usage < FAIRSHARE_MIN_USAGE)
-		root->usage = FAIRSHARE_MIN_USAGE;
+	for (group_info *g = root; g != NULL; g = g->sibling) {
+		decay_fairshare_tree(g->child, ndecays);
+
+		g->usage *= factor;
+		if (g->usage < FAIRSHARE_MIN_USAGE)
+			g->usage = FAIRSHARE_MIN_USAGE;
+	}
 }
 
 /**
@@ -516,6 +573,11 @@ compare_path(std::vector<group_info *> &gp1, std::vector<group_info *> &gp2)
  *		write_usage - write the usage information to the usage file
  *		      This function uses a recursive helper function
  *
+ * @par
+ *		The usage is written to a temporary file which is synced to disk
+ *		and then renamed over the usage file.  A crash while writing leaves
+ *		the previous usage file in place instead of a truncated one.
+ *
  * @param[in]	filename	-	usage file
  * @param[in]	fhead	-	Pointer to fairshare_head structure.
  *
@@ -527,6 +589,8 @@ write_usage(const char *filename, fairshare_head *fhead)
 {
 	FILE *fp; /* file pointer to usage file */
 	struct group_node_header head;
+	char tmpname[MAXPATHLEN + 1];
+	int error = 0;
 
 	if (fhead == NULL)
 		return 0;
@@ -534,8 +598,10 @@ write_usage(const char *filename, fairshare_head *fhead)
 	if (filename == NULL)
 		filename = USAGE_FILE;
 
-	if ((fp = fopen(filename, "wb")) == NULL) {
-		sprintf(log_buffer, "Error opening file %s", filename);
+	snprintf(tmpname, sizeof(tmpname), "%s.new", filename);
+
+	if ((fp = fopen(tmpname, "wb")) == NULL) {
+		sprintf(log_buffer, "Error opening file %s", tmpname);
 		log_err(errno, "write_usage", log_buffer);
 		return 0;
 	}
@@ -556,7 +622,21 @@ write_usage(const char *filename, fairshare_head *fhead)
 	fwrite(&fhead->last_decay, sizeof(time_t), 1, fp);
 
 	rec_write_usage(fhead->root, fp);
-	fclose(fp);
+
+	if (fflush(fp) != 0 || ferror(fp) || fsync(fileno(fp)) != 0)
+		error = 1;
+	if (fclose(fp) != 0)
+		error = 1;
+
+	if (!error && rename(tmpname, filename) != 0)
+		error = 1;
+
+	if (error) {
+		sprintf(log_buffer, "Error writing file %s", filename);
+		log_err(errno, "write_usage", log_buffer);
+		unlink(tmpname);
+		return 0;
+	}
 	return 1;
 }
 
@@ -576,23 +656,26 @@ rec_write_usage(group_info *root, FILE *fp)
 {
 	struct group_node_usage_v2 grp; /* used to write out usage info */
 
-	if (root == NULL)
-		return;
+	std::vector<group_info *> sibs;
 
-	/* only write out leaves of the tree (fairshare entities)
-	 * usage defaults to 1 so don't bother writing those out either
-	 * It is possible that the unknown group is empty.  Don't want to write it out
-	 */
-	if (root->usage != 1 && root->child == NULL && root->name != UNKNOWN_GROUP_NAME) {
-		memset(&grp, 0, sizeof(struct group_node_usage_v2));
-		snprintf(grp.name, sizeof(grp.name), "%s", root->name.c_str());
-		grp.usage = root->usage;
+	for (group_info *g = root; g != NULL; g = g->sibling) {
+		sibs.push_back(g);
+		/* only write out leaves of the tree (fairshare entities)
+		 * usage defaults to 1 so don't bother writing those out either
+		 * It is possible that the unknown group is empty.  Don't want to write it out
+		 */
+		if (g->usage != 1 && g->child == NULL && g->name != UNKNOWN_GROUP_NAME) {
+			memset(&grp, 0, sizeof(struct group_node_usage_v2));
+			snprintf(grp.name, sizeof(grp.name), "%s", g->name.c_str());
+			grp.usage = g->usage;
 
-		fwrite(&grp, sizeof(struct group_node_usage_v2), 1, fp);
+			fwrite(&grp, sizeof(struct group_node_usage_v2), 1, fp);
+		}
 	}
 
-	rec_write_usage(root->sibling, fp);
-	rec_write_usage(root->child, fp);
+	/* children are written last sibling first, as the file has always been laid out */
+	for (auto it = sibs.rbegin(); it != sibs.rend(); ++it)
+		rec_write_usage((*it)->child, fp);
 }
 
 /**
@@ -641,7 +724,7 @@ read_usage(const char *filename, int flags, fairshare_head *fhead)
 						error = 1;
 				}
 				if (!error)
-					read_usage_v2(fp, flags, fhead->root);
+					read_usage_v2(fp, flags, fhead);
 			} else
 				error = 1;
 
@@ -651,7 +734,7 @@ read_usage(const char *filename, int flags, fairshare_head *fhead)
 
 		} else { /* original headerless usage file */
 			rewind(fp);
-			read_usage_v1(fp, fhead->root);
+			read_usage_v1(fp, fhead);
 		}
 	}
 
@@ -663,7 +746,7 @@ read_usage(const char *filename, int flags, fairshare_head *fhead)
  * 		read version 1 usage file
  *
  * @param[in]	fp	-	the file pointer to the open file
- * @param[in]	root	-	root of the fairshare tree
+ * @param[in]	fhead	-	the fairshare tree
  *
  * @return	int
  *	@retval	1	: success
@@ -671,7 +754,7 @@ read_usage(const char *filename, int flags, fairshare_head *fhead)
  *
  */
 int
-read_usage_v1(FILE *fp, group_info *root)
+read_usage_v1(FILE *fp, fairshare_head *fhead)
 {
 	struct group_node_usage_v1 grp;
 	group_info *ginfo;
@@ -681,7 +764,7 @@ read_usage_v1(FILE *fp, group_info *root)
 	memset(&grp, 0, sizeof(struct group_node_usage_v1));
 	while (fread(&grp, sizeof(struct group_node_usage_v1), 1, fp)) {
 		if (grp.usage >= 0 && is_valid_pbs_name(grp.name, USAGE_NAME_MAX)) {
-			ginfo = find_alloc_ginfo(grp.name, root);
+			ginfo = find_alloc_ginfo(grp.name, fhead);
 			if (ginfo != NULL) {
 				ginfo->usage = grp.usage;
 				ginfo->temp_usage = grp.usage;
@@ -709,14 +792,14 @@ read_usage_v1(FILE *fp, group_info *root)
  *
  * @param[in]	fp	- the file pointer to the open file
  * @param[in]	flags	- flags to check whether to trim or not.
- * @param[in]	root	- root of the fairshare tree
+ * @param[in]	fhead	- the fairshare tree
  *
  *	@retval 1 success
  *	@retval 0 failure
  *
  */
 int
-read_usage_v2(FILE *fp, int flags, group_info *root)
+read_usage_v2(FILE *fp, int flags, fairshare_head *fhead)
 {
 	struct group_node_usage_v2 grp;
 	group_info *ginfo;
@@ -731,9 +814,9 @@ read_usage_v2(FILE *fp, int flags, group_info *root)
 			 * already in the resource_group file
 			 */
 			if (flags & FS_TRIM)
-				ginfo = find_group_info(grp.name, root);
+				ginfo = find_group_info(grp.name, fhead);
 			else
-				ginfo = find_alloc_ginfo(grp.name, root);
+				ginfo = find_alloc_ginfo(grp.name, fhead);
 
 			if (ginfo != NULL) {
 				ginfo->usage = grp.usage;
@@ -925,6 +1008,7 @@ fairshare_head::fairshare_head(fairshare_head &ofhead)
 {
 	last_decay = ofhead.last_decay;
 	root = dup_fairshare_tree(ofhead.root, NULL);
+	index_fairshare_tree(root, this);
 }
 
 /**
@@ -934,8 +1018,10 @@ fairshare_head &
 fairshare_head::operator=(fairshare_head &ofhead)
 {
 	free_fairshare_tree(root);
+	gindex.clear();
 	last_decay = ofhead.last_decay;
 	root = dup_fairshare_tree(ofhead.root, NULL);
+	index_fairshare_tree(root, this);
 	return *this;
 }
 
@@ -961,12 +1047,10 @@ fairshare_head::~fairshare_head()
 void
 reset_temp_usage(group_info *head)
 {
-	if (head == NULL)
-		return;
-
-	head->temp_usage = head->usage;
-	reset_temp_usage(head->sibling);
-	reset_temp_usage(head->child);
+	for (group_info *g = head; g != NULL; g = g->sibling) {
+		g->temp_usage = g->usage;
+		reset_temp_usage(g->child);
+	}
 }
 
 /**
@@ -47,24 +47,28 @@
 void add_child(group_info *ginfo, group_info *parent);
 
 /*
- *      find_group_info - recursive function to find a ginfo in the
- resgroup tree
+ *      index_group_info - add a ginfo to the name index of the fairshare tree
  */
-group_info *find_group_info(const std::string &name, group_info *root);
+void index_group_info(group_info *ginfo, fairshare_head *fhead);
+
+/*
+ *      find_group_info - find a ginfo in the resgroup tree by name
+ */
+group_info *find_group_info(const std::string &name, fairshare_head *fhead);
 
 /*
  *      find_alloc_ginfo - trys to find a ginfo in the fair share tree.  If it
  *                        can not find the ginfo, then allocate a new one and
  *                        add it to the "unknown" group
  */
-group_info *find_alloc_ginfo(const std::string &name, group_info *root);
+group_info *find_alloc_ginfo(const std::string &name, fairshare_head *fhead);
 
 /*
  *
  *	parse_group - parse the resource group file
  *
  *	  fname - name of the file
- *	  root  - root of fairshare tree
+ *	  fhead - fairshare tree
  *
  *	return success/failure
  *
@@ -77,7 +81,7 @@ group_info *find_alloc_ginfo(const std::string &name, group_info *root);
  *	  shares  - the amount of shares the user/group has in its resgroup
  *
  */
-int parse_group(const char *fname, group_info *root);
+int parse_group(const char *fname, fairshare_head *fhead);
 
 /*
  *
@@ -113,7 +117,7 @@ void update_usage_on_run(resource_resv *resresv);
  *      decay_fairshare_tree - decay the usage information kept in the fair
  *                             share tree
  */
-void decay_fairshare_tree(group_info *root);
+void decay_fairshare_tree(group_info *root, int ndecays);
 
 /*
  *      write_usage - write the usage information to the usage file
@@ -136,12 +140,12 @@ void read_usage(const char *filename, int flags, fairshare_head *fhead);
 /*
  *      read_usage_v1 - read version 1 usage file
  */
-int read_usage_v1(FILE *fp, group_info *root);
+int read_usage_v1(FILE *fp, fairshare_head *fhead);
 
 /*
  *      read_usage_v2 - read version 2 usage file
  */
-int read_usage_v2(FILE *fp, int flags, group_info *root);
+int read_usage_v2(FILE *fp, int flags, fairshare_head *fhead);
 
 /*
  *      create_group_path - create a path from the root to the leaf of the tree
@@ -182,12 +186,12 @@ void free_fairshare_tree(group_info *root);
  *	add_unknown - add a ginfo to the "unknown" group
  *
  *	  ginfo - ginfo to add
- *	  root  - root of fairshare tre
+ *	  fhead - fairshare tree
  *
  *	return nothing
  *
  */
-void add_unknown(group_info *ginfo, group_info *root);
+void add_unknown(group_info *ginfo, fairshare_head *fhead);
 
 /*
  * 	reset_temp_usage - walk the fairshare tree resetting temp_usage = usage
@@ -50,14 +50,17 @@
 #endif
 
 #include <algorithm>
+#include <deque>
 
 #include "buckets.h"
 #include "check.h"
 #include "config.h"
 #include "constant.h"
+#include "cycle_prof.h"
 #include "dedtime.h"
 #include "fairshare.h"
 #include "fifo.h"
+#include "formula.h"
 #include "globals.h"
 #include "job_info.h"
 #include "libpbs.h"
@@ -66,6 +69,7 @@
 #include "multi_threading.h"
 #include "node_info.h"
 #include "node_partition.h"
+#include "node_scan.h"
 #include "parse.h"
 #include "pbs_internal.h"
 #include "pbs_python.h"
@@ -75,6 +79,7 @@
 #include "prime.h"
 #include "queue_info.h"
 #include "range.h"
+#include "replay.h"
 #include "resource.h"
 #include "resource_resv.h"
 #include "resv_info.h"
@@ -124,6 +129,11 @@ schedinit(int nthreads)
 #endif
 
 	conf = parse_config(CONFIG_FILE);
+	/* the verdicts and placement sets were kept under the old configuration */
+	clear_resresv_set_verdicts();
+	clear_kept_node_partitions();
+	/* publish the first profile under the new configuration at once */
+	cycle_prof_reset();
 
 	parse_holidays(HOLIDAYS_FILE);
 	time(&(cstat.current_time));
@@ -147,7 +157,7 @@ schedinit(int nthreads)
 	/* preload the static members to the fairshare tree */
 	fstree = preload_tree();
 	if (fstree != NULL) {
-		parse_group(RESGROUP_FILE, fstree->root);
+		parse_group(RESGROUP_FILE, fstree);
 		calc_fair_share_perc(fstree->root->child, UNSPECIFIED);
 		read_usage(USAGE_FILE, 0, fstree);
 
@@ -205,6 +215,9 @@ schedinit(int nthreads)
 		}
 	}
 
+	log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+		   "Using the %s kernel to scan vnodes", node_scan_kernel_name());
+
 	return 0;
 }
 
@@ -322,6 +335,7 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 		FILE *fp;
 		bool decayed = false;
 		bool resort = false;
+		bool usage_changed = false;
 		if ((fp = fopen(USAGE_TOUCH, "r")) != NULL) {
 			fclose(fp);
 			reset_usage(fstree->root);
@@ -337,7 +351,7 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 			 */
 
 			for (const auto &lj : last_running) {
-				user = find_alloc_ginfo(lj.entity_name, sinfo->fstree->root);
+				user = find_alloc_ginfo(lj.entity_name, sinfo->fstree);
 
 				if (user != NULL) {
 					auto rj = find_resource_resv(sinfo->running_jobs, lj.name);
@@ -349,9 +363,11 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 
 						delta = IF_NEG_THEN_ZERO(delta);
 
-						;
-						for (auto &g : user->gpath)
-							g->usage += delta;
+						if (delta > 0) {
+							for (auto &g : user->gpath)
+								g->usage += delta;
+							usage_changed = true;
+						}
 
 						resort = true;
 					}
@@ -361,17 +377,17 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 
 		/* The half life for the fair share tree might have passed since the last
 		 * scheduling cycle.  For that matter, several half lives could have
-		 * passed.  If this is the case, perform as many decays as necessary
+		 * passed.  If this is the case, perform all the decays in one pass
 		 */
 
-		auto t = policy->current_time;
-		while (conf.decay_time != SCHD_INFINITY &&
-		       (t - sinfo->fstree->last_decay) > conf.decay_time) {
-			log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SERVER, LOG_DEBUG,
-				  "Fairshare", "Decaying Fairshare Tree");
+		auto since_decay = policy->current_time - sinfo->fstree->last_decay;
+		if (conf.decay_time != SCHD_INFINITY && since_decay > conf.decay_time) {
+			int ndecays = (since_decay - 1) / conf.decay_time;
+
+			log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SERVER, LOG_DEBUG,
+				   "Fairshare", "Decaying Fairshare Tree %d time(s)", ndecays);
 			if (fstree != NULL)
-				decay_fairshare_tree(sinfo->fstree->root);
-			t -= conf.decay_time;
+				decay_fairshare_tree(sinfo->fstree->root, ndecays);
 			decayed = true;
 			resort = true;
 		}
@@ -385,7 +401,8 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 								       conf.decay_time;
 		}
 
-		if (decayed || !last_running.empty()) {
+		/* only rewrite the usage file if some usage actually changed */
+		if (decayed || usage_changed) {
 			write_usage(USAGE_FILE, sinfo->fstree);
 			log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SERVER, LOG_DEBUG,
 				  "Fairshare", "Usage Sync");
@@ -412,6 +429,8 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 		}
 	}
 	if (sinfo->jobs != NULL) {
+		if (sinfo->job_sort_formula != NULL)
+			formula_evaluate_jobs(find_formula(sinfo->job_sort_formula), sinfo->jobs);
 		for (int i = 0; sinfo->jobs[i] != NULL; i++) {
 			resource_resv *resresv = sinfo->jobs[i];
 			if (resresv->job != NULL) {
@@ -423,7 +442,6 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 				}
 				if (sinfo->job_sort_formula != NULL) {
 					double threshold = sc_attrs.job_sort_formula_threshold;
-					resresv->job->formula_value = formula_evaluate(sinfo->job_sort_formula, resresv, resresv->resreq);
 					log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_DEBUG, resresv->name, "Formula Evaluation = %.*f",
 						   float_digits(resresv->job->formula_value, FLOAT_NUM_DIGITS), resresv->job->formula_value);
 
@@ -535,7 +553,11 @@ intermediate_schedule(int sd, const sched_cmd *cmd)
 	int cycle_cnt = 0; /* count of cycles run */
 
 	do {
+		cycle_prof_begin();
+		capture_begin_cycle(sd);
 		ret = scheduling_cycle(sd, cmd);
+		capture_end_cycle();
+		cycle_prof_end(sd);
 
 		/* don't restart cycle if :- */
 
@@ -594,7 +616,7 @@ scheduling_cycle(int sd, const sched_cmd *cmd)
 	else
 		send_job_attr_updates = 0;
 
-	update_cycle_status(cstat, 0);
+	update_cycle_status(cstat, replay_cycle_time());
 
 #ifdef NAS /* localmod 030 */
 	do_soft_cycle_interrupt = 0;
@@ -659,9 +681,16 @@ scheduling_cycle(int sd, const sched_cmd *cmd)
 		}
 	}
 
+	/* a qrun request wants the job tried, whatever happened last cycle */
+	if (sinfo->qrun_job == NULL)
+		carry_resresv_set_verdicts(sinfo);
+
 	/* run loop run */
-	if (error == 0)
+	if (error == 0) {
 		rc = main_sched_loop(policy, sd, sinfo, &err);
+		if (sinfo->qrun_job == NULL)
+			save_resresv_set_verdicts(sinfo);
+	}
 
 	if (cmd->jid != NULL) {
 		int def_rc = -1;
@@ -762,6 +791,30 @@ get_high_prio_cmd(int *is_conn_lost, sched_cmd *high_prior_cmd)
 	return 0;
 }
 
+/**
+ * @brief is a job turned away for lack of resources, which jobs the server
+ *	  refused to run would hand back?
+ *
+ * @param[in] err - why the job can not run
+ *
+ * @return bool
+ */
+static bool
+is_resource_shortage(schd_error *err)
+{
+	switch (err->error_code) {
+		case NOT_ENOUGH_NODES_AVAIL:
+		case NO_NODE_RESOURCES:
+		case INSUFFICIENT_RESOURCE:
+		case INSUFFICIENT_QUEUE_RESOURCE:
+		case INSUFFICIENT_SERVER_RESOURCE:
+		case NO_FREE_NODES:
+			return true;
+		default:
+			return false;
+	}
+}
+
 /**
  * @brief
  * 		the main scheduler loop
@@ -858,6 +911,20 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 		} else
 			ns_arr = is_ok_to_run(policy, sinfo, qinfo, njob, flags, err);
 
+		/* Jobs the server refused in the pipelined runjob window hand their
+		 * resources back.  If the job is short of resources, settle the window
+		 * and give the job a second look so those resources are used in this
+		 * cycle.  Nothing more can run if the connection was lost.
+		 */
+		if (ns_arr.empty() && err->status_code != NEVER_RUN &&
+		    is_resource_shortage(err) && reap_run_job_acks(0) > 0) {
+			clear_schd_error(err);
+			if (njob->is_shrink_to_fit)
+				ns_arr = is_ok_to_run_STF(policy, sinfo, qinfo, njob, flags, err, shrink_job_algorithm);
+			else
+				ns_arr = is_ok_to_run(policy, sinfo, qinfo, njob, flags, err);
+		}
+
 		if (err->status_code == NEVER_RUN)
 			njob->can_never_run = 1;
 
@@ -993,6 +1060,7 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 				resresv_set *ec = sinfo->equiv_classes[njob->ec_index];
 				if (rc != RUN_FAILURE && !ec->can_not_run) {
 					ec->can_not_run = 1;
+					ec->carry = resresv_set_verdict_carries(sinfo, err);
 					ec->err = dup_schd_error(err);
 				}
 			}
@@ -1059,6 +1127,9 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 		send_job_updates(sd, njob);
 	}
 
+	/* the universe is about to be freed, settle the jobs still in flight */
+	reap_run_job_acks(0);
+
 	*rerr = err;
 
 	free_schd_error(chk_lim_err);
@@ -1205,6 +1276,97 @@ move_peer_job(resource_resv *rr)
 	return rc;
 }
 
+/* jobs whose runjob request was sent without waiting for the acknowledgement */
+static std::deque<resource_resv *> runjob_acks_pending;
+static int runjob_acks_sd = -1;
+
+/**
+ * @brief
+ * 		should the runjob request for a job be pipelined?  Only acknowledged
+ * 		asynchronous runjob requests are.  The server acknowledges them in
+ * 		the order it receives them, before it contacts the MoM.
+ *
+ * @param[in]	rr	-	the job to run
+ *
+ * @return	bool
+ */
+static bool
+should_pipeline_run_job(resource_resv *rr)
+{
+	if (conf.runjob_pipeline_depth <= 0)
+		return false;
+	if (sc_attrs.runjob_mode != RJ_RUNJOB_HOOK || !rr->server->has_runjob_hook)
+		return false;
+	/* qrun needs to know right away if the job ran */
+	if (rr->server->qrun_job != NULL)
+		return false;
+	return true;
+}
+
+/**
+ * @brief
+ * 		read the acknowledgements of pipelined runjob requests, oldest
+ * 		first, until at most keep requests are outstanding.  A job the
+ * 		server refused was already accounted for as running, so it is
+ * 		put back in the queued state in the universe and marked as not
+ * 		able to run this cycle.
+ *
+ * @param[in]	keep	-	number of requests which may stay outstanding
+ *
+ * @return	int
+ * @retval	number of jobs the server refused to run
+ * @retval	-1	: the connection to the server was lost
+ */
+int
+reap_run_job_acks(size_t keep)
+{
+	bool conn_lost = false;
+	int refused = 0;
+
+	while (runjob_acks_pending.size() > keep) {
+		resource_resv *rr = runjob_acks_pending.front();
+		int pbsrc;
+
+		runjob_acks_pending.pop_front();
+
+		if (conn_lost)
+			pbsrc = PBSE_PROTOCOL;
+		else
+			pbsrc = recv_run_job_ack(runjob_acks_sd);
+
+		if (pbsrc == 0)
+			continue;
+		if (pbsrc == PBSE_PROTOCOL)
+			conn_lost = true;
+		else
+			refused++;
+
+		schd_error *err = new_schd_error();
+		if (err == NULL)
+			continue;
+
+		const char *errbuf = conn_lost ? NULL : pbs_geterrmsg(runjob_acks_sd);
+		char buf[MAX_LOG_SIZE];
+
+		set_schd_error_codes(err, NOT_RUN, RUN_FAILURE);
+		set_schd_error_arg(err, ARG1, errbuf != NULL ? errbuf : "");
+		snprintf(buf, sizeof(buf), "%d", pbsrc);
+		set_schd_error_arg(err, ARG2, buf);
+
+		if (rr->job->is_running)
+			update_universe_on_end(rr->server->policy, rr, "Q", NO_FLAGS);
+		update_job_can_not_run(runjob_acks_sd, rr, err);
+		free_schd_error(err);
+	}
+
+	if (runjob_acks_pending.empty())
+		runjob_acks_sd = -1;
+
+	if (conn_lost)
+		return -1;
+	return refused;
+}
+
 /**
  * @brief
  * 		run_job - handle the running of a pbs job.  If it's a peer job
@@ -1288,11 +1450,23 @@ run_job(status *policy, int pbs_sd, resource_resv *rr, std::vector<nspec *> &ns_
 				if (strlen(timebuf) > 0)
 					log_eventf(PBSEVENT_SCHED, PBS_EVENTCLASS_JOB, LOG_NOTICE, rr->name,
 						   "Job will run for duration=%s", timebuf);
-				pbsrc = send_run_job(pbs_sd, rr->server->has_runjob_hook, rr->name, execvnode);
+				pbsrc = 0;
 			} else
 				pbsrc = 1;
-		} else
-			pbsrc = send_run_job(pbs_sd, rr->server->has_runjob_hook, rr->name, execvnode);
+		}
+
+		if (!pbsrc) {
+			if (should_pipeline_run_job(rr)) {
+				pbsrc = send_run_job_pipelined(pbs_sd, rr->name, execvnode);
+				if (!pbsrc) {
+					runjob_acks_pending.push_back(rr);
+					runjob_acks_sd = pbs_sd;
+					/* keep this job's request outstanding, the caller has yet to account for it */
+					reap_run_job_acks(static_cast<size_t>(conf.runjob_pipeline_depth));
+				}
+			} else
+				pbsrc = send_run_job(pbs_sd, rr->server->has_runjob_hook, rr->name, execvnode);
+		}
 	}
 
 #ifdef NAS_CLUSTER /* localmod 125 */
@@ -1705,7 +1879,7 @@ add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo,
 		 * Note: We only ever look from now into the future
 		 */
 		auto nexte = get_next_event(sinfo->calendar);
-		if (find_timed_event(nexte, topjob->name, IGNORE_DISABLED_EVENTS, TIMED_NOEVENT, 0) != NULL)
+		if (find_calendar_event(sinfo->calendar, nexte, topjob->name, IGNORE_DISABLED_EVENTS, TIMED_NOEVENT, 0) != NULL)
 			return 1;
 	}
 	try {
@@ -1773,8 +1947,7 @@ add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo,
 					create_node_array_from_nspec(bjob->nspec_arr);
 				selectspec = create_select_from_nspec(bjob->nspec_arr);
 				if (!selectspec.empty()) {
-					delete bjob->execselect;
-					bjob->execselect = parse_selspec(selectspec);
+					bjob->execselect.reset(parse_selspec(selectspec));
 				}
 			} else {
 				delete nsinfo;
@@ -1822,9 +1995,7 @@ add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo,
 				bkt = sinfo->buckets[sinfo->unordered_nodes[ind]->bucket_ind];
 				if (pbs_bitmap_get_bit(bkt->free_pool->truth, ind)) {
 					pbs_bitmap_bit_off(bkt->free_pool->truth, ind);
-					bkt->free_pool->truth_ct--;
 					pbs_bitmap_bit_on(bkt->busy_later_pool->truth, ind);
-					bkt->busy_later_pool->truth_ct++;
 				}
 			}
 		}
@@ -2355,6 +2526,9 @@ parse_sched_obj(int connector, struct batch_status *status)
 		} else if (!strcmp(attrp->name, ATTR_job_sort_formula)) {
 			free(sc_attrs.job_sort_formula);
 			sc_attrs.job_sort_formula = read_formula();
+			/* compile it now rather than in the middle of a cycle */
+			if (sc_attrs.job_sort_formula != NULL)
+				find_formula(sc_attrs.job_sort_formula);
 			if (!conf.prime_sort.empty() || !conf.non_prime_sort.empty())
 				log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
 					  "Job sorting formula and job_sort_key are incompatible.  "
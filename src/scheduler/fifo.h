@@ -178,6 +178,14 @@ int update_job_can_not_run(int pbs_sd, resource_resv *job, schd_error *err);
  */
 void end_cycle_tasks(server_info *sinfo);
 
+/*
+ *	reap_run_job_acks - read the acknowledgements of pipelined run job
+ *			    requests until at most 'keep' are outstanding
+ *			    returns the number of jobs the server refused,
+ *			    or -1 if the connection was lost
+ */
+int reap_run_job_acks(size_t keep);
+
 /*
  *	add_job_to_calendar - find the most top job and init all the
  *		correct variables in sinfo to correctly backfill around it
@@ -243,6 +251,10 @@ int validate_running_user(char *exename);
 
 int send_run_job(int virtual_sd, int has_runjob_hook, const std::string &jobid, char *execvnode);
 
+int send_run_job_pipelined(int virtual_sd, const std::string &jobid, char *execvnode);
+
+int recv_run_job_ack(int virtual_sd);
+
 struct batch_status *send_statsched(int virtual_fd, struct attrl *attrib, char *extend);
 
 #endif /* _FIFO_H */
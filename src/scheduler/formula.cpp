@@ -0,0 +1,684 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file    formula.cpp
+ *
+ * @brief
+ * 		formula.cpp - native evaluation of job_sort_formula and
+ *		fairshare_usage_res
+ *
+ *	A formula is parsed once, the first time it is seen, into a small
+ *	stack program over the job's consumable resources and the special
+ *	terms (eligible_time, fairshare_perc, ...).  The grammar is the part
+ *	of Python's expression grammar formulas normally use: numbers, names,
+ *	parentheses, unary + and -, and the + - * / // % ** operators.  The
+ *	program follows Python's semantics (true division, floored // and %,
+ *	right associative **), and sees the values rounded exactly as they are
+ *	printed for the Python interpreter.
+ *
+ *	Formulas using anything else (function calls, comparisons, ...) are
+ *	evaluated by the embedded Python interpreter as before.  So is a job
+ *	whose evaluation hits an error Python would report, such as a division
+ *	by zero or an overflow, so the error is logged just as it used to be.
+ *
+ * Functions included are:
+ * 	sched_formula::sched_formula()
+ * 	sched_formula::evaluate()
+ * 	find_formula()
+ * 	clear_formulas()
+ * 	formula_evaluate()
+ * 	formula_evaluate_jobs()
+ *
+ */
+#include <pbs_config.h>
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include <log.h>
+#include <libutil.h>
+#include <pbs_share.h>
+#include "formula.h"
+#include "constant.h"
+#include "globals.h"
+#include "job_info.h"
+#include "misc.h"
+#include "multi_threading.h"
+#include "resource_resv.h"
+
+/* deepest stack a native formula may use */
+#define FORMULA_MAX_DEPTH 64
+/* integers beyond this are exact in Python but not in a double */
+#define FORMULA_MAX_EXACT 9007199254740992.0 /* 2^53 */
+/* compiled formulas kept before the cache is emptied */
+#define FORMULA_CACHE_MAX 16
+
+static std::unordered_map<std::string, sched_formula *> formulas;
+
+/*
+ * formula_parser - recursive descent parser producing a sched_formula's
+ *		    program, one function per level of Python's grammar
+ */
+class formula_parser
+{
+public:
+	explicit formula_parser(sched_formula &f) : f(f), p(f.text.c_str()), depth(0) {}
+	bool parse();
+
+private:
+	bool arith();
+	bool term();
+	bool factor();
+	bool power();
+	bool atom();
+	bool number();
+	bool name();
+	bool fail(const char *why);
+	void emit(enum formula_opcode code, int pushes);
+	void skip_ws()
+	{
+		while (*p == ' ' || *p == '\t')
+			p++;
+	}
+
+	sched_formula &f;
+	const char *p; /* next character to parse */
+	int depth;     /* stack depth at this point of the program */
+};
+
+/**
+ * @brief	give up compiling the formula natively
+ *
+ * @param[in]	why	-	what was found, for the log
+ *
+ * @return	false
+ */
+bool
+formula_parser::fail(const char *why)
+{
+	if (f.why_not_native.empty())
+		f.why_not_native = std::string(why) + " at '" + p + "'";
+	return false;
+}
+
+/**
+ * @brief	append an operation to the program
+ *
+ * @param[in]	code	-	the operation
+ * @param[in]	pushes	-	change of stack depth it causes
+ */
+void
+formula_parser::emit(enum formula_opcode code, int pushes)
+{
+	formula_op op = {code, 0, NULL, FTERM_ELIGIBLE_TIME};
+
+	f.prog.push_back(op);
+	depth += pushes;
+	if (depth > f.max_depth)
+		f.max_depth = depth;
+}
+
+/**
+ * @brief	parse the whole formula
+ *
+ * @return	bool
+ * @retval	true	: the formula can be evaluated natively
+ * @retval	false	: it needs Python
+ */
+bool
+formula_parser::parse()
+{
+	skip_ws();
+	if (*p == '\0')
+		return fail("empty formula");
+	if (!arith())
+		return false;
+	skip_ws();
+	if (*p != '\0')
+		return fail("unsupported syntax");
+	if (f.max_depth > FORMULA_MAX_DEPTH)
+		return fail("formula too deep");
+	return true;
+}
+
+/**
+ * @brief	a_expr: term (('+' | '-') term)*
+ */
+bool
+formula_parser::arith()
+{
+	if (!term())
+		return false;
+	for (;;) {
+		enum formula_opcode code;
+
+		skip_ws();
+		if (*p == '+')
+			code = FOP_ADD;
+		else if (*p == '-')
+			code = FOP_SUB;
+		else
+			return true;
+		p++;
+		if (!term())
+			return false;
+		emit(code, -1);
+	}
+}
+
+/**
+ * @brief	m_expr: u_expr (('*' | '/' | '//' | '%') u_expr)*
+ */
+bool
+formula_parser::term()
+{
+	if (!factor())
+		return false;
+	for (;;) {
+		enum formula_opcode code;
+
+		skip_ws();
+		if (*p == '*' && p[1] != '*') {
+			code = FOP_MUL;
+			p++;
+		} else if (*p == '/' && p[1] == '/') {
+			code = FOP_FLOORDIV;
+			p += 2;
+		} else if (*p == '/') {
+			code = FOP_DIV;
+			p++;
+		} else if (*p == '%') {
+			code = FOP_MOD;
+			p++;
+		} else
+			return true;
+		if (*p == '=')
+			return fail("unsupported operator");
+		if (!factor())
+			return false;
+		emit(code, -1);
+	}
+}
+
+/**
+ * @brief	u_expr: power | '-' u_expr | '+' u_expr
+ */
+bool
+formula_parser::factor()
+{
+	skip_ws();
+	if (*p == '-') {
+		p++;
+		if (!factor())
+			return false;
+		emit(FOP_NEG, 0);
+		return true;
+	} else if (*p == '+') {
+		p++;
+		return factor();
+	}
+	return power();
+}
+
+/**
+ * @brief	power: atom ['**' u_expr]
+ */
+bool
+formula_parser::power()
+{
+	if (!atom())
+		return false;
+	skip_ws();
+	if (*p == '*' && p[1] == '*') {
+		p += 2;
+		if (!factor())
+			return false;
+		emit(FOP_POW, -1);
+	}
+	return true;
+}
+
+/**
+ * @brief	atom: number | name | '(' a_expr ')'
+ */
+bool
+formula_parser::atom()
+{
+	skip_ws();
+	if (*p == '(') {
+		p++;
+		if (!arith())
+			return false;
+		skip_ws();
+		if (*p != ')')
+			return fail("unsupported syntax");
+		p++;
+		return true;
+	}
+	if (isdigit(*p) || (*p == '.' && isdigit(p[1])))
+		return number();
+	if (isalpha(*p) || *p == '_')
+		return name();
+	return fail("unsupported syntax");
+}
+
+/**
+ * @brief	a decimal integer or floating point literal
+ */
+bool
+formula_parser::number()
+{
+	const char *start = p;
+	bool is_int = true;
+	char *endp;
+
+	while (isdigit(*p))
+		p++;
+	if (*p == '.') {
+		is_int = false;
+		p++;
+		while (isdigit(*p))
+			p++;
+	}
+	if (*p == 'e' || *p == 'E') {
+		const char *e = p + 1;
+
+		if (*e == '+' || *e == '-')
+			e++;
+		if (!isdigit(*e))
+			return fail("unsupported number");
+		is_int = false;
+		for (p = e; isdigit(*p);)
+			p++;
+	}
+	/* hex, complex, underscores, leading zeros and long integers */
+	if (isalnum(*p) || *p == '_' || *p == '.')
+		return fail("unsupported number");
+	if (is_int && ((*start == '0' && p - start > 1) || p - start > 15))
+		return fail("unsupported number");
+
+	emit(FOP_CONST, 1);
+	f.prog.back().value = strtod(start, &endp);
+	return true;
+}
+
+/**
+ * @brief	a special term or a consumable resource
+ */
+bool
+formula_parser::name()
+{
+	static const struct {
+		const char *name;
+		enum formula_term term;
+	} terms[] = {
+		{FORMULA_ELIGIBLE_TIME, FTERM_ELIGIBLE_TIME},
+		{FORMULA_QUEUE_PRIO, FTERM_QUEUE_PRIO},
+		{FORMULA_JOB_PRIO, FTERM_JOB_PRIO},
+		{FORMULA_FSPERC, FTERM_FSPERC},
+		{FORMULA_FSPERC_DEP, FTERM_FSPERC},
+		{FORMULA_TREE_USAGE, FTERM_TREE_USAGE},
+		{FORMULA_FSFACTOR, FTERM_FSFACTOR},
+		{FORMULA_ACCRUE_TYPE, FTERM_ACCRUE_TYPE}};
+	const char *start = p;
+
+	while (isalnum(*p) || *p == '_')
+		p++;
+	std::string word(start, p - start);
+
+	/* the special terms take precedence over resources of the same name */
+	for (const auto &t : terms) {
+		if (word == t.name) {
+			emit(FOP_TERM, 1);
+			f.prog.back().term = t.term;
+			return true;
+		}
+	}
+	for (const auto &cr : consres) {
+		if (word == cr->name) {
+			emit(FOP_RES, 1);
+			f.prog.back().def = cr;
+			return true;
+		}
+	}
+	p = start;
+	return fail("unsupported name");
+}
+
+/**
+ * @brief	constructor - compile the formula
+ *
+ * @param[in]	formula	-	the formula text
+ */
+sched_formula::sched_formula(const std::string &formula) : text(formula), native(false), max_depth(0)
+{
+	formula_parser fp(*this);
+
+	native = fp.parse();
+	if (!native)
+		prog.clear();
+}
+
+/**
+ * @brief	round a value the way printf() does before Python reads it
+ *
+ * @param[in]	val	-	the value
+ * @param[in]	digits	-	digits after the decimal point
+ *
+ * @return	double
+ */
+static double
+formula_round(double val, int digits)
+{
+	char buf[512];
+
+	snprintf(buf, sizeof(buf), "%.*f", digits, val);
+	return strtod(buf, NULL);
+}
+
+/**
+ * @brief	the value of a special term for a job
+ *
+ * @see	formula_evaluate_python() for how they are passed to Python
+ */
+static double
+formula_term_value(enum formula_term term, resource_resv *resresv)
+{
+	job_info *job = resresv->job;
+
+	switch (term) {
+		case FTERM_ELIGIBLE_TIME:
+			return job->eligible_time;
+		case FTERM_QUEUE_PRIO:
+			return job->queue->priority;
+		case FTERM_JOB_PRIO:
+			return job->priority;
+		case FTERM_FSPERC:
+			return formula_round(job->ginfo->tree_percentage, 6);
+		case FTERM_TREE_USAGE:
+			return formula_round(job->ginfo->usage_factor, 6);
+		case FTERM_FSFACTOR:
+			return formula_round(job->ginfo->tree_percentage == 0 ? 0 : pow(2, -(job->ginfo->usage_factor / job->ginfo->tree_percentage)), 6);
+		case FTERM_ACCRUE_TYPE:
+			return job->accrue_type;
+	}
+	return 0;
+}
+
+/**
+ * @brief	floored division and modulo of two floats, as done by Python
+ *
+ * @param[in]	a	-	dividend
+ * @param[in]	b	-	divisor, not 0
+ * @param[out]	div	-	a // b
+ * @param[out]	mod	-	a % b
+ */
+static void
+formula_divmod(double a, double b, double *div, double *mod)
+{
+	double m = fmod(a, b);
+	double d = (a - m) / b;
+
+	if (m != 0) {
+		if ((b < 0) != (m < 0)) {
+			m += b;
+			d -= 1.0;
+		}
+	} else
+		m = copysign(0.0, b);
+
+	if (d != 0) {
+		double fd = floor(d);
+
+		if (d - fd > 0.5)
+			fd += 1.0;
+		d = fd;
+	} else
+		d = copysign(0.0, a / b);
+
+	*div = d;
+	*mod = m;
+}
+
+/**
+ * @brief	evaluate the compiled formula for a job
+ *
+ * @param[in]	resresv	-	job for the special terms
+ * @param[in]	resreq	-	resources to use when evaluating
+ * @param[out]	ans	-	the value of the formula
+ *
+ * @return	bool
+ * @retval	true	: ans is set
+ * @retval	false	: the formula isn't native or Python would raise an
+ *			  error for this job, evaluate it through Python
+ *
+ * @par MT-Safe:	yes
+ */
+bool
+sched_formula::evaluate(resource_resv *resresv, resource_req *resreq, sch_resource_t *ans) const
+{
+	double stack[FORMULA_MAX_DEPTH];
+	int sp = 0;
+
+	if (!native)
+		return false;
+
+	for (const auto &op : prog) {
+		double a, b, div, mod;
+
+		switch (op.code) {
+			case FOP_CONST:
+				stack[sp++] = op.value;
+				continue;
+			case FOP_RES: {
+				auto req = find_resource_req(resreq, op.def);
+
+				if (req != NULL)
+					stack[sp++] = formula_round(req->amount, float_digits(req->amount, FLOAT_NUM_DIGITS));
+				else
+					stack[sp++] = 0;
+				continue;
+			}
+			case FOP_TERM:
+				stack[sp++] = formula_term_value(op.term, resresv);
+				continue;
+			case FOP_NEG:
+				stack[sp - 1] = -stack[sp - 1];
+				continue;
+			default:
+				break;
+		}
+
+		b = stack[--sp];
+		a = stack[sp - 1];
+		switch (op.code) {
+			case FOP_ADD:
+				a += b;
+				break;
+			case FOP_SUB:
+				a -= b;
+				break;
+			case FOP_MUL:
+				a *= b;
+				break;
+			case FOP_DIV:
+				if (b == 0)
+					return false;
+				a /= b;
+				break;
+			case FOP_FLOORDIV:
+			case FOP_MOD:
+				if (b == 0)
+					return false;
+				formula_divmod(a, b, &div, &mod);
+				a = (op.code == FOP_FLOORDIV) ? div : mod;
+				break;
+			case FOP_POW:
+				/* Python raises or goes complex or exact for these */
+				if ((a == 0 && b < 0) || (a < 0 && b != floor(b)))
+					return false;
+				a = pow(a, b);
+				if (!isfinite(a) || fabs(a) >= FORMULA_MAX_EXACT)
+					return false;
+				break;
+			default:
+				return false;
+		}
+		stack[sp - 1] = a;
+	}
+
+	if (!isfinite(stack[0]))
+		return false;
+	*ans = stack[0];
+	return true;
+}
+
+/**
+ * @brief	return the compiled form of a formula, compiling it the first
+ *		time it is seen
+ *
+ * @param[in]	formula	-	the formula text
+ *
+ * @return	const sched_formula *
+ *
+ * @par MT-Safe:	no
+ */
+const sched_formula *
+find_formula(const char *formula)
+{
+	auto f = formulas.find(formula);
+
+	if (f != formulas.end())
+		return f->second;
+
+	if (formulas.size() >= FORMULA_CACHE_MAX)
+		clear_formulas();
+
+	auto sf = new sched_formula(formula);
+	formulas[formula] = sf;
+	if (sf->native)
+		log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+			   "Formula will be evaluated natively: %s", formula);
+	else
+		log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+			   "Formula will be evaluated through Python (%s): %s", sf->why_not_native.c_str(), formula);
+	return sf;
+}
+
+/**
+ * @brief	drop all compiled formulas.  They point to resdefs, so this is
+ *		called whenever the resource definitions are replaced.
+ *
+ * @return	void
+ */
+void
+clear_formulas(void)
+{
+	for (auto &f : formulas)
+		delete f.second;
+	formulas.clear();
+}
+
+/**
+ * @brief	evaluate a compiled formula for a job
+ *
+ * @param[in]	formula	-	compiled formula
+ * @param[in]	resresv	-	job for the special terms
+ * @param[in]	resreq	-	resources to use when evaluating
+ *
+ * @return	evaluated formula answer or 0 on error
+ */
+sch_resource_t
+formula_evaluate(const sched_formula *formula, resource_resv *resresv, resource_req *resreq)
+{
+	sch_resource_t ans;
+
+	if (formula == NULL || resresv == NULL || resresv->job == NULL)
+		return 0;
+
+	if (formula->evaluate(resresv, resreq, &ans))
+		return ans;
+
+	return formula_evaluate_python(formula->text.c_str(), resresv, resreq);
+}
+
+/**
+ * @brief	set the formula_value of every job in an array.  Native
+ *		evaluations are spread over the worker threads, the jobs left
+ *		for Python are done afterwards by this thread.
+ *
+ * @param[in]	formula	-	compiled formula
+ * @param[in,out]	jobs	-	the jobs
+ *
+ * @return	void
+ */
+void
+formula_evaluate_jobs(const sched_formula *formula, resource_resv **jobs)
+{
+	int num_jobs;
+
+	if (formula == NULL || jobs == NULL)
+		return;
+
+	num_jobs = count_array(jobs);
+	std::vector<char> need_python(num_jobs, 1);
+
+	if (formula->is_native()) {
+		parallel_for(TS_EVAL_FORMULA, num_jobs, mt_grainsize(num_jobs), [&](int sidx, int eidx, int chunk) {
+			for (int i = sidx; i <= eidx; i++) {
+				sch_resource_t ans;
+
+				if (jobs[i]->job == NULL)
+					need_python[i] = 0;
+				else if (formula->evaluate(jobs[i], jobs[i]->resreq, &ans)) {
+					jobs[i]->job->formula_value = ans;
+					need_python[i] = 0;
+				}
+			}
+		});
+	}
+
+	for (int i = 0; i < num_jobs; i++)
+		if (need_python[i] && jobs[i]->job != NULL)
+			jobs[i]->job->formula_value = formula_evaluate_python(formula->text.c_str(), jobs[i], jobs[i]->resreq);
+}
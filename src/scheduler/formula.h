@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+#ifndef _FORMULA_H
+#define _FORMULA_H
+
+#include <string>
+#include <vector>
+#include "data_types.h"
+
+/* an operation of a compiled formula, run on a stack of values */
+enum formula_opcode {
+	FOP_CONST,	/* push a number */
+	FOP_RES,	/* push the amount of a consumable resource */
+	FOP_TERM,	/* push one of the special terms (eligible_time, ...) */
+	FOP_NEG,
+	FOP_ADD,
+	FOP_SUB,
+	FOP_MUL,
+	FOP_DIV,
+	FOP_FLOORDIV,
+	FOP_MOD,
+	FOP_POW
+};
+
+/* special terms of a formula, see FORMULA_* in pbs_share.h */
+enum formula_term {
+	FTERM_ELIGIBLE_TIME,
+	FTERM_QUEUE_PRIO,
+	FTERM_JOB_PRIO,
+	FTERM_FSPERC,
+	FTERM_TREE_USAGE,
+	FTERM_FSFACTOR,
+	FTERM_ACCRUE_TYPE
+};
+
+struct formula_op {
+	enum formula_opcode code;
+	double value;	    /* FOP_CONST */
+	resdef *def;	    /* FOP_RES */
+	enum formula_term term; /* FOP_TERM */
+};
+
+/*
+ * sched_formula - a formula (job_sort_formula or fairshare_usage_res)
+ *		   compiled into a program over resources and special terms
+ *
+ *	Formulas using only numbers, resources, special terms, parentheses and
+ *	the arithmetic operators are evaluated natively with Python's
+ *	semantics.  Anything else is left to the embedded Python interpreter.
+ */
+class sched_formula
+{
+public:
+	explicit sched_formula(const std::string &formula);
+
+	/* the formula can be evaluated without Python */
+	bool is_native() const { return native; }
+
+	/* evaluate natively; false if the job needs Python (errors, overflow) */
+	bool evaluate(resource_resv *resresv, resource_req *resreq, sch_resource_t *ans) const;
+
+	const std::string text;
+
+private:
+	bool native;
+	std::string why_not_native; /* what the parser stopped at */
+	int max_depth;		    /* stack depth the program needs */
+	std::vector<formula_op> prog;
+
+	friend class formula_parser;
+	friend const sched_formula *find_formula(const char *formula);
+};
+
+/*
+ *	find_formula - return the compiled form of a formula, compiling it
+ *		       the first time it is seen
+ */
+const sched_formula *find_formula(const char *formula);
+
+/*
+ *	clear_formulas - drop all compiled formulas (they refer to resdefs)
+ */
+void clear_formulas(void);
+
+/*
+ *	formula_evaluate - evaluate a compiled formula for a job, through
+ *			   Python if it can't be done natively
+ */
+sch_resource_t formula_evaluate(const sched_formula *formula, resource_resv *resresv, resource_req *resreq);
+
+/*
+ *	formula_evaluate_jobs - set formula_value of every job in an array
+ */
+void formula_evaluate_jobs(const sched_formula *formula, resource_resv **jobs);
+
+#endif /* _FORMULA_H */
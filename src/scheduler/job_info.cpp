@@ -72,6 +72,7 @@
  * 	modify_job_array_for_qrun()
  * 	queue_subjob()
  * 	formula_evaluate()
+ * 	formula_evaluate_python()
  * 	make_eligible()
  * 	make_ineligible()
  * 	update_accruetype()
@@ -98,6 +99,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <math.h>
+#include <unordered_map>
 #include <pbs_ifl.h>
 #include <log.h>
 #include <libutil.h>
@@ -125,6 +127,8 @@
 #include "attribute.h"
 #include "multi_threading.h"
 #include "libpbs.h"
+#include "state_feed.h"
+#include "formula.h"
 
 #ifdef NAS
 #include "site_code.h"
@@ -548,44 +552,6 @@ query_jobs_chunk(th_data_query_jinfo *data)
 	free_schd_error(err);
 }
 
-/**
- * @brief	Allocates th_data_query_jinfo for multi-threading of query_jobs
- *
- * @param[in]	policy	-	policy info
- * @param[in]	pbs_sd	-	connection to pbs_server
- * @param[in]	jobs	-	batch_status of jobs
- * @param[in]	qinfo	-	queue to get jobs from
- * @param[in]	sidx	-	start index for the jobs list for the thread
- * @param[in]	eidx	-	end index for the jobs list for the thread
- *
- * @return th_data_query_jinfo *
- * @retval a newly allocated th_data_query_jinfo object
- * @retval NULL for malloc error
- */
-static inline th_data_query_jinfo *
-alloc_tdata_jquery(status *policy, int pbs_sd, struct batch_status *jobs, queue_info *qinfo,
-		   int sidx, int eidx)
-{
-	th_data_query_jinfo *tdata;
-
-	tdata = static_cast<th_data_query_jinfo *>(malloc(sizeof(th_data_query_jinfo)));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-	tdata->error = 0;
-	tdata->jobs = jobs;
-	tdata->oarr = NULL; /* Will be filled by the thread routine */
-	tdata->sinfo = qinfo->server;
-	tdata->qinfo = qinfo;
-	tdata->pbs_sd = pbs_sd;
-	tdata->policy = policy;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  * 		create an array of jobs in a specified queue
@@ -633,10 +599,10 @@ query_jobs(status *policy, int pbs_sd, queue_info *qinfo, resource_resv **pjobs,
 
 	/* for multi-threading */
 	int jidx;
-	th_data_query_jinfo *tdata = NULL;
-	th_task_info *task = NULL;
-	resource_resv ***jinfo_arrs_tasks;
-	int tid;
+	int grain;
+	int num_chunks;
+	int th_err = 0;
+	int i;
 
 	if (policy == NULL || qinfo == NULL || queue_name.empty())
 		return pjobs;
@@ -697,7 +663,9 @@ query_jobs(status *policy, int pbs_sd, queue_info *qinfo, resource_resv **pjobs,
 	}
 
 	/* get jobs from PBS server */
-	if ((jobs = send_selstat(pbs_sd, &opl, attrib, const_cast<char *>("S"))) == NULL) {
+	jobs = feed_query(pbs_sd, "jobs:" + qinfo->name + ":" + queue_name, "S",
+			  [&](char *extend) { return send_selstat(pbs_sd, &opl, attrib, extend); });
+	if (jobs == NULL) {
 		if (pbs_errno > 0) {
 			const char *errmsg = pbs_geterrmsg(pbs_sd);
 			if (errmsg == NULL)
@@ -725,110 +693,56 @@ query_jobs(status *policy, int pbs_sd, queue_info *qinfo, resource_resv **pjobs,
 
 	if (resresv_arr == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
-		pbs_statfree(jobs);
+		feed_release(jobs);
 		return NULL;
 	}
 	resresv_arr[num_prev_jobs] = NULL;
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_jquery(policy, pbs_sd, jobs, qinfo, 0, num_new_jobs - 1);
-		if (tdata == NULL) {
-			free_resource_resv_array(resresv_arr);
-			pbs_statfree(jobs);
-			return NULL;
-		}
-		query_jobs_chunk(tdata);
-
-		if (tdata->error || tdata->oarr == NULL) {
-			free_resource_resv_array(resresv_arr);
-			pbs_statfree(jobs);
-			free(tdata->oarr);
-			free(tdata);
-			return NULL;
-		}
-
-		jidx = num_prev_jobs;
-		for (int j = 0; tdata->oarr[j] != NULL; j++) {
-			resresv_arr[jidx++] = tdata->oarr[j];
-		}
-		free(tdata->oarr);
-		free(tdata);
-		resresv_arr[jidx] = NULL;
-	} else {
-		int chunk_size = num_new_jobs / num_threads;
-		int th_err = 0;
-		int num_tasks = 0;
-
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		chunk_size = (chunk_size < MT_CHUNK_SIZE_MAX) ? chunk_size : MT_CHUNK_SIZE_MAX;
-		for (int j = 0; num_new_jobs > 0;
-		     num_tasks++, j += chunk_size, num_new_jobs -= chunk_size) {
-			tdata = alloc_tdata_jquery(policy, pbs_sd, jobs, qinfo, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-			if (task == NULL) {
-				free(tdata);
-				log_err(errno, __func__, MEM_ERR_MSG);
-				th_err = 1;
-				break;
-			}
-			task->task_id = num_tasks;
-			task->task_type = TS_QUERY_JOB_INFO;
-			task->thread_data = (void *) tdata;
-
-			pthread_mutex_lock(&work_lock);
-			ds_enqueue(work_queue, (void *) task);
-			pthread_cond_signal(&work_cond);
-			pthread_mutex_unlock(&work_lock);
-		}
-		jinfo_arrs_tasks = static_cast<resource_resv ***>(malloc(num_tasks * sizeof(resource_resv **)));
-		if (jinfo_arrs_tasks == NULL) {
-			log_err(errno, __func__, MEM_ERR_MSG);
+	grain = mt_grainsize(num_new_jobs);
+	num_chunks = (num_new_jobs + grain - 1) / grain;
+	std::vector<th_data_query_jinfo> tdata(num_chunks);
+	std::vector<struct batch_status *> chunk_start(num_chunks, NULL);
+
+	/* remember where each chunk starts so no thread has to walk the list */
+	for (cur_job = jobs, i = 0; cur_job != NULL; cur_job = cur_job->next, i++)
+		if (i % grain == 0)
+			chunk_start[i / grain] = cur_job;
+
+	parallel_for(TS_QUERY_JOB_INFO, num_new_jobs, grain, [&](int sidx, int eidx, int chunk) {
+		th_data_query_jinfo *td = &tdata[chunk];
+
+		td->error = 0;
+		td->jobs = chunk_start[chunk];
+		td->oarr = NULL; /* Will be filled by query_jobs_chunk() */
+		td->sinfo = qinfo->server;
+		td->qinfo = qinfo;
+		td->pbs_sd = pbs_sd;
+		td->policy = policy;
+		td->sidx = 0;
+		td->eidx = eidx - sidx;
+		query_jobs_chunk(td);
+	});
+
+	/* Assemble job info objects from the chunks into the resresv_arr */
+	jidx = num_prev_jobs;
+	for (i = 0; i < num_chunks; i++) {
+		if (tdata[i].error)
 			th_err = 1;
+		else if (tdata[i].oarr != NULL) {
+			for (int j = 0; tdata[i].oarr[j] != NULL; j++)
+				resresv_arr[jidx++] = tdata[i].oarr[j];
 		}
-		/* Get results from worker threads */
-		for (int i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-				tdata = static_cast<th_data_query_jinfo *>(task->thread_data);
-				if (tdata->error)
-					th_err = 1;
-				jinfo_arrs_tasks[task->task_id] = tdata->oarr;
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
-		if (th_err) {
-			pbs_statfree(jobs);
-			free_resource_resv_array(resresv_arr);
-			free(jinfo_arrs_tasks);
-			return NULL;
-		}
-		/* Assemble job info objects from various threads into the resresv_arr */
-		jidx = num_prev_jobs;
-		for (int i = 0; i < num_tasks; i++) {
-			if (jinfo_arrs_tasks[i] != NULL) {
-				for (int j = 0; jinfo_arrs_tasks[i][j] != NULL; j++) {
-					resresv_arr[jidx++] = jinfo_arrs_tasks[i][j];
-				}
-				free(jinfo_arrs_tasks[i]);
-			}
-		}
-		resresv_arr[jidx] = NULL;
-		free(jinfo_arrs_tasks);
+		free(tdata[i].oarr);
+	}
+	resresv_arr[jidx] = NULL;
+
+	if (th_err) {
+		feed_release(jobs);
+		free_resource_resv_array(resresv_arr);
+		return NULL;
 	}
 
-	pbs_statfree(jobs);
+	feed_release(jobs);
 
 	return resresv_arr;
 }
@@ -895,7 +809,7 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 					resresv->job->sh_info = site_find_alloc_share(sinfo, attrp->value);
 				}
 #else
-				resresv->job->ginfo = find_alloc_ginfo(attrp->value, sinfo->fstree->root);
+				resresv->job->ginfo = find_alloc_ginfo(attrp->value, sinfo->fstree);
 #endif /* localmod 059 */
 			} else
 				resresv->job->ginfo = NULL;
@@ -975,7 +889,7 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 			resresv->job->schedsel = string_dup(attrp->value);
 #endif /* localmod 031 */
 
-			resresv->select = parse_selspec(attrp->value);
+			resresv->select.reset(parse_selspec(attrp->value));
 #ifdef NAS /* localmod 031 */
 		}
 #endif /* localmod 031 */
@@ -1039,7 +953,7 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 				}
 #endif
 				if (!strcmp(attrp->resource, "place")) {
-					resresv->place_spec = parse_placespec(attrp->value);
+					resresv->place_spec.reset(parse_placespec(attrp->value), free_place);
 					if (resresv->place_spec == NULL) {
 						set_schd_error_codes(err, NEVER_RUN, ERR_SPECIAL);
 						set_schd_error_arg(err, SPECMSG, "invalid placement spec");
@@ -1104,9 +1018,9 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 		resresv->job->peer_sd = pbs_sd;
 	}
 
-	if ((resresv->aoename = getaoename(resresv->select)) != NULL)
+	if ((resresv->aoename = getaoename(resresv->select.get())) != NULL)
 		resresv->is_prov_needed = true;
-	if ((resresv->eoename = geteoename(resresv->select)) != NULL) {
+	if ((resresv->eoename = geteoename(resresv->select.get())) != NULL) {
 		/* job with a power profile can't be checkpointed or suspended */
 		resresv->job->can_checkpoint = false;
 		resresv->job->can_suspend = false;
@@ -1155,7 +1069,7 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 		selectspec = create_select_from_nspec(resresv->nspec_arr);
 
 	if (!selectspec.empty())
-		resresv->execselect = parse_selspec(selectspec);
+		resresv->execselect.reset(parse_selspec(selectspec));
 
 	set_job_times(pbs_sd, resresv, sinfo->server_time);
 
@@ -1179,7 +1093,7 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 	if (conf.fairshare_ent == "queue") {
 		if (sinfo->fstree != NULL) {
 			resresv->job->ginfo =
-				find_alloc_ginfo(qinfo->name, sinfo->fstree->root);
+				find_alloc_ginfo(qinfo->name, sinfo->fstree);
 		} else
 			resresv->job->ginfo = NULL;
 	}
@@ -1197,7 +1111,7 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 		sprintf(fairshare_name, "%s:%s", resresv->group.c_str(), resresv->user.c_str());
 #endif /* localmod 058 */
 		if (resresv->server->fstree != NULL) {
-			resresv->job->ginfo = find_alloc_ginfo(fairshare_name, sinfo->fstree->root);
+			resresv->job->ginfo = find_alloc_ginfo(fairshare_name, sinfo->fstree);
 		} else
 			resresv->job->ginfo = NULL;
 	}
@@ -2014,6 +1928,8 @@ new_resresv_set(void)
 	}
 
 	rset->can_not_run = 0;
+	rset->carry = 0;
+	rset->carried = 0;
 	rset->err = NULL;
 	rset->user = NULL;
 	rset->group = NULL;
@@ -2076,6 +1992,8 @@ dup_resresv_set(resresv_set *oset, server_info *nsinfo)
 		return NULL;
 
 	rset->can_not_run = oset->can_not_run;
+	rset->carry = oset->carry;
+	rset->carried = oset->carried;
 
 	rset->err = dup_schd_error(oset->err);
 	if (oset->err != NULL && oset->err == NULL) {
@@ -2256,9 +2174,9 @@ resresv_set_which_selspec(resource_resv *resresv)
 		return NULL;
 
 	if (resresv->job != NULL && !resresv->job->is_running && resresv->execselect != NULL)
-		return resresv->execselect;
+		return resresv->execselect.get();
 
-	return resresv->select;
+	return resresv->select.get();
 }
 
 /**
@@ -2333,7 +2251,7 @@ create_resresv_set_by_resresv(status *policy, server_info *sinfo, resource_resv
 		free_resresv_set(rset);
 		return NULL;
 	}
-	rset->place_spec = dup_place(resresv->place_spec);
+	rset->place_spec = dup_place(resresv->place_spec.get());
 	if (rset->place_spec == NULL) {
 		free_resresv_set(rset);
 		return NULL;
@@ -2344,6 +2262,55 @@ create_resresv_set_by_resresv(status *policy, server_info *sinfo, resource_resv
 	return rset;
 }
 
+/**
+ * @brief does a resresv_set have the given component parts
+ * @par qinfo, user, group, project, or req can be NULL if the resresv_set does not have one
+ * @param[in] policy - policy info
+ * @param[in] rset - resresv_set to check
+ * @param[in] user - user name
+ * @param[in] group - group name
+ * @param[in] project - project name
+ * @param[in] sel - select spec
+ * @param[in] pl - place spec
+ * @param[in] req - list of resources (i.e., qsub -l)
+ * @param[in] qinfo - queue
+ * @return bool
+ * @retval true if the resresv_set matches
+ * @retval false if not
+ */
+static bool
+resresv_set_matches(status *policy, resresv_set *rset, const char *user, const char *group, const char *project, selspec *sel, place *pl, resource_req *req, queue_info *qinfo)
+{
+	if ((qinfo != NULL && rset->qinfo == NULL) || (qinfo == NULL && rset->qinfo != NULL))
+		return false;
+	if ((qinfo != NULL && rset->qinfo != NULL) && qinfo->name != rset->qinfo->name)
+		return false;
+
+	if ((user != NULL && rset->user == NULL) || (user == NULL && rset->user != NULL))
+		return false;
+	if (user != NULL && cstrcmp(user, rset->user) != 0)
+		return false;
+
+	if ((group != NULL && rset->group == NULL) || (group == NULL && rset->group != NULL))
+		return false;
+	if (group != NULL && cstrcmp(group, rset->group) != 0)
+		return false;
+
+	if ((project != NULL && rset->project == NULL) || (project == NULL && rset->project != NULL))
+		return false;
+	if (project != NULL && cstrcmp(project, rset->project) != 0)
+		return false;
+
+	if (compare_selspec(rset->select_spec, sel) == 0)
+		return false;
+	if (compare_place(rset->place_spec, pl) == 0)
+		return false;
+	if (compare_resource_req_list(rset->req, req, policy->equiv_class_resdef) == 0)
+		return false;
+
+	return true;
+}
+
 /**
  * @brief find the index of a resresv_set by its component parts
  * @par qinfo, user, group, project, or req can be NULL if the resresv_set does not have one
@@ -2369,36 +2336,114 @@ find_resresv_set(status *policy, resresv_set **rsets, const char *user, const ch
 		return -1;
 
 	for (i = 0; rsets[i] != NULL; i++) {
-		if ((qinfo != NULL && rsets[i]->qinfo == NULL) || (qinfo == NULL && rsets[i]->qinfo != NULL))
-			continue;
-		if ((qinfo != NULL && rsets[i]->qinfo != NULL) && qinfo->name != rsets[i]->qinfo->name)
+		if (resresv_set_matches(policy, rsets[i], user, group, project, sel, pl, req, qinfo))
+			return i;
+	}
+	return -1;
+}
 
-			continue;
-		if ((user != NULL && rsets[i]->user == NULL) || (user == NULL && rsets[i]->user != NULL))
-			continue;
-		if (user != NULL && cstrcmp(user, rsets[i]->user) != 0)
-			continue;
+/**
+ * @brief hash the resources of a resource_req list which
+ *	  compare_resource_req_list() would compare
+ *
+ * @par
+ *	The terms of each resource are added up so the order of the list
+ *	doesn't matter.  Resources compare_resource_req() never finds equal
+ *	are left out.
+ *
+ * @param[in] reqlist - the resources
+ * @param[in] defs - the resources to hash
+ *
+ * @return size_t
+ */
+static size_t
+resresv_set_req_key(resource_req *reqlist, std::unordered_set<resdef *> &defs)
+{
+	size_t key = 0;
 
-		if ((group != NULL && rsets[i]->group == NULL) || (group == NULL && rsets[i]->group != NULL))
-			continue;
-		if (group != NULL && cstrcmp(group, rsets[i]->group) != 0)
-			continue;
+	for (auto req = reqlist; req != NULL; req = req->next) {
+		size_t val;
 
-		if ((project != NULL && rsets[i]->project == NULL) || (project == NULL && rsets[i]->project != NULL))
-			continue;
-		if (project != NULL && cstrcmp(project, rsets[i]->project) != 0)
+		if (defs.find(req->def) == defs.end())
 			continue;
 
-		if (compare_selspec(rsets[i]->select_spec, sel) == 0)
-			continue;
-		if (compare_place(rsets[i]->place_spec, pl) == 0)
-			continue;
-		if (compare_resource_req_list(rsets[i]->req, req, policy->equiv_class_resdef) == 0)
+		if (req->type.is_consumable || req->type.is_boolean)
+			val = std::hash<sch_resource_t>()(req->amount);
+		else if (req->type.is_string && req->res_str != NULL)
+			val = std::hash<std::string>()(req->res_str);
+		else
 			continue;
-		/* If we got here, we have found our set */
-		return i;
+
+		key += (std::hash<resdef *>()(req->def) ^ val) * 0x9e3779b97f4a7c15ULL;
 	}
-	return -1;
+
+	return key;
+}
+
+/**
+ * @brief hash the component parts of a resresv_set
+ *
+ * @par
+ *	Parts which resresv_set_matches() finds equal hash the same, so only
+ *	the sets with the same key need to be compared.
+ *
+ * @return size_t
+ * @retval key of the resresv_set
+ */
+static size_t
+resresv_set_key(status *policy, const char *user, const char *group, const char *project, selspec *sel, place *pl, resource_req *req, queue_info *qinfo)
+{
+	std::hash<std::string> str_hash;
+	size_t key = 0;
+
+	if (qinfo != NULL)
+		key = str_hash(qinfo->name);
+	key = key * 31 + (user != NULL ? str_hash(user) : 0);
+	key = key * 31 + (group != NULL ? str_hash(group) : 0);
+	key = key * 31 + (project != NULL ? str_hash(project) : 0);
+
+	if (sel != NULL) {
+		key = key * 31 + sel->total_chunks;
+		if (sel->chunks != NULL)
+			for (int i = 0; sel->chunks[i] != NULL; i++)
+				key = key * 31 + sel->chunks[i]->num_chunks + resresv_set_req_key(sel->chunks[i]->req, conf.resdef_to_check);
+	}
+
+	if (pl != NULL) {
+		key = key * 31 + (pl->excl | pl->exclhost << 1 | pl->share << 2 | pl->free << 3 |
+				  pl->pack << 4 | pl->scatter << 5 | pl->vscatter << 6);
+		if (pl->group != NULL)
+			key = key * 31 + str_hash(pl->group);
+	}
+
+	return key * 31 + resresv_set_req_key(req, policy->equiv_class_resdef);
+}
+
+/**
+ * @brief find which of a resresv's user, group, project, and queue a
+ *	  resresv_set uses.  The ones not used are left NULL.
+ * @param[in] resresv - the resresv
+ * @param[out] user - user name
+ * @param[out] grp - group name
+ * @param[out] proj - project name
+ * @param[out] qinfo - queue
+ * @return void
+ */
+static void
+resresv_set_parts(resource_resv *resresv, const char **user, const char **grp, const char **proj, queue_info **qinfo)
+{
+	if (resresv->is_job && resresv->job != NULL)
+		if (resresv_set_use_queue(resresv->job->queue))
+			*qinfo = resresv->job->queue;
+
+	if (resresv_set_use_user(resresv->server, *qinfo))
+		*user = resresv->user.c_str();
+
+	if (resresv_set_use_grp(resresv->server, *qinfo))
+		*grp = resresv->group.c_str();
+
+	if (resresv_set_use_proj(resresv->server, *qinfo))
+		*proj = resresv->project.c_str();
 }
 
 /**
@@ -2415,27 +2460,13 @@ find_resresv_set_by_resresv(status *policy, resresv_set **rsets, resource_resv *
 	const char *grp = NULL;
 	const char *proj = NULL;
 	queue_info *qinfo = NULL;
-	selspec *sspec;
 
 	if (policy == NULL || rsets == NULL || resresv == NULL)
 		return -1;
 
-	if (resresv->is_job && resresv->job != NULL)
-		if (resresv_set_use_queue(resresv->job->queue))
-			qinfo = resresv->job->queue;
-
-	if (resresv_set_use_user(resresv->server, qinfo))
-		user = resresv->user.c_str();
-
-	if (resresv_set_use_grp(resresv->server, qinfo))
-		grp = resresv->group.c_str();
-
-	if (resresv_set_use_proj(resresv->server, qinfo))
-		proj = resresv->project.c_str();
+	resresv_set_parts(resresv, &user, &grp, &proj, &qinfo);
 
-	sspec = resresv_set_which_selspec(resresv);
-
-	return find_resresv_set(policy, rsets, user, grp, proj, sspec, resresv->place_spec, resresv->resreq, qinfo);
+	return find_resresv_set(policy, rsets, user, grp, proj, resresv_set_which_selspec(resresv), resresv->place_spec.get(), resresv->resreq, qinfo);
 }
 
 /**
@@ -2470,8 +2501,28 @@ create_resresv_sets(status *policy, server_info *sinfo)
 
 	rsets[0] = NULL;
 
+	/* index the sets by the hash of their parts so each resresv is only
+	 * compared to the sets it could belong to
+	 */
+	std::unordered_multimap<size_t, int> set_index;
+
 	for (i = 0; resresvs[i] != NULL; i++) {
-		auto cur_ind = find_resresv_set_by_resresv(policy, rsets, resresvs[i]);
+		const char *user = NULL;
+		const char *grp = NULL;
+		const char *proj = NULL;
+		queue_info *qinfo = NULL;
+		selspec *sspec = resresv_set_which_selspec(resresvs[i]);
+		int cur_ind = -1;
+
+		resresv_set_parts(resresvs[i], &user, &grp, &proj, &qinfo);
+		auto key = resresv_set_key(policy, user, grp, proj, sspec, resresvs[i]->place_spec.get(), resresvs[i]->resreq, qinfo);
+		auto range = set_index.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (resresv_set_matches(policy, rsets[it->second], user, grp, proj, sspec, resresvs[i]->place_spec.get(), resresvs[i]->resreq, qinfo)) {
+				cur_ind = it->second;
+				break;
+			}
+		}
 
 		/* Didn't find the set, create it.*/
 		if (cur_ind == -1) {
@@ -2483,6 +2534,7 @@ create_resresv_sets(status *policy, server_info *sinfo)
 			cur_ind = j;
 			rsets[j++] = cur_rset;
 			rsets[j] = NULL;
+			set_index.emplace(key, cur_ind);
 		}
 		resresvs[i]->ec_index = cur_ind;
 	}
@@ -2499,6 +2551,237 @@ create_resresv_sets(status *policy, server_info *sinfo)
 	return rsets;
 }
 
+/* a can-not-run verdict of an equivalence class kept for the next cycle */
+struct ec_verdict {
+	resresv_set *rset; /* copy of the class, its qinfo is not kept */
+	std::string qname; /* name of the class's queue, empty if it has none */
+};
+
+/* kept verdicts by resresv_set_key() */
+static std::unordered_multimap<size_t, ec_verdict> ec_verdicts;
+/* universe_state_key() of the universe the verdicts were kept from */
+static size_t ec_verdicts_state;
+
+/**
+ * @brief hash a resource list's amounts available and assigned
+ * @param[in] res - resource list
+ * @return size_t
+ */
+static size_t
+res_state_key(schd_resource *res)
+{
+	size_t key = 0;
+
+	for (; res != NULL; res = res->next) {
+		size_t val = std::hash<sch_resource_t>()(res->avail) * 31 + std::hash<sch_resource_t>()(res->assigned);
+
+		if (res->orig_str_avail != NULL)
+			val = val * 31 + std::hash<std::string>()(res->orig_str_avail);
+		key += (std::hash<resdef *>()(res->def) ^ val) * 0x9e3779b97f4a7c15ULL;
+	}
+
+	return key;
+}
+
+/**
+ * @brief hash the state of the universe a can-not-run verdict depends on:
+ *	  every node field node eligibility and the node search read, the
+ *	  resources of the nodes, queues and server, node grouping, the jobs
+ *	  holding resources, the reservations, and prime time.  The parts are
+ *	  summed so their order does not matter.
+ * @param[in] sinfo - server universe
+ * @return size_t
+ */
+static size_t
+universe_state_key(server_info *sinfo)
+{
+	std::hash<std::string> str_hash;
+	size_t key;
+	int i;
+
+	key = res_state_key(sinfo->res) * 31 + sinfo->policy->is_prime;
+	key = key * 31 + sinfo->node_group_enable;
+	for (const auto &ng : sinfo->node_group_key)
+		key = key * 31 + str_hash(ng);
+
+	for (auto qinfo : sinfo->queues) {
+		size_t val = qinfo->is_started | qinfo->is_ok_to_run << 1;
+
+		for (const auto &ng : qinfo->node_group_key)
+			val = val * 31 + str_hash(ng);
+		key += (str_hash(qinfo->name) ^ val) * 0x9e3779b97f4a7c15ULL + res_state_key(qinfo->qres);
+	}
+
+	for (i = 0; sinfo->nodes != NULL && sinfo->nodes[i] != NULL; i++) {
+		node_info *node = sinfo->nodes[i];
+		size_t flags = node->is_down | node->is_offline << 1 | node->is_unknown << 2 | node->is_stale << 3 |
+			       node->is_maintenance << 4 | node->is_provisioning << 5 | node->is_sleeping << 6 |
+			       node->is_free << 7 | node->is_exclusive << 8 | node->is_job_exclusive << 9 |
+			       node->is_resv_exclusive << 10 | node->is_sharing << 11 | node->is_busy << 12 |
+			       node->is_job_busy << 13 | node->lic_lock << 14 | node->has_hard_limit << 15 |
+			       node->no_multinode_jobs << 16 | node->resv_enable << 17 | node->provision_enable << 18 |
+			       node->is_multivnoded << 19 | node->power_provisioning << 20 |
+			       static_cast<size_t>(node->sharing) << 24;
+		size_t val;
+
+		/* everything node eligibility and the node search read */
+		val = str_hash(node->queue_name);
+		val = val * 31 + str_hash(node->current_aoe != NULL ? node->current_aoe : "");
+		val = val * 31 + str_hash(node->current_eoe != NULL ? node->current_eoe : "");
+		val = val * 31 + str_hash(node->partition != NULL ? node->partition : "");
+		val = val * 31 + node->priority;
+		val = val * 31 + node->num_jobs;
+		val = val * 31 + node->num_run_resv;
+		val = val * 31 + node->num_susp_jobs;
+		val = val * 31 + node->max_running;
+		val = val * 31 + node->max_user_run;
+		val = val * 31 + node->max_group_run;
+
+		key += (str_hash(node->name) ^ flags ^ val * 0x2545f4914f6cdd1dULL) * 0x9e3779b97f4a7c15ULL + res_state_key(node->res);
+	}
+
+	for (i = 0; sinfo->jobs != NULL && sinfo->jobs[i] != NULL; i++) {
+		job_info *job = sinfo->jobs[i]->job;
+
+		if (job->is_running || job->is_exiting || job->is_suspended)
+			key += str_hash(sinfo->jobs[i]->name) * (1 + 2 * (job->is_running | job->is_exiting << 1 | job->is_suspended << 2));
+	}
+
+	for (i = 0; sinfo->resvs != NULL && sinfo->resvs[i] != NULL; i++) {
+		resource_resv *resv = sinfo->resvs[i];
+
+		key += (str_hash(resv->name) ^ resv->resv->resv_state) * 0x9e3779b97f4a7c15ULL + resv->start * 31 + resv->end;
+	}
+
+	return key;
+}
+
+/**
+ * @brief can an equivalence class's can-not-run verdict be carried to the
+ *	  next cycle?  Only a lack of resources found against the universe as
+ *	  it is, not against the calendar of top jobs and reservations, still
+ *	  holds when the universe has not changed.
+ * @param[in] sinfo - server universe
+ * @param[in] err - why the class can not run
+ * @return bool
+ */
+bool
+resresv_set_verdict_carries(server_info *sinfo, schd_error *err)
+{
+	if (sinfo == NULL || err == NULL)
+		return false;
+
+	if (sinfo->calendar != NULL && sinfo->calendar->first_run_event != NULL)
+		return false;
+
+	switch (err->error_code) {
+		case NOT_ENOUGH_NODES_AVAIL:
+		case NO_NODE_RESOURCES:
+		case INSUFFICIENT_RESOURCE:
+		case INSUFFICIENT_QUEUE_RESOURCE:
+		case INSUFFICIENT_SERVER_RESOURCE:
+		case NO_FREE_NODES:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * @brief forget the kept can-not-run verdicts
+ * @return void
+ */
+void
+clear_resresv_set_verdicts(void)
+{
+	for (auto &v : ec_verdicts)
+		free_resresv_set(v.second.rset);
+	ec_verdicts.clear();
+}
+
+/**
+ * @brief set the can-not-run verdicts kept by save_resresv_set_verdicts()
+ *	  on sinfo's equivalence classes.  They are only used if the universe
+ *	  is as it was when they were kept, i.e., no job ended, and no node,
+ *	  queue, reservation or resource changed.  The classes' jobs are then
+ *	  turned away without a node search, as they would be after the first
+ *	  job of the class failed within a cycle.
+ * @param[in] sinfo - server universe at the start of the cycle
+ * @return void
+ */
+void
+carry_resresv_set_verdicts(server_info *sinfo)
+{
+	status *policy;
+	int n = 0;
+
+	if (sinfo == NULL || ec_verdicts.empty())
+		return;
+
+	policy = sinfo->policy;
+	if (sinfo->equiv_classes != NULL && universe_state_key(sinfo) == ec_verdicts_state) {
+		for (int i = 0; sinfo->equiv_classes[i] != NULL; i++) {
+			resresv_set *rset = sinfo->equiv_classes[i];
+			auto key = resresv_set_key(policy, rset->user, rset->group, rset->project, rset->select_spec, rset->place_spec, rset->req, rset->qinfo);
+			auto range = ec_verdicts.equal_range(key);
+
+			for (auto it = range.first; it != range.second; ++it) {
+				resresv_set *kept = it->second.rset;
+
+				if (it->second.qname != (rset->qinfo != NULL ? rset->qinfo->name : ""))
+					continue;
+				if (!resresv_set_matches(policy, kept, rset->user, rset->group, rset->project, rset->select_spec, rset->place_spec, rset->req, NULL))
+					continue;
+
+				rset->err = dup_schd_error(kept->err);
+				if (rset->err == NULL)
+					break;
+				rset->can_not_run = 1;
+				rset->carry = 1;
+				rset->carried = kept->carried + 1;
+				n++;
+				break;
+			}
+		}
+		log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+			   "Carried the can-not-run verdicts of %d equivalence classes", n);
+	}
+
+	clear_resresv_set_verdicts();
+}
+
+/**
+ * @brief keep the can-not-run verdicts of sinfo's equivalence classes for
+ *	  carry_resresv_set_verdicts() in the next cycle
+ * @param[in] sinfo - server universe at the end of the cycle
+ * @return void
+ */
+void
+save_resresv_set_verdicts(server_info *sinfo)
+{
+	clear_resresv_set_verdicts();
+
+	if (sinfo == NULL || sinfo->equiv_classes == NULL)
+		return;
+
+	for (int i = 0; sinfo->equiv_classes[i] != NULL; i++) {
+		resresv_set *rset = sinfo->equiv_classes[i];
+		resresv_set *kept;
+
+		if (!rset->can_not_run || !rset->carry || rset->carried >= EC_VERDICT_MAX_CYCLES)
+			continue;
+
+		kept = dup_resresv_set(rset, sinfo);
+		if (kept == NULL)
+			continue;
+		kept->qinfo = NULL;
+		ec_verdicts.emplace(resresv_set_key(sinfo->policy, rset->user, rset->group, rset->project, rset->select_spec, rset->place_spec, rset->req, rset->qinfo),
+				    ec_verdict{kept, rset->qinfo != NULL ? rset->qinfo->name : ""});
+	}
+
+	ec_verdicts_state = universe_state_key(sinfo);
+}
+
 /**
  * @brief
  * 		job_info copy constructor
@@ -2574,7 +2857,7 @@ dup_job_info(job_info *ojinfo, queue_info *nqinfo, server_info *nsinfo)
 
 	if (nqinfo->server->fstree != NULL) {
 		njinfo->ginfo = find_group_info(ojinfo->ginfo->name,
-						nqinfo->server->fstree->root);
+						nqinfo->server->fstree);
 	} else
 		njinfo->ginfo = NULL;
 
@@ -2920,6 +3203,51 @@ find_and_preempt_jobs(status *policy, int pbs_sd, resource_resv *hjob, server_in
 	return rc;
 }
 
+/**
+ * @brief
+ * 		is a job still short of the server or queue resource which kept it
+ * 		from running?  Preempting jobs only frees resources, so the checks
+ * 		is_ok_to_run() does before this one still pass.  The calendar can only
+ * 		make less of the resource available than there is right now.  If the
+ * 		job doesn't fit in what is available now, is_ok_to_run() would fail
+ * 		with the same error.
+ *
+ * @param[in]	hjob	-	the high priority job
+ * @param[in]	sinfo	-	the simulated server
+ * @param[in]	err	-	why hjob couldn't run the last time it was checked
+ *
+ * @return	bool
+ * @retval	true	: hjob is still short of err->rdef
+ * @retval	false	: it might not be, call is_ok_to_run()
+ */
+static bool
+still_short_of_resource(resource_resv *hjob, server_info *sinfo, schd_error *err)
+{
+	schd_resource *res;
+	resource_req *resreq;
+	std::unordered_set<resdef *> rdc;
+
+	if (err->rdef == NULL || err->status_code == NEVER_RUN)
+		return false;
+
+	if (err->error_code == INSUFFICIENT_SERVER_RESOURCE)
+		res = sinfo->res;
+	else if (err->error_code == INSUFFICIENT_QUEUE_RESOURCE)
+		res = hjob->job->queue->qres;
+	else
+		return false;
+	if (res == NULL)
+		return false;
+
+	if (hjob->job->resreq_rel != NULL)
+		resreq = hjob->job->resreq_rel;
+	else
+		resreq = hjob->resreq;
+
+	rdc.insert(err->rdef);
+	return check_avail_resources(res, resreq, NO_ALLPART, rdc, err->error_code, NULL) == 0;
+}
+
 /**
  * @brief
  * 		find jobs to preempt in order to run a high priority job.
@@ -2976,6 +3304,7 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob, server_info *sinfo, in
 	char **preempt_targets_list = NULL;
 	resource_resv **prjobs = NULL;
 	int rjobs_count = 0;
+	preempt_cand_cache cand_cache;
 
 	*no_of_jobs = 0;
 	if (hjob == NULL || sinfo == NULL)
@@ -3154,8 +3483,11 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob, server_info *sinfo, in
 		goto cleanup;
 	}
 
+	for (i = 0; fail_list[i] != 0; i++)
+		cand_cache.failed.insert(fail_list[i]);
+
 	skipto = 0;
-	while ((indexfound = select_index_to_preempt(npolicy, nhjob, rjobs_subset, skipto, err, fail_list)) != NO_JOB_FOUND) {
+	while ((indexfound = select_index_to_preempt(npolicy, nhjob, rjobs_subset, skipto, err, cand_cache)) != NO_JOB_FOUND) {
 		struct preempt_ordering *po;
 		int dont_preempt_job = 0;
 		int ind = 0;
@@ -3221,8 +3553,15 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob, server_info *sinfo, in
 		} else
 			old_rdef = NULL;
 
-		clear_schd_error(err);
-		ns_arr = is_ok_to_run(npolicy, nsinfo, nhjob->job->queue, nhjob, NO_ALLPART, err);
+		/* If we are still short of the server or queue resource, is_ok_to_run() would fail
+		 * the same way.  Skip it and leave err as it is.
+		 */
+		if (still_short_of_resource(nhjob, nsinfo, err))
+			free_nspecs(ns_arr);
+		else {
+			clear_schd_error(err);
+			ns_arr = is_ok_to_run(npolicy, nsinfo, nhjob->job->queue, nhjob, NO_ALLPART, err);
+		}
 		if (!ns_arr.empty()) {
 			/* Normally when running a subjob, we do not care about the subjob. We just care that it successfully runs.
 			 * We allow run_update_job() to enqueue and run the subjob.  In this case, we need to act upon the
@@ -3356,6 +3695,71 @@ cleanup:
 	return pjobs_list;
 }
 
+/**
+ * @brief
+ *		can a node hold any chunk of a job, going by its total resources?
+ *		This doesn't depend on what runs on the node, so the answer stays
+ *		the same while we simulate preempting jobs.
+ *
+ * @param[in] policy - policy info
+ * @param[in] hjob - the high priority job to preempt for
+ * @param[in] node - the node
+ *
+ * @return int
+ * @retval 1 a chunk of hjob fits on the node
+ * @retval 0 it does not
+ */
+static int
+node_can_hold_chunk(status *policy, resource_resv *hjob, node_info *node)
+{
+	bool only_check_noncons = false;
+	int fits = 0;
+	schd_error *err;
+
+	err = new_schd_error();
+	if (err == NULL)
+		return 0;
+
+	if (node->is_multivnoded) {
+		/* unsafe to consider vnodes from multivnoded hosts "no good" when "not enough" of some consumable
+		 * resource can be found in the vnode, since rest may be provided by other vnodes on the same host
+		 * restrict check on these vnodes to check only against non consumable resources
+		 */
+		if (policy->resdef_to_check_noncons.empty()) {
+			for (const auto &rtc : policy->resdef_to_check) {
+				if (rtc->type.is_non_consumable)
+					policy->resdef_to_check_noncons.insert(rtc);
+			}
+		}
+		only_check_noncons = true;
+	}
+	for (int k = 0; hjob->select->chunks[k] != NULL; k++) {
+		long num_chunks_returned = 0;
+		unsigned int flags = COMPARE_TOTAL | CHECK_ALL_BOOLS | UNSET_RES_ZERO;
+		/* if only non consumables are checked, infinite number of chunks can be satisfied,
+		 * and SCHD_INFINITY is negative, so don't be tempted to check on positive value
+		 */
+		clear_schd_error(err);
+		if (only_check_noncons) {
+			if (!policy->resdef_to_check_noncons.empty())
+				num_chunks_returned = check_avail_resources(node->res, hjob->select->chunks[k]->req,
+									    flags, policy->resdef_to_check_noncons, INSUFFICIENT_RESOURCE, err);
+			else
+				num_chunks_returned = SCHD_INFINITY;
+		} else
+			num_chunks_returned = check_avail_resources(node->res, hjob->select->chunks[k]->req,
+								    flags, INSUFFICIENT_RESOURCE, err);
+
+		if ((num_chunks_returned > 0) || (num_chunks_returned == SCHD_INFINITY)) {
+			fits = 1;
+			break;
+		}
+	}
+	free_schd_error(err);
+
+	return fits;
+}
+
 /**
  * @brief
  *		select a good candidate for preemption
@@ -3365,8 +3769,9 @@ cleanup:
  * @param[in] rjobs - the list of running jobs to select from
  * @param[in] skipto - Index from where we need to start looking into rjobs
  * @param[in] err    - reason the high prio job isn't running
- * @param[in] fail_list - list of jobs to skip. They previously failed to be preempted.
- *			  Do not select them again.
+ * @param[in,out] cache - what we know about hjob: the jobs which previously
+ *			  failed to be preempted (don't select them again) and
+ *			  which nodes can hold one of its chunks
  *
  * @return long
  * @retval index of the job to preempt
@@ -3376,9 +3781,9 @@ cleanup:
 long
 select_index_to_preempt(status *policy, resource_resv *hjob,
 			resource_resv **rjobs, long skipto, schd_error *err,
-			int *fail_list)
+			preempt_cand_cache &cache)
 {
-	int i, j, k;
+	int i, j;
 	int good = 1; /* good boolean: Is job eligible to be preempted */
 	struct preempt_ordering *po;
 
@@ -3424,12 +3829,8 @@ select_index_to_preempt(status *policy, resource_resv *hjob,
 		}
 
 		if (good) {
-			for (j = 0; fail_list[j] != 0; j++) {
-				if (fail_list[j] == rjobs[i]->rank) {
-					good = 0;
-					break;
-				}
-			}
+			if (cache.failed.find(rjobs[i]->rank) != cache.failed.end())
+				good = 0;
 		}
 
 		if (good) {
@@ -3484,54 +3885,22 @@ select_index_to_preempt(status *policy, resource_resv *hjob,
 			}
 		}
 		if (good) {
-			schd_error *err;
 			node_good = 0;
 
-			err = new_schd_error();
-			if (err == NULL)
-				return NO_JOB_FOUND;
-
 			for (j = 0; rjobs[i]->ninfo_arr[j] != NULL && !node_good; j++) {
 				node_info *node = rjobs[i]->ninfo_arr[j];
-				bool only_check_noncons = false;
+				int ind = node->node_ind;
 
-				if (node->is_multivnoded) {
-					/* unsafe to consider vnodes from multivnoded hosts "no good" when "not enough" of some consumable
-					 * resource can be found in the vnode, since rest may be provided by other vnodes on the same host
-					 * restrict check on these vnodes to check only against non consumable resources
-					 */
-					if (policy->resdef_to_check_noncons.empty()) {
-						for (const auto &rtc : policy->resdef_to_check) {
-							if (rtc->type.is_non_consumable)
-								policy->resdef_to_check_noncons.insert(rtc);
-						}
-					}
-					only_check_noncons = true;
-				}
-				for (k = 0; hjob->select->chunks[k] != NULL; k++) {
-					long num_chunks_returned = 0;
-					unsigned int flags = COMPARE_TOTAL | CHECK_ALL_BOOLS | UNSET_RES_ZERO;
-					/* if only non consumables are checked, infinite number of chunks can be satisfied,
-					 * and SCHD_INFINITY is negative, so don't be tempted to check on positive value
-					 */
-					clear_schd_error(err);
-					if (only_check_noncons) {
-						if (!policy->resdef_to_check_noncons.empty())
-							num_chunks_returned = check_avail_resources(node->res, hjob->select->chunks[k]->req,
-												    flags, policy->resdef_to_check_noncons, INSUFFICIENT_RESOURCE, err);
-						else
-							num_chunks_returned = SCHD_INFINITY;
-					} else
-						num_chunks_returned = check_avail_resources(node->res, hjob->select->chunks[k]->req,
-											    flags, INSUFFICIENT_RESOURCE, err);
-
-					if ((num_chunks_returned > 0) || (num_chunks_returned == SCHD_INFINITY)) {
-						node_good = 1;
-						break;
-					}
+				if (ind < 0) {
+					node_good = node_can_hold_chunk(policy, hjob, node);
+					continue;
 				}
+				if (static_cast<size_t>(ind) >= cache.node_fits.size())
+					cache.node_fits.resize(ind + 1, -1);
+				if (cache.node_fits[ind] == -1)
+					cache.node_fits[ind] = node_can_hold_chunk(policy, hjob, node);
+				node_good = cache.node_fits[ind];
 			}
-			free_schd_error(err);
 		}
 
 		if (node_good == 0)
@@ -3955,7 +4324,29 @@ queue_subjob(resource_resv *array, server_info *sinfo,
 /**
  * @brief
  * 		evaluate a math formula for jobs based on their resources
- *		NOTE: currently done through embedded python interpreter
+ *		The formula is compiled once and evaluated natively when
+ *		possible, see formula.cpp.
+ *
+ * @param[in]	formula	-	formula to evaluate
+ * @param[in]	resresv	-	job for special case key words
+ * @param[in]	resreq	-	resources to use when evaluating
+ *
+ * @return	evaluated formula answer or 0 on exception
+ *
+ */
+sch_resource_t
+formula_evaluate(const char *formula, resource_resv *resresv, resource_req *resreq)
+{
+	if (formula == NULL)
+		return 0;
+
+	return formula_evaluate(find_formula(formula), resresv, resreq);
+}
+
+/**
+ * @brief
+ * 		evaluate a math formula for jobs through the embedded python
+ *		interpreter
  *
  * @param[in]	formula	-	formula to evaluate
  * @param[in]	resresv	-	job for special case key words
@@ -3967,7 +4358,7 @@ queue_subjob(resource_resv *array, server_info *sinfo,
 
 #ifdef PYTHON
 sch_resource_t
-formula_evaluate(const char *formula, resource_resv *resresv, resource_req *resreq)
+formula_evaluate_python(const char *formula, resource_resv *resresv, resource_req *resreq)
 {
 	char buf[1024];
 	char *globals;
@@ -4080,7 +4471,7 @@ formula_evaluate(const char *formula, resource_resv *resresv, resource_req *resr
 }
 #else
 sch_resource_t
-formula_evaluate(char *formula, resource_resv *resresv, resource_req *resreq)
+formula_evaluate_python(const char *formula, resource_resv *resresv, resource_req *resreq)
 {
 	return 0;
 }
@@ -4613,8 +5004,7 @@ create_res_released(status *policy, resource_resv *pjob)
 		pjob->job->resreq_rel = create_resreq_rel_list(policy, pjob);
 	}
 	selectspec = create_select_from_nspec(pjob->job->resreleased);
-	delete pjob->execselect;
-	pjob->execselect = parse_selspec(selectspec);
+	pjob->execselect.reset(parse_selspec(selectspec));
 	return;
 }
 
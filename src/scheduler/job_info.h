@@ -167,7 +167,7 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob,
 long
 select_index_to_preempt(status *policy, resource_resv *hjob,
 			resource_resv **rjobs, long skipto, schd_error *err,
-			int *fail_list);
+			preempt_cand_cache &cache);
 
 /*
  *      preempt_level - take a preemption priority and return a preemption
@@ -244,11 +244,16 @@ queue_subjob(resource_resv *array, server_info *sinfo,
 	     queue_info *qinfo);
 /*
  *	formula_evaluate - evaluate a math formula for jobs based on their resources
- *		NOTE: currently done through embedded python interpreter
  */
 
 sch_resource_t formula_evaluate(const char *formula, resource_resv *resresv, resource_req *resreq);
 
+/*
+ *	formula_evaluate_python - evaluate a math formula for jobs through the
+ *				  embedded python interpreter
+ */
+sch_resource_t formula_evaluate_python(const char *formula, resource_resv *resresv, resource_req *resreq);
+
 /*
  *
  *      update_accruetype - Updates accrue_type of job on server.
@@ -358,6 +363,18 @@ std::unordered_set<resdef *> create_resresv_sets_resdef(status *policy);
 
 /* Create an array of resresv_sets based on sinfo*/
 resresv_set **create_resresv_sets(status *policy, server_info *sinfo);
+
+/* can an equivalence class's can-not-run verdict be carried to the next cycle */
+bool resresv_set_verdict_carries(server_info *sinfo, schd_error *err);
+
+/* set the can-not-run verdicts kept from the last cycle on sinfo's classes */
+void carry_resresv_set_verdicts(server_info *sinfo);
+
+/* keep the can-not-run verdicts of sinfo's classes for the next cycle */
+void save_resresv_set_verdicts(server_info *sinfo);
+
+/* forget the kept can-not-run verdicts */
+void clear_resresv_set_verdicts(void);
 /*
  * This function creates a string and update resources_released job
  *  attribute.
@@ -87,13 +87,13 @@
  * 	clear_limres()
  * 	lim_setrunlimits()
  * 	lim_setoldlimits()
+ * 	lim_alloc_ctx()
+ * 	lim_free_ctx()
  * 	lim_dup_ctx()
  * 	is_hardlimit()
- * 	lim_gengroupreskey()
- * 	lim_genprojectreskey()
- * 	lim_genuserreskey()
  * 	lim_callback()
- * 	lim_get()
+ * 	lim_get_run()
+ * 	lim_get_res()
  * 	schderr_args_q()
  * 	schderr_args_q_res()
  * 	schderr_args_server()
@@ -116,6 +116,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <string>
+#include <unordered_map>
 #include "pbs_config.h"
 #include "pbs_ifl.h"
 #include "data_types.h"
@@ -128,40 +130,60 @@
 #include "resource.h"
 #include "globals.h"
 
+/*
+ * The counts the limit functions check.  A limcounts either owns a copy of
+ * the counts, which it is free to change, or refers to the server's or
+ * queue's own counts, which are kept up to date as jobs are run and must
+ * only be read.
+ */
 class limcounts {
+      private:
+	counts_umap own_user;
+	counts_umap own_group;
+	counts_umap own_project;
+	counts_umap own_all;
+	bool owner;
+
       public:
-	counts_umap user;
-	counts_umap group;
-	counts_umap project;
-	counts_umap all;
+	counts_umap &user;
+	counts_umap &group;
+	counts_umap &project;
+	counts_umap &all;
 	limcounts() = delete;
 	limcounts(const counts_umap &ruser,
 		  const counts_umap &rgroup,
 		  const counts_umap &rproject,
 		  const counts_umap &rall);
-	limcounts(const limcounts &);
-	limcounts &operator=(const limcounts &);
+	limcounts(counts_umap &ruser,
+		  counts_umap &rgroup,
+		  counts_umap &rproject,
+		  counts_umap &rall,
+		  bool ref);
+	limcounts(const limcounts &) = delete;
+	limcounts &operator=(const limcounts &) = delete;
 	~limcounts();
 };
 
+struct lim_ctx;
+
 static int
 check_max_group_res(resource_resv *, counts_umap &,
-		    resdef **, void *);
+		    resdef **, struct lim_ctx *);
 static int
 check_max_project_res(resource_resv *, counts_umap &,
-		      resdef **, void *);
+		      resdef **, struct lim_ctx *);
 static int
 check_max_user_res(resource_resv *, counts_umap &,
-		   resdef **, void *);
+		   resdef **, struct lim_ctx *);
 static int
 check_max_group_res_soft(resource_resv *,
-			 counts_umap &, void *, int);
+			 counts_umap &, struct lim_ctx *, int);
 static int
 check_max_project_res_soft(resource_resv *,
-			   counts_umap &, void *, int);
+			   counts_umap &, struct lim_ctx *, int);
 static int
 check_max_user_res_soft(resource_resv **, resource_resv *,
-			counts_umap &, void *, int);
+			counts_umap &, struct lim_ctx *, int);
 static int
 check_server_max_user_run(server_info *, queue_info *,
 			  resource_resv *, limcounts *, limcounts *, schd_error *);
@@ -361,17 +383,16 @@ static struct lim_old2new old2new_soft[] = {
 	{ATTR_maxuserressoft, "u:" PBS_GENERIC_ENTITY, 1},
 	{ATTR_maxuserrunsoft, "u:" PBS_GENERIC_ENTITY, 0}};
 
-static const char allparam[] = PBS_ALL_ENTITY;
-static const char genparam[] = PBS_GENERIC_ENTITY;
+static const std::string allparam(PBS_ALL_ENTITY);
+static const std::string genparam(PBS_GENERIC_ENTITY);
 
 static int is_hardlimit(const struct attrl *);
 static int
 lim_callback(void *, enum lim_keytypes, char *, char *,
 	     char *, char *);
-static void *lim_dup_ctx(void *);
-static char *lim_gengroupreskey(const char *);
-static char *lim_genprojectreskey(const char *);
-static char *lim_genuserreskey(const char *);
+static struct lim_ctx *lim_alloc_ctx(void);
+static void lim_free_ctx(struct lim_ctx *);
+static struct lim_ctx *lim_dup_ctx(struct lim_ctx *);
 static void schderr_args_q(const std::string &, const char *, schd_error *);
 static void schderr_args_q(const std::string &, const std::string &, schd_error *);
 static void schderr_args_q_res(const std::string &, const char *, char *, schd_error *);
@@ -379,11 +400,33 @@ static void schderr_args_q_res(const std::string &, const std::string &, char *,
 static void schderr_args_server(const char *, schd_error *);
 static void schderr_args_server(const std::string &, schd_error *);
 static void schderr_args_server_res(std::string &, const char *, schd_error *);
-static sch_resource_t lim_get(const char *, void *);
+static sch_resource_t lim_get_run(enum lim_keytypes, const std::string &, struct lim_ctx *);
+static sch_resource_t lim_get_res(enum lim_keytypes, const std::string &, const resdef *, struct lim_ctx *);
 static int lim_setoldlimits(const struct attrl *, void *);
 static int lim_setreslimits(const struct attrl *, void *);
 static int lim_setrunlimits(const struct attrl *, void *);
 
+/**
+ * @struct	lim_ctx
+ * @brief
+ * 		limit storage context
+ * @par
+ *		The limits are stored in an entlim context as the strings they were
+ *		set with.  As they are set, they are also compiled into hash tables
+ *		keyed by entity name (and resource definition for resource limits)
+ *		so checking a limit doesn't have to build a key string and look it
+ *		up in the entlim tree.
+ *
+ * @param[in]	entctx	-	entlim context the limits are stored in
+ * @param[in]	run	-	run limits of each entity, by key type
+ * @param[in]	res	-	resource limits of each entity, by key type
+ */
+struct lim_ctx {
+	void *entctx;
+	std::unordered_map<std::string, sch_resource_t> run[LIM_OVERALL + 1];
+	std::unordered_map<std::string, std::unordered_map<const resdef *, sch_resource_t>> res[LIM_OVERALL + 1];
+};
+
 /**
  * @struct	limit_info
  * @brief
@@ -393,8 +436,8 @@ static int lim_setrunlimits(const struct attrl *, void *);
  * @param[in]	li_ctxs	-	limit context for storing (soft) resource and run limits
  */
 struct limit_info {
-	void *li_ctxh;
-	void *li_ctxs;
+	struct lim_ctx *li_ctxh;
+	struct lim_ctx *li_ctxs;
 };
 #define LI2RESCTX(li) (((struct limit_info *) li)->li_ctxh)
 #define LI2RESCTXSOFT(li) (((struct limit_info *) li)->li_ctxs)
@@ -442,14 +485,14 @@ lim_alloc_liminfo(void)
 	if ((lip = static_cast<limit_info *>(calloc(1, sizeof(struct limit_info)))) == NULL)
 		return NULL;
 	else {
-		void *ctx;
+		struct lim_ctx *ctx;
 
-		if ((ctx = entlim_initialize_ctx()) == NULL) {
+		if ((ctx = lim_alloc_ctx()) == NULL) {
 			lim_free_liminfo(lip);
 			return NULL;
 		} else
 			LI2RESCTX(lip) = ctx;
-		if ((ctx = entlim_initialize_ctx()) == NULL) {
+		if ((ctx = lim_alloc_ctx()) == NULL) {
 			lim_free_liminfo(lip);
 			return NULL;
 		} else
@@ -484,7 +527,7 @@ lim_dup_liminfo(void *p)
 	if ((newlip = static_cast<limit_info *>(calloc(1, sizeof(struct limit_info)))) == NULL)
 		return NULL;
 	else {
-		void *ctx;
+		struct lim_ctx *ctx;
 
 		if ((ctx = lim_dup_ctx(LI2RESCTX(oldlip))) == NULL) {
 			lim_free_liminfo(newlip);
@@ -527,19 +570,19 @@ lim_free_liminfo(void *p)
 		return;
 
 	if (LI2RESCTX(lip) != NULL) {
-		(void) entlim_free_ctx(LI2RESCTX(lip), free);
+		lim_free_ctx(LI2RESCTX(lip));
 		LI2RESCTX(lip) = NULL;
 	}
 	if (LI2RESCTXSOFT(lip) != NULL) {
-		(void) entlim_free_ctx(LI2RESCTXSOFT(lip), free);
+		lim_free_ctx(LI2RESCTXSOFT(lip));
 		LI2RESCTXSOFT(lip) = NULL;
 	}
 	if (LI2RUNCTX(lip) != NULL) {
-		(void) entlim_free_ctx(LI2RUNCTX(lip), free);
+		lim_free_ctx(LI2RUNCTX(lip));
 		LI2RUNCTX(lip) = NULL;
 	}
 	if (LI2RUNCTXSOFT(lip) != NULL) {
-		(void) entlim_free_ctx(LI2RUNCTXSOFT(lip), free);
+		lim_free_ctx(LI2RUNCTXSOFT(lip));
 		LI2RUNCTXSOFT(lip) = NULL;
 	}
 	free(lip);
@@ -678,14 +721,14 @@ has_hardlimits(void *p)
 	struct limit_info *lip = static_cast<limit_info *>(p);
 	char *k = NULL;
 
-	if (entlim_get_next(LI2RESCTX(lip), (void **) &k) != NULL) /* at least one hard resource limit present */
+	if (entlim_get_next(LI2RESCTX(lip)->entctx, (void **) &k) != NULL) /* at least one hard resource limit present */
 		return (1);
 
 	/* run limit already checked? */
 	if (LI2RUNCTX(lip) == LI2RESCTX(lip))
 		return (0);
 	k = NULL;
-	if (entlim_get_next(LI2RUNCTX(lip), (void **) &k) != NULL) /* at least one hard run limit present */
+	if (entlim_get_next(LI2RUNCTX(lip)->entctx, (void **) &k) != NULL) /* at least one hard run limit present */
 		return (1);
 
 	return (0);
@@ -707,14 +750,14 @@ has_softlimits(void *p)
 	struct limit_info *lip = static_cast<limit_info *>(p);
 	char *k = NULL;
 
-	if (entlim_get_next(LI2RESCTXSOFT(lip), (void **) &k) != NULL) /* at least one soft resource limit present */
+	if (entlim_get_next(LI2RESCTXSOFT(lip)->entctx, (void **) &k) != NULL) /* at least one soft resource limit present */
 		return (1);
 
 	/* run limit already checked? */
 	if (LI2RUNCTXSOFT(lip) == LI2RESCTXSOFT(lip))
 		return (0);
 	k = NULL;
-	if (entlim_get_next(LI2RUNCTXSOFT(lip), (void **) &k) != NULL) /* at least one soft run limit present */
+	if (entlim_get_next(LI2RUNCTXSOFT(lip)->entctx, (void **) &k) != NULL) /* at least one soft run limit present */
 		return (1);
 
 	return (0);
@@ -723,45 +766,44 @@ has_softlimits(void *p)
  * @brief
  *		limitcount class constructor.
  */
-// Parametrized Constructor
+// Parametrized Constructor: copy the counts
 limcounts::limcounts(const counts_umap &ruser,
 		     const counts_umap &rgroup,
 		     const counts_umap &rproject,
-		     const counts_umap &rall)
+		     const counts_umap &rall) : own_user(dup_counts_umap(ruser)),
+						own_group(dup_counts_umap(rgroup)),
+						own_project(dup_counts_umap(rproject)),
+						own_all(dup_counts_umap(rall)),
+						owner(true),
+						user(own_user),
+						group(own_group),
+						project(own_project),
+						all(own_all)
 {
-	user = dup_counts_umap(ruser);
-	group = dup_counts_umap(rgroup);
-	project = dup_counts_umap(rproject);
-	all = dup_counts_umap(rall);
 }
 
-// Copy Constructor
-limcounts::limcounts(const limcounts &rlimit)
+// Parametrized Constructor: refer to the counts
+limcounts::limcounts(counts_umap &ruser,
+		     counts_umap &rgroup,
+		     counts_umap &rproject,
+		     counts_umap &rall,
+		     bool ref) : owner(false),
+				 user(ruser),
+				 group(rgroup),
+				 project(rproject),
+				 all(rall)
 {
-	user = dup_counts_umap(rlimit.user);
-	group = dup_counts_umap(rlimit.group);
-	project = dup_counts_umap(rlimit.project);
-	all = dup_counts_umap(rlimit.all);
-}
-
-// Assignment operator
-limcounts &
-limcounts::operator=(const limcounts &rlimit)
-{
-	user = dup_counts_umap(rlimit.user);
-	group = dup_counts_umap(rlimit.group);
-	project = dup_counts_umap(rlimit.project);
-	all = dup_counts_umap(rlimit.all);
-	return *this;
 }
 
 // destructor
 limcounts::~limcounts()
 {
-	free_counts_list(user);
-	free_counts_list(group);
-	free_counts_list(project);
-	free_counts_list(all);
+	if (owner) {
+		free_counts_list(own_user);
+		free_counts_list(own_group);
+		free_counts_list(own_project);
+		free_counts_list(own_all);
+	}
 }
 
 /**
@@ -965,7 +1007,7 @@ check_limits(server_info *si, queue_info *qi, resource_resv *rr, schd_error *err
 			server_lim = new limcounts(si->user_counts,
 						   si->group_counts,
 						   si->project_counts,
-						   si->alljobcounts);
+						   si->alljobcounts, true);
 		}
 		if (que_counts_max != NULL) {
 			queue_lim = que_counts_max;
@@ -973,7 +1015,7 @@ check_limits(server_info *si, queue_info *qi, resource_resv *rr, schd_error *err
 			queue_lim = new limcounts(qi->user_counts,
 						  qi->group_counts,
 						  qi->project_counts,
-						  qi->alljobcounts);
+						  qi->alljobcounts, true);
 		}
 	} else if ((flags & CHECK_CUMULATIVE_LIMIT)) {
 		if (!si->has_hard_limit && !qi->has_hard_limit)
@@ -981,11 +1023,11 @@ check_limits(server_info *si, queue_info *qi, resource_resv *rr, schd_error *err
 		server_lim = new limcounts(si->total_user_counts,
 					   si->total_group_counts,
 					   si->total_project_counts,
-					   si->total_alljobcounts);
+					   si->total_alljobcounts, true);
 		queue_lim = new limcounts(qi->total_user_counts,
 					  qi->total_group_counts,
 					  qi->total_project_counts,
-					  qi->total_alljobcounts);
+					  qi->total_alljobcounts, true);
 	}
 	for (i = 0; i < sizeof(limfuncs) / sizeof(limfuncs[0]); i++) {
 		rc = static_cast<enum sched_error_code>((limfuncs[i])(si, qi, rr, server_lim, queue_lim, err));
@@ -1142,8 +1184,6 @@ static int
 check_server_max_user_run(server_info *si, queue_info *qi, resource_resv *rr,
 			  limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
-	std::string user;
 	int used;
 	int max_user_run, max_genuser_run;
 
@@ -1153,19 +1193,12 @@ check_server_max_user_run(server_info *si, queue_info *qi, resource_resv *rr,
 	if (!si->has_user_limit)
 		return (0);
 
-	user = rr->user;
+	const std::string &user = rr->user;
 
 	auto &cts = sc->user;
 
-	if ((key = entlim_mk_runkey(LIM_USER, user.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_user_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
-
-	if ((key = entlim_mk_runkey(LIM_USER, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_genuser_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
+	max_user_run = (int) lim_get_run(LIM_USER, user, LI2RUNCTX(si->liminfo));
+	max_genuser_run = (int) lim_get_run(LIM_USER, genparam, LI2RUNCTX(si->liminfo));
 
 	if ((max_user_run == SCHD_INFINITY) &&
 	    (max_genuser_run == SCHD_INFINITY))
@@ -1212,8 +1245,6 @@ static int
 check_server_max_group_run(server_info *si, queue_info *qi, resource_resv *rr,
 			   limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
-	std::string group;
 	int used;
 	int max_group_run, max_gengroup_run;
 
@@ -1223,19 +1254,12 @@ check_server_max_group_run(server_info *si, queue_info *qi, resource_resv *rr,
 	if (!si->has_grp_limit)
 		return (0);
 
-	group = rr->group;
+	const std::string &group = rr->group;
 
 	auto &cts = sc->group;
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, group.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_group_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
-
-	if ((key = entlim_mk_runkey(LIM_GROUP, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_gengroup_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
+	max_group_run = (int) lim_get_run(LIM_GROUP, group, LI2RUNCTX(si->liminfo));
+	max_gengroup_run = (int) lim_get_run(LIM_GROUP, genparam, LI2RUNCTX(si->liminfo));
 
 	if ((max_group_run == SCHD_INFINITY) &&
 	    (max_gengroup_run == SCHD_INFINITY))
@@ -1392,8 +1416,6 @@ static int
 check_queue_max_user_run(server_info *si, queue_info *qi, resource_resv *rr,
 			 limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
-	std::string user;
 	int used;
 	int max_user_run, max_genuser_run;
 
@@ -1403,19 +1425,12 @@ check_queue_max_user_run(server_info *si, queue_info *qi, resource_resv *rr,
 	if (!qi->has_user_limit)
 		return (0);
 
-	user = rr->user;
+	const std::string &user = rr->user;
 
 	auto &cts = qc->user;
 
-	if ((key = entlim_mk_runkey(LIM_USER, user.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_user_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
-
-	if ((key = entlim_mk_runkey(LIM_USER, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_genuser_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
+	max_user_run = (int) lim_get_run(LIM_USER, user, LI2RUNCTX(qi->liminfo));
+	max_genuser_run = (int) lim_get_run(LIM_USER, genparam, LI2RUNCTX(qi->liminfo));
 
 	if ((max_user_run == SCHD_INFINITY) &&
 	    (max_genuser_run == SCHD_INFINITY))
@@ -1462,8 +1477,6 @@ static int
 check_queue_max_group_run(server_info *si, queue_info *qi, resource_resv *rr,
 			  limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
-	std::string group;
 	int used;
 	int max_group_run, max_gengroup_run;
 
@@ -1473,19 +1486,12 @@ check_queue_max_group_run(server_info *si, queue_info *qi, resource_resv *rr,
 	if (!qi->has_grp_limit)
 		return (0);
 
-	group = rr->group;
+	const std::string &group = rr->group;
 
 	auto &cts = qc->group;
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, group.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_group_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
-
-	if ((key = entlim_mk_runkey(LIM_GROUP, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_gengroup_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
+	max_group_run = (int) lim_get_run(LIM_GROUP, group, LI2RUNCTX(qi->liminfo));
+	max_gengroup_run = (int) lim_get_run(LIM_GROUP, genparam, LI2RUNCTX(qi->liminfo));
 
 	if ((max_group_run == SCHD_INFINITY) &&
 	    (max_gengroup_run == SCHD_INFINITY))
@@ -1645,7 +1651,6 @@ static int
 check_queue_max_res(server_info *si, queue_info *qi, resource_resv *rr,
 		    limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *reskey;
 	sch_resource_t max_res;
 	sch_resource_t used;
 	schd_resource *res;
@@ -1669,11 +1674,7 @@ check_queue_max_res(server_info *si, queue_info *qi, resource_resv *rr,
 		if ((req = find_resource_req(rr->resreq, res->def)) == NULL)
 			continue;
 
-		if ((reskey = entlim_mk_reskey(LIM_OVERALL, allparam,
-					       res->name)) == NULL)
-			return (SCHD_ERROR);
-		max_res = lim_get(reskey, LI2RESCTX(qi->liminfo));
-		free(reskey);
+		max_res = lim_get_res(LIM_OVERALL, allparam, res->def, LI2RESCTX(qi->liminfo));
 
 		if (max_res == SCHD_INFINITY)
 			continue;
@@ -1718,7 +1719,6 @@ static int
 check_server_max_res(server_info *si, queue_info *qi, resource_resv *rr,
 		     limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *reskey;
 	sch_resource_t max_res;
 	sch_resource_t used;
 	schd_resource *res;
@@ -1743,11 +1743,7 @@ check_server_max_res(server_info *si, queue_info *qi, resource_resv *rr,
 		if ((req = find_resource_req(rr->resreq, res->def)) == NULL)
 			continue;
 
-		if ((reskey = entlim_mk_reskey(LIM_OVERALL, allparam,
-					       res->name)) == NULL)
-			return (SCHD_ERROR);
-		max_res = lim_get(reskey, LI2RESCTX(si->liminfo));
-		free(reskey);
+		max_res = lim_get_res(LIM_OVERALL, allparam, res->def, LI2RESCTX(si->liminfo));
 
 		if (max_res == SCHD_INFINITY)
 			continue;
@@ -1792,7 +1788,6 @@ check_server_max_run(server_info *si, queue_info *qi, resource_resv *rr,
 		     limcounts *sc, limcounts *qc, schd_error *err)
 {
 	int max_running;
-	char *key;
 	int running;
 
 	if (si == NULL)
@@ -1803,10 +1798,7 @@ check_server_max_run(server_info *si, queue_info *qi, resource_resv *rr,
 
 	auto &cts = sc->all;
 
-	if ((key = entlim_mk_runkey(LIM_OVERALL, allparam)) == NULL)
-		return (SCHD_ERROR);
-	max_running = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
+	max_running = (int) lim_get_run(LIM_OVERALL, allparam, LI2RUNCTX(si->liminfo));
 
 	running = find_counts_elm(cts, PBS_ALL_ENTITY, NULL, NULL, NULL);
 
@@ -1843,7 +1835,6 @@ check_queue_max_run(server_info *si, queue_info *qi, resource_resv *rr,
 		    limcounts *sc, limcounts *qc, schd_error *err)
 {
 	int max_running;
-	char *key;
 	int running;
 
 	if (qi == NULL)
@@ -1854,11 +1845,7 @@ check_queue_max_run(server_info *si, queue_info *qi, resource_resv *rr,
 
 	auto &cts = qc->all;
 
-	if ((key = entlim_mk_runkey(LIM_OVERALL, allparam)) == NULL)
-		return (SCHD_ERROR);
-
-	max_running = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
+	max_running = (int) lim_get_run(LIM_OVERALL, allparam, LI2RUNCTX(qi->liminfo));
 
 	running = find_counts_elm(cts, PBS_ALL_ENTITY, NULL, NULL, NULL);
 
@@ -1891,7 +1878,6 @@ static int
 check_queue_max_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 {
 	int max_running;
-	char *key;
 	counts *cnt = NULL;
 	int used = 0;
 
@@ -1901,10 +1887,7 @@ check_queue_max_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 	if (!qi->has_all_limit)
 		return (0);
 
-	if ((key = entlim_mk_runkey(LIM_OVERALL, allparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_running = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	max_running = (int) lim_get_run(LIM_OVERALL, allparam, LI2RUNCTXSOFT(qi->liminfo));
 
 	/* at this point, we know a limit is set for PBS_ALL*/
 	used = find_counts_elm(qi->alljobcounts, PBS_ALL_ENTITY, NULL, &cnt, NULL);
@@ -1938,8 +1921,6 @@ check_queue_max_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 static int
 check_queue_max_user_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 {
-	char *key;
-	std::string user;
 	int used;
 	int max_user_run_soft, max_genuser_run_soft;
 	counts *cnt = NULL;
@@ -1950,17 +1931,10 @@ check_queue_max_user_run_soft(server_info *si, queue_info *qi, resource_resv *rr
 	if (!qi->has_user_limit)
 		return (0);
 
-	user = rr->user;
-
-	if ((key = entlim_mk_runkey(LIM_USER, user.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_user_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	const std::string &user = rr->user;
 
-	if ((key = entlim_mk_runkey(LIM_USER, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_genuser_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	max_user_run_soft = (int) lim_get_run(LIM_USER, user, LI2RUNCTXSOFT(qi->liminfo));
+	max_genuser_run_soft = (int) lim_get_run(LIM_USER, genparam, LI2RUNCTXSOFT(qi->liminfo));
 
 	if ((max_user_run_soft == SCHD_INFINITY) &&
 	    (max_genuser_run_soft == SCHD_INFINITY))
@@ -2014,8 +1988,6 @@ static int
 check_queue_max_group_run_soft(server_info *si, queue_info *qi,
 			       resource_resv *rr)
 {
-	char *key;
-	std::string group;
 	int used;
 	int max_group_run_soft, max_gengroup_run_soft;
 	counts *cnt = NULL;
@@ -2026,17 +1998,10 @@ check_queue_max_group_run_soft(server_info *si, queue_info *qi,
 	if (!qi->has_grp_limit)
 		return (0);
 
-	group = rr->group;
+	const std::string &group = rr->group;
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, group.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_group_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
-
-	if ((key = entlim_mk_runkey(LIM_GROUP, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_gengroup_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	max_group_run_soft = (int) lim_get_run(LIM_GROUP, group, LI2RUNCTXSOFT(qi->liminfo));
+	max_gengroup_run_soft = (int) lim_get_run(LIM_GROUP, genparam, LI2RUNCTXSOFT(qi->liminfo));
 
 	if ((max_group_run_soft == SCHD_INFINITY) &&
 	    (max_gengroup_run_soft == SCHD_INFINITY))
@@ -2147,7 +2112,6 @@ static int
 check_server_max_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 {
 	int max_running;
-	char *key;
 	counts *cnt = NULL;
 	int used = 0;
 
@@ -2157,10 +2121,7 @@ check_server_max_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 	if (!si->has_all_limit)
 		return (0);
 
-	if ((key = entlim_mk_runkey(LIM_OVERALL, allparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_running = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
+	max_running = (int) lim_get_run(LIM_OVERALL, allparam, LI2RUNCTXSOFT(si->liminfo));
 
 	/* at this point, we know a limit is set for PBS_ALL*/
 	used = find_counts_elm(si->alljobcounts, PBS_ALL_ENTITY, NULL, &cnt, NULL);
@@ -2195,8 +2156,6 @@ static int
 check_server_max_user_run_soft(server_info *si, queue_info *qi,
 			       resource_resv *rr)
 {
-	char *key;
-	std::string user;
 	int used;
 	int max_user_run_soft, max_genuser_run_soft;
 	counts *cnt = NULL;
@@ -2207,17 +2166,10 @@ check_server_max_user_run_soft(server_info *si, queue_info *qi,
 	if (!si->has_user_limit)
 		return (0);
 
-	user = rr->user;
+	const std::string &user = rr->user;
 
-	if ((key = entlim_mk_runkey(LIM_USER, user.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_user_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
-
-	if ((key = entlim_mk_runkey(LIM_USER, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_genuser_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
+	max_user_run_soft = (int) lim_get_run(LIM_USER, user, LI2RUNCTXSOFT(si->liminfo));
+	max_genuser_run_soft = (int) lim_get_run(LIM_USER, genparam, LI2RUNCTXSOFT(si->liminfo));
 
 	if ((max_user_run_soft == SCHD_INFINITY) &&
 	    (max_genuser_run_soft == SCHD_INFINITY))
@@ -2270,8 +2222,6 @@ static int
 check_server_max_group_run_soft(server_info *si, queue_info *qi,
 				resource_resv *rr)
 {
-	char *key;
-	std::string group;
 	int used;
 	int max_group_run_soft, max_gengroup_run_soft;
 	counts *cnt = NULL;
@@ -2282,17 +2232,10 @@ check_server_max_group_run_soft(server_info *si, queue_info *qi,
 	if (!si->has_grp_limit)
 		return (0);
 
-	group = rr->group;
+	const std::string &group = rr->group;
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, group.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_group_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
-
-	if ((key = entlim_mk_runkey(LIM_GROUP, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_gengroup_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
+	max_group_run_soft = (int) lim_get_run(LIM_GROUP, group, LI2RUNCTXSOFT(si->liminfo));
+	max_gengroup_run_soft = (int) lim_get_run(LIM_GROUP, genparam, LI2RUNCTXSOFT(si->liminfo));
 
 	if ((max_group_run_soft == SCHD_INFINITY) &&
 	    (max_gengroup_run_soft == SCHD_INFINITY))
@@ -2404,7 +2347,6 @@ check_server_max_group_res_soft(server_info *si, queue_info *qi,
 static int
 check_server_max_res_soft(server_info *si, queue_info *qi, resource_resv *rr)
 {
-	char *reskey;
 	sch_resource_t max_res_soft;
 	sch_resource_t used;
 	schd_resource *res;
@@ -2423,11 +2365,7 @@ check_server_max_res_soft(server_info *si, queue_info *qi, resource_resv *rr)
 		if (find_resource_req(rr->resreq, res->def) == NULL)
 			continue;
 
-		if ((reskey = entlim_mk_reskey(LIM_OVERALL, allparam,
-					       res->name)) == NULL)
-			return (PREEMPT_TO_BIT(PREEMPT_ERR));
-		max_res_soft = lim_get(reskey, LI2RESCTXSOFT(si->liminfo));
-		free(reskey);
+		max_res_soft = lim_get_res(LIM_OVERALL, allparam, res->def, LI2RESCTXSOFT(si->liminfo));
 
 		if (max_res_soft == SCHD_INFINITY)
 			continue;
@@ -2473,7 +2411,6 @@ check_server_max_res_soft(server_info *si, queue_info *qi, resource_resv *rr)
 static int
 check_queue_max_res_soft(server_info *si, queue_info *qi, resource_resv *rr)
 {
-	char *reskey;
 	sch_resource_t max_res_soft;
 	sch_resource_t used;
 	schd_resource *res;
@@ -2492,11 +2429,7 @@ check_queue_max_res_soft(server_info *si, queue_info *qi, resource_resv *rr)
 		if (find_resource_req(rr->resreq, res->def) == NULL)
 			continue;
 
-		if ((reskey = entlim_mk_reskey(LIM_OVERALL, allparam,
-					       res->name)) == NULL)
-			return (PREEMPT_TO_BIT(PREEMPT_ERR));
-		max_res_soft = lim_get(reskey, LI2RESCTXSOFT(qi->liminfo));
-		free(reskey);
+		max_res_soft = lim_get_res(LIM_OVERALL, allparam, res->def, LI2RESCTXSOFT(qi->liminfo));
 
 		if (max_res_soft == SCHD_INFINITY)
 			continue;
@@ -2542,11 +2475,8 @@ check_queue_max_res_soft(server_info *si, queue_info *qi, resource_resv *rr)
  */
 static int
 check_max_group_res(resource_resv *rr, counts_umap &cts_list,
-		    resdef **rdef, void *limitctx)
+		    resdef **rdef, struct lim_ctx *limitctx)
 {
-	char *groupreskey;
-	char *gengroupreskey;
-	std::string group;
 	schd_resource *res;
 	sch_resource_t max_group_res;
 	sch_resource_t max_gengroup_res;
@@ -2557,7 +2487,7 @@ check_max_group_res(resource_resv *rr, counts_umap &cts_list,
 	if ((limres == NULL) || (rr->resreq == NULL))
 		return (0);
 
-	group = rr->group;
+	const std::string &group = rr->group;
 
 	for (res = limres; res != NULL; res = res->next) {
 		resource_req *req;
@@ -2565,17 +2495,10 @@ check_max_group_res(resource_resv *rr, counts_umap &cts_list,
 			continue;
 
 		/* individual group limit check */
-		if ((groupreskey = entlim_mk_reskey(LIM_GROUP, group.c_str(),
-						    res->name)) == NULL)
-			return (-1);
-		max_group_res = lim_get(groupreskey, limitctx);
-		free(groupreskey);
+		max_group_res = lim_get_res(LIM_GROUP, group, res->def, limitctx);
 
 		/* generic group limit check */
-		if ((gengroupreskey = lim_gengroupreskey(res->name)) == NULL)
-			return (-1);
-		max_gengroup_res = lim_get(gengroupreskey, limitctx);
-		free(gengroupreskey);
+		max_gengroup_res = lim_get_res(LIM_GROUP, genparam, res->def, limitctx);
 
 		if ((max_group_res == SCHD_INFINITY) &&
 		    (max_gengroup_res == SCHD_INFINITY))
@@ -2620,11 +2543,8 @@ check_max_group_res(resource_resv *rr, counts_umap &cts_list,
  * @retval	-1	: on error
  */
 static int
-check_max_group_res_soft(resource_resv *rr, counts_umap &cts_list, void *limitctx, int preempt_bit)
+check_max_group_res_soft(resource_resv *rr, counts_umap &cts_list, struct lim_ctx *limitctx, int preempt_bit)
 {
-	char *groupreskey;
-	char *gengroupreskey;
-	std::string group;
 	schd_resource *res;
 	sch_resource_t max_group_res_soft;
 	sch_resource_t max_gengroup_res_soft;
@@ -2637,7 +2557,7 @@ check_max_group_res_soft(resource_resv *rr, counts_umap &cts_list, void *limitct
 	if ((limres == NULL) || (rr->resreq == NULL))
 		return (0);
 
-	group = rr->group;
+	const std::string &group = rr->group;
 
 	for (res = limres; res != NULL; res = res->next) {
 		/* If the job is not requesting the limit resource, it is not over its soft limit*/
@@ -2645,17 +2565,10 @@ check_max_group_res_soft(resource_resv *rr, counts_umap &cts_list, void *limitct
 			continue;
 
 		/* individual group limit check */
-		if ((groupreskey = entlim_mk_reskey(LIM_GROUP, group.c_str(),
-						    res->name)) == NULL)
-			return (-1);
-		max_group_res_soft = lim_get(groupreskey, limitctx);
-		free(groupreskey);
+		max_group_res_soft = lim_get_res(LIM_GROUP, group, res->def, limitctx);
 
 		/* generic group limit check */
-		if ((gengroupreskey = lim_gengroupreskey(res->name)) == NULL)
-			return (-1);
-		max_gengroup_res_soft = lim_get(gengroupreskey, limitctx);
-		free(gengroupreskey);
+		max_gengroup_res_soft = lim_get_res(LIM_GROUP, genparam, res->def, limitctx);
 
 		if ((max_group_res_soft == SCHD_INFINITY) &&
 		    (max_gengroup_res_soft == SCHD_INFINITY))
@@ -2710,11 +2623,8 @@ check_max_group_res_soft(resource_resv *rr, counts_umap &cts_list, void *limitct
  */
 static int
 check_max_user_res(resource_resv *rr, counts_umap &cts_list, resdef **rdef,
-		   void *limitctx)
+		   struct lim_ctx *limitctx)
 {
-	char *userreskey;
-	char *genuserreskey;
-	std::string user;
 	schd_resource *res;
 	sch_resource_t max_user_res;
 	sch_resource_t max_genuser_res;
@@ -2725,7 +2635,7 @@ check_max_user_res(resource_resv *rr, counts_umap &cts_list, resdef **rdef,
 	if ((limres == NULL) || (rr->resreq == NULL))
 		return (0);
 
-	user = rr->user;
+	const std::string &user = rr->user;
 
 	for (res = limres; res != NULL; res = res->next) {
 		resource_req *req;
@@ -2734,17 +2644,10 @@ check_max_user_res(resource_resv *rr, counts_umap &cts_list, resdef **rdef,
 			continue;
 
 		/* individual user limit check */
-		if ((userreskey = entlim_mk_reskey(LIM_USER, user.c_str(),
-						   res->name)) == NULL)
-			return (-1);
-		max_user_res = lim_get(userreskey, limitctx);
-		free(userreskey);
+		max_user_res = lim_get_res(LIM_USER, user, res->def, limitctx);
 
 		/* generic user limit check */
-		if ((genuserreskey = lim_genuserreskey(res->name)) == NULL)
-			return (-1);
-		max_genuser_res = lim_get(genuserreskey, limitctx);
-		free(genuserreskey);
+		max_genuser_res = lim_get_res(LIM_USER, genparam, res->def, limitctx);
 
 		if ((max_user_res == SCHD_INFINITY) &&
 		    (max_genuser_res == SCHD_INFINITY))
@@ -2791,11 +2694,8 @@ check_max_user_res(resource_resv *rr, counts_umap &cts_list, resdef **rdef,
  */
 static int
 check_max_user_res_soft(resource_resv **rr_arr, resource_resv *rr,
-			counts_umap &cts_list, void *limitctx, int preempt_bit)
+			counts_umap &cts_list, struct lim_ctx *limitctx, int preempt_bit)
 {
-	char *userreskey;
-	char *genuserreskey;
-	std::string user;
 	schd_resource *res;
 	sch_resource_t max_user_res_soft;
 	sch_resource_t max_genuser_res_soft;
@@ -2808,7 +2708,7 @@ check_max_user_res_soft(resource_resv **rr_arr, resource_resv *rr,
 	if ((limres == NULL) || (rr->resreq == NULL))
 		return (0);
 
-	user = rr->user;
+	const std::string &user = rr->user;
 
 	for (res = limres; res != NULL; res = res->next) {
 		/* If the job is not requesting the limit resource, it is not over its soft limit*/
@@ -2816,17 +2716,10 @@ check_max_user_res_soft(resource_resv **rr_arr, resource_resv *rr,
 			continue;
 
 		/* individual user limit check */
-		if ((userreskey = entlim_mk_reskey(LIM_USER, user.c_str(),
-						   res->name)) == NULL)
-			return (-1);
-		max_user_res_soft = lim_get(userreskey, limitctx);
-		free(userreskey);
+		max_user_res_soft = lim_get_res(LIM_USER, user, res->def, limitctx);
 
 		/* generic user limit check */
-		if ((genuserreskey = lim_genuserreskey(res->name)) == NULL)
-			return (-1);
-		max_genuser_res_soft = lim_get(genuserreskey, limitctx);
-		free(genuserreskey);
+		max_genuser_res_soft = lim_get_res(LIM_USER, genparam, res->def, limitctx);
 
 		if ((max_user_res_soft == SCHD_INFINITY) &&
 		    (max_genuser_res_soft == SCHD_INFINITY))
@@ -3059,35 +2952,80 @@ lim_setoldlimits(const struct attrl *a, void *ctx)
 
 	return (1); /* attribute name not found in translation table */
 }
+/**
+ * @brief
+ *		lim_alloc_ctx	allocate an empty limit storage context
+ *
+ * @return	struct lim_ctx *
+ * @retval	the newly-allocated storage context	: on success
+ * @retval	NULL	: on error
+ */
+static struct lim_ctx *
+lim_alloc_ctx(void)
+{
+	struct lim_ctx *ctx;
+
+	ctx = new lim_ctx();
+	if ((ctx->entctx = entlim_initialize_ctx()) == NULL) {
+		log_err(errno, __func__, "malloc failed");
+		delete ctx;
+		return (NULL);
+	}
+
+	return ctx;
+}
+
+/**
+ * @brief
+ *		lim_free_ctx	free a limit storage context
+ *
+ * @param[in]	ctx	-	the limit storage context
+ *
+ * @return	void
+ */
+static void
+lim_free_ctx(struct lim_ctx *ctx)
+{
+	if (ctx == NULL)
+		return;
+
+	if (ctx->entctx != NULL)
+		(void) entlim_free_ctx(ctx->entctx, free);
+	delete ctx;
+}
+
 /**
  * @brief
  *		lim_dup_ctx	duplicate all entries in a limit storage context
  *
  * @param[in]	ctx	-	the limit storage context
  *
- * @return	void *
+ * @return	struct lim_ctx *
  * @retval	the newly-allocated storage context	: on success
  * @retval	NULL	: on error
  */
-static void *
-lim_dup_ctx(void *ctx)
+static struct lim_ctx *
+lim_dup_ctx(struct lim_ctx *ctx)
 {
-	void *newctx;
+	struct lim_ctx *newctx;
 	char *key = NULL;
 	char *value = NULL;
 
-	if ((newctx = entlim_initialize_ctx()) == NULL) {
-		log_err(errno, __func__, "malloc failed");
+	if ((newctx = lim_alloc_ctx()) == NULL)
 		return (NULL);
+
+	for (int kt = LIM_USER; kt <= LIM_OVERALL; kt++) {
+		newctx->run[kt] = ctx->run[kt];
+		newctx->res[kt] = ctx->res[kt];
 	}
 
-	while ((value = static_cast<char *>(entlim_get_next(ctx, (void **) &key))) != NULL) {
+	while ((value = static_cast<char *>(entlim_get_next(ctx->entctx, (void **) &key))) != NULL) {
 		const char *newval;
 		if ((newval = strdup(value)) == NULL) {
 			log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_ERR, __func__, "strdup value failed");
-			(void) entlim_free_ctx(newctx, free);
+			lim_free_ctx(newctx);
 			return NULL;
-		} else if (entlim_add(key, newval, newctx) != 0) {
+		} else if (entlim_add(key, newval, newctx->entctx) != 0) {
 			log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_ERR, __func__, "entlim_add(%s) failed", key);
 			/*
 			 *	One might think that we should free newval
@@ -3101,7 +3039,7 @@ lim_dup_ctx(void *ctx)
 			 *	memory allocation code detects and aborts due
 			 *	to twice-freed memory.
 			 */
-			(void) entlim_free_ctx(newctx, free);
+			lim_free_ctx(newctx);
 			return NULL;
 		}
 	}
@@ -3128,59 +3066,11 @@ is_hardlimit(const struct attrl *a)
 		return (0);
 }
 
-/**
- * @brief
- *		lim_gengroupreskey	special-purpose shortcut function to construct a
- *				generic group resource key
- *
- * @param[in]	res	-	the resource
- *
- * @return	a resource limit key if successful
- * @retval	NULL	: if not
- */
-static char *
-lim_gengroupreskey(const char *res)
-{
-	return (entlim_mk_reskey(LIM_GROUP, genparam, res));
-}
-
-/**
- * @brief
- *		lim_genprojectreskey	special-purpose shortcut function to construct a
- *				generic project resource key
- *
- * @param[in]	res	-	the resource
- *
- * @return	a resource limit key if successful
- * @retval	NULL	: if not
- */
-static char *
-lim_genprojectreskey(const char *res)
-{
-	return (entlim_mk_reskey(LIM_PROJECT, genparam, res));
-}
-
-/**
- * @brief
- *		lim_genuserreskey	special-purpose shortcut function to construct a
- *				generic user resource key
- *
- * @param[in]	res	-	the resource
- *
- * @return	a resource limit key on success
- * @retval	NULL	: on failure
- */
-static char *
-lim_genuserreskey(const char *res)
-{
-	return (entlim_mk_reskey(LIM_USER, genparam, res));
-}
-
 /**
  * @brief
  *		lim_callback install a new key of the given type and value
  *
- * @param[in]	ctx		the limit storage context
+ * @param[in]	ctx		the limit storage context (struct lim_ctx *)
  * @param[in]	kt		the key type
  * @param[in]	param		entity type (unused - see entlim_parse_one())
  * @param[in]	namestring	entity name (see entlim_parse_one())
@@ -3195,6 +3085,7 @@ static int
 lim_callback(void *ctx, enum lim_keytypes kt, char *param, char *namestring,
 	     char *res, char *val)
 {
+	struct lim_ctx *lctx = static_cast<struct lim_ctx *>(ctx);
 	char *key = NULL;
 	char *v = NULL;
 
@@ -3215,13 +3106,24 @@ lim_callback(void *ctx, enum lim_keytypes kt, char *param, char *namestring,
 		return (-1);
 	}
 
-	if (entlim_add(key, v, ctx) != 0) {
+	if (entlim_add(key, v, lctx->entctx) != 0) {
 		log_eventf(PBSEVENT_SCHED, PBS_EVENTCLASS_SCHED, LOG_ERR, __func__,
 			   "limit set %s %s %s failed", key, res, val);
 		free(v);
 		free(key);
 		return (-1);
 	} else {
+		sch_resource_t value = res_to_num(val, NULL);
+
+		if (res == NULL)
+			lctx->run[kt][namestring] = value;
+		else {
+			resdef *def = find_resdef(res);
+
+			/* limits on undefined resources are never checked */
+			if (def != NULL)
+				lctx->res[kt][namestring][def] = value;
+		}
 		if (res != NULL)
 			log_eventf(PBSEVENT_DEBUG4, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
 				   "limit set %s %s %s", key, res, val);
@@ -3235,29 +3137,55 @@ lim_callback(void *ctx, enum lim_keytypes kt, char *param, char *namestring,
 
 /**
  * @brief
- *		lim_get	fetch a limit value
+ *		lim_get_run	fetch a run limit value
  *
- * @param[in]	param	-	the requested limit
+ * @param[in]	kt	-	the key type
+ * @param[in]	entity	-	the entity name
  * @param[in]	ctx	-	the limit storage context
  *
  * @return	sch_resource_t
- * @retval	the value of the limit, if no error occurs fetching it
+ * @retval	the value of the limit
  * @retval	SCHD_INFINITY if no such limit exists in the named context
  */
 static sch_resource_t
-lim_get(const char *param, void *ctx)
+lim_get_run(enum lim_keytypes kt, const std::string &entity, struct lim_ctx *ctx)
 {
-	char *retptr;
+	auto &lims = ctx->run[kt];
+	auto l = lims.find(entity);
 
-	retptr = static_cast<char *>(entlim_get(param, ctx));
-	if (retptr != NULL) {
-		sch_resource_t v;
+	if (l == lims.end())
+		return (SCHD_INFINITY);
 
-		v = res_to_num(retptr, NULL);
-		return (v);
-	} else {
+	return l->second;
+}
+
+/**
+ * @brief
+ *		lim_get_res	fetch a resource limit value
+ *
+ * @param[in]	kt	-	the key type
+ * @param[in]	entity	-	the entity name
+ * @param[in]	def	-	the limited resource
+ * @param[in]	ctx	-	the limit storage context
+ *
+ * @return	sch_resource_t
+ * @retval	the value of the limit
+ * @retval	SCHD_INFINITY if no such limit exists in the named context
+ */
+static sch_resource_t
+lim_get_res(enum lim_keytypes kt, const std::string &entity, const resdef *def, struct lim_ctx *ctx)
+{
+	auto &lims = ctx->res[kt];
+	auto e = lims.find(entity);
+
+	if (e == lims.end())
 		return (SCHD_INFINITY);
-	}
+
+	auto l = e->second.find(def);
+	if (l == e->second.end())
+		return (SCHD_INFINITY);
+
+	return l->second;
 }
 
 /**
@@ -3367,12 +3295,9 @@ schderr_args_server_res(std::string &entity, const char *res, schd_error *err)
  */
 static int
 check_max_project_res(resource_resv *rr, counts_umap &cts_list,
-		      resdef **rdef, void *limitctx)
+		      resdef **rdef, struct lim_ctx *limitctx)
 {
-	char *projectreskey;
-	char *genprojectreskey;
 	schd_resource *res;
-	std::string project;
 	sch_resource_t max_project_res;
 	sch_resource_t max_genproject_res;
 	sch_resource_t used = 0;
@@ -3382,24 +3307,17 @@ check_max_project_res(resource_resv *rr, counts_umap &cts_list,
 	if ((limres == NULL) || (rr->resreq == NULL) || (rr->project.empty()))
 		return (0);
 
-	project = rr->project;
+	const std::string &project = rr->project;
 	for (res = limres; res != NULL; res = res->next) {
 		resource_req *req;
 		if ((req = find_resource_req(rr->resreq, res->def)) == NULL)
 			continue;
 
 		/* individual project limit check */
-		if ((projectreskey = entlim_mk_reskey(LIM_PROJECT,
-						      project.c_str(), res->name)) == NULL)
-			return (-1);
-		max_project_res = lim_get(projectreskey, limitctx);
-		free(projectreskey);
+		max_project_res = lim_get_res(LIM_PROJECT, project, res->def, limitctx);
 
 		/* generic project limit check */
-		if ((genprojectreskey = lim_genprojectreskey(res->name)) == NULL)
-			return (-1);
-		max_genproject_res = lim_get(genprojectreskey, limitctx);
-		free(genprojectreskey);
+		max_genproject_res = lim_get_res(LIM_PROJECT, genparam, res->def, limitctx);
 
 		if ((max_project_res == SCHD_INFINITY) &&
 		    (max_genproject_res == SCHD_INFINITY))
@@ -3444,11 +3362,8 @@ check_max_project_res(resource_resv *rr, counts_umap &cts_list,
  * @retval	-1	: on error
  */
 static int
-check_max_project_res_soft(resource_resv *rr, counts_umap &cts_list, void *limitctx, int preempt_bit)
+check_max_project_res_soft(resource_resv *rr, counts_umap &cts_list, struct lim_ctx *limitctx, int preempt_bit)
 {
-	char *projectreskey;
-	char *genprojectreskey;
-	std::string project;
 	schd_resource *res;
 	sch_resource_t max_project_res_soft;
 	sch_resource_t max_genproject_res_soft;
@@ -3461,24 +3376,17 @@ check_max_project_res_soft(resource_resv *rr, counts_umap &cts_list, void *limit
 	if ((limres == NULL) || (rr->resreq == NULL) || (rr->project.empty()))
 		return (0);
 
-	project = rr->project;
+	const std::string &project = rr->project;
 	for (res = limres; res != NULL; res = res->next) {
 		/* If the job is not requesting the limit resource, it is not over its soft limit*/
 		if (find_resource_req(rr->resreq, res->def) == NULL)
 			continue;
 
 		/* individual project limit check */
-		if ((projectreskey = entlim_mk_reskey(LIM_PROJECT, project.c_str(),
-						      res->name)) == NULL)
-			return (-1);
-		max_project_res_soft = lim_get(projectreskey, limitctx);
-		free(projectreskey);
+		max_project_res_soft = lim_get_res(LIM_PROJECT, project, res->def, limitctx);
 
 		/* generic project limit check */
-		if ((genprojectreskey = lim_genprojectreskey(res->name)) == NULL)
-			return (-1);
-		max_genproject_res_soft = lim_get(genprojectreskey, limitctx);
-		free(genprojectreskey);
+		max_genproject_res_soft = lim_get_res(LIM_PROJECT, genparam, res->def, limitctx);
 
 		if ((max_project_res_soft == SCHD_INFINITY) &&
 		    (max_genproject_res_soft == SCHD_INFINITY))
@@ -3594,8 +3502,6 @@ static int
 check_server_max_project_run_soft(server_info *si, queue_info *qi,
 				  resource_resv *rr)
 {
-	char *key;
-	std::string project;
 	int used;
 	int max_project_run_soft, max_genproject_run_soft;
 	counts *cnt = NULL;
@@ -3609,16 +3515,9 @@ check_server_max_project_run_soft(server_info *si, queue_info *qi,
 	if (!si->has_proj_limit)
 		return (0);
 
-	project = rr->project;
-	if ((key = entlim_mk_runkey(LIM_PROJECT, project.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_project_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
-
-	if ((key = entlim_mk_runkey(LIM_PROJECT, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_genproject_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
+	const std::string &project = rr->project;
+	max_project_run_soft = (int) lim_get_run(LIM_PROJECT, project, LI2RUNCTXSOFT(si->liminfo));
+	max_genproject_run_soft = (int) lim_get_run(LIM_PROJECT, genparam, LI2RUNCTXSOFT(si->liminfo));
 
 	if ((max_project_run_soft == SCHD_INFINITY) &&
 	    (max_genproject_run_soft == SCHD_INFINITY))
@@ -3759,8 +3658,6 @@ static int
 check_queue_max_project_run_soft(server_info *si, queue_info *qi,
 				 resource_resv *rr)
 {
-	char *key;
-	std::string project;
 	int used;
 	int max_project_run_soft, max_genproject_run_soft;
 	counts *cnt = NULL;
@@ -3774,16 +3671,9 @@ check_queue_max_project_run_soft(server_info *si, queue_info *qi,
 	if (!qi->has_proj_limit)
 		return (0);
 
-	project = rr->project;
-	if ((key = entlim_mk_runkey(LIM_PROJECT, project.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_project_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
-
-	if ((key = entlim_mk_runkey(LIM_PROJECT, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_genproject_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	const std::string &project = rr->project;
+	max_project_run_soft = (int) lim_get_run(LIM_PROJECT, project, LI2RUNCTXSOFT(qi->liminfo));
+	max_genproject_run_soft = (int) lim_get_run(LIM_PROJECT, genparam, LI2RUNCTXSOFT(qi->liminfo));
 
 	if ((max_project_run_soft == SCHD_INFINITY) &&
 	    (max_genproject_run_soft == SCHD_INFINITY))
@@ -3869,8 +3759,6 @@ static int
 check_server_max_project_run(server_info *si, queue_info *qi, resource_resv *rr,
 			     limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
-	std::string project;
 	int used;
 	int max_project_run, max_genproject_run;
 
@@ -3885,16 +3773,9 @@ check_server_max_project_run(server_info *si, queue_info *qi, resource_resv *rr,
 	if (!si->has_proj_limit)
 		return (0);
 
-	project = rr->project;
-	if ((key = entlim_mk_runkey(LIM_PROJECT, project.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_project_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
-
-	if ((key = entlim_mk_runkey(LIM_PROJECT, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_genproject_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
+	const std::string &project = rr->project;
+	max_project_run = (int) lim_get_run(LIM_PROJECT, project, LI2RUNCTX(si->liminfo));
+	max_genproject_run = (int) lim_get_run(LIM_PROJECT, genparam, LI2RUNCTX(si->liminfo));
 
 	if ((max_project_run == SCHD_INFINITY) &&
 	    (max_genproject_run == SCHD_INFINITY))
@@ -3943,8 +3824,6 @@ static int
 check_queue_max_project_run(server_info *si, queue_info *qi, resource_resv *rr,
 			    limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
-	std::string project;
 	int used;
 	int max_project_run, max_genproject_run;
 
@@ -3953,22 +3832,15 @@ check_queue_max_project_run(server_info *si, queue_info *qi, resource_resv *rr,
 
 	auto &cts = qc->project;
 
-	project = rr->project;
+	const std::string &project = rr->project;
 	if (project.empty())
 		return 0;
 
 	if (!qi->has_proj_limit)
 		return (0);
 
-	if ((key = entlim_mk_runkey(LIM_PROJECT, project.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_project_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
-
-	if ((key = entlim_mk_runkey(LIM_PROJECT, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_genproject_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
+	max_project_run = (int) lim_get_run(LIM_PROJECT, project, LI2RUNCTX(qi->liminfo));
+	max_genproject_run = (int) lim_get_run(LIM_PROJECT, genparam, LI2RUNCTX(qi->liminfo));
 
 	if ((max_project_run == SCHD_INFINITY) &&
 	    (max_genproject_run == SCHD_INFINITY))
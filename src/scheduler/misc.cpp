@@ -47,6 +47,7 @@
 #include "fairshare.h"
 #include "globals.h"
 #include "misc.h"
+#include "obj_pool.h"
 #include "resource.h"
 #include "resource_resv.h"
 #include <algorithm>
@@ -941,7 +942,7 @@ schd_error *
 new_schd_error()
 {
 	schd_error *err;
-	if ((err = static_cast<schd_error *>(calloc(1, sizeof(schd_error)))) == NULL) {
+	if ((err = obj_pool<schd_error>::alloc()) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
 		return NULL;
 	}
@@ -1131,7 +1132,7 @@ free_schd_error(schd_error *err)
 
 	err->next = NULL; /* just incase people try and access freed memory */
 
-	free(err);
+	obj_pool<schd_error>::release(err);
 }
 
 /**
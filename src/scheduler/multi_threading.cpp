@@ -45,6 +45,10 @@
 #include <pthread.h>
 #include <errno.h>
 #include <signal.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
 
 #include "log.h"
 #include "pbs_idx.h"
@@ -59,6 +63,50 @@
 #include "resource_resv.h"
 #include "multi_threading.h"
 
+/* a range of items to run through the function of a parallel_for() */
+struct mt_chunk {
+	int sidx;
+	int eidx;
+	int chunk;
+};
+
+/*
+ * Each thread has its own deque of chunks.  The owner takes chunks from
+ * the back, other threads steal from the front when they run out.
+ * Index 0 belongs to the thread calling parallel_for().
+ */
+struct mt_deque {
+	pthread_mutex_t lock;
+	std::deque<mt_chunk> chunks;
+};
+
+/* a parallel_for() in progress */
+struct mt_job {
+	const mt_func *fn;
+	std::atomic<int> left;	   /* chunks not yet finished */
+	int active;		   /* workers in the job, protected by result_lock */
+	std::vector<double> busy;  /* seconds spent in fn per thread */
+	std::vector<int> nchunks;  /* chunks run per thread */
+	std::vector<int> nstolen;  /* chunks stolen per thread */
+};
+
+static mt_deque *deques = NULL;
+static mt_job *cur_job = NULL;	  /* protected by work_lock */
+static unsigned long job_gen = 0; /* protected by work_lock */
+static int in_parallel_for = 0;	  /* the main thread is inside parallel_for() */
+
+static const char *task_names[] = {
+	"check_node_eligibility",
+	"dup_node_info",
+	"query_node_info",
+	"free_node_info",
+	"dup_resource_resv",
+	"query_jobs",
+	"free_resource_resv",
+	"eval_formula",
+	"sort_keys",
+	"start_time_bound"};
+
 /**
  * @brief	create the thread id key & set it for the main thread
  *
@@ -111,13 +159,13 @@ kill_threads(void)
 	pthread_mutex_destroy(&result_lock);
 	pthread_cond_destroy(&result_cond);
 	pthread_mutex_destroy(&general_lock);
+	for (i = 0; i <= num_threads; i++)
+		pthread_mutex_destroy(&deques[i].lock);
+	delete[] deques;
 	free(threads);
-	free_ds_queue(work_queue);
-	free_ds_queue(result_queue);
+	deques = NULL;
 	threads = NULL;
 	num_threads = 0;
-	work_queue = NULL;
-	result_queue = NULL;
 }
 
 /**
@@ -183,19 +231,10 @@ init_multi_threading(int nthreads)
 		return 0;
 	}
 
-	/* Create task and result queues */
-	work_queue = new_ds_queue();
-	if (work_queue == NULL) {
-		free(threads);
-		return 0;
-	}
-	result_queue = new_ds_queue();
-	if (result_queue == NULL) {
-		free(threads);
-		free_ds_queue(work_queue);
-		work_queue = NULL;
-		return 0;
-	}
+	/* One deque per worker thread plus one for the main thread */
+	deques = new mt_deque[num_threads + 1];
+	for (i = 0; i <= num_threads; i++)
+		pthread_mutex_init(&deques[i].lock, NULL);
 
 	pthread_once(&key_once, create_id_key);
 	for (i = 0; i < num_threads; i++) {
@@ -204,10 +243,9 @@ init_multi_threading(int nthreads)
 		thid = static_cast<int *>(malloc(sizeof(int)));
 		if (thid == NULL) {
 			free(threads);
-			free_ds_queue(work_queue);
-			free_ds_queue(result_queue);
-			work_queue = NULL;
-			result_queue = NULL;
+			delete[] deques;
+			threads = NULL;
+			deques = NULL;
 			log_err(errno, __func__, MEM_ERR_MSG);
 			return 0;
 		}
@@ -218,6 +256,102 @@ init_multi_threading(int nthreads)
 	return 1;
 }
 
+/**
+ * @brief	take the next chunk off a thread's own deque
+ *
+ * @param[in]	me - index of the thread
+ * @param[out]	ch - the chunk
+ *
+ * @return	bool
+ * @retval	true	- got a chunk
+ * @retval	false	- deque is empty
+ */
+static bool
+pop_chunk(int me, mt_chunk *ch)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&deques[me].lock);
+	if (!deques[me].chunks.empty()) {
+		*ch = deques[me].chunks.back();
+		deques[me].chunks.pop_back();
+		found = true;
+	}
+	pthread_mutex_unlock(&deques[me].lock);
+
+	return found;
+}
+
+/**
+ * @brief	steal a chunk from the front of another thread's deque
+ *
+ * @param[in]	me - index of the thread stealing
+ * @param[out]	ch - the chunk
+ *
+ * @return	bool
+ * @retval	true	- stole a chunk
+ * @retval	false	- all deques are empty
+ */
+static bool
+steal_chunk(int me, mt_chunk *ch)
+{
+	int i;
+
+	for (i = 1; i <= num_threads; i++) {
+		mt_deque *victim = &deques[(me + i) % (num_threads + 1)];
+		bool found = false;
+
+		pthread_mutex_lock(&victim->lock);
+		if (!victim->chunks.empty()) {
+			*ch = victim->chunks.front();
+			victim->chunks.pop_front();
+			found = true;
+		}
+		pthread_mutex_unlock(&victim->lock);
+		if (found)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief	run chunks of a job until there are none left to take
+ *
+ * @param[in,out]	job - the job
+ * @param[in]	me - index of the thread
+ *
+ * @return void
+ */
+static void
+run_chunks(mt_job *job, int me)
+{
+	mt_chunk ch;
+
+	for (;;) {
+		bool stolen = false;
+
+		if (!pop_chunk(me, &ch)) {
+			if (!steal_chunk(me, &ch))
+				break;
+			stolen = true;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		(*job->fn)(ch.sidx, ch.eidx, ch.chunk);
+		job->busy[me] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		job->nchunks[me]++;
+		if (stolen)
+			job->nstolen[me]++;
+
+		if (--job->left == 0) {
+			pthread_mutex_lock(&result_lock);
+			pthread_cond_signal(&result_cond);
+			pthread_mutex_unlock(&result_lock);
+		}
+	}
+}
+
 /**
  * @brief	Main pthread routine for worker threads
  *
@@ -228,10 +362,10 @@ init_multi_threading(int nthreads)
 void *
 worker(void *tid)
 {
-	th_task_info *work = NULL;
+	mt_job *job;
 	sigset_t set;
 	int ntid;
-	char buf[1024];
+	unsigned long seen_gen = 0;
 
 	pthread_setspecific(th_id_key, tid);
 	ntid = *(int *) tid;
@@ -247,61 +381,25 @@ worker(void *tid)
 	}
 
 	while (!threads_die) {
-		/* Get the next work task from work queue */
+		/* Wait for the next parallel_for() */
 		pthread_mutex_lock(&work_lock);
-		while (ds_queue_is_empty(work_queue) && !threads_die) {
+		while (job_gen == seen_gen && !threads_die)
 			pthread_cond_wait(&work_cond, &work_lock);
+		seen_gen = job_gen;
+		job = cur_job;
+		if (job != NULL) {
+			pthread_mutex_lock(&result_lock);
+			job->active++;
+			pthread_mutex_unlock(&result_lock);
 		}
-		work = static_cast<th_task_info *>(ds_dequeue(work_queue));
 		pthread_mutex_unlock(&work_lock);
 
-		/* find out what task we need to do */
-		if (work != NULL) {
-			switch (work->task_type) {
-				case TS_IS_ND_ELIGIBLE:
-					snprintf(buf, sizeof(buf), "Thread %d calling check_node_eligibility_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					check_node_eligibility_chunk(static_cast<th_data_nd_eligible *>(work->thread_data));
-					break;
-				case TS_DUP_ND_INFO:
-					snprintf(buf, sizeof(buf), "Thread %d calling dup_node_info_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					dup_node_info_chunk(static_cast<th_data_dup_nd_info *>(work->thread_data));
-					break;
-				case TS_QUERY_ND_INFO:
-					snprintf(buf, sizeof(buf), "Thread %d calling query_node_info_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					query_node_info_chunk(static_cast<th_data_query_ninfo *>(work->thread_data));
-					break;
-				case TS_FREE_ND_INFO:
-					snprintf(buf, sizeof(buf), "Thread %d calling free_node_info_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					free_node_info_chunk(static_cast<th_data_free_ninfo *>(work->thread_data));
-					break;
-				case TS_DUP_RESRESV:
-					snprintf(buf, sizeof(buf), "Thread %d calling dup_resource_resv_array_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					dup_resource_resv_array_chunk(static_cast<th_data_dup_resresv *>(work->thread_data));
-					break;
-				case TS_QUERY_JOB_INFO:
-					snprintf(buf, sizeof(buf), "Thread %d calling query_jobs_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					query_jobs_chunk(static_cast<th_data_query_jinfo *>(work->thread_data));
-					break;
-				case TS_FREE_RESRESV:
-					snprintf(buf, sizeof(buf), "Thread %d calling free_resource_resv_array_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					free_resource_resv_array_chunk(static_cast<th_data_free_resresv *>(work->thread_data));
-					break;
-				default:
-					log_event(PBSEVENT_ERROR, PBS_EVENTCLASS_SCHED, LOG_ERR, __func__,
-						  "Invalid task type passed to worker thread");
-			}
-
-			/* Post results */
+		if (job != NULL) {
+			run_chunks(job, ntid);
+
 			pthread_mutex_lock(&result_lock);
-			ds_enqueue(result_queue, (void *) work);
-			pthread_cond_signal(&result_cond);
+			if (--job->active == 0)
+				pthread_cond_signal(&result_cond);
 			pthread_mutex_unlock(&result_lock);
 		}
 	}
@@ -310,17 +408,126 @@ worker(void *tid)
 }
 
 /**
- * @brief	Convenience function to queue up work for worker threads
+ * @brief	pick the number of items handed out at a time by parallel_for()
+ *
+ * @param[in]	num_items - number of items in the range
+ *
+ * @return	int
+ * @retval	grain size, the whole range if the work will not be split
+ */
+int
+mt_grainsize(int num_items)
+{
+	int grain;
+	int tid;
+
+	if (num_items < 1)
+		return 1;
+
+	tid = *((int *) pthread_getspecific(th_id_key));
+	if (tid != 0 || num_threads <= 1 || in_parallel_for)
+		return num_items;
+
+	/* several chunks per thread so that threads which finish early can steal */
+	grain = num_items / (num_threads * MT_CHUNKS_PER_THREAD);
+
+	return (grain > MT_CHUNK_SIZE_MIN) ? grain : MT_CHUNK_SIZE_MIN;
+}
+
+/**
+ * @brief	run fn over the range [0, num_items) in chunks of grainsize items
  *
- * @param[in]	task - the task to queue up
+ * @par	The chunks are spread over the deques of the worker threads and the
+ *	calling thread, which all run chunks until none are left.  The call
+ *	returns once every chunk has been run.  Chunk i covers items
+ *	i * grainsize through min((i + 1) * grainsize, num_items) - 1.
+ *	If called from a worker thread, from inside fn, or with a single
+ *	chunk, fn is run on the calling thread.
+ *
+ * @param[in]	task_type - what kind of work this is, for logging
+ * @param[in]	num_items - number of items in the range
+ * @param[in]	grainsize - items per chunk, see mt_grainsize()
+ * @param[in]	fn - function called as fn(sidx, eidx, chunk) with eidx inclusive
  *
  * @return void
  */
 void
-queue_work_for_threads(th_task_info *task)
+parallel_for(enum thread_task_type task_type, int num_items, int grainsize, const mt_func &fn)
 {
+	mt_job job;
+	int num_chunks;
+	int tid;
+	int i;
+	int chunks = 0;
+	int stolen = 0;
+	double busy = 0;
+	double max_busy = 0;
+
+	if (num_items <= 0)
+		return;
+	if (grainsize < 1)
+		grainsize = mt_grainsize(num_items);
+
+	num_chunks = (num_items + grainsize - 1) / grainsize;
+
+	tid = *((int *) pthread_getspecific(th_id_key));
+	if (tid != 0 || num_threads <= 1 || in_parallel_for || num_chunks == 1) {
+		for (i = 0; i < num_chunks; i++) {
+			int eidx = (i + 1) * grainsize - 1;
+			fn(i * grainsize, (eidx < num_items) ? eidx : num_items - 1, i);
+		}
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	job.fn = &fn;
+	job.left = num_chunks;
+	job.active = 0;
+	job.busy.assign(num_threads + 1, 0);
+	job.nchunks.assign(num_threads + 1, 0);
+	job.nstolen.assign(num_threads + 1, 0);
+
+	/* deal out the chunks round robin, the main thread gets the first ones */
+	for (i = 0; i < num_chunks; i++) {
+		mt_deque *dq = &deques[i % (num_threads + 1)];
+		int eidx = (i + 1) * grainsize - 1;
+
+		pthread_mutex_lock(&dq->lock);
+		dq->chunks.push_back({i * grainsize, (eidx < num_items) ? eidx : num_items - 1, i});
+		pthread_mutex_unlock(&dq->lock);
+	}
+
+	in_parallel_for = 1;
 	pthread_mutex_lock(&work_lock);
-	ds_enqueue(work_queue, (void *) task);
-	pthread_cond_signal(&work_cond);
+	cur_job = &job;
+	job_gen++;
+	pthread_cond_broadcast(&work_cond);
 	pthread_mutex_unlock(&work_lock);
+
+	run_chunks(&job, 0);
+
+	/* All the chunks are taken, no new worker may join the job */
+	pthread_mutex_lock(&work_lock);
+	cur_job = NULL;
+	pthread_mutex_unlock(&work_lock);
+
+	pthread_mutex_lock(&result_lock);
+	while (job.left > 0 || job.active > 0)
+		pthread_cond_wait(&result_cond, &result_lock);
+	pthread_mutex_unlock(&result_lock);
+	in_parallel_for = 0;
+
+	for (i = 0; i <= num_threads; i++) {
+		chunks += job.nchunks[i];
+		stolen += job.nstolen[i];
+		busy += job.busy[i];
+		if (job.busy[i] > max_busy)
+			max_busy = job.busy[i];
+	}
+	log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+		   "%s: %d items in %d chunks (%d stolen, %d run by main thread), wall %.6fs, busy %.6fs, max thread %.6fs",
+		   task_names[task_type], num_items, chunks, stolen, job.nchunks[0],
+		   std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+		   busy, max_busy);
 }
@@ -40,14 +40,21 @@
 #ifndef SRC_SCHEDULER_MULTI_THREADING_H_
 #define SRC_SCHEDULER_MULTI_THREADING_H_
 
+#include <functional>
 #include "data_types.h"
 
-#define MT_CHUNK_SIZE_MIN 1024
-#define MT_CHUNK_SIZE_MAX 8192
+/* minimum number of items handed out at a time by parallel_for() */
+#define MT_CHUNK_SIZE_MIN 256
+/* chunks to split the work into per thread, to leave work to steal */
+#define MT_CHUNKS_PER_THREAD 4
+
+/* body of a parallel_for(): called with the start/end index (inclusive) and the chunk number */
+typedef std::function<void(int, int, int)> mt_func;
 
 int init_multi_threading(int nthreads);
 void kill_threads(void);
 void *worker(void *);
-void queue_work_for_threads(th_task_info *task);
+int mt_grainsize(int num_items);
+void parallel_for(enum thread_task_type task_type, int num_items, int grainsize, const mt_func &fn);
 
 #endif /* SRC_SCHEDULER_MULTI_THREADING_H_ */
@@ -105,7 +105,9 @@
  *
  */
 
+#include <atomic>
 #include <unordered_map>
+#include <new>
 
 #include <pbs_config.h>
 
@@ -144,6 +146,9 @@
 #include "pbs_bitmap.h"
 #include "pbs_license.h"
 #include "multi_threading.h"
+#include "state_feed.h"
+#include "node_scan.h"
+#include "obj_pool.h"
 #ifdef NAS
 #include "site_code.h"
 #endif
@@ -200,38 +205,6 @@ query_node_info_chunk(th_data_query_ninfo *data)
 	data->oarr = ninfo_arr;
 }
 
-/**
- * @brief	Allocates th_data_query_ninfo for multi-threading of query_nodes
- *
- * @param[in]	nodes	-	batch_status of nodes queried from server
- * @param[in]	sinfo	-	server information
- * @param[in]	sidx	-	start index for the jobs list for the thread
- * @param[in]	eidx	-	end index for the jobs list for the thread
- *
- * @return th_data_query_ninfo *
- * @retval a newly allocated th_data_query_ninfo object
- * @retval NULL for malloc error
- */
-static inline th_data_query_ninfo *
-alloc_tdata_nd_query(struct batch_status *nodes, server_info *sinfo, int sidx, int eidx)
-{
-	th_data_query_ninfo *tdata;
-
-	tdata = static_cast<th_data_query_ninfo *>(malloc(sizeof(th_data_query_ninfo)));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-	tdata->error = 0;
-	tdata->nodes = nodes;
-	tdata->oarr = NULL; /* Will be filled by the thread routine */
-	tdata->sinfo = sinfo;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  *      query_nodes - query all the nodes associated with a server
@@ -251,10 +224,10 @@ query_nodes(int pbs_sd, server_info *sinfo)
 	int num_nodes = 0;	       /* the number of nodes */
 	int nidx = 0;
 	static struct attrl *attrib = NULL;
-	th_data_query_ninfo *tdata = NULL;
-	th_task_info *task = NULL;
-	node_info ***ninfo_arrs_tasks = NULL;
-	int tid;
+	int grain;
+	int num_chunks;
+	int th_err = 0;
+	int i;
 
 	if (attrib == NULL) {
 		const char *nodeattrs[] = {
@@ -297,7 +270,9 @@ query_nodes(int pbs_sd, server_info *sinfo)
 	}
 
 	/* get nodes from PBS server */
-	if ((nodes = send_statvnode(pbs_sd, NULL, attrib, NULL)) == NULL) {
+	nodes = feed_query(pbs_sd, "nodes", NULL,
+			   [&](char *extend) { return send_statvnode(pbs_sd, NULL, attrib, extend); });
+	if (nodes == NULL) {
 		auto err = pbs_geterrmsg(pbs_sd);
 		log_eventf(PBSEVENT_SCHED, PBS_EVENTCLASS_NODE, LOG_INFO, "", "Error getting nodes: %s", err);
 		return NULL;
@@ -309,101 +284,61 @@ query_nodes(int pbs_sd, server_info *sinfo)
 		cur_node = cur_node->next;
 	}
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_nd_query(nodes, sinfo, 0, num_nodes - 1);
-		if (tdata == NULL) {
-			pbs_statfree(nodes);
-			return NULL;
-		}
-		query_node_info_chunk(tdata);
-		ninfo_arr = tdata->oarr;
-		free(tdata);
-
-		for (nidx = 0; ninfo_arr[nidx] != NULL; nidx++)
-			ninfo_arr[nidx]->rank = get_sched_rank();
-
-		ninfo_arr[nidx] = NULL;
-	} else {
-		int chunk_size = num_nodes / num_threads;
-		int th_err = 0;
-		int j;
-		int num_tasks;
-		if ((ninfo_arr = static_cast<node_info **>(malloc((num_nodes + 1) * sizeof(node_info *)))) == NULL) {
-			log_err(errno, __func__, MEM_ERR_MSG);
-			pbs_statfree(nodes);
-			return NULL;
-		}
-		ninfo_arr[0] = NULL;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		for (j = 0, num_tasks = 0; num_nodes > 0;
-		     j += chunk_size, num_tasks++, num_nodes -= chunk_size) {
-			tdata = alloc_tdata_nd_query(nodes, sinfo, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-			if (task == NULL) {
-				free(tdata);
-				log_err(errno, __func__, MEM_ERR_MSG);
-				th_err = 1;
-				break;
-			}
-			task->task_id = num_tasks;
-			task->task_type = TS_QUERY_ND_INFO;
-			task->thread_data = (void *) tdata;
+	if ((ninfo_arr = static_cast<node_info **>(malloc((num_nodes + 1) * sizeof(node_info *)))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		feed_release(nodes);
+		return NULL;
+	}
+	ninfo_arr[0] = NULL;
 
-			queue_work_for_threads(task);
-		}
-		ninfo_arrs_tasks = static_cast<node_info ***>(malloc(num_tasks * sizeof(node_info **)));
-		if (ninfo_arrs_tasks == NULL) {
-			log_err(errno, __func__, MEM_ERR_MSG);
+	grain = mt_grainsize(num_nodes);
+	num_chunks = (num_nodes + grain - 1) / grain;
+	std::vector<th_data_query_ninfo> tdata(num_chunks);
+	std::vector<struct batch_status *> chunk_start(num_chunks, NULL);
+
+	/* remember where each chunk starts so no thread has to walk the list */
+	for (cur_node = nodes, i = 0; cur_node != NULL; cur_node = cur_node->next, i++)
+		if (i % grain == 0)
+			chunk_start[i / grain] = cur_node;
+
+	parallel_for(TS_QUERY_ND_INFO, num_nodes, grain, [&](int sidx, int eidx, int chunk) {
+		th_data_query_ninfo *td = &tdata[chunk];
+
+		td->error = 0;
+		td->nodes = chunk_start[chunk];
+		td->oarr = NULL; /* Will be filled by query_node_info_chunk() */
+		td->sinfo = sinfo;
+		td->sidx = 0;
+		td->eidx = eidx - sidx;
+		query_node_info_chunk(td);
+	});
+
+	/* Assemble node info objects from the chunks into the ninfo_arr */
+	for (i = 0; i < num_chunks; i++) {
+		if (tdata[i].error)
 			th_err = 1;
-		}
-		/* Get results from worker threads */
-		for (int i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-				tdata = static_cast<th_data_query_ninfo *>(task->thread_data);
-				if (tdata->error)
-					th_err = 1;
-				ninfo_arrs_tasks[task->task_id] = tdata->oarr;
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
-		if (th_err) {
-			pbs_statfree(nodes);
-			free_nodes(ninfo_arr);
-			return NULL;
-		}
-		/* Assemble node info objects from various threads into the ninfo_arr */
-		for (int i = 0; i < num_tasks; i++) {
-			if (ninfo_arrs_tasks[i] != NULL) {
-				node_info *ninfo;
-
-				for (int j = 0; (ninfo = ninfo_arrs_tasks[i][j]) != NULL; j++) {
-					ninfo->rank = get_sched_rank();
-					ninfo_arr[nidx++] = ninfo;
-				}
-				free(ninfo_arrs_tasks[i]);
+		else if (tdata[i].oarr != NULL) {
+			node_info *ninfo;
+
+			for (int j = 0; (ninfo = tdata[i].oarr[j]) != NULL; j++) {
+				ninfo->rank = get_sched_rank();
+				ninfo_arr[nidx++] = ninfo;
 			}
 		}
-		ninfo_arr[nidx] = NULL;
-		free(ninfo_arrs_tasks);
+		free(tdata[i].oarr);
+	}
+	ninfo_arr[nidx] = NULL;
+
+	if (th_err) {
+		feed_release(nodes);
+		free_nodes(ninfo_arr);
+		return NULL;
 	}
 
 	if (nidx == 0) {
 		log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_SERVER, LOG_INFO, __func__,
 			  "No nodes found in partitions serviced by scheduler");
-		pbs_statfree(nodes);
+		feed_release(nodes);
 		free(ninfo_arr);
 		return NULL;
 	}
@@ -413,7 +348,7 @@ query_nodes(int pbs_sd, server_info *sinfo)
 #endif /* localmod 062 */
 	resolve_indirect_resources(ninfo_arr);
 	sinfo->num_nodes = nidx;
-	pbs_statfree(nodes);
+	feed_release(nodes);
 	return ninfo_arr;
 }
 
@@ -589,6 +524,9 @@ query_node_info(struct batch_status *node, server_info *sinfo)
 	if (ninfo->lic_lock != 1)
 		ninfo->nscr |= NSCR_CYCLE_INELIGIBLE;
 
+	/* resources are looked up on every eligibility check, index them */
+	index_resource_list(ninfo->res);
+
 	return ninfo;
 }
 
@@ -695,35 +633,6 @@ free_node_info_chunk(th_data_free_ninfo *data)
 	}
 }
 
-/**
- * @brief	Allocates th_data_free_ninfo for multi-threading of free_nodes
- *
- * @param[in,out]	ninfo_arr	-	the node array to free
- * @param[in]	sidx	-	start index for the nodes array for the thread
- * @param[in]	eidx	-	end index for the nodes array for the thread
- *
- * @return th_data_free_ninfo *
- * @retval a newly allocated th_data_free_ninfo object
- * @retval NULL for malloc error
- */
-static inline th_data_free_ninfo *
-alloc_tdata_free_nodes(node_info **ninfo_arr, int sidx, int eidx)
-{
-	th_data_free_ninfo *tdata;
-
-	tdata = static_cast<th_data_free_ninfo *>(malloc(sizeof(th_data_free_ninfo)));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-
-	tdata->ninfo_arr = ninfo_arr;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  *		free_nodes - free all the nodes in a node_info array
@@ -736,65 +645,22 @@ alloc_tdata_free_nodes(node_info **ninfo_arr, int sidx, int eidx)
 void
 free_nodes(node_info **ninfo_arr)
 {
-	int i;
-	int chunk_size;
-	th_data_free_ninfo *tdata = NULL;
-	th_task_info *task = NULL;
-	int num_tasks;
 	int num_nodes;
-	int tid;
 
 	if (ninfo_arr == NULL)
 		return;
 
 	num_nodes = count_array(ninfo_arr);
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_free_nodes(ninfo_arr, 0, num_nodes - 1);
-		if (tdata == NULL)
-			return;
+	parallel_for(TS_FREE_ND_INFO, num_nodes, mt_grainsize(num_nodes), [&](int sidx, int eidx, int chunk) {
+		th_data_free_ninfo tdata;
 
-		free_node_info_chunk(tdata);
-		free(tdata);
-		free(ninfo_arr);
-		return;
-	}
-	chunk_size = num_nodes / num_threads;
-	chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-	for (i = 0, num_tasks = 0; num_nodes > 0;
-	     num_tasks++, i += chunk_size, num_nodes -= chunk_size) {
-		tdata = alloc_tdata_free_nodes(ninfo_arr, i, i + chunk_size - 1);
-		if (tdata == NULL)
-			break;
+		tdata.ninfo_arr = ninfo_arr;
+		tdata.sidx = sidx;
+		tdata.eidx = eidx;
+		free_node_info_chunk(&tdata);
+	});
 
-		task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-		if (task == NULL) {
-			free(tdata);
-			log_err(errno, __func__, MEM_ERR_MSG);
-			break;
-		}
-		task->task_type = TS_FREE_ND_INFO;
-		task->thread_data = (void *) tdata;
-
-		queue_work_for_threads(task);
-	}
-
-	/* Get results from worker threads */
-	for (i = 0; i < num_tasks;) {
-		pthread_mutex_lock(&result_lock);
-		while (ds_queue_is_empty(result_queue))
-			pthread_cond_wait(&result_cond, &result_lock);
-		while (!ds_queue_is_empty(result_queue)) {
-			task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-			tdata = static_cast<th_data_free_ninfo *>(task->thread_data);
-			free(tdata);
-			free(task);
-			i++;
-		}
-		pthread_mutex_unlock(&result_lock);
-	}
 	free(ninfo_arr);
 }
 
@@ -1143,41 +1009,6 @@ dup_node_info_chunk(th_data_dup_nd_info *data)
 	}
 }
 
-/**
- * @brief	Allocates th_data_dup_nd_info for multi-threading of dup_nodes
- *
- * @param[in]	flags	-	flags passed to dup_nodes
- * @param[in]	nsinfo	-	the new server
- * @param[in]	onodes	-	the array to duplicate
- * @param[out]	nnodes	-	the duplicated array
- * @param[in]	sidx	-	start index for the nodes list for the thread
- * @param[in]	eidx	-	end index for the nodes list for the thread
- *
- * @return th_data_dup_nd_info *
- * @retval a newly allocated th_data_dup_nd_info object
- * @retval NULL for malloc error
- */
-static inline th_data_dup_nd_info *
-alloc_tdata_dup_nodes(unsigned int flags, server_info *nsinfo, node_info **onodes, node_info **nnodes,
-		      int sidx, int eidx)
-{
-	th_data_dup_nd_info *tdata;
-
-	tdata = static_cast<th_data_dup_nd_info *>(malloc(sizeof(th_data_dup_nd_info)));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-	tdata->flags = flags;
-	tdata->nsinfo = nsinfo;
-	tdata->onodes = onodes;
-	tdata->nnodes = nnodes;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  *		dup_nodes - duplicate an array of nodes
@@ -1196,81 +1027,35 @@ dup_nodes(node_info **onodes, server_info *nsinfo, unsigned int flags)
 {
 	node_info **nnodes;
 	int num_nodes;
-	int thread_node_ct_left;
 	schd_resource *nres = NULL;
 	schd_resource *ores = NULL;
 	schd_resource *tres = NULL;
 	node_info *ninfo = NULL;
-	th_data_dup_nd_info *tdata = NULL;
-	th_task_info *task = NULL;
-	int th_err = 0;
-	int tid;
+	std::atomic<int> th_err(0);
 
 	if (onodes == NULL || nsinfo == NULL)
 		return NULL;
 
-	num_nodes = thread_node_ct_left = count_array(onodes);
+	num_nodes = count_array(onodes);
 
 	if ((nnodes = static_cast<node_info **>(malloc((num_nodes + 1) * sizeof(node_info *)))) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
 		return NULL;
 	}
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_dup_nodes(flags, nsinfo, onodes, nnodes, 0, num_nodes - 1);
-		if (tdata == NULL) {
-			free_nodes(nnodes);
-			log_err(errno, __func__, MEM_ERR_MSG);
-			return NULL;
-		}
-
-		dup_node_info_chunk(tdata);
-		th_err = tdata->error;
-		free(tdata);
-	} else { /* We are multithreading */
-		int j;
-		int num_tasks;
-		int chunk_size = num_nodes / num_threads;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		for (j = 0, num_tasks = 0; thread_node_ct_left > 0;
-		     num_tasks++, j += chunk_size, thread_node_ct_left -= chunk_size) {
-			tdata = alloc_tdata_dup_nodes(flags, nsinfo, onodes, nnodes, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-			if (task == NULL) {
-				free(tdata);
-				th_err = 1;
-				log_err(errno, __func__, MEM_ERR_MSG);
-				break;
-			}
-			task->task_type = TS_DUP_ND_INFO;
-			task->thread_data = (void *) tdata;
-
-			queue_work_for_threads(task);
-		}
-
-		/* Get results from worker threads */
-		for (int i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-				tdata = static_cast<th_data_dup_nd_info *>(task->thread_data);
-				if (tdata->error)
-					th_err = 1;
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
-	}
+	parallel_for(TS_DUP_ND_INFO, num_nodes, mt_grainsize(num_nodes), [&](int sidx, int eidx, int chunk) {
+		th_data_dup_nd_info tdata;
+
+		tdata.flags = flags;
+		tdata.nsinfo = nsinfo;
+		tdata.onodes = onodes;
+		tdata.nnodes = nnodes;
+		tdata.sidx = sidx;
+		tdata.eidx = eidx;
+		dup_node_info_chunk(&tdata);
+		if (tdata.error)
+			th_err = 1;
+	});
 
 	if (th_err) {
 		free_nodes(nnodes);
@@ -1769,7 +1554,7 @@ update_node_on_run(nspec *ns, resource_resv *resresv, const char *job_state)
 	if (resresv->is_job && resresv->eoename != NULL)
 		set_current_eoe(ninfo, resresv->eoename);
 
-	if (is_excl(resresv->place_spec, ninfo->sharing)) {
+	if (is_excl(resresv->place_spec.get(), ninfo->sharing)) {
 		if (resresv->is_resv) {
 			add_node_state(ninfo, ND_resv_exclusive);
 		} else {
@@ -1786,16 +1571,9 @@ update_node_on_run(nspec *ns, resource_resv *resresv, const char *job_state)
 		node_bucket *bkt = ninfo->server->buckets[ninfo->bucket_ind];
 		int ind = ninfo->node_ind;
 
-		if (pbs_bitmap_get_bit(bkt->free_pool->truth, ind)) {
-			pbs_bitmap_bit_off(bkt->free_pool->truth, ind);
-			bkt->free_pool->truth_ct--;
-		} else {
-			pbs_bitmap_bit_off(bkt->busy_later_pool->truth, ind);
-			bkt->busy_later_pool->truth_ct--;
-		}
-
+		pbs_bitmap_bit_off(bkt->free_pool->truth, ind);
+		pbs_bitmap_bit_off(bkt->busy_later_pool->truth, ind);
 		pbs_bitmap_bit_on(bkt->busy_pool->truth, ind);
-		bkt->busy_pool->truth_ct++;
 	}
 }
 
@@ -1844,7 +1622,7 @@ update_node_on_end(node_info *ninfo, resource_resv *resresv, const char *job_sta
 
 	if (ninfo->is_job_busy)
 		remove_node_state(ninfo, ND_jobbusy);
-	if (is_excl(resresv->place_spec, ninfo->sharing)) {
+	if (is_excl(resresv->place_spec.get(), ninfo->sharing)) {
 		if (resresv->is_resv)
 			remove_node_state(ninfo, ND_resv_exclusive);
 		else {
@@ -1899,15 +1677,11 @@ update_node_on_end(node_info *ninfo, resource_resv *resresv, const char *job_sta
 	if (ind != -1 && ninfo->bucket_ind != -1 && ninfo->num_jobs == 0) {
 		node_bucket *bkt = ninfo->server->buckets[ninfo->bucket_ind];
 
-		if (ninfo->node_events == NULL) {
+		if (ninfo->node_events == NULL)
 			pbs_bitmap_bit_on(bkt->free_pool->truth, ind);
-			bkt->free_pool->truth_ct++;
-		} else {
+		else
 			pbs_bitmap_bit_on(bkt->busy_later_pool->truth, ind);
-			bkt->busy_later_pool->truth_ct++;
-		}
 		pbs_bitmap_bit_off(bkt->busy_pool->truth, ind);
-		bkt->busy_pool->truth_ct--;
 	}
 }
 
@@ -1929,6 +1703,24 @@ nspec::~nspec()
 	free_resource_req_list(resreq);
 }
 
+// allocate from the nspec pool
+void *
+nspec::operator new(size_t size)
+{
+	void *ptr;
+
+	if ((ptr = obj_pool<nspec>::alloc()) == NULL)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+// give back to the nspec pool
+void
+nspec::operator delete(void *ptr)
+{
+	obj_pool<nspec>::release(static_cast<nspec *>(ptr));
+}
+
 // copy constructor
 nspec::nspec(const nspec &ons, node_info **ninfo_arr, selspec *sel)
 {
@@ -2662,7 +2454,7 @@ eval_complex_selspec(status *policy, selspec *spec, node_info **ninfo_arr, place
 				 */
 				if (conf.provision_policy != AVOID_PROVISION &&
 				    !cstat.node_sort->empty() && conf.node_sort_unused)
-					qsort(nodes, tot_nodes, sizeof(node_info *), multi_node_sort);
+					sort_node_list(nodes, tot_nodes);
 			}
 			chunks_needed--;
 			nsa.insert(nsa.end(), ns_chunk.begin(), ns_chunk.end());
@@ -2746,6 +2538,10 @@ eval_simple_selspec(status *policy, chunk *chk, node_info **pninfo_arr,
 
 	std::vector<nspec *> nsa;
 
+	pbs_bitmap *scan = NULL; /* vnodes with enough consumables, @see scan_vnode_consumables() */
+	int num_fails = 0;
+	int last_skipped = -1;
+
 	if (chk == NULL || pninfo_arr == NULL || resresv == NULL || pl == NULL)
 		return false;
 
@@ -2832,6 +2628,18 @@ eval_simple_selspec(status *policy, chunk *chk, node_info **pninfo_arr,
 		if (ninfo_arr[i]->nscr)
 			continue;
 
+		/* The scan found the vnode does not have enough consumables free,
+		 * so it would fail below.  Once the error to report is known,
+		 * skip it without building the error again.
+		 */
+		if (scan != NULL && !pbs_bitmap_get_bit(scan, i) &&
+		    ninfo_arr[i]->lic_lock && failerr->status_code != SCHD_UNKWN) {
+			ninfo_arr[i]->nscr |= NSCR_VISITED;
+			last_skipped = i;
+			continue;
+		}
+		last_skipped = -1;
+
 		allocated = false;
 		clear_schd_error(err);
 		if (ninfo_arr[i]->lic_lock) {
@@ -2933,7 +2741,23 @@ eval_simple_selspec(status *policy, chunk *chk, node_info **pninfo_arr,
 			log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_NODE, LOG_DEBUG,
 				  ninfo_arr[i]->name, "Node allocated to job");
 		}
+
+		/* Many vnodes can't hold the chunk.  Rather than building and
+		 * logging an error for each of them, scan the rest at once.  When
+		 * the per vnode errors are logged, keep checking one by one.
+		 */
+		if (!allocated && ++num_fails == NODE_SCAN_MIN_FAILS && scan == NULL &&
+		    !(flags & EVAL_OKBREAK) && !will_log_event(PBSEVENT_DEBUG3))
+			scan = scan_vnode_consumables(ninfo_arr, specreq_cons);
+	}
+
+	/* The error returned is the one of the last vnode looked at */
+	if (last_skipped != -1) {
+		clear_schd_error(err);
+		if (is_vnode_eligible_chunk(specreq_noncons, ninfo_arr[last_skipped], resresv, err))
+			resources_avail_on_vnode(specreq_cons, ninfo_arr[last_skipped], pl, resresv, flags, NULL, err);
 	}
+	pbs_bitmap_free(scan);
 
 	if (specreq_cons != NULL)
 		free_resource_req_list(specreq_cons);
@@ -3451,7 +3275,7 @@ check_resources_for_node(resource_req *resreq, node_info *ninfo,
 		 * at t2.
 		 */
 		auto nres = dup_ind_resource_list(noderes);
-		auto resresv_excl = is_excl(resresv->place_spec, ninfo->sharing);
+		auto resresv_excl = is_excl(resresv->place_spec.get(), ninfo->sharing);
 
 		if (nres != NULL) {
 			/* Walk the event list by time such that the start of an event always
@@ -3494,7 +3318,7 @@ check_resources_for_node(resource_req *resreq, node_info *ninfo,
 						break;
 					}
 
-					if (is_excl(resc_resv->place_spec, ninfo->sharing) || resresv_excl) {
+					if (is_excl(resc_resv->place_spec.get(), ninfo->sharing) || resresv_excl) {
 						min_chunks = 0;
 					} else {
 						for (auto cur_res = nres; cur_res != NULL; cur_res = cur_res->next) {
@@ -4753,11 +4577,7 @@ node_up_event(node_info *node, void *arg)
 		set_node_info_state(node, ND_free);
 
 	sinfo = node->server;
-	if (sinfo->node_group_enable && !sinfo->node_group_key.empty()) {
-		node_partition_update_array(sinfo->policy, sinfo->nodepart);
-		qsort(sinfo->nodepart, sinfo->num_parts,
-		      sizeof(node_partition *), cmp_placement_sets);
-	}
+	mark_node_partitions_stale(node);
 	update_all_nodepart(sinfo->policy, sinfo, NO_ALLPART);
 
 	return 1;
@@ -4801,11 +4621,7 @@ node_down_event(node_info *node, void *arg)
 
 	set_node_info_state(node, ND_down);
 
-	if (sinfo->node_group_enable && !sinfo->node_group_key.empty()) {
-		node_partition_update_array(sinfo->policy, sinfo->nodepart);
-		qsort(sinfo->nodepart, sinfo->num_parts,
-		      sizeof(node_partition *), cmp_placement_sets);
-	}
+	mark_node_partitions_stale(node);
 	update_all_nodepart(sinfo->policy, sinfo, NO_ALLPART);
 
 	return 1;
@@ -4987,8 +4803,8 @@ sim_exclhost_func(timed_event *te, void *arg1, void *arg2)
 	if (find_nspec_by_rank(future_resresv->nspec_arr, ninfo->rank) == NULL)
 		return 0; /* event does not affect the node */
 
-	if (is_exclhost(future_resresv->place_spec, ninfo->sharing) ||
-	    is_exclhost(resresv->place_spec, ninfo->sharing)) {
+	if (is_exclhost(future_resresv->place_spec.get(), ninfo->sharing) ||
+	    is_exclhost(resresv->place_spec.get(), ninfo->sharing)) {
 		return -1;
 	}
 
@@ -5148,41 +4964,6 @@ check_node_eligibility_chunk(th_data_nd_eligible *data)
 	data->err = misc_err;
 }
 
-/**
- * @brief	 Allocates th_data_nd_eligible for multi-threading of check_node_array_eligibility
- *
- * @param[in]	pl	-	the placement object
- * @param[in]	resresv	-	resresv to check to place on nodes
- * @param[in]	exclerr_buf	-	buffer for not exclusive error message
- * @param[in]	ninfo_arr	-	array to check
- * @param[in]	sidx	-	the start index in ninfo_arr for the thread
- * @param[in]	eidx	-	the end index in ninfo_arr for the thread
- *
- * @return th_data_nd_eligible *
- * @retval a newly allocated th_data_nd_eligible object
- * @retval NULL for malloc error
- */
-static inline th_data_nd_eligible *
-alloc_tdata_nd_eligible(place *pl, resource_resv *resresv, node_info **ninfo_arr,
-			int sidx, int eidx)
-{
-	th_data_nd_eligible *tdata;
-
-	tdata = static_cast<th_data_nd_eligible *>(malloc(sizeof(th_data_nd_eligible)));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-	tdata->err = NULL;
-	tdata->pl = pl;
-	tdata->resresv = resresv;
-	tdata->ninfo_arr = ninfo_arr;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  * 		check nodes for eligibility and mark them ineligible if not
@@ -5201,67 +4982,36 @@ alloc_tdata_nd_eligible(place *pl, resource_resv *resresv, node_info **ninfo_arr
 void
 check_node_array_eligibility(node_info **ninfo_arr, resource_resv *resresv, place *pl, schd_error *err)
 {
-	th_data_nd_eligible *tdata = NULL;
-	th_task_info *task = NULL;
-	int tid;
 	int num_nodes;
+	int grain;
+	int num_chunks;
 
 	if (ninfo_arr == NULL || resresv == NULL || pl == NULL || err == NULL)
 		return;
 
 	num_nodes = count_array(ninfo_arr);
-
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_nd_eligible(pl, resresv, ninfo_arr, 0, num_nodes - 1);
-		if (tdata == NULL)
-			return;
-		check_node_eligibility_chunk(tdata);
-		copy_schd_error(err, tdata->err);
-		free_schd_error(tdata->err);
-		free(tdata);
-	} else { /* We are multithreading */
-		int j;
-		int num_tasks;
-		int chunk_size = num_nodes / num_threads;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		for (j = 0, num_tasks = 0; num_nodes > 0;
-		     num_tasks++, j += chunk_size, num_nodes -= chunk_size) {
-			tdata = alloc_tdata_nd_eligible(pl, resresv, ninfo_arr, j, j + chunk_size - 1);
-			if (tdata == NULL)
-				break;
-
-			task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-			if (task == NULL) {
-				free(tdata);
-				log_err(errno, __func__, MEM_ERR_MSG);
-				break;
-			}
-			task->task_type = TS_IS_ND_ELIGIBLE;
-			task->thread_data = (void *) tdata;
-
-			queue_work_for_threads(task);
-		}
-
-		/* Get results from worker threads */
-		for (int i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-				tdata = static_cast<th_data_nd_eligible *>(task->thread_data);
-				if (err->status_code == SCHD_UNKWN && tdata->err->status_code != SCHD_UNKWN)
-					copy_schd_error(err, tdata->err);
-
-				free_schd_error(tdata->err);
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
+	grain = mt_grainsize(num_nodes);
+	num_chunks = (num_nodes + grain - 1) / grain;
+	std::vector<schd_error *> errs(num_chunks, NULL);
+
+	parallel_for(TS_IS_ND_ELIGIBLE, num_nodes, grain, [&](int sidx, int eidx, int chunk) {
+		th_data_nd_eligible tdata;
+
+		tdata.err = NULL;
+		tdata.pl = pl;
+		tdata.resresv = resresv;
+		tdata.ninfo_arr = ninfo_arr;
+		tdata.sidx = sidx;
+		tdata.eidx = eidx;
+		check_node_eligibility_chunk(&tdata);
+		errs[chunk] = tdata.err;
+	});
+
+	/* report the error of the first chunk which had one */
+	for (auto e : errs) {
+		if (e != NULL && err->status_code == SCHD_UNKWN && e->status_code != SCHD_UNKWN)
+			copy_schd_error(err, e);
+		free_schd_error(e);
 	}
 }
 
@@ -52,8 +52,10 @@
  * 	find_node_partition()
  * 	find_node_partition_by_rank()
  * 	create_node_partitions()
+ * 	clear_kept_node_partitions()
  * 	node_partition_update_array()
  * 	node_partition_update()
+ * 	mark_node_partitions_stale()
  * 	free_np_cache_array()
  * 	find_alloc_np_cache()
  * 	resresv_can_fit_nodepart()
@@ -88,6 +90,10 @@
 #include "globals.h"
 #include "sort.h"
 #include "buckets.h"
+#include "cycle_prof.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 /**
@@ -110,6 +116,7 @@ new_node_partition()
 
 	np->ok_break = false;
 	np->excl = false;
+	np->stale = false;
 	np->name = NULL;
 	np->def = NULL;
 	np->res_val = NULL;
@@ -253,6 +260,7 @@ dup_node_partition(node_partition *onp, server_info *nsinfo)
 
 	nnp->ok_break = onp->ok_break;
 	nnp->excl = onp->excl;
+	nnp->stale = onp->stale;
 	nnp->tot_nodes = onp->tot_nodes;
 	nnp->free_nodes = onp->free_nodes;
 	nnp->res = dup_resource_list(onp->res);
@@ -349,18 +357,181 @@ find_node_partition_by_rank(node_partition **np_arr, int rank)
 	return np_arr[i];
 }
 
+/**
+ * @brief
+ * 		group nodes into partitions by their values of resnames.  The
+ *		nodes are grouped in one pass over the nodes using a hash of the
+ *		res_name=res_val partition names.  A node whose resource lists the
+ *		same value more than once is added to that partition once.
+ *
+ * @param[in]	nodes	-	the nodes which to create partitions from
+ * @param[in]	resnames	-	node grouping resource names
+ * @param[in]	flags	-	flags which change operations of node partition creation
+ * @param[out]	parts	-	the new partitions in the order they are first seen
+ * @param[out]	members	-	the nodes of each partition
+ *
+ * @return	bool
+ * @retval	true	: success
+ * @retval	false	: failure, parts is empty
+ */
+static bool
+group_node_partitions(node_info **nodes, const std::vector<std::string> &resnames, unsigned int flags,
+		      std::vector<node_partition *> &parts, std::vector<std::vector<node_info *>> &members)
+{
+	std::unordered_map<std::string, int> np_index;
+	std::unordered_set<std::string> seen_res;
+	static const char *unset_vals[] = {"", NULL};
+
+	for (auto &res_i : resnames) {
+		if (!seen_res.insert(res_i).second)
+			continue;
+		auto def = find_resdef(res_i);
+		for (int node_i = 0; nodes[node_i] != NULL; node_i++) {
+			const char *const *vals = NULL;
+
+			if (nodes[node_i]->is_stale)
+				continue;
+
+			auto res = find_resource(nodes[node_i]->res, def);
+			if (res != NULL) {
+				/* Incase of indirect resource, point it to the right place */
+				if (res->indirect_res != NULL)
+					res = res->indirect_res;
+				vals = res->str_avail;
+			} else if (flags & NP_CREATE_REST)
+				vals = unset_vals;
+			/* else we ignore nodes without the node partition resource set
+			 * unless the NP_CREATE_REST flag is set
+			 */
+			if (vals == NULL)
+				continue;
+
+			for (int val_i = 0; vals[val_i] != NULL; val_i++) {
+				std::string str = res_i + "=" + vals[val_i];
+				auto it = np_index.find(str);
+				if (it == np_index.end()) {
+					auto np = new_node_partition();
+					if (np == NULL) {
+						for (auto p : parts)
+							free_node_partition(p);
+						parts.clear();
+						return false;
+					}
+					np->name = string_dup(str.c_str());
+					np->def = def;
+					np->res_val = string_dup(vals[val_i]);
+					parts.push_back(np);
+					if (np->name == NULL || np->res_val == NULL) {
+						for (auto p : parts)
+							free_node_partition(p);
+						parts.clear();
+						return false;
+					}
+					it = np_index.emplace(str, parts.size() - 1).first;
+					members.emplace_back();
+				}
+				auto &mem = members[it->second];
+				if (mem.empty() || mem.back() != nodes[node_i])
+					mem.push_back(nodes[node_i]);
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief
+ * 		turn grouped partitions into a node partition array.  The node
+ *		arrays, buckets and np_arr are set up for each partition, and the
+ *		meta data of the partitions marked stale is computed.  Partitions
+ *		which are not stale already have their meta data set.
+ *
+ * @param[in]	policy	-	policy info
+ * @param[in]	nodes	-	the nodes the partitions were created from
+ * @param[in]	parts	-	the partitions, freed on error
+ * @param[in]	members	-	the nodes of each partition
+ * @param[in]	flags	-	flags which change operations of node partition creation
+ * @param[out]	num_parts	-	the number of partitions created
+ *
+ * @return	node_partition ** (NULL terminated node_partition array)
+ * @retval	NULL	: on error
+ */
+static node_partition **
+fill_node_partitions(status *policy, node_info **nodes, std::vector<node_partition *> &parts,
+		     std::vector<std::vector<node_info *>> &members, unsigned int flags, int *num_parts)
+{
+	node_partition **np_arr;
+	int np_i;
+	std::vector<queue_info *> queues;
+
+	if (nodes[0] != NULL && nodes[0]->server != NULL)
+		queues = nodes[0]->server->queues;
+
+	if ((np_arr = static_cast<node_partition **>(malloc((parts.size() + 1) * sizeof(node_partition *)))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		for (auto p : parts)
+			free_node_partition(p);
+		return NULL;
+	}
+	for (np_i = 0; np_i < static_cast<int>(parts.size()); np_i++)
+		np_arr[np_i] = parts[np_i];
+	np_arr[np_i] = NULL;
+
+	/* now that we have a list of node partitions and the nodes in each
+	 * lets allocate a node array and fill it
+	 */
+	for (np_i = 0; np_arr[np_i] != NULL; np_i++) {
+		node_partition *np = np_arr[np_i];
+		auto &mem = members[np_i];
+		schd_resource *hostres = NULL;
+		int i = 0;
+
+		np->rank = get_sched_rank();
+		np->ok_break = true;
+		np->ninfo_arr = static_cast<node_info **>(malloc((mem.size() + 1) * sizeof(node_info *)));
+		if (np->ninfo_arr == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			free_node_partition_array(np_arr);
+			return NULL;
+		}
+
+		for (auto ninfo : mem) {
+			if (np->ok_break) {
+				auto tmpres = find_resource(ninfo->res, allres["host"]);
+				if (tmpres != NULL) {
+					if (hostres == NULL)
+						hostres = tmpres;
+					else if (!compare_res_to_str(hostres, tmpres->str_avail[0], CMP_CASELESS))
+						np->ok_break = false;
+				}
+			}
+			if (!(NP_NO_ADD_NP_ARR & flags)) {
+				auto tmp_arr = static_cast<node_partition **>(add_ptr_to_array(ninfo->np_arr, np));
+				if (tmp_arr == NULL) {
+					free_node_partition_array(np_arr);
+					return NULL;
+				}
+				ninfo->np_arr = tmp_arr;
+			}
+			np->ninfo_arr[i++] = ninfo;
+		}
+		np->ninfo_arr[i] = NULL;
+		np->tot_nodes = i;
+		np->bkts = create_node_buckets(policy, np->ninfo_arr, queues, NO_PRINT_BUCKETS);
+		if (np->stale)
+			node_partition_update(policy, np);
+		else if (!policy->node_sort->empty() && conf.node_sort_unused)
+			sort_node_list(np->ninfo_arr, np->tot_nodes);
+	}
+
+	*num_parts = np_i;
+	return np_arr;
+}
+
 /**
  * @brief
  * 		break apart nodes into partitions
- *		A possible side-effect of this function when multiple identical
- *		resources are defined on an attribute, is that the node
- *		partitions accounting for this node may count this node in the
- *		total count of "free_nodes" for that partition (if the node was
- *		free in the first place). Due to this, incorrect accounting,
- *		the metadata of the node partition may cause eval_selspec to
- *		descend into the node matching code instead of bailing out right
- *		away due to the fact that the node partition has insufficient
- *		resources.
  *
  * @param[in]	policy	-	policy info
  * @param[in]	nodes	-	the nodes which to create partitions from
@@ -378,187 +549,260 @@ find_node_partition_by_rank(node_partition **np_arr, int rank)
 node_partition **
 create_node_partitions(status *policy, node_info **nodes, const std::vector<std::string> &resnames, unsigned int flags, int *num_parts)
 {
-	node_partition **np_arr;
-	node_partition *np;
-	node_partition **tmp_arr;
-	int np_arr_size = 0;
-	static schd_resource *res;
-
-	int num_nodes;
-
-	schd_resource *tmpres;
-
-	int val_i;  /* index of placement set resource value */
-	int node_i; /* index into nodes array */
-	int np_i;   /* index into node partition array we are creating */
-
-	static schd_resource *unset_res = NULL;
-
-	std::vector<queue_info *> queues;
+	std::vector<std::vector<node_info *>> members;
+	std::vector<node_partition *> parts;
 
 	if (nodes == NULL || resnames.empty())
 		return NULL;
 
-	if (nodes[0] != NULL && nodes[0]->server != NULL)
-		queues = nodes[0]->server->queues;
+	if (!group_node_partitions(nodes, resnames, flags, parts, members))
+		return NULL;
+	for (auto np : parts)
+		np->stale = true;
 
-	num_nodes = count_array(nodes);
+	return fill_node_partitions(policy, nodes, parts, members, flags, num_parts);
+}
 
-	if ((np_arr = static_cast<node_partition **>(malloc((num_nodes + 1) * sizeof(node_partition *)))) == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
+/* a placement set kept from the last cycle */
+struct np_kept {
+	std::string name;
+	resdef *def;
+	std::string res_val;
+	std::vector<int> members; /* indices into np_layout::nodes */
+	schd_resource *res;	  /* meta data as of the start of the last cycle */
+	int free_nodes;
+};
+
+/* the placement sets of one server, queue or the host sets kept from the last cycle */
+struct np_layout {
+	std::string key;		 /* what the sets were created with: resnames, flags and resdef_to_check */
+	std::vector<std::string> nodes;	 /* names of the nodes the sets were created from in order */
+	std::vector<std::string> groups; /* each node's values of the grouping resources */
+	std::vector<std::string> states; /* each node's state the meta data is summed from */
+	std::vector<np_kept> parts;
+};
+
+/* kept placement sets by owner: "@server", "@hostsets" or the queue name */
+static std::unordered_map<std::string, np_layout> np_layouts;
 
-	np_arr_size = num_nodes;
+/**
+ * @brief free the meta data kept with a layout's placement sets
+ * @param[in] layout - the layout
+ * @return void
+ */
+static void
+free_np_layout_res(np_layout &layout)
+{
+	for (auto &kp : layout.parts)
+		free_resource_list(kp.res);
+	layout.parts.clear();
+}
 
-	np_i = 0;
-	np_arr[0] = NULL;
+/**
+ * @brief forget the placement sets kept from the last cycle
+ * @return void
+ */
+void
+clear_kept_node_partitions(void)
+{
+	for (auto &l : np_layouts)
+		free_np_layout_res(l.second);
+	np_layouts.clear();
+}
 
-	if (flags & NP_CREATE_REST && unset_res == NULL)
-		unset_res = new_resource();
+/**
+ * @brief the state of a node that a placement set's meta data is summed
+ *	  from by node_partition_update()
+ * @param[in] ninfo - the node
+ * @return std::string
+ */
+static std::string
+node_partition_state(node_info *ninfo)
+{
+	std::string state(1, ninfo->is_free ? 'f' : 'b');
+
+	for (auto res = ninfo->res; res != NULL; res = res->next) {
+		state.append(reinterpret_cast<const char *>(&res->def), sizeof(res->def));
+		state.append(reinterpret_cast<const char *>(&res->avail), sizeof(res->avail));
+		state.append(reinterpret_cast<const char *>(&res->assigned), sizeof(res->assigned));
+		for (int i = 0; res->str_avail != NULL && res->str_avail[i] != NULL; i++) {
+			state += res->str_avail[i];
+			state += '\x1f';
+		}
+		state += '\x1e';
+	}
 
-	for (auto &res_i : resnames) {
-		auto def = find_resdef(res_i);
-		for (node_i = 0; nodes[node_i] != NULL; node_i++) {
-			if (nodes[node_i]->is_stale)
-				continue;
+	return state;
+}
 
-			res = find_resource(nodes[node_i]->res, def);
+/**
+ * @brief a node's values of the resources it is grouped by
+ * @param[in] ninfo - the node
+ * @param[in] defs - the grouping resources
+ * @return std::string
+ */
+static std::string
+node_partition_group(node_info *ninfo, const std::vector<resdef *> &defs)
+{
+	std::string group(ninfo->is_stale ? "s" : "");
 
-			if (res == NULL && (flags & NP_CREATE_REST)) {
-				unset_res->name = res_i.c_str();
-				if (set_resource(unset_res, "\"\"", RF_AVAIL) == 0) {
-					free_node_partition_array(np_arr);
-					return NULL;
-				}
-				res = unset_res;
-			}
-			if (res != NULL) {
-				/* Incase of indirect resource, point it to the right place */
-				if (res->indirect_res != NULL)
-					res = res->indirect_res;
-				for (val_i = 0; res->str_avail[val_i] != NULL; val_i++) {
-					std::string str = res_i + "=" + res->str_avail[val_i];
-					/* If we find the partition, we've already created it - add the node
-					 * to the existing partition.  If we don't find it, we create it.
-					 */
-					np = find_node_partition(np_arr, str);
-					if (np == NULL) {
-						if (np_i >= np_arr_size) {
-							tmp_arr = static_cast<node_partition **>(realloc(np_arr,
-													 (np_arr_size * 2 + 1) * sizeof(node_partition *)));
-							if (tmp_arr == NULL) {
-								log_err(errno, __func__, MEM_ERR_MSG);
-								free_node_partition_array(np_arr);
-								return NULL;
-							}
-							np_arr = tmp_arr;
-							np_arr_size *= 2;
-						}
-
-						np_arr[np_i] = new_node_partition();
-						if (np_arr[np_i] != NULL) {
-							np_arr[np_i]->name = string_dup(str.c_str());
-							np_arr[np_i]->def = def;
-							np_arr[np_i]->res_val = string_dup(res->str_avail[val_i]);
-							np_arr[np_i]->tot_nodes = 1;
-							if (nodes[node_i]->is_free)
-								np_arr[np_i]->free_nodes = 1;
-							np_arr[np_i]->rank = get_sched_rank();
-
-							if (np_arr[np_i]->res_val == NULL) {
-								np_arr[np_i + 1] = NULL;
-								free_node_partition_array(np_arr);
-								return NULL;
-							}
-
-							np_i++;
-							np_arr[np_i] = NULL;
-						} else {
-							free_node_partition_array(np_arr);
-							return NULL;
-						}
-					} else {
-						np->tot_nodes++;
-						if (nodes[node_i]->is_free)
-							np->free_nodes++;
-					}
-				}
-			}
-			/* else we ignore nodes without the node partition resource set
-			 * unless the NP_CREATE_REST flag is set
-			 */
+	for (auto def : defs) {
+		auto res = find_resource(ninfo->res, def);
+		if (res == NULL) {
+			group += '\x1d';
+			continue;
+		}
+		if (res->indirect_res != NULL)
+			res = res->indirect_res;
+		for (int i = 0; res->str_avail != NULL && res->str_avail[i] != NULL; i++) {
+			group += res->str_avail[i];
+			group += '\x1f';
 		}
+		group += '\x1e';
 	}
 
-	/* now that we have a list of node partitions and number of nodes in each
-	 * lets allocate a node array and fill it
-	 */
+	return group;
+}
 
-	for (np_i = 0; np_arr[np_i] != NULL; np_i++) {
-		int i = 0;
-		np_arr[np_i]->ok_break = 1;
-		schd_resource *hostres = NULL;
+/**
+ * @brief
+ * 		create_node_partitions() for placement sets which are kept across
+ *		cycles.  If the nodes and their grouping resource values are as
+ *		they were last cycle, the partitions are rebuilt from the kept
+ *		membership without grouping the nodes again.  A partition is
+ *		marked stale if any of its nodes changed state, and only stale
+ *		partitions have their meta data summed by node_partition_update().
+ *		The others start out with the meta data kept from the last cycle.
+ *
+ * @param[in]	policy	-	policy info
+ * @param[in]	owner	-	what the partitions are kept for
+ * @param[in]	nodes	-	the nodes which to create partitions from
+ * @param[in]	resnames	-	node grouping resource names
+ * @param[in]	flags	-	flags which change operations of node partition creation
+ * @param[in]	states	-	node_partition_state() of the server's nodes by node_ind
+ * @param[out]	num_parts	-	the number of partitions created
+ * @param[in,out]	carried	-	incremented by the number of partitions whose meta data was kept
+ *
+ * @return	node_partition ** (NULL terminated node_partition array)
+ * @retval	NULL	: on error
+ */
+static node_partition **
+carry_node_partitions(status *policy, const std::string &owner, node_info **nodes,
+		      const std::vector<std::string> &resnames, unsigned int flags,
+		      const std::vector<std::string> &states, int *num_parts, int *carried)
+{
+	std::vector<std::vector<node_info *>> members;
+	std::vector<node_partition *> parts;
+	std::vector<std::string> names;
+	std::vector<std::string> groups;
+	std::vector<resdef *> defs;
+	std::vector<int> ids;
+	std::vector<bool> kept_meta;
+	std::string key;
+	node_partition **np_arr;
+	int i;
 
-		np_arr[np_i]->ninfo_arr =
-			static_cast<node_info **>(malloc((np_arr[np_i]->tot_nodes + 1) * sizeof(node_info *)));
+	if (nodes == NULL || resnames.empty())
+		return NULL;
 
-		if (np_arr[np_i]->ninfo_arr == NULL) {
-			free_node_partition_array(np_arr);
+	for (auto &r : resnames) {
+		auto def = find_resdef(r);
+		if (std::find(defs.begin(), defs.end(), def) == defs.end())
+			defs.push_back(def);
+		key += r + ',';
+	}
+	key += std::to_string(flags);
+	for (auto def : policy->resdef_to_check)
+		ids.push_back(def->id);
+	std::sort(ids.begin(), ids.end());
+	for (auto id : ids)
+		key += ',' + std::to_string(id);
+
+	for (i = 0; nodes[i] != NULL; i++) {
+		names.push_back(nodes[i]->name);
+		groups.push_back(node_partition_group(nodes[i], defs));
+	}
+
+	auto &layout = np_layouts[owner];
+	if (layout.key == key && layout.nodes == names && layout.groups == groups) {
+		for (auto &kp : layout.parts) {
+			auto np = new_node_partition();
+			if (np == NULL) {
+				for (auto p : parts)
+					free_node_partition(p);
+				return NULL;
+			}
+			parts.push_back(np);
+			np->name = string_dup(kp.name.c_str());
+			np->def = kp.def;
+			np->res_val = string_dup(kp.res_val.c_str());
+			if (np->name == NULL || np->res_val == NULL) {
+				for (auto p : parts)
+					free_node_partition(p);
+				return NULL;
+			}
+			members.emplace_back();
+			for (auto n : kp.members) {
+				members.back().push_back(nodes[n]);
+				if (layout.states[n] != states[nodes[n]->node_ind])
+					np->stale = true;
+			}
+			if (!np->stale) {
+				np->res = dup_resource_list(kp.res);
+				np->free_nodes = kp.free_nodes;
+				if (kp.res != NULL && np->res == NULL)
+					np->stale = true;
+				else
+					(*carried)++;
+			}
+			kept_meta.push_back(!np->stale);
+		}
+	} else {
+		free_np_layout_res(layout);
+		if (!group_node_partitions(nodes, resnames, flags, parts, members)) {
+			np_layouts.erase(owner);
 			return NULL;
 		}
+		for (auto np : parts)
+			np->stale = true;
+		kept_meta.assign(parts.size(), false);
+	}
 
-		np_arr[np_i]->ninfo_arr[0] = NULL;
-
-		for (node_i = 0; nodes[node_i] != NULL && i < np_arr[np_i]->tot_nodes; node_i++) {
-			if (nodes[node_i]->is_stale)
-				continue;
-
-			res = find_resource(nodes[node_i]->res, np_arr[np_i]->def);
-			if (res == NULL && (flags & NP_CREATE_REST)) {
-				set_resource(unset_res, "\"\"", RF_AVAIL);
-				res = unset_res;
-			}
-			if (res != NULL) {
-				/* Incase of indirect resource, point it to the right place */
-				if (res->indirect_res != NULL)
-					res = res->indirect_res;
-				if (compare_res_to_str(res, np_arr[np_i]->res_val, CMP_CASE)) {
-					if (np_arr[np_i]->ok_break) {
-						tmpres = find_resource(nodes[node_i]->res, allres["host"]);
-						if (tmpres != NULL) {
-							if (hostres == NULL)
-								hostres = tmpres;
-							else {
-								if (!compare_res_to_str(hostres, tmpres->str_avail[0], CMP_CASELESS))
-									np_arr[np_i]->ok_break = 0;
-							}
-						}
-					}
-					if (!(NP_NO_ADD_NP_ARR & flags)) {
-						tmp_arr = static_cast<node_partition **>(add_ptr_to_array(nodes[node_i]->np_arr, np_arr[np_i]));
-						if (tmp_arr == NULL) {
-							free_node_partition_array(np_arr);
-							return NULL;
-						}
-						nodes[node_i]->np_arr = tmp_arr;
-					}
+	np_arr = fill_node_partitions(policy, nodes, parts, members, flags, num_parts);
+	if (np_arr == NULL) {
+		free_np_layout_res(layout);
+		np_layouts.erase(owner);
+		return NULL;
+	}
 
-					np_arr[np_i]->ninfo_arr[i] = nodes[node_i];
-					i++;
-					np_arr[np_i]->ninfo_arr[i] = NULL;
-				}
-			}
+	/* keep the partitions as they are at the start of the cycle */
+	if (layout.parts.empty() && !parts.empty()) {
+		std::unordered_map<node_info *, int> index;
+
+		for (i = 0; nodes[i] != NULL; i++)
+			index[nodes[i]] = i;
+		for (size_t p = 0; p < parts.size(); p++) {
+			np_kept kp{parts[p]->name, parts[p]->def, parts[p]->res_val, {}, NULL, 0};
+			for (auto ninfo : members[p])
+				kp.members.push_back(index[ninfo]);
+			layout.parts.push_back(std::move(kp));
 		}
-		/* if multiple resource values are present, tot_nodes may be incorrect.
-		 * recalculating tot_nodes for each node partition.
-		 */
-		np_arr[np_i]->tot_nodes = count_array(np_arr[np_i]->ninfo_arr);
-		np_arr[np_i]->bkts = create_node_buckets(policy, np_arr[np_i]->ninfo_arr, queues, NO_PRINT_BUCKETS);
-		node_partition_update(policy, np_arr[np_i]);
 	}
+	for (size_t p = 0; p < parts.size(); p++) {
+		auto &kp = layout.parts[p];
+		if (kept_meta[p])
+			continue;
+		free_resource_list(kp.res);
+		kp.res = dup_resource_list(parts[p]->res);
+		kp.free_nodes = parts[p]->free_nodes;
+	}
+	layout.key = key;
+	layout.nodes = std::move(names);
+	layout.groups = std::move(groups);
+	layout.states.clear();
+	for (i = 0; nodes[i] != NULL; i++)
+		layout.states.push_back(states[nodes[i]->node_ind]);
 
-	*num_parts = np_i;
 	return np_arr;
 }
 
@@ -582,28 +826,18 @@ update_buckets_for_node(node_bucket **bkts, node_info *ninfo)
 		/* Is this node in the bucket? */
 		if (pbs_bitmap_get_bit(bkts[i]->bkt_nodes, node_ind)) {
 			/* First turn off the current bit */
-			if (pbs_bitmap_get_bit(bkts[i]->free_pool->truth, node_ind)) {
-				pbs_bitmap_bit_off(bkts[i]->free_pool->truth, node_ind);
-				bkts[i]->free_pool->truth_ct--;
-			} else if (pbs_bitmap_get_bit(bkts[i]->busy_later_pool->truth, node_ind)) {
-				pbs_bitmap_bit_off(bkts[i]->busy_later_pool->truth, node_ind);
-				bkts[i]->busy_later_pool->truth_ct--;
-			} else if (pbs_bitmap_get_bit(bkts[i]->busy_pool->truth, node_ind)) {
-				pbs_bitmap_bit_off(bkts[i]->busy_pool->truth, node_ind);
-				bkts[i]->busy_pool->truth_ct--;
-			}
+			pbs_bitmap_bit_off(bkts[i]->free_pool->truth, node_ind);
+			pbs_bitmap_bit_off(bkts[i]->busy_later_pool->truth, node_ind);
+			pbs_bitmap_bit_off(bkts[i]->busy_pool->truth, node_ind);
 
 			/* Next, turn on the correct bit */
 			if (ninfo->num_jobs > 0 || ninfo->num_run_resv > 0) {
 				pbs_bitmap_bit_on(bkts[i]->busy_pool->truth, node_ind);
-				bkts[i]->busy_pool->truth_ct++;
 			} else {
 				if (ninfo->node_events != NULL) {
 					pbs_bitmap_bit_on(bkts[i]->busy_later_pool->truth, node_ind);
-					bkts[i]->busy_later_pool->truth_ct++;
 				} else {
 					pbs_bitmap_bit_on(bkts[i]->free_pool->truth, node_ind);
-					bkts[i]->free_pool->truth_ct++;
 				}
 			}
 		}
@@ -722,13 +956,57 @@ node_partition_update(status *policy, node_partition *np)
 
 	if (!policy->node_sort->empty() && conf.node_sort_unused) {
 		/* Resort the nodes in the partition so that selection works correctly. */
-		qsort(np->ninfo_arr, np->tot_nodes, sizeof(node_info *),
-		      multi_node_sort);
+		sort_node_list(np->ninfo_arr, np->tot_nodes);
 	}
 
+	np->stale = false;
+
 	return rc;
 }
 
+/**
+ * @brief
+ * 		mark the node partitions a node belongs to as stale.  Their
+ *		meta data will be recomputed in the next call to update_all_nodepart()
+ *
+ * @param[in]	ninfo	-	the node which changed
+ *
+ * @return	nothing
+ */
+void
+mark_node_partitions_stale(node_info *ninfo)
+{
+	if (ninfo == NULL || ninfo->np_arr == NULL)
+		return;
+
+	for (int i = 0; ninfo->np_arr[i] != NULL; i++)
+		ninfo->np_arr[i]->stale = true;
+}
+
+/**
+ * @brief
+ * 		update the node partitions in an array which have been marked stale.
+ *		Partitions none of whose nodes have changed are left alone.
+ *
+ * @param[in]	policy	-	policy info
+ * @param[in]	nodepart	-	the array of node partitions
+ *
+ * @return	nothing
+ */
+static void
+update_stale_node_partitions(status *policy, node_partition **nodepart)
+{
+	if (nodepart == NULL)
+		return;
+
+	for (int i = 0; nodepart[i] != NULL; i++) {
+		if (!nodepart[i]->stale)
+			continue;
+		node_partition_update(policy, nodepart[i]);
+		update_buckets_for_node_array(nodepart[i]->bkts, nodepart[i]->ninfo_arr);
+	}
+}
+
 /**
  * @brief
  *		np_cache - constructor
@@ -1012,7 +1290,7 @@ resresv_can_fit_nodepart(status *policy, node_partition *np, resource_resv *resr
 	if ((flags & RETURN_ALL_ERR)) {
 		if (prev_err != NULL) {
 			prev_err->next = NULL;
-			free(err);
+			free_schd_error(err);
 		}
 		return can_fit;
 	}
@@ -1092,7 +1370,9 @@ create_specific_nodepart(status *policy, const char *name, node_info **nodes, in
 
 /**
  * @brief
- * 		create the placement sets for the server and queues
+ * 		create the placement sets for the server and queues.  The
+ *		server's and queues' placement sets and the host sets are kept
+ *		across cycles by carry_node_partitions().
  *
  * @param[in]	policy	-	policy info
  * @param[in]	sinfo	-	the server
@@ -1104,16 +1384,25 @@ create_specific_nodepart(status *policy, const char *name, node_info **nodes, in
 bool
 create_placement_sets(status *policy, server_info *sinfo)
 {
+	prof_timer timer(PROF_PLACEMENT_SETS);
 	bool is_success = true;
+	std::vector<std::string> states;
+	int carried = 0;
+	int total = 0;
+
+	for (int i = 0; sinfo->nodes[i] != NULL; i++)
+		states.push_back(node_partition_state(sinfo->nodes[i]));
 
 	sinfo->allpart = create_specific_nodepart(policy, "all", sinfo->unassoc_nodes, NO_FLAGS);
 	if (sinfo->has_multi_vnode) {
 		const std::vector<std::string> resstr{"host"};
 		int num;
-		sinfo->hostsets = create_node_partitions(policy, sinfo->nodes,
-							 resstr, sc_attrs.only_explicit_psets ? NP_NONE : NP_CREATE_REST, &num);
+		sinfo->hostsets = carry_node_partitions(policy, "@hostsets", sinfo->nodes,
+							resstr, sc_attrs.only_explicit_psets ? NP_NONE : NP_CREATE_REST,
+							states, &num, &carried);
 		if (sinfo->hostsets != NULL) {
 			sinfo->num_hostsets = num;
+			total += num;
 			for (int i = 0; sinfo->nodes[i] != NULL; i++) {
 				schd_resource *hostres;
 				char hostbuf[256];
@@ -1137,12 +1426,13 @@ create_placement_sets(status *policy, server_info *sinfo)
 	}
 
 	if (sinfo->node_group_enable && !sinfo->node_group_key.empty()) {
-		sinfo->nodepart = create_node_partitions(policy, sinfo->unassoc_nodes,
-							 sinfo->node_group_key,
-							 sc_attrs.only_explicit_psets ? NP_NONE : NP_CREATE_REST,
-							 &sinfo->num_parts);
+		sinfo->nodepart = carry_node_partitions(policy, "@server", sinfo->unassoc_nodes,
+							sinfo->node_group_key,
+							sc_attrs.only_explicit_psets ? NP_NONE : NP_CREATE_REST,
+							states, &sinfo->num_parts, &carried);
 
 		if (sinfo->nodepart != NULL) {
+			total += sinfo->num_parts;
 			qsort(sinfo->nodepart, sinfo->num_parts,
 			      sizeof(node_partition *), cmp_placement_sets);
 		} else {
@@ -1171,10 +1461,11 @@ create_placement_sets(status *policy, server_info *sinfo)
 			else
 				ngkey = sinfo->node_group_key;
 
-			qinfo->nodepart = create_node_partitions(policy, ngroup_nodes,
-								 ngkey, sc_attrs.only_explicit_psets ? NP_NONE : NP_CREATE_REST,
-								 &(qinfo->num_parts));
+			qinfo->nodepart = carry_node_partitions(policy, qinfo->name, ngroup_nodes,
+								ngkey, sc_attrs.only_explicit_psets ? NP_NONE : NP_CREATE_REST,
+								states, &(qinfo->num_parts), &carried);
 			if (qinfo->nodepart != NULL) {
+				total += qinfo->num_parts;
 				qsort(qinfo->nodepart, qinfo->num_parts,
 				      sizeof(node_partition *), cmp_placement_sets);
 			} else {
@@ -1184,6 +1475,10 @@ create_placement_sets(status *policy, server_info *sinfo)
 			}
 		}
 	}
+
+	log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SERVER, LOG_DEBUG, __func__,
+		   "Kept the meta data of %d of %d placement sets", carried, total);
+
 	return is_success;
 }
 
@@ -1242,13 +1537,13 @@ update_all_nodepart(status *policy, server_info *sinfo, unsigned int flags)
 		return;
 
 	if (sinfo->node_group_enable && !sinfo->node_group_key.empty())
-		node_partition_update_array(policy, sinfo->nodepart);
+		update_stale_node_partitions(policy, sinfo->nodepart);
 
 	/* Update and resort the placement sets on the queues */
 	for (auto qinfo : sinfo->queues) {
 
 		if (sinfo->node_group_enable && !qinfo->node_group_key.empty())
-			node_partition_update_array(policy, qinfo->nodepart);
+			update_stale_node_partitions(policy, qinfo->nodepart);
 
 		if ((flags & NO_ALLPART) == 0) {
 			if (qinfo->allpart != NULL && qinfo->allpart->res == NULL)
@@ -1257,7 +1552,7 @@ update_all_nodepart(status *policy, server_info *sinfo, unsigned int flags)
 	}
 
 	/* Update and resort the hostsets */
-	node_partition_update_array(policy, sinfo->hostsets);
+	update_stale_node_partitions(policy, sinfo->hostsets);
 
 	if ((flags & NO_ALLPART) == 0)
 		node_partition_update(policy, sinfo->allpart);
@@ -121,6 +121,11 @@ node_partition **copy_node_partition_ptr_array(node_partition **onp_arr, node_pa
 node_partition **create_node_partitions(status *policy, node_info **nodes, const std::vector<std::string> &resnames,
 					unsigned int flags, int *num_parts);
 
+/*
+ *      clear_kept_node_partitions - forget the placement sets kept across cycles
+ */
+void clear_kept_node_partitions(void);
+
 /*
  *
  *      find_node_partition - find a node partition by name in an array
@@ -156,6 +161,9 @@ int node_partition_update_array(status *policy, node_partition **nodepart);
  */
 int node_partition_update(status *policy, node_partition *np);
 
+/* mark the node partitions a node belongs to as needing an update */
+void mark_node_partitions_stale(node_info *ninfo);
+
 /*
  *	free_np_cache_array - destructor for array
  */
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file    node_scan.cpp
+ *
+ * @brief
+ * 		node_scan.cpp - vectorized scan of vnodes for consumable resources
+ *
+ *	The amounts of the requested consumable resources that are free on
+ *	each vnode are copied into one array per resource.  Each array is then
+ *	compared against the requested amount a vector at a time, and the
+ *	results are ANDed into a pbs_bitmap with one bit per vnode.  The
+ *	comparison kernel is picked once at runtime for the cpu the scheduler
+ *	runs on (AVX2, SSE2 or plain C).
+ *
+ * Functions included are:
+ * 	scan_vnode_consumables()
+ * 	node_scan_kernel_name()
+ *
+ */
+#include <pbs_config.h>
+
+#include <errno.h>
+#include <string.h>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NODE_SCAN_X86
+#endif
+#include <log.h>
+#include "node_scan.h"
+#include "constant.h"
+#include "globals.h"
+#include "misc.h"
+#include "server_info.h"
+
+#define SCAN_WORD_BITS (sizeof(unsigned long) * 8)
+
+/* ANDs (col[i] >= amount) for i in [0, n) into bits */
+typedef void (*scan_kernel)(const sch_resource_t *col, int n, sch_resource_t amount, unsigned long *bits);
+
+/**
+ * @brief	plain C scan kernel
+ *
+ * @param[in]	col	-	free amount of the resource on each vnode
+ * @param[in]	n	-	number of vnodes
+ * @param[in]	amount	-	requested amount
+ * @param[in,out]	bits	-	bitmap words to AND the result into
+ *
+ * @return	void
+ */
+static void
+scan_ge_scalar(const sch_resource_t *col, int n, sch_resource_t amount, unsigned long *bits)
+{
+	int i;
+
+	for (i = 0; i < n; i += SCAN_WORD_BITS) {
+		unsigned long word = 0;
+		int end = (n - i < static_cast<int>(SCAN_WORD_BITS)) ? n - i : SCAN_WORD_BITS;
+
+		for (int j = 0; j < end; j++)
+			if (col[i + j] >= amount)
+				word |= 1UL << j;
+		bits[i / SCAN_WORD_BITS] &= word;
+	}
+}
+
+#ifdef NODE_SCAN_X86
+/**
+ * @brief	SSE2 scan kernel, two vnodes per compare
+ * @see	scan_ge_scalar()
+ */
+__attribute__((target("sse2"))) static void
+scan_ge_sse2(const sch_resource_t *col, int n, sch_resource_t amount, unsigned long *bits)
+{
+	__m128d amt = _mm_set1_pd(amount);
+	int i;
+
+	for (i = 0; i < n; i += SCAN_WORD_BITS) {
+		unsigned long word = 0;
+		int end = (n - i < static_cast<int>(SCAN_WORD_BITS)) ? n - i : SCAN_WORD_BITS;
+		int j;
+
+		for (j = 0; j + 2 <= end; j += 2) {
+			__m128d v = _mm_loadu_pd(&col[i + j]);
+			word |= static_cast<unsigned long>(_mm_movemask_pd(_mm_cmpge_pd(v, amt))) << j;
+		}
+		for (; j < end; j++)
+			if (col[i + j] >= amount)
+				word |= 1UL << j;
+		bits[i / SCAN_WORD_BITS] &= word;
+	}
+}
+
+/**
+ * @brief	AVX2 scan kernel, four vnodes per compare
+ * @see	scan_ge_scalar()
+ */
+__attribute__((target("avx2"))) static void
+scan_ge_avx2(const sch_resource_t *col, int n, sch_resource_t amount, unsigned long *bits)
+{
+	__m256d amt = _mm256_set1_pd(amount);
+	int i;
+
+	for (i = 0; i < n; i += SCAN_WORD_BITS) {
+		unsigned long word = 0;
+		int end = (n - i < static_cast<int>(SCAN_WORD_BITS)) ? n - i : SCAN_WORD_BITS;
+		int j;
+
+		for (j = 0; j + 4 <= end; j += 4) {
+			__m256d v = _mm256_loadu_pd(&col[i + j]);
+			word |= static_cast<unsigned long>(_mm256_movemask_pd(_mm256_cmp_pd(v, amt, _CMP_GE_OQ))) << j;
+		}
+		for (; j < end; j++)
+			if (col[i + j] >= amount)
+				word |= 1UL << j;
+		bits[i / SCAN_WORD_BITS] &= word;
+	}
+}
+#endif /* NODE_SCAN_X86 */
+
+/**
+ * @brief	pick the scan kernel for the cpu we're running on
+ *
+ * @param[out]	name	-	name of the picked kernel
+ *
+ * @return	scan_kernel
+ */
+static scan_kernel
+pick_scan_kernel(const char **name)
+{
+#ifdef NODE_SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		*name = "avx2";
+		return scan_ge_avx2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		*name = "sse2";
+		return scan_ge_sse2;
+	}
+#endif
+	*name = "scalar";
+	return scan_ge_scalar;
+}
+
+static const char *kernel_name;
+static scan_kernel kernel = pick_scan_kernel(&kernel_name);
+
+/**
+ * @brief
+ * 		node_scan_kernel_name - name of the scan kernel picked for this cpu
+ *
+ * @return	const char *
+ */
+const char *
+node_scan_kernel_name(void)
+{
+	return kernel_name;
+}
+
+/**
+ * @brief
+ * 		free amount of a resource on a vnode, the way match_resource()
+ *		sees it with UNSET_RES_ZERO
+ *
+ * @param[in]	ninfo	-	the vnode
+ * @param[in]	req	-	the requested resource
+ *
+ * @return	sch_resource_t
+ * @retval	SCHD_INFINITY_RES	: the resource is not checked
+ */
+static sch_resource_t
+vnode_free_amount(node_info *ninfo, resource_req *req)
+{
+	schd_resource *res;
+
+	/* check_avail_resources() doesn't fail a vnode without resources */
+	if (ninfo->res == NULL)
+		return SCHD_INFINITY_RES;
+
+	res = find_resource(ninfo->res, req->def);
+	if (res == NULL || res->orig_str_avail == NULL) {
+		if (conf.ignore_res.find(req->name) != conf.ignore_res.end())
+			return SCHD_INFINITY_RES;
+	}
+	if (res == NULL)
+		return 0;
+	if (res->indirect_res != NULL)
+		res = res->indirect_res;
+
+	/* an unset resource is treated as zero */
+	if (res->avail == SCHD_INFINITY_RES)
+		return 0;
+	if (res->avail - res->assigned <= 0)
+		return 0;
+
+	return res->avail - res->assigned;
+}
+
+/**
+ * @brief
+ * 		scan_vnode_consumables - find the vnodes which have enough of the
+ *		requested consumable resources available
+ *
+ * @par
+ *		A bit is off for each vnode which does not have enough of one of
+ *		the consumable resources in reqlist free right now.  Such a vnode
+ *		would fail check_avail_resources() with UNSET_RES_ZERO.  A bit
+ *		which is on means nothing more than the vnode passed this check.
+ *
+ * @param[in]	ninfo_arr	-	the vnodes to scan
+ * @param[in]	reqlist	-	requested resources, all consumable
+ *
+ * @return	pbs_bitmap *
+ * @retval	bitmap with one bit per vnode in ninfo_arr
+ * @retval	NULL	: reqlist holds a non-consumable resource or error
+ */
+pbs_bitmap *
+scan_vnode_consumables(node_info **ninfo_arr, resource_req *reqlist)
+{
+	pbs_bitmap *bm;
+	resource_req *req;
+	int num_nodes;
+	int i;
+
+	if (ninfo_arr == NULL || reqlist == NULL)
+		return NULL;
+
+	for (req = reqlist; req != NULL; req = req->next)
+		if (!req->type.is_consumable)
+			return NULL;
+
+	num_nodes = count_array(ninfo_arr);
+	if (num_nodes == 0)
+		return NULL;
+
+	if ((bm = pbs_bitmap_alloc(NULL, num_nodes)) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return NULL;
+	}
+	memset(bm->bits, 0xff, bm->num_longs * sizeof(unsigned long));
+	if (num_nodes % SCAN_WORD_BITS != 0)
+		bm->bits[bm->num_longs - 1] = (1UL << (num_nodes % SCAN_WORD_BITS)) - 1;
+
+	std::vector<sch_resource_t> col(num_nodes);
+	for (req = reqlist; req != NULL; req = req->next) {
+		if (req->amount == 0)
+			continue;
+
+		for (i = 0; i < num_nodes; i++)
+			col[i] = vnode_free_amount(ninfo_arr[i], req);
+		kernel(col.data(), num_nodes, req->amount, bm->bits);
+	}
+
+	return bm;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+#ifndef _OBJ_POOL_H
+#define _OBJ_POOL_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+
+/* objects carved out of the heap at a time */
+#define OBJ_POOL_CHUNK 1024
+/* free objects moved between a thread and the shared list at a time */
+#define OBJ_POOL_BATCH 256
+
+/**
+ * @brief
+ *	Pool of fixed size objects for the small structures the scheduler
+ *	creates and frees by the hundred thousand every cycle (resources,
+ *	resource requests, nspecs, errors).
+ *
+ *	Each thread keeps its own list of free objects, so the worker threads
+ *	duplicating and freeing the universe don't contend on malloc.  A
+ *	thread holding more than two batches of free objects hands a batch to
+ *	a shared list, where a thread which ran out picks it up before it
+ *	carves a new chunk.  Chunks are never given back; the memory of one
+ *	cycle is reused by the next.
+ *
+ *	alloc() returns zeroed memory like calloc(), release() takes it back.
+ *	Nothing is constructed or destroyed here.
+ */
+template <typename T>
+class obj_pool
+{
+	struct free_obj {
+		free_obj *next;
+	};
+	struct local_list {
+		free_obj *head;
+		size_t count;
+	};
+
+	static constexpr size_t obj_size =
+		((sizeof(T) > sizeof(free_obj) ? sizeof(T) : sizeof(free_obj)) + alignof(max_align_t) - 1) &
+		~(alignof(max_align_t) - 1);
+
+	static thread_local local_list local;
+	static std::mutex shared_lock;
+	static std::vector<free_obj *> shared; /* batches of OBJ_POOL_BATCH free objects */
+
+	/**
+	 * @brief	refill this thread's free list from the shared list or the heap
+	 *
+	 * @return	bool
+	 * @retval	true	: the free list has objects
+	 * @retval	false	: out of memory
+	 */
+	static bool
+	refill()
+	{
+		char *chunk;
+
+		{
+			std::lock_guard<std::mutex> lock(shared_lock);
+			if (!shared.empty()) {
+				local.head = shared.back();
+				local.count = OBJ_POOL_BATCH;
+				shared.pop_back();
+				return true;
+			}
+		}
+
+		if ((chunk = static_cast<char *>(malloc(obj_size * OBJ_POOL_CHUNK))) == NULL)
+			return false;
+		for (size_t i = 0; i < OBJ_POOL_CHUNK; i++) {
+			free_obj *f = reinterpret_cast<free_obj *>(chunk + i * obj_size);
+			f->next = local.head;
+			local.head = f;
+		}
+		local.count += OBJ_POOL_CHUNK;
+		return true;
+	}
+
+	/**
+	 * @brief	hand a batch of this thread's free objects to the shared list
+	 */
+	static void
+	spill()
+	{
+		free_obj *batch = local.head;
+		free_obj *last = batch;
+
+		for (size_t i = 1; i < OBJ_POOL_BATCH; i++)
+			last = last->next;
+		local.head = last->next;
+		local.count -= OBJ_POOL_BATCH;
+		last->next = NULL;
+
+		std::lock_guard<std::mutex> lock(shared_lock);
+		shared.push_back(batch);
+	}
+
+public:
+	/**
+	 * @brief	allocate a zeroed object
+	 *
+	 * @return	T *
+	 * @retval	NULL	: out of memory
+	 */
+	static T *
+	alloc()
+	{
+		free_obj *f;
+
+		if (local.head == NULL && !refill())
+			return NULL;
+
+		f = local.head;
+		local.head = f->next;
+		local.count--;
+		memset(f, 0, sizeof(T));
+		return reinterpret_cast<T *>(f);
+	}
+
+	/**
+	 * @brief	give an object from alloc() back to the pool
+	 *
+	 * @param[in]	obj	-	the object, may be NULL
+	 */
+	static void
+	release(T *obj)
+	{
+		free_obj *f = reinterpret_cast<free_obj *>(obj);
+
+		if (f == NULL)
+			return;
+
+		f->next = local.head;
+		local.head = f;
+		if (++local.count > 2 * OBJ_POOL_BATCH)
+			spill();
+	}
+};
+
+template <typename T>
+thread_local typename obj_pool<T>::local_list obj_pool<T>::local = {NULL, 0};
+template <typename T>
+std::mutex obj_pool<T>::shared_lock;
+template <typename T>
+std::vector<typename obj_pool<T>::free_obj *> obj_pool<T>::shared;
+
+#endif /* _OBJ_POOL_H */
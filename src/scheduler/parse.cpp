@@ -100,6 +100,7 @@ config::config() : fairshare_res("cput"), fairshare_ent("euser")
 	node_sort_unused = 0;
 	resv_conf_ignore = 0;
 	allow_aoe_calendar = 0;
+	cycle_profile = 0;
 #ifdef NAS /* localmod 034 */
 	prime_sto = 0;
 	non_prime_sto = 0;
@@ -117,6 +118,8 @@ config::config() : fairshare_res("cput"), fairshare_ent("euser")
 	unknown_shares = 0;		      /* unknown group shares */
 	max_preempt_attempts = SCHD_INFINITY; /* max num of preempt attempts per cyc*/
 	max_jobs_to_check = SCHD_INFINITY;    /* max number of jobs to check in cyc*/
+	state_feed_resync = 20;		      /* cycles between full server queries */
+	runjob_pipeline_depth = 0;	      /* wait for every runjob acknowledgement */
 	fairshare_decay_factor = .5;	      /* decay factor used when decaying fairshare tree */
 #ifdef NAS
 	/* localmod 034 */
@@ -284,6 +287,8 @@ parse_config(const char *fname)
 					tmpconf.enforce_no_shares = num ? 1 : 0;
 				else if (!strcmp(config_name, PARSE_ALLOW_AOE_CALENDAR))
 					tmpconf.allow_aoe_calendar = 1;
+				else if (!strcmp(config_name, PARSE_CYCLE_PROFILE))
+					tmpconf.cycle_profile = num ? 1 : 0;
 				else if (!strcmp(config_name, PARSE_PRIME_SPILL)) {
 					if (prime == PRIME || prime == PT_ALL)
 						tmpconf.prime_spill = res_to_num(config_value, &type);
@@ -324,6 +329,8 @@ parse_config(const char *fname)
 					}
 				} else if (!strcmp(config_name, PARSE_FAIRSHARE_RES)) {
 					tmpconf.fairshare_res = config_value;
+				} else if (!strcmp(config_name, PARSE_CAPTURE_FILE)) {
+					tmpconf.capture_file = config_value;
 				} else if (!strcmp(config_name, PARSE_FAIRSHARE_ENT)) {
 					if (strcmp(config_value, ATTR_euser) &&
 					    strcmp(config_value, ATTR_egroup) &&
@@ -584,7 +591,11 @@ parse_config(const char *fname)
 						tmpconf.max_jobs_to_check = SCHD_INFINITY;
 					else
 						tmpconf.max_jobs_to_check = num;
-				} else if (!strcmp(config_name, PARSE_SELECT_PROVISION)) {
+				} else if (!strcmp(config_name, PARSE_STATE_FEED_RESYNC))
+					tmpconf.state_feed_resync = num;
+				else if (!strcmp(config_name, PARSE_RUNJOB_PIPELINE_DEPTH))
+					tmpconf.runjob_pipeline_depth = num;
+				else if (!strcmp(config_name, PARSE_SELECT_PROVISION)) {
 					if (!strcmp(config_value, PROVPOLICY_AVOID))
 						tmpconf.provision_policy = AVOID_PROVISION;
 				}
@@ -43,6 +43,7 @@
 #include "pbs_bitmap.h"
 
 #define BYTES_TO_BITS(x) ((x) *8)
+#define BITS_PER_LONG BYTES_TO_BITS(sizeof(unsigned long))
 
 /**
  * @brief allocate space for a pbs_bitmap (and possibly the bitmap itself)
@@ -70,17 +71,11 @@ pbs_bitmap_alloc(pbs_bitmap *pbm, unsigned long num_bits)
 		bm = pbm;
 
 	/* shrinking bitmap, clear previously used bits */
-	if (num_bits < bm->num_bits) {
-		long i;
-		i = num_bits / BYTES_TO_BITS(sizeof(unsigned long)) + 1;
-		for (; static_cast<unsigned long>(i) < bm->num_longs; i++)
-			bm->bits[i] = 0;
-		for (i = pbs_bitmap_next_on_bit(bm, num_bits); i != -1; i = pbs_bitmap_next_on_bit(bm, i))
-			pbs_bitmap_bit_off(bm, i);
-	}
+	if (num_bits < bm->num_bits)
+		pbs_bitmap_clear_range(bm, num_bits, bm->num_bits);
 
 	/* If we have enough unused bits available, we don't need to allocate */
-	if (bm->num_longs * BYTES_TO_BITS(sizeof(unsigned long)) >= num_bits) {
+	if (bm->num_longs * BITS_PER_LONG >= num_bits) {
 		bm->num_bits = num_bits;
 		return bm;
 	}
@@ -88,8 +83,8 @@ pbs_bitmap_alloc(pbs_bitmap *pbm, unsigned long num_bits)
 	prev_longs = bm->num_longs;
 
 	bm->num_bits = num_bits;
-	bm->num_longs = num_bits / BYTES_TO_BITS(sizeof(unsigned long));
-	if (num_bits % BYTES_TO_BITS(sizeof(unsigned long)) > 0)
+	bm->num_longs = num_bits / BITS_PER_LONG;
+	if (num_bits % BITS_PER_LONG > 0)
 		bm->num_longs++;
 	tmp_bits = static_cast<unsigned long *>(calloc(bm->num_longs, sizeof(unsigned long)));
 	if (tmp_bits == NULL) {
@@ -140,8 +135,8 @@ pbs_bitmap_bit_on(pbs_bitmap *pbm, unsigned long bit)
 			return 0;
 	}
 
-	long_ind = bit / BYTES_TO_BITS(sizeof(unsigned long));
-	b = 1UL << (bit % BYTES_TO_BITS(sizeof(unsigned long)));
+	long_ind = bit / BITS_PER_LONG;
+	b = 1UL << (bit % BITS_PER_LONG);
 
 	pbm->bits[long_ind] |= b;
 	return 1;
@@ -167,8 +162,8 @@ pbs_bitmap_bit_off(pbs_bitmap *pbm, unsigned long bit)
 			return 0;
 	}
 
-	long_ind = bit / BYTES_TO_BITS(sizeof(unsigned long));
-	b = 1UL << (bit % BYTES_TO_BITS(sizeof(unsigned long)));
+	long_ind = bit / BITS_PER_LONG;
+	b = 1UL << (bit % BITS_PER_LONG);
 
 	pbm->bits[long_ind] &= ~b;
 	return 1;
@@ -194,8 +189,8 @@ pbs_bitmap_get_bit(pbs_bitmap *pbm, unsigned long bit)
 	if (bit >= pbm->num_bits)
 		return 0;
 
-	long_ind = bit / BYTES_TO_BITS(sizeof(unsigned long));
-	b = 1UL << (bit % BYTES_TO_BITS(sizeof(unsigned long)));
+	long_ind = bit / BITS_PER_LONG;
+	b = 1UL << (bit % BITS_PER_LONG);
 
 	return (pbm->bits[long_ind] & b) ? 1 : 0;
 }
@@ -212,45 +207,25 @@ int
 pbs_bitmap_next_on_bit(pbs_bitmap *pbm, unsigned long start_bit)
 {
 	unsigned long long_ind;
-	long bit;
-	size_t i;
+	unsigned long word;
 
 	if (pbm == NULL)
 		return -1;
 
-	if (start_bit >= pbm->num_bits)
+	if (start_bit + 1 >= pbm->num_bits)
 		return -1;
 
-	long_ind = start_bit / BYTES_TO_BITS(sizeof(unsigned long));
-	bit = start_bit % BYTES_TO_BITS(sizeof(unsigned long));
-
-	/* special case - look at first long that contains start_bit */
-	if (pbm->bits[long_ind] != 0) {
-		for (i = bit + 1; i < BYTES_TO_BITS(sizeof(unsigned long)); i++) {
-			if (pbm->bits[long_ind] & (1UL << i)) {
-				return (long_ind * BYTES_TO_BITS(sizeof(unsigned long)) + i);
-			}
-		}
-
-		/* didn't find an on bit after start_bit_index in the long that contained start_bit */
-		if (long_ind < pbm->num_longs) {
-			long_ind++;
-		}
-	}
-
-	for (; long_ind < pbm->num_longs && pbm->bits[long_ind] == 0; long_ind++)
-		;
-
-	if (long_ind == pbm->num_longs)
-		return -1;
+	long_ind = (start_bit + 1) / BITS_PER_LONG;
+	/* mask off start_bit and the bits before it in its long */
+	word = pbm->bits[long_ind] & (~0UL << ((start_bit + 1) % BITS_PER_LONG));
 
-	for (i = 0; i < BYTES_TO_BITS(sizeof(unsigned long)); i++) {
-		if (pbm->bits[long_ind] & (1UL << i)) {
-			return (long_ind * BYTES_TO_BITS(sizeof(unsigned long)) + i);
-		}
+	while (word == 0) {
+		if (++long_ind >= pbm->num_longs)
+			return -1;
+		word = pbm->bits[long_ind];
 	}
 
-	return -1;
+	return long_ind * BITS_PER_LONG + __builtin_ctzl(word);
 }
 
 /**
@@ -263,10 +238,16 @@ pbs_bitmap_next_on_bit(pbs_bitmap *pbm, unsigned long start_bit)
 int
 pbs_bitmap_first_on_bit(pbs_bitmap *bm)
 {
-	if (pbs_bitmap_get_bit(bm, 0))
-		return 0;
+	unsigned long i;
 
-	return pbs_bitmap_next_on_bit(bm, 0);
+	if (bm == NULL)
+		return -1;
+
+	for (i = 0; i < bm->num_longs; i++)
+		if (bm->bits[i] != 0)
+			return i * BITS_PER_LONG + __builtin_ctzl(bm->bits[i]);
+
+	return -1;
 }
 
 /**
@@ -330,3 +311,189 @@ pbs_bitmap_is_equal(pbs_bitmap *L, pbs_bitmap *R)
 
 	return 1;
 }
+
+/**
+ * @brief count the number of on bits in a bitmap
+ * @param bm - the bitmap
+ * @return unsigned long
+ * @retval number of on bits
+ */
+#if defined(__x86_64__)
+__attribute__((target_clones("popcnt", "default")))
+#endif
+unsigned long
+pbs_bitmap_count(pbs_bitmap *bm)
+{
+	unsigned long i;
+	unsigned long ct = 0;
+
+	if (bm == NULL)
+		return 0;
+
+	for (i = 0; i < bm->num_longs; i++)
+		ct += __builtin_popcountl(bm->bits[i]);
+
+	return ct;
+}
+
+/**
+ * @brief pbs_bitmap version of L &= R
+ * @param L - bitmap lvalue
+ * @param R - bitmap rvalue
+ * @return int
+ * @retval 1 success
+ * @retval 0 failure
+ */
+int
+pbs_bitmap_and(pbs_bitmap *L, pbs_bitmap *R)
+{
+	unsigned long i;
+
+	if (L == NULL || R == NULL)
+		return 0;
+
+	for (i = 0; i < L->num_longs && i < R->num_longs; i++)
+		L->bits[i] &= R->bits[i];
+	/* bits past the end of R are off */
+	for (; i < L->num_longs; i++)
+		L->bits[i] = 0;
+
+	return 1;
+}
+
+/**
+ * @brief pbs_bitmap version of L |= R
+ * @param L - bitmap lvalue
+ * @param R - bitmap rvalue
+ * @return int
+ * @retval 1 success
+ * @retval 0 failure
+ */
+int
+pbs_bitmap_or(pbs_bitmap *L, pbs_bitmap *R)
+{
+	unsigned long i;
+
+	if (L == NULL || R == NULL)
+		return 0;
+
+	if (R->num_bits > L->num_bits)
+		if (pbs_bitmap_alloc(L, R->num_bits) == NULL)
+			return 0;
+
+	for (i = 0; i < L->num_longs && i < R->num_longs; i++)
+		L->bits[i] |= R->bits[i];
+
+	return 1;
+}
+
+/**
+ * @brief pbs_bitmap version of L &= ~R
+ * @param L - bitmap lvalue
+ * @param R - bitmap rvalue
+ * @return int
+ * @retval 1 success
+ * @retval 0 failure
+ */
+int
+pbs_bitmap_andnot(pbs_bitmap *L, pbs_bitmap *R)
+{
+	unsigned long i;
+
+	if (L == NULL || R == NULL)
+		return 0;
+
+	for (i = 0; i < L->num_longs && i < R->num_longs; i++)
+		L->bits[i] &= ~R->bits[i];
+
+	return 1;
+}
+
+/**
+ * @brief turn a range of bits on or off a long at a time
+ * @param bm - the bitmap
+ * @param start - first bit of the range
+ * @param end - one past the last bit of the range
+ * @param on - 1 to turn the bits on, 0 to turn them off
+ * @return nothing
+ */
+static void
+bitmap_range_op(pbs_bitmap *bm, unsigned long start, unsigned long end, int on)
+{
+	unsigned long first = start / BITS_PER_LONG;
+	unsigned long last = (end - 1) / BITS_PER_LONG;
+	unsigned long first_mask = ~0UL << (start % BITS_PER_LONG);
+	unsigned long last_mask = ~0UL >> (BITS_PER_LONG - 1 - (end - 1) % BITS_PER_LONG);
+	unsigned long i;
+
+	if (first == last)
+		first_mask &= last_mask;
+
+	if (on)
+		bm->bits[first] |= first_mask;
+	else
+		bm->bits[first] &= ~first_mask;
+
+	if (first == last)
+		return;
+
+	for (i = first + 1; i < last; i++)
+		bm->bits[i] = on ? ~0UL : 0;
+
+	if (on)
+		bm->bits[last] |= last_mask;
+	else
+		bm->bits[last] &= ~last_mask;
+}
+
+/**
+ * @brief turn on the bits from start up to (but not including) end
+ * @param bm - the bitmap
+ * @param start - first bit to turn on
+ * @param end - one past the last bit to turn on
+ * @return int
+ * @retval 1 success
+ * @retval 0 failure
+ */
+int
+pbs_bitmap_set_range(pbs_bitmap *bm, unsigned long start, unsigned long end)
+{
+	if (bm == NULL)
+		return 0;
+
+	if (start >= end)
+		return 1;
+
+	if (end > bm->num_bits)
+		if (pbs_bitmap_alloc(bm, end) == NULL)
+			return 0;
+
+	bitmap_range_op(bm, start, end, 1);
+	return 1;
+}
+
+/**
+ * @brief turn off the bits from start up to (but not including) end
+ * @param bm - the bitmap
+ * @param start - first bit to turn off
+ * @param end - one past the last bit to turn off
+ * @return int
+ * @retval 1 success
+ * @retval 0 failure
+ */
+int
+pbs_bitmap_clear_range(pbs_bitmap *bm, unsigned long start, unsigned long end)
+{
+	if (bm == NULL)
+		return 0;
+
+	/* bits past num_bits are always off */
+	if (end > bm->num_bits)
+		end = bm->num_bits;
+
+	if (start >= end)
+		return 1;
+
+	bitmap_range_op(bm, start, end, 0);
+	return 1;
+}
@@ -75,4 +75,22 @@ int pbs_bitmap_assign(pbs_bitmap *L, pbs_bitmap *R);
 /* pbs_bitmap's version of L == R */
 int pbs_bitmap_is_equal(pbs_bitmap *L, pbs_bitmap *R);
 
+/* Count the on bits in a bitmap */
+unsigned long pbs_bitmap_count(pbs_bitmap *bm);
+
+/* pbs_bitmap's version of L &= R */
+int pbs_bitmap_and(pbs_bitmap *L, pbs_bitmap *R);
+
+/* pbs_bitmap's version of L |= R */
+int pbs_bitmap_or(pbs_bitmap *L, pbs_bitmap *R);
+
+/* pbs_bitmap's version of L &= ~R */
+int pbs_bitmap_andnot(pbs_bitmap *L, pbs_bitmap *R);
+
+/* Turn on the bits in [start, end) */
+int pbs_bitmap_set_range(pbs_bitmap *bm, unsigned long start, unsigned long end);
+
+/* Turn off the bits in [start, end) */
+int pbs_bitmap_clear_range(pbs_bitmap *bm, unsigned long start, unsigned long end);
+
 #endif /* _PBS_BITMASK_H */
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file    pbs_sched_replay.cpp
+ *
+ * @brief
+ *	pbs_sched_replay - run the scheduling cycle over a cycle captured with
+ *	the capture_file sched_config option, without a server or MoMs.
+ *
+ *	usage: pbs_sched_replay [-d sched_priv] [-L logfile] [-c cycle]
+ *				[-n runs] [-t threads] capture_file
+ *
+ *	The sched_config, resource_group and other files are read from the
+ *	sched_priv directory given with -d, as pbs_sched would.  The cycle
+ *	writes the fairshare usage file there, so use a copy.  Each run of the
+ *	cycle is profiled as with cycle_profile and its wall time, decisions
+ *	and the memory high water mark are printed.
+ */
+#include <pbs_config.h> /* the master config generated by configure */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "config.h"
+#include "cycle_prof.h"
+#include "data_types.h"
+#include "fifo.h"
+#include "globals.h"
+#include "libpbs.h"
+#include "log.h"
+#include "pbs_ecl.h"
+#include "pbs_version.h"
+#include "replay.h"
+
+/* the cycle never talks to the server, any descriptor but SIMULATE_SD will do */
+#define REPLAY_SD INT_MAX
+
+int
+main(int argc, char *argv[])
+{
+	const char *usage = "[-d sched_priv] [-L logfile] [-c cycle] [-n runs] [-t threads] capture_file";
+	char *priv_dir = NULL;
+	char *logfile = NULL;
+	char *endp;
+	int cycle = 0;
+	int runs = 1;
+	int nthreads = -1;
+	int errflg = 0;
+	int c;
+	char log_dir[MAXPATHLEN + 1];
+	char cwd[MAXPATHLEN + 1];
+	char *capture;
+	sched_cmd cmd;
+	struct rusage ru;
+
+	PRINT_VERSION_AND_EXIT(argc, argv);
+
+	if (set_msgdaemonname(const_cast<char *>("pbs_sched_replay"))) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	while ((c = getopt(argc, argv, "d:L:c:n:t:")) != EOF) {
+		switch (c) {
+			case 'd':
+				priv_dir = optarg;
+				break;
+			case 'L':
+				logfile = optarg;
+				break;
+			case 'c':
+				cycle = strtol(optarg, &endp, 10);
+				if (*endp != '\0' || cycle < 0)
+					errflg = 1;
+				break;
+			case 'n':
+				runs = strtol(optarg, &endp, 10);
+				if (*endp != '\0' || runs < 1)
+					errflg = 1;
+				break;
+			case 't':
+				nthreads = strtol(optarg, &endp, 10);
+				if (*endp != '\0' || nthreads < 1)
+					errflg = 1;
+				break;
+			default:
+				errflg = 1;
+				break;
+		}
+	}
+
+	if (errflg || optind != argc - 1) {
+		fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+		fprintf(stderr, "       %s --version\n", argv[0]);
+		return 1;
+	}
+
+	/* the capture file is relative to where we were started */
+	if (argv[optind][0] != '/' && getcwd(cwd, sizeof(cwd)) != NULL) {
+		if ((capture = static_cast<char *>(malloc(strlen(cwd) + strlen(argv[optind]) + 2))) == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+		sprintf(capture, "%s/%s", cwd, argv[optind]);
+	} else
+		capture = argv[optind];
+
+	if (pbs_loadconf(0) == 0)
+		return 1;
+
+	set_no_attribute_verification();
+
+	if (pbs_client_thread_init_thread_context() != 0) {
+		fprintf(stderr, "%s: Unable to initialize thread context\n", argv[0]);
+		return 1;
+	}
+
+	set_log_conf(pbs_conf.pbs_leaf_name, pbs_conf.pbs_mom_node_name,
+		     pbs_conf.locallog, pbs_conf.syslogfac,
+		     pbs_conf.syslogsvr, pbs_conf.pbs_log_highres_timestamp);
+
+	if (nthreads == -1)
+		nthreads = pbs_conf.pbs_sched_threads;
+
+	sc_name = PBS_DFLT_SCHED_NAME;
+	dflt_sched = 1;
+
+	if (priv_dir == NULL) {
+		snprintf(log_dir, sizeof(log_dir), "%s/sched_priv", pbs_conf.pbs_home_path);
+		priv_dir = log_dir;
+	}
+	if (chdir(priv_dir) == -1) {
+		perror(priv_dir);
+		return 1;
+	}
+
+	/* log next to the scheduler's files unless told otherwise */
+	if (getcwd(log_dir, sizeof(log_dir)) == NULL || log_open(logfile, log_dir) == -1) {
+		fprintf(stderr, "%s: logfile could not be opened\n", argv[0]);
+		return 1;
+	}
+
+	if (schedinit(nthreads) != 0) {
+		fprintf(stderr, "%s: could not initialize the scheduler\n", argv[0]);
+		return 1;
+	}
+	/* a capture_file in the copied sched_config must not append to itself */
+	conf.capture_file.clear();
+	conf.cycle_profile = 1;
+
+	if (!replay_load(capture, cycle)) {
+		fprintf(stderr, "%s: could not load cycle %d of %s\n", argv[0], cycle, capture);
+		return 1;
+	}
+
+	cmd.cmd = SCH_SCHEDULE_NEW;
+	cmd.jid = NULL;
+
+	for (int i = 0; i < runs; i++) {
+		struct timespec begin;
+		struct timespec end;
+
+		replay_begin_cycle();
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+
+		/* the resource definitions are read by query_server() on the first run */
+		if (!set_validate_sched_attrs(REPLAY_SD)) {
+			fprintf(stderr, "%s: captured scheduler object is not valid\n", argv[0]);
+			return 1;
+		}
+		cycle_prof_begin();
+		scheduling_cycle(REPLAY_SD, &cmd);
+		cycle_prof_end(REPLAY_SD);
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		printf("run %d: cycle=%.6fs runjob=%d preempt=%d sigjob=%d confirmresv=%d\n", i,
+		       (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9,
+		       replay_accepted("runjob"), replay_accepted("preempt"),
+		       replay_accepted("sigjob"), replay_accepted("confirmresv"));
+	}
+
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+		printf("maxrss=%ldkB\n", ru.ru_maxrss);
+	printf("phase timings: %s/cycle_prof.json\n", log_dir);
+
+	log_close(1);
+	return 0;
+}
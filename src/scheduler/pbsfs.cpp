@@ -206,7 +206,7 @@ main(int argc, char *argv[])
 		fprintf(stderr, "Error in preloading fairshare information\n");
 		return 1;
 	}
-	if (parse_group(RESGROUP_FILE, fstree->root) == 0)
+	if (parse_group(RESGROUP_FILE, fstree) == 0)
 		return 1;
 
 	if (flags & FS_TRIM_TREE) {
@@ -224,17 +224,17 @@ main(int argc, char *argv[])
 		printf("Fairshare usage units are in: %s\n", conf.fairshare_res.c_str());
 		print_fairshare(fstree->root, -1);
 	} else if (flags & FS_DECAY) {
-		decay_fairshare_tree(fstree->root);
+		decay_fairshare_tree(fstree->root, 1);
 		fstree->last_decay = time(NULL);
 	} else if (flags & (FS_GET | FS_SET | FS_COMP)) {
-		ginfo = find_group_info(argv[optind], fstree->root);
+		ginfo = find_group_info(argv[optind], fstree);
 
 		if (ginfo == NULL) {
 			fprintf(stderr, "Fairshare Entity %s does not exist.\n", argv[optind]);
 			return 1;
 		}
 		if (flags & FS_COMP) {
-			ginfo2 = find_group_info(argv[optind + 1], fstree->root);
+			ginfo2 = find_group_info(argv[optind + 1], fstree);
 
 			if (ginfo2 == NULL) {
 				fprintf(stderr, "Fairshare Entity %s does not exist.\n", argv[optind + 1]);
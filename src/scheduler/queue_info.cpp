@@ -77,6 +77,7 @@
 #include "resource_resv.h"
 #include "resource.h"
 #include "state_count.h"
+#include "state_feed.h"
 #ifdef NAS
 #include "site_code.h"
 #endif
@@ -137,7 +138,9 @@ query_queues(status *policy, int pbs_sd, server_info *sinfo)
 		return qinfo_arr;
 
 	/* get queue info from PBS server */
-	if ((queues = send_statqueue(pbs_sd, NULL, NULL, NULL)) == NULL) {
+	queues = feed_query(pbs_sd, "queues", NULL,
+			    [&](char *extend) { return send_statqueue(pbs_sd, NULL, NULL, extend); });
+	if (queues == NULL) {
 		const char *errmsg = pbs_geterrmsg(pbs_sd);
 		if (errmsg == NULL)
 			errmsg = "";
@@ -153,7 +156,7 @@ query_queues(status *policy, int pbs_sd, server_info *sinfo)
 		/* convert queue information from batch_status to queue_info */
 		if ((qinfo = query_queue_info(policy, cur_queue, sinfo)) == NULL) {
 			free_schd_error(sch_err);
-			pbs_statfree(queues);
+			feed_release(queues);
 			free_queues(qinfo_arr);
 			return qinfo_arr;
 		}
@@ -256,7 +259,7 @@ query_queues(status *policy, int pbs_sd, server_info *sinfo)
 			delete qinfo;
 	}
 
-	pbs_statfree(queues);
+	feed_release(queues);
 	free_schd_error(sch_err);
 	if (err) {
 		free_queues(qinfo_arr);
@@ -551,8 +554,7 @@ update_queue_on_run(queue_info *qinfo, resource_resv *resresv, char *job_state)
 	}
 
 	if (!cstat.node_sort->empty() && conf.node_sort_unused && qinfo->nodes != NULL)
-		qsort(qinfo->nodes, qinfo->num_nodes, sizeof(node_info *),
-		      multi_node_sort);
+		sort_node_list(qinfo->nodes, qinfo->num_nodes);
 
 	if ((job_state != NULL) && (*job_state == 'S') && (resresv->job->resreq_rel != NULL))
 		req = resresv->job->resreq_rel;
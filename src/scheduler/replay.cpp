@@ -0,0 +1,701 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file    replay.cpp
+ *
+ * @brief
+ * 		replay.cpp - capture and replay of the server state seen by a cycle
+ *
+ *	When the capture_file sched_config option is set, every status reply
+ *	the scheduler receives during a cycle is appended to the capture file.
+ *	Once the file has grown past 10MB it is moved to <file>.1 and a new
+ *	one is started, so at most two files are kept.
+ *	The capture also holds the resource definitions, the scheduler
+ *	object, the fairshare usage file, and the server's answers to
+ *	preemption requests.  pbs_sched_replay loads one captured cycle and
+ *	runs the scheduling cycle over it without a server.  The status
+ *	wrappers hand out the captured replies.  Requests that would change
+ *	the server (run job, preempt, confirm reservation) are accepted
+ *	without being sent.
+ *
+ *	A capture holds one block per cycle.  Strings are written as
+ *	<len>:<bytes> so values may hold any character.  "-" is a NULL string.
+ *	    cycle <time>
+ *	    usage <usage file>
+ *	    reply <kind> <number of objects>
+ *	    obj <name> <text> <number of attributes>
+ *	    attr <name> <resource> <value>
+ *	    preempt <number of jobs>
+ *	    job <job id> <order>
+ *	    end
+ *
+ * Functions included are:
+ * 	capture_begin_cycle()
+ * 	capture_reply()
+ * 	capture_preempt()
+ * 	capture_end_cycle()
+ * 	replay_load()
+ * 	replay_active()
+ * 	replay_begin_cycle()
+ * 	replay_cycle_time()
+ * 	replay_reply()
+ * 	replay_preempt()
+ * 	replay_accept()
+ * 	replay_accepted()
+ *
+ */
+#include <pbs_config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <pbs_error.h>
+#include <pbs_ifl.h>
+#include <log.h>
+#include <libutil.h>
+#include "attribute.h"
+#include "replay.h"
+#include "config.h"
+#include "constant.h"
+#include "data_types.h"
+#include "fairshare.h"
+#include "globals.h"
+
+#define REPLAY_USAGE_FILE USAGE_FILE ".replay"
+#define CAPTURE_FILE_MAX (10 * 1024 * 1024) /* rotate the capture file past 10MB */
+
+static FILE *capture_fp = NULL; /* capture file of the current cycle */
+
+/* the captured cycle being replayed */
+static bool replaying = false;
+static time_t replay_time;
+static std::string replay_usage;
+static bool replay_has_usage;
+static std::unordered_map<std::string, std::vector<struct batch_status *>> replay_replies;
+static std::unordered_map<std::string, size_t> replay_next;
+static std::unordered_map<std::string, std::string> replay_orders;
+static std::unordered_map<std::string, int> replay_counts;
+
+/**
+ * @brief	write a string to the capture file as <len>:<bytes>
+ *
+ * @param[in]	fp	-	capture file
+ * @param[in]	buf	-	the bytes to write, NULL for a NULL string
+ * @param[in]	len	-	number of bytes in buf
+ *
+ * @return	void
+ */
+static void
+put_buf(FILE *fp, const char *buf, size_t len)
+{
+	if (buf == NULL) {
+		fputs(" -", fp);
+		return;
+	}
+	fprintf(fp, " %zu:", len);
+	fwrite(buf, 1, len, fp);
+}
+
+/**
+ * @brief	write a NUL terminated string to the capture file
+ */
+static void
+put_str(FILE *fp, const char *str)
+{
+	put_buf(fp, str, str == NULL ? 0 : strlen(str));
+}
+
+/**
+ * @brief	read a string written by put_buf()
+ *
+ * @param[in]	fp	-	capture file
+ * @param[out]	str	-	the string read
+ * @param[out]	is_null	-	set if a NULL string was written
+ *
+ * @return	bool
+ * @retval	true	: string read
+ * @retval	false	: malformed or truncated file
+ */
+static bool
+get_buf(FILE *fp, std::string &str, bool &is_null)
+{
+	int c;
+	size_t len;
+
+	while ((c = fgetc(fp)) == ' ')
+		;
+	if (c == '-') {
+		is_null = true;
+		str.clear();
+		return true;
+	}
+	if (c == EOF)
+		return false;
+	ungetc(c, fp);
+	if (fscanf(fp, "%zu:", &len) != 1)
+		return false;
+	is_null = false;
+	str.resize(len);
+	if (len > 0 && fread(&str[0], 1, len, fp) != len)
+		return false;
+	return true;
+}
+
+/**
+ * @brief	read a string written by put_str() into a malloc'd copy
+ *
+ * @param[in]	fp	-	capture file
+ * @param[out]	out	-	malloc'd copy of the string or NULL
+ *
+ * @return	bool
+ * @retval	true	: string read
+ * @retval	false	: malformed file or no memory
+ */
+static bool
+get_str(FILE *fp, char **out)
+{
+	std::string str;
+	bool is_null;
+
+	*out = NULL;
+	if (!get_buf(fp, str, is_null))
+		return false;
+	if (is_null)
+		return true;
+	if ((*out = strdup(str.c_str())) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief
+ *		capture_begin_cycle - start capturing the server state seen by
+ *		a cycle if the capture_file option is set
+ *
+ * @par
+ *		The resource definitions, the scheduler objects and the usage
+ *		file are captured with every cycle, so each cycle can be
+ *		replayed on its own.
+ *
+ * @param[in]	pbs_sd	-	connection to the server
+ *
+ * @return	void
+ */
+void
+capture_begin_cycle(int pbs_sd)
+{
+	struct batch_status *bs;
+	std::string usage;
+	char buf[4096];
+	FILE *ufp;
+	size_t n;
+	struct stat sb;
+
+	if (conf.capture_file.empty() || replaying)
+		return;
+
+	if (stat(conf.capture_file.c_str(), &sb) == 0 && sb.st_size >= CAPTURE_FILE_MAX)
+		rename(conf.capture_file.c_str(), (conf.capture_file + ".1").c_str());
+
+	if ((capture_fp = fopen(conf.capture_file.c_str(), "a")) == NULL) {
+		log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_WARNING, __func__,
+			   "Can not open %s", conf.capture_file.c_str());
+		return;
+	}
+
+	fprintf(capture_fp, "cycle %ld\n", static_cast<long>(time(NULL)));
+
+	if ((ufp = fopen(USAGE_FILE, "r")) != NULL) {
+		while ((n = fread(buf, 1, sizeof(buf), ufp)) > 0)
+			usage.append(buf, n);
+		fclose(ufp);
+		fputs("usage", capture_fp);
+		put_buf(capture_fp, usage.data(), usage.size());
+		fputc('\n', capture_fp);
+	}
+
+	bs = pbs_statrsc(pbs_sd, NULL, NULL, const_cast<char *>("p"));
+	capture_reply("rsc", bs);
+	pbs_statfree(bs);
+
+	bs = pbs_statsched(pbs_sd, NULL, NULL);
+	capture_reply("sched", bs);
+	pbs_statfree(bs);
+}
+
+/**
+ * @brief
+ *		capture_reply - add a status reply to the capture of the cycle
+ *
+ * @param[in]	kind	-	what was queried (e.g., "server", "job")
+ * @param[in]	bs	-	the reply
+ *
+ * @return	void
+ */
+void
+capture_reply(const char *kind, struct batch_status *bs)
+{
+	struct batch_status *cur;
+	struct attrl *attrp;
+	int count = 0;
+
+	if (capture_fp == NULL)
+		return;
+
+	for (cur = bs; cur != NULL; cur = cur->next)
+		count++;
+
+	fprintf(capture_fp, "reply %s %d\n", kind, count);
+	for (cur = bs; cur != NULL; cur = cur->next) {
+		count = 0;
+		for (attrp = cur->attribs; attrp != NULL; attrp = attrp->next)
+			count++;
+		fputs("obj", capture_fp);
+		put_str(capture_fp, cur->name);
+		put_str(capture_fp, cur->text);
+		fprintf(capture_fp, " %d\n", count);
+		for (attrp = cur->attribs; attrp != NULL; attrp = attrp->next) {
+			fputs("attr", capture_fp);
+			put_str(capture_fp, attrp->name);
+			put_str(capture_fp, attrp->resource);
+			put_str(capture_fp, attrp->value);
+			fputc('\n', capture_fp);
+		}
+	}
+}
+
+/**
+ * @brief
+ *		capture_preempt - add the server's reply to a preemption request
+ *		to the capture of the cycle
+ *
+ * @param[in]	preempt_jobs_list	-	jobs asked to be preempted
+ * @param[in]	reply	-	the server's reply, one entry per job
+ *
+ * @return	void
+ */
+void
+capture_preempt(char **preempt_jobs_list, preempt_job_info *reply)
+{
+	int count = 0;
+
+	if (capture_fp == NULL || preempt_jobs_list == NULL || reply == NULL)
+		return;
+
+	while (preempt_jobs_list[count] != NULL)
+		count++;
+
+	fprintf(capture_fp, "preempt %d\n", count);
+	for (int i = 0; i < count; i++) {
+		fputs("job", capture_fp);
+		put_str(capture_fp, reply[i].job_id);
+		put_str(capture_fp, reply[i].order);
+		fputc('\n', capture_fp);
+	}
+}
+
+/**
+ * @brief
+ *		capture_end_cycle - finish the capture of the cycle
+ *
+ * @return	void
+ */
+void
+capture_end_cycle(void)
+{
+	if (capture_fp == NULL)
+		return;
+
+	fputs("end\n", capture_fp);
+	if (fclose(capture_fp) != 0)
+		log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_WARNING, __func__,
+			   "Error writing %s", conf.capture_file.c_str());
+	capture_fp = NULL;
+}
+
+/**
+ * @brief	read one reply block of a capture file
+ *
+ * @param[in]	fp	-	capture file
+ * @param[in]	count	-	number of objects in the reply
+ *
+ * @return	struct batch_status *
+ * @retval	the reply
+ * @retval	NULL	: empty reply or error (err set)
+ */
+static struct batch_status *
+read_reply(FILE *fp, int count, bool &err)
+{
+	struct batch_status *head = NULL;
+	struct batch_status **bs_tail = &head;
+	char tok[16];
+
+	err = false;
+	for (int i = 0; i < count; i++) {
+		struct batch_status *bs;
+		struct attrl **at_tail;
+		int nattrs;
+
+		if ((bs = static_cast<struct batch_status *>(calloc(1, sizeof(struct batch_status)))) == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			err = true;
+			break;
+		}
+		*bs_tail = bs;
+		bs_tail = &bs->next;
+
+		if (fscanf(fp, "%15s", tok) != 1 || strcmp(tok, "obj") ||
+		    !get_str(fp, &bs->name) || !get_str(fp, &bs->text) ||
+		    fscanf(fp, "%d", &nattrs) != 1) {
+			err = true;
+			break;
+		}
+
+		at_tail = &bs->attribs;
+		for (int j = 0; j < nattrs; j++) {
+			struct attrl *attrp;
+
+			if ((attrp = static_cast<struct attrl *>(calloc(1, sizeof(struct attrl)))) == NULL) {
+				log_err(errno, __func__, MEM_ERR_MSG);
+				err = true;
+				break;
+			}
+			attrp->op = SET;
+			*at_tail = attrp;
+			at_tail = &attrp->next;
+
+			if (fscanf(fp, "%15s", tok) != 1 || strcmp(tok, "attr") ||
+			    !get_str(fp, &attrp->name) || !get_str(fp, &attrp->resource) ||
+			    !get_str(fp, &attrp->value)) {
+				err = true;
+				break;
+			}
+		}
+		if (err)
+			break;
+	}
+
+	if (err) {
+		pbs_statfree(head);
+		return NULL;
+	}
+	return head;
+}
+
+/**
+ * @brief
+ *		replay_load - load a captured cycle to replay
+ *
+ * @param[in]	filename	-	capture file
+ * @param[in]	cycle	-	which cycle of the capture to load, starting at 0
+ *
+ * @return	int
+ * @retval	1	: cycle loaded, the scheduler is now replaying
+ * @retval	0	: the file could not be read or has no such cycle
+ */
+int
+replay_load(const char *filename, int cycle)
+{
+	FILE *fp;
+	char tok[16];
+	int cur_cycle = -1;
+	bool err = false;
+	bool found = false;
+
+	if (filename == NULL || (fp = fopen(filename, "r")) == NULL)
+		return 0;
+
+	while (!found && !err && fscanf(fp, "%15s", tok) == 1) {
+		bool mine = cur_cycle == cycle;
+
+		if (!strcmp(tok, "cycle")) {
+			long t;
+			if (fscanf(fp, "%ld", &t) != 1)
+				err = true;
+			else if (++cur_cycle == cycle)
+				replay_time = t;
+		} else if (!strcmp(tok, "usage")) {
+			std::string usage;
+			bool is_null;
+			if (!get_buf(fp, usage, is_null))
+				err = true;
+			else if (mine) {
+				replay_usage = usage;
+				replay_has_usage = true;
+			}
+		} else if (!strcmp(tok, "reply")) {
+			char kind[16];
+			int count;
+			if (fscanf(fp, "%15s %d", kind, &count) != 2)
+				err = true;
+			else {
+				auto bs = read_reply(fp, count, err);
+				if (mine && !err)
+					replay_replies[kind].push_back(bs);
+				else
+					pbs_statfree(bs);
+			}
+		} else if (!strcmp(tok, "preempt")) {
+			int count;
+			if (fscanf(fp, "%d", &count) != 1)
+				err = true;
+			for (int i = 0; !err && i < count; i++) {
+				char *jobid = NULL;
+				char *order = NULL;
+				if (fscanf(fp, "%15s", tok) != 1 || strcmp(tok, "job") ||
+				    !get_str(fp, &jobid) || !get_str(fp, &order))
+					err = true;
+				else if (mine && jobid != NULL && order != NULL)
+					replay_orders[jobid] = order;
+				free(order);
+				free(jobid);
+			}
+		} else if (!strcmp(tok, "end")) {
+			if (mine)
+				found = true;
+		} else
+			err = true;
+	}
+	fclose(fp);
+
+	if (err || !found) {
+		for (auto &r : replay_replies)
+			for (auto bs : r.second)
+				pbs_statfree(bs);
+		replay_replies.clear();
+		replay_orders.clear();
+		return 0;
+	}
+
+	replaying = true;
+	return 1;
+}
+
+/**
+ * @brief
+ *		replay_active - are we replaying a captured cycle instead of
+ *		talking to a server
+ *
+ * @return	bool
+ */
+bool
+replay_active(void)
+{
+	return replaying;
+}
+
+/**
+ * @brief
+ *		replay_begin_cycle - rewind the captured replies for another run
+ *		of the cycle and restore the fairshare usage
+ *
+ * @return	void
+ */
+void
+replay_begin_cycle(void)
+{
+	FILE *fp;
+
+	if (!replaying)
+		return;
+
+	replay_next.clear();
+	replay_counts.clear();
+
+	if (replay_has_usage && fstree != NULL) {
+		if ((fp = fopen(REPLAY_USAGE_FILE, "w")) != NULL) {
+			fwrite(replay_usage.data(), 1, replay_usage.size(), fp);
+			fclose(fp);
+			reset_usage(fstree->root);
+			read_usage(REPLAY_USAGE_FILE, NO_FLAGS, fstree);
+			unlink(REPLAY_USAGE_FILE);
+		}
+	}
+}
+
+/**
+ * @brief
+ *		replay_cycle_time - time the captured cycle ran at
+ *
+ * @return	time_t
+ * @retval	the time of the captured cycle
+ * @retval	0	: not replaying
+ */
+time_t
+replay_cycle_time(void)
+{
+	return replaying ? replay_time : 0;
+}
+
+/**
+ * @brief
+ *		replay_reply - hand out the next captured status reply of a kind
+ *
+ * @par
+ *		Replies of a kind are handed out in the order they were captured.
+ *		The caller frees the reply with pbs_statfree().
+ *
+ * @param[in]	kind	-	what is queried (e.g., "server", "job")
+ *
+ * @return	struct batch_status *
+ * @retval	copy of the captured reply
+ * @retval	NULL	: empty reply or none left (pbs_errno set)
+ */
+struct batch_status *
+replay_reply(const char *kind)
+{
+	struct batch_status *head = NULL;
+	struct batch_status **tail = &head;
+
+	auto it = replay_replies.find(kind);
+	auto &next = replay_next[kind];
+	if (it == replay_replies.end() || next >= it->second.size()) {
+		log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_WARNING, __func__,
+			   "No captured %s reply left to replay", kind);
+		pbs_errno = PBSE_NOSERVER;
+		return NULL;
+	}
+
+	for (auto bs = it->second[next++]; bs != NULL; bs = bs->next) {
+		struct batch_status *nbs;
+
+		if ((nbs = static_cast<struct batch_status *>(calloc(1, sizeof(struct batch_status)))) == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			pbs_statfree(head);
+			pbs_errno = PBSE_SYSTEM;
+			return NULL;
+		}
+		if (bs->name != NULL)
+			nbs->name = strdup(bs->name);
+		if (bs->text != NULL)
+			nbs->text = strdup(bs->text);
+		nbs->attribs = dup_attrl_list(bs->attribs);
+		*tail = nbs;
+		tail = &nbs->next;
+	}
+
+	if (head == NULL)
+		pbs_errno = PBSE_NONE;
+	return head;
+}
+
+/**
+ * @brief
+ *		replay_preempt - answer a preemption request from the capture
+ *
+ * @par
+ *		Jobs the server preempted in the captured cycle get the same
+ *		answer.  Any other job is taken as preempted by requeueing.
+ *
+ * @param[in]	preempt_jobs_list	-	jobs asked to be preempted
+ *
+ * @return	preempt_job_info *
+ * @retval	one entry per job, to be freed by the caller
+ * @retval	NULL	: on error
+ */
+preempt_job_info *
+replay_preempt(char **preempt_jobs_list)
+{
+	preempt_job_info *reply;
+	int count = 0;
+
+	if (preempt_jobs_list == NULL)
+		return NULL;
+
+	while (preempt_jobs_list[count] != NULL)
+		count++;
+
+	if ((reply = static_cast<preempt_job_info *>(calloc(count + 1, sizeof(preempt_job_info)))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return NULL;
+	}
+
+	replay_counts["preempt"] += count;
+	for (int i = 0; i < count; i++) {
+		pbs_strncpy(reply[i].job_id, preempt_jobs_list[i], sizeof(reply[i].job_id));
+		auto it = replay_orders.find(preempt_jobs_list[i]);
+		if (it != replay_orders.end())
+			pbs_strncpy(reply[i].order, it->second.c_str(), sizeof(reply[i].order));
+		else
+			pbs_strncpy(reply[i].order, "Q", sizeof(reply[i].order));
+	}
+
+	return reply;
+}
+
+/**
+ * @brief
+ *		replay_accept - accept a request that would change the server
+ *		(e.g., run a job) without sending it
+ *
+ * @param[in]	kind	-	the request (e.g., "runjob")
+ *
+ * @return	int
+ * @retval	0	: the request succeeded
+ */
+int
+replay_accept(const char *kind)
+{
+	replay_counts[kind]++;
+	return 0;
+}
+
+/**
+ * @brief
+ *		replay_accepted - number of requests of a kind accepted since
+ *		replay_begin_cycle()
+ *
+ * @param[in]	kind	-	the request (e.g., "runjob", "preempt")
+ *
+ * @return	int
+ */
+int
+replay_accepted(const char *kind)
+{
+	auto it = replay_counts.find(kind);
+	return it == replay_counts.end() ? 0 : it->second;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#include <time.h>
+#include <pbs_ifl.h>
+
+/*
+ *	capture_begin_cycle - start capturing the server state seen by a
+ *			      cycle if the capture_file option is set
+ */
+void capture_begin_cycle(int pbs_sd);
+
+/*
+ *	capture_reply - add a status reply to the capture of the cycle
+ */
+void capture_reply(const char *kind, struct batch_status *bs);
+
+/*
+ *	capture_preempt - add the server's reply to a preemption request
+ *			  to the capture of the cycle
+ */
+void capture_preempt(char **preempt_jobs_list, preempt_job_info *reply);
+
+/*
+ *	capture_end_cycle - finish the capture of the cycle
+ */
+void capture_end_cycle(void);
+
+/*
+ *	replay_load - load a captured cycle to replay
+ */
+int replay_load(const char *filename, int cycle);
+
+/*
+ *	replay_active - are we replaying a captured cycle instead of
+ *			talking to a server
+ */
+bool replay_active(void);
+
+/*
+ *	replay_begin_cycle - rewind the captured replies for another run
+ *			     of the cycle and restore the fairshare usage
+ */
+void replay_begin_cycle(void);
+
+/*
+ *	replay_cycle_time - time the captured cycle ran at, 0 if not replaying
+ */
+time_t replay_cycle_time(void);
+
+/*
+ *	replay_reply - hand out the next captured status reply of a kind
+ */
+struct batch_status *replay_reply(const char *kind);
+
+/*
+ *	replay_preempt - answer a preemption request from the capture
+ */
+preempt_job_info *replay_preempt(char **preempt_jobs_list);
+
+/*
+ *	replay_accept - accept a request that would change the server
+ */
+int replay_accept(const char *kind);
+
+/*
+ *	replay_accepted - number of requests of a kind accepted this cycle
+ */
+int replay_accepted(const char *kind);
+
+#endif /* _REPLAY_H */
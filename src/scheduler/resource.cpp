@@ -81,6 +81,9 @@
 #include "sort.h"
 #include "parse.h"
 #include "fifo.h"
+#include "formula.h"
+#include "job_info.h"
+#include "node_partition.h"
 
 /**
  * @brief
@@ -377,11 +380,20 @@ update_resource_defs(int pbs_sd)
 
 	allres = tmpres;
 
+	/* hand out the ids used to index resource lists */
+	int id = 0;
+	for (auto &def : allres)
+		def.second->id = id++;
+
 	consres.clear();
 	for (const auto &def : allres) {
 		if (def.second->type.is_consumable)
 			consres.insert(def.second);
 	}
+	/* compiled formulas, kept class verdicts and kept placement sets point to the old resdefs */
+	clear_formulas();
+	clear_resresv_set_verdicts();
+	clear_kept_node_partitions();
 
 	boolres.clear();
 	for (const auto &def : allres) {
@@ -92,6 +92,7 @@
 #include <string.h>
 #include <log.h>
 #include <pthread.h>
+#include <atomic>
 #include <libutil.h>
 #include "pbs_config.h"
 #include "data_types.h"
@@ -110,6 +111,7 @@
 #include "range.h"
 #include "simulate.h"
 #include "multi_threading.h"
+#include "obj_pool.h"
 
 /**
  * @brief
@@ -118,10 +120,6 @@
 resource_resv::resource_resv(const std::string &rname) : name(rname)
 {
 	nodepart_name = NULL;
-	select = NULL;
-	execselect = NULL;
-
-	place_spec = NULL;
 
 	is_invalid = 0;
 	can_not_fit = 0;
@@ -193,35 +191,6 @@ free_resource_resv_array_chunk(th_data_free_resresv *data)
 	}
 }
 
-/**
- * @brief	Allocates th_data_free_resresv for multi-threading of free_resource_resv_array
- *
- * @param[in,out]	resresv_arr	-	the resresv array to free
- * @param[in]	sidx	-	start index for the resresv array for the thread
- * @param[in]	eidx	-	end index for the resresv array for the thread
- *
- * @return th_data_free_resresv *
- * @retval a newly allocated th_data_free_resresv object
- * @retval NULL for malloc error
- */
-static inline th_data_free_resresv *
-alloc_tdata_free_rr_arr(resource_resv **resresv_arr, int sidx, int eidx)
-{
-	th_data_free_resresv *tdata;
-
-	tdata = static_cast<th_data_free_resresv *>(malloc(sizeof(th_data_free_resresv)));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-
-	tdata->resresv_arr = resresv_arr;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-
-	return tdata;
-}
-
 /**
  * @brief
  *		free_resource_resv_array - free an array of resource resvs
@@ -234,62 +203,21 @@ alloc_tdata_free_rr_arr(resource_resv **resresv_arr, int sidx, int eidx)
 void
 free_resource_resv_array(resource_resv **resresv_arr)
 {
-	int i;
-	int chunk_size;
-	th_data_free_resresv *tdata = NULL;
-	th_task_info *task = NULL;
-	int num_tasks;
 	int num_jobs;
-	int tid;
 
 	if (resresv_arr == NULL)
 		return;
 
 	num_jobs = count_array(resresv_arr);
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_free_rr_arr(resresv_arr, 0, num_jobs - 1);
-		if (tdata == NULL)
-			return;
-
-		free_resource_resv_array_chunk(tdata);
-		free(tdata);
-		free(resresv_arr);
-		return;
-	}
-
-	chunk_size = num_jobs / num_threads;
-	chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-	chunk_size = (chunk_size < MT_CHUNK_SIZE_MAX) ? chunk_size : MT_CHUNK_SIZE_MAX;
-	for (i = 0, num_tasks = 0; num_jobs > 0;
-	     num_tasks++, i += chunk_size, num_jobs -= chunk_size) {
-		tdata = alloc_tdata_free_rr_arr(resresv_arr, i, i + chunk_size - 1);
-		if (tdata == NULL)
-			break;
-
-		task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-		task->task_type = TS_FREE_RESRESV;
-		task->thread_data = (void *) tdata;
-
-		queue_work_for_threads(task);
-	}
+	parallel_for(TS_FREE_RESRESV, num_jobs, mt_grainsize(num_jobs), [&](int sidx, int eidx, int chunk) {
+		th_data_free_resresv tdata;
 
-	/* Get results from worker threads */
-	for (i = 0; i < num_tasks;) {
-		pthread_mutex_lock(&result_lock);
-		while (ds_queue_is_empty(result_queue))
-			pthread_cond_wait(&result_cond, &result_lock);
-		while (!ds_queue_is_empty(result_queue)) {
-			task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-			tdata = static_cast<th_data_free_resresv *>(task->thread_data);
-			free(tdata);
-			free(task);
-			i++;
-		}
-		pthread_mutex_unlock(&result_lock);
-	}
+		tdata.resresv_arr = resresv_arr;
+		tdata.sidx = sidx;
+		tdata.eidx = eidx;
+		free_resource_resv_array_chunk(&tdata);
+	});
 
 	free(resresv_arr);
 }
@@ -302,9 +230,6 @@ free_resource_resv_array(resource_resv **resresv_arr)
 resource_resv::~resource_resv()
 {
 	free(nodepart_name);
-	delete select;
-	delete execselect;
-	free_place(place_spec);
 	free_resource_req_list(resreq);
 	free(ninfo_arr);
 	free_nspecs(nspec_arr);
@@ -366,42 +291,6 @@ dup_resource_resv_array_chunk(th_data_dup_resresv *data)
 	free_schd_error(err);
 }
 
-/**
- * @brief	Allocates th_data_dup_resresv for multi-threading of dup_resource_resv_array
- *
- * @param[in]	oresresv_arr	-	the array to duplicate
- * @param[out]	nresresv_arr	-	the duplicated array
- * @param[in]	nsinfo	-	new server ptr for new resresv array
- * @param[in]	nqinfo	-	new queue ptr for new resresv array
- * @param[in]	sidx	-	start index for the resresv list for the thread
- * @param[in]	eidx	-	end index for the resresv list for the thread
- *
- * @return th_data_dup_resresv *
- * @retval a newly allocated th_data_dup_resresv object
- * @retval NULL for malloc error
- */
-static inline th_data_dup_resresv *
-alloc_tdata_dup_nodes(resource_resv **oresresv_arr, resource_resv **nresresv_arr, server_info *nsinfo,
-		      queue_info *nqinfo, int sidx, int eidx)
-{
-	th_data_dup_resresv *tdata;
-
-	tdata = static_cast<th_data_dup_resresv *>(malloc(sizeof(th_data_dup_resresv)));
-	if (tdata == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
-	tdata->oresresv_arr = oresresv_arr;
-	tdata->nresresv_arr = nresresv_arr;
-	tdata->nsinfo = nsinfo;
-	tdata->nqinfo = nqinfo;
-	tdata->sidx = sidx;
-	tdata->eidx = eidx;
-	tdata->error = 0;
-
-	return tdata;
-}
-
 /**
  * @brief
  *		dup_resource_resv_array - dup a array of pointers of resource resvs
@@ -419,17 +308,13 @@ dup_resource_resv_array(resource_resv **oresresv_arr,
 			server_info *nsinfo, queue_info *nqinfo)
 {
 	resource_resv **nresresv_arr;
-	th_data_dup_resresv *tdata = NULL;
-	th_task_info *task = NULL;
 	int num_resresv;
-	int thread_job_ct_left;
-	int th_err = 0;
-	int tid;
+	std::atomic<int> th_err(0);
 
 	if (oresresv_arr == NULL || nsinfo == NULL)
 		return NULL;
 
-	num_resresv = thread_job_ct_left = count_array(oresresv_arr);
+	num_resresv = count_array(oresresv_arr);
 
 	if ((nresresv_arr = static_cast<resource_resv **>(malloc((num_resresv + 1) * sizeof(resource_resv *)))) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
@@ -437,53 +322,19 @@ dup_resource_resv_array(resource_resv **oresresv_arr,
 	}
 	nresresv_arr[0] = NULL;
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_dup_nodes(oresresv_arr, nresresv_arr, nsinfo, nqinfo, 0, num_resresv - 1);
-		if (tdata == NULL)
+	parallel_for(TS_DUP_RESRESV, num_resresv, mt_grainsize(num_resresv), [&](int sidx, int eidx, int chunk) {
+		th_data_dup_resresv tdata;
+
+		tdata.oresresv_arr = oresresv_arr;
+		tdata.nresresv_arr = nresresv_arr;
+		tdata.nsinfo = nsinfo;
+		tdata.nqinfo = nqinfo;
+		tdata.sidx = sidx;
+		tdata.eidx = eidx;
+		dup_resource_resv_array_chunk(&tdata);
+		if (tdata.error)
 			th_err = 1;
-		else {
-			dup_resource_resv_array_chunk(tdata);
-			th_err = tdata->error;
-			free(tdata);
-		}
-	} else { /* We are multithreading */
-		int num_tasks = 0;
-		int chunk_size = num_resresv / num_threads;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		chunk_size = (chunk_size < MT_CHUNK_SIZE_MAX) ? chunk_size : MT_CHUNK_SIZE_MAX;
-		for (int j = 0; thread_job_ct_left > 0;
-		     num_tasks++, j += chunk_size, thread_job_ct_left -= chunk_size) {
-			tdata = alloc_tdata_dup_nodes(oresresv_arr, nresresv_arr, nsinfo, nqinfo, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-			task->task_type = TS_DUP_RESRESV;
-			task->thread_data = (void *) tdata;
-
-			queue_work_for_threads(task);
-		}
-
-		/* Get results from worker threads */
-		for (int i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-				tdata = static_cast<th_data_dup_resresv *>(task->thread_data);
-				if (tdata->error)
-					th_err = 1;
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
-	}
+	});
 
 	if (th_err) {
 		free_resource_resv_array(nresresv_arr);
@@ -541,10 +392,9 @@ dup_resource_resv(resource_resv *oresresv, server_info *nsinfo, queue_info *nqin
 	nresresv->project = oresresv->project;
 
 	nresresv->nodepart_name = string_dup(oresresv->nodepart_name);
-	if (oresresv->select != NULL)
-		nresresv->select = new selspec(*oresresv->select); /* must come before calls to dup_nspecs() below */
-	if (oresresv->execselect != NULL)
-		nresresv->execselect = new selspec(*oresresv->execselect);
+	/* The select and place specs are shared, not copied */
+	nresresv->select = oresresv->select; /* must come before calls to dup_nspecs() below */
+	nresresv->execselect = oresresv->execselect;
 
 	nresresv->is_invalid = oresresv->is_invalid;
 	nresresv->can_not_fit = oresresv->can_not_fit;
@@ -570,7 +420,7 @@ dup_resource_resv(resource_resv *oresresv, server_info *nsinfo, queue_info *nqin
 
 	nresresv->resreq = dup_resource_req_list(oresresv->resreq);
 
-	nresresv->place_spec = dup_place(oresresv->place_spec);
+	nresresv->place_spec = oresresv->place_spec;
 
 	nresresv->aoename = string_dup(oresresv->aoename);
 	nresresv->eoename = string_dup(oresresv->eoename);
@@ -604,7 +454,7 @@ dup_resource_resv(resource_resv *oresresv, server_info *nsinfo, queue_info *nqin
 		if (nresresv->resv->select_orig != NULL)
 			sel = nresresv->resv->select_orig;
 		else
-			sel = nresresv->select;
+			sel = nresresv->select.get();
 		nresresv->resv->orig_nspec_arr = dup_nspecs(oresresv->resv->orig_nspec_arr, nsinfo->nodes, sel);
 		nresresv->ninfo_arr = copy_node_ptr_array(oresresv->ninfo_arr, nsinfo->nodes);
 		nresresv->nspec_arr = dup_nspecs(oresresv->nspec_arr, nsinfo->nodes, NULL);
@@ -988,12 +838,12 @@ new_resource_req()
 {
 	resource_req *resreq;
 
-	if ((resreq = static_cast<resource_req *>(calloc(1, sizeof(resource_req)))) == NULL) {
+	if ((resreq = obj_pool<resource_req>::alloc()) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
 		return NULL;
 	}
 
-	/* member type zero'd by calloc() */
+	/* member type zero'd by obj_pool */
 
 	resreq->name = NULL;
 	resreq->res_str = NULL;
@@ -1359,7 +1209,7 @@ free_resource_req(resource_req *req)
 	if (req->res_str != NULL)
 		free(req->res_str);
 
-	free(req);
+	obj_pool<resource_req>::release(req);
 }
 
 /**
@@ -1505,7 +1355,7 @@ update_resresv_on_run(resource_resv *resresv, std::vector<nspec *> &nspec_arr)
 		if (resresv->execselect == NULL) {
 			std::string selectspec;
 			selectspec = create_select_from_nspec(nspec_arr);
-			resresv->execselect = parse_selspec(selectspec);
+			resresv->execselect.reset(parse_selspec(selectspec));
 		}
 		if (resresv->job->dependent_jobs != NULL) {
 			for (int i = 0; resresv->job->dependent_jobs[i] != NULL; i++) {
@@ -1596,8 +1446,7 @@ update_resresv_on_end(resource_resv *resresv, const char *job_state)
 				free(resresv->nodepart_name);
 				resresv->nodepart_name = NULL;
 			}
-			delete resresv->execselect;
-			resresv->execselect = NULL;
+			resresv->execselect.reset();
 		}
 		/* We need to correct our calendar */
 		if (resresv->end_event != NULL)
@@ -88,6 +88,7 @@
 #include "server_info.h"
 #include "simulate.h"
 #include "sort.h"
+#include "state_feed.h"
 
 /**
  * @brief
@@ -102,7 +103,9 @@ stat_resvs(int pbs_sd)
 {
 	struct batch_status *resvs;
 	/* get the reservation info from the PBS server */
-	if ((resvs = send_statresv(pbs_sd, NULL, NULL, NULL)) == NULL) {
+	resvs = feed_query(pbs_sd, "resvs", NULL,
+			   [&](char *extend) { return send_statresv(pbs_sd, NULL, NULL, extend); });
+	if (resvs == NULL) {
 		if (pbs_errno) {
 			const char *errmsg = pbs_geterrmsg(pbs_sd);
 			if (errmsg == NULL)
@@ -203,7 +206,7 @@ query_reservations(int pbs_sd, server_info *sinfo, struct batch_status *resvs)
 		}
 #ifdef NAS /* localmod 047 */
 		if (resresv->place_spec == NULL) {
-			resresv->place_spec = parse_placespec("scatter");
+			resresv->place_spec.reset(parse_placespec("scatter"), free_place);
 		}
 #endif /* localmod 047 */
 
@@ -401,12 +404,11 @@ query_reservations(int pbs_sd, server_info *sinfo, struct batch_status *resvs)
 					release_nodes(resresv_ocr);
 
 					if (resresv_ocr->resv->select_standing != NULL) {
-						delete resresv_ocr->select;
-						resresv_ocr->select = new selspec(*resresv_ocr->resv->select_standing);
+						resresv_ocr->select = std::make_shared<selspec>(*resresv_ocr->resv->select_standing);
 					}
 
 					resresv_ocr->resv->orig_nspec_arr = parse_execvnode(
-						execvnode_ptr[degraded_idx - 1], sinfo, resresv_ocr->select);
+						execvnode_ptr[degraded_idx - 1], sinfo, resresv_ocr->select.get());
 					resresv_ocr->nspec_arr = combine_nspec_array(resresv_ocr->resv->orig_nspec_arr);
 					resresv_ocr->ninfo_arr = create_node_array_from_nspec(resresv_ocr->nspec_arr);
 					resresv_ocr->resv->resv_nodes = create_resv_nodes(
@@ -505,7 +507,7 @@ query_resv(struct batch_status *resv, server_info *sinfo)
 		else if (!strcmp(attrp->name, ATTR_queue))
 			advresv->resv->queuename = string_dup(attrp->value);
 		else if (!strcmp(attrp->name, ATTR_SchedSelect)) {
-			advresv->select = parse_selspec(attrp->value);
+			advresv->select.reset(parse_selspec(attrp->value));
 			if (advresv->select != NULL && advresv->select->chunks != NULL) {
 				/* Ignore resv if any of the chunks has no resource req. */
 				int i;
@@ -576,7 +578,7 @@ query_resv(struct batch_status *resv, server_info *sinfo)
 				if (advresv->resreq == NULL)
 					advresv->resreq = resreq;
 				if (!strcmp(attrp->resource, "place")) {
-					advresv->place_spec = parse_placespec(attrp->value);
+					advresv->place_spec.reset(parse_placespec(attrp->value), free_place);
 					if (advresv->place_spec == NULL)
 						advresv->is_invalid = 1;
 				}
@@ -638,7 +640,7 @@ query_resv(struct batch_status *resv, server_info *sinfo)
 		if (advresv->resv->select_orig != NULL)
 			sel = advresv->resv->select_orig;
 		else
-			sel = advresv->select;
+			sel = advresv->select.get();
 		advresv->resv->orig_nspec_arr = parse_execvnode(resv_nodes, sinfo, sel);
 		advresv->nspec_arr = combine_nspec_array(advresv->resv->orig_nspec_arr);
 		advresv->ninfo_arr = create_node_array_from_nspec(advresv->nspec_arr);
@@ -648,7 +650,7 @@ query_resv(struct batch_status *resv, server_info *sinfo)
 		 */
 		advresv->resv->resv_nodes = create_resv_nodes(advresv->nspec_arr, sinfo);
 		selectspec = create_select_from_nspec(advresv->resv->orig_nspec_arr);
-		advresv->execselect = parse_selspec(selectspec);
+		advresv->execselect.reset(parse_selspec(selectspec));
 	}
 
 	/* If reservation is unconfirmed and the number of occurrences is 0 then flag
@@ -683,8 +685,8 @@ query_resv(struct batch_status *resv, server_info *sinfo)
 
 	advresv->rank = get_sched_rank();
 
-	advresv->aoename = getaoename(advresv->select);
-	advresv->eoename = geteoename(advresv->select);
+	advresv->aoename = getaoename(advresv->select.get());
+	advresv->eoename = geteoename(advresv->select.get());
 
 	/* reservations requesting AOE mark nodes as exclusive */
 	if (advresv->aoename) {
@@ -1061,14 +1063,13 @@ check_new_reservations(status *policy, int pbs_sd, resource_resv **resvs, server
 							if (nresv_copy == NULL)
 								break;
 							if (nresv_copy->resv->select_standing != NULL) {
-								delete nresv_copy->select;
-								nresv_copy->select = new selspec(*nresv_copy->resv->select_standing);
+								nresv_copy->select = std::make_shared<selspec>(*nresv_copy->resv->select_standing);
 							}
 						}
 					}
 					release_nodes(nresv_copy);
 
-					nresv_copy->resv->orig_nspec_arr = parse_execvnode(occr_execvnodes_arr[j], sinfo, nresv_copy->select);
+					nresv_copy->resv->orig_nspec_arr = parse_execvnode(occr_execvnodes_arr[j], sinfo, nresv_copy->select.get());
 					nresv_copy->nspec_arr = combine_nspec_array(nresv_copy->resv->orig_nspec_arr);
 					nresv_copy->ninfo_arr = create_node_array_from_nspec(nresv_copy->nspec_arr);
 					nresv_copy->resv->resv_nodes = create_resv_nodes(nresv_copy->nspec_arr, sinfo);
@@ -1403,16 +1404,14 @@ confirm_reservation(status *policy, int pbs_sd, resource_resv *unconf_resv, serv
 				   nresv->resv->resv_state == RESV_BEING_ALTERED) {
 				if (nresv->resv->is_running) {
 					std::string sel;
-					delete nresv->execselect;
-
 					sel = create_select_from_nspec(nresv->resv->orig_nspec_arr);
-					nresv->execselect = parse_selspec(sel);
+					nresv->execselect.reset(parse_selspec(sel));
 					for (size_t ind = 0; ind < nresv->resv->orig_nspec_arr.size(); ind++) {
 						nresv->execselect->chunks[ind]->seq_num = nresv->resv->orig_nspec_arr[ind]->seq_num;
 					}
 					if (spec != NULL) {
 						if (nresv->execselect == NULL)
-							nresv->execselect = spec;
+							nresv->execselect.reset(spec);
 						else {
 							/* Everything in that select has a running job on it.  Now add in the rest */
 							int num_exec_chunks = count_array(nresv->execselect->chunks);
@@ -1919,6 +1918,7 @@ release_running_resv_nodes(resource_resv *resv, server_info *sinfo)
 		for (int i = 0; resv_nodes[i] != NULL; i++) {
 			auto ninfo = find_node_by_indrank(sinfo->nodes, resv_nodes[i]->node_ind, resv_nodes[i]->rank);
 			update_node_on_end(ninfo, resv, NULL);
+			mark_node_partitions_stale(ninfo);
 		}
 		sinfo->pset_metadata_stale = 1;
 	}
@@ -2022,8 +2022,7 @@ modify_jobs_nodes_for_resv(resource_resv *resresv, time_t server_time)
 		free(jobs_in_reservations);
 
 		/* Sort the nodes to ensure correct job placement. */
-		qsort(resresv->resv->resv_nodes,
-		      count_array(resresv->resv->resv_nodes),
-		      sizeof(node_info *), multi_node_sort);
+		sort_node_list(resresv->resv->resv_nodes,
+			       count_array(resresv->resv->resv_nodes));
 	}
 }
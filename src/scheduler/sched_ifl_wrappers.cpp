@@ -42,11 +42,13 @@
 #include <stdlib.h>
 #include <pbs_ifl.h>
 #include <libpbs.h>
+#include "cycle_prof.h"
 #include "data_types.h"
 #include "fifo.h"
 #include "globals.h"
 #include "job_info.h"
 #include "misc.h"
+#include "replay.h"
 #include "log.h"
 #include "server_info.h"
 #include "libutil.h"
@@ -66,9 +68,15 @@
 int
 send_run_job(int sd, int has_runjob_hook, const std::string &jobid, char *execvnode)
 {
+	prof_timer timer(PROF_RUN_JOB);
 	if (jobid.empty() || execvnode == NULL)
 		return 1;
 
+	if (replay_active())
+		return replay_accept("runjob");
+
+	reap_run_job_acks(0);
+
 	if (sc_attrs.runjob_mode == RJ_EXECJOB_HOOK)
 		return pbs_runjob(sd, const_cast<char *>(jobid.c_str()), execvnode, NULL);
 	else if (((sc_attrs.runjob_mode == RJ_RUNJOB_HOOK) && has_runjob_hook))
@@ -77,6 +85,51 @@ send_run_job(int sd, int has_runjob_hook, const std::string &jobid, char *execvn
 		return pbs_asyrunjob(sd, const_cast<char *>(jobid.c_str()), execvnode, NULL);
 }
 
+/**
+ * @brief	Send an acknowledged asynchronous runjob request to the server
+ *		without waiting for the acknowledgement.  It must be read
+ *		later with recv_run_job_ack().
+ *
+ * @param[in]	sd	-	communication handle
+ * @param[in]	jobid	-	id of the job to run
+ * @param[in]	execvnode	-	the execvnode to run the job on
+ *
+ * @return	int
+ * @retval	0	request sent
+ * @retval	!0	failure to send the request
+ */
+int
+send_run_job_pipelined(int sd, const std::string &jobid, char *execvnode)
+{
+	prof_timer timer(PROF_RUN_JOB);
+	if (jobid.empty() || execvnode == NULL)
+		return 1;
+
+	if (replay_active())
+		return replay_accept("runjob");
+
+	return PBSD_asyrunjob_ack_put(sd, jobid.c_str(), execvnode, NULL);
+}
+
+/**
+ * @brief	Read the acknowledgement of the oldest runjob request sent
+ *		with send_run_job_pipelined()
+ *
+ * @param[in]	sd	-	communication handle
+ *
+ * @return	int
+ * @retval	0	the server accepted the request
+ * @retval	!0	error code from the server
+ */
+int
+recv_run_job_ack(int sd)
+{
+	prof_timer timer(PROF_RUN_JOB);
+	if (replay_active())
+		return 0;
+	return PBSD_asyrunjob_ack_get(sd);
+}
+
 /**
  * @brief
  * 		send delayed attributes to the server for a job
@@ -99,7 +152,7 @@ send_attr_updates(int sd, resource_resv *resresv, struct attrl *pattr)
 	if (job_name.empty() || pattr == NULL)
 		return 0;
 
-	if (sd == SIMULATE_SD)
+	if (sd == SIMULATE_SD || replay_active())
 		return 1; /* simulation always successful */
 
 	if (pattr->next == NULL)
@@ -148,7 +201,15 @@ send_attr_updates(int sd, resource_resv *resresv, struct attrl *pattr)
 preempt_job_info *
 send_preempt_jobs(int sd, char **preempt_jobs_list)
 {
-	return pbs_preempt_jobs(sd, preempt_jobs_list);
+	preempt_job_info *reply;
+
+	if (replay_active())
+		return replay_preempt(preempt_jobs_list);
+
+	reap_run_job_acks(0);
+	reply = pbs_preempt_jobs(sd, preempt_jobs_list);
+	capture_preempt(preempt_jobs_list, reply);
+	return reply;
 }
 
 /**
@@ -165,6 +226,10 @@ send_preempt_jobs(int sd, char **preempt_jobs_list)
 int
 send_sigjob(int sd, resource_resv *resresv, const char *signal, char *extend)
 {
+	if (replay_active())
+		return replay_accept("sigjob");
+
+	reap_run_job_acks(0);
 	return pbs_sigjob(sd, const_cast<char *>(resresv->name.c_str()), const_cast<char *>(signal), extend);
 }
 
@@ -184,6 +249,10 @@ send_sigjob(int sd, resource_resv *resresv, const char *signal, char *extend)
 int
 send_confirmresv(int sd, resource_resv *resv, const char *location, unsigned long start, const char *extend)
 {
+	if (replay_active())
+		return replay_accept("confirmresv");
+
+	reap_run_job_acks(0);
 	return pbs_confirmresv(sd, const_cast<char *>(resv->name.c_str()), const_cast<char *>(location), start, const_cast<char *>(extend));
 }
 
@@ -202,7 +271,15 @@ send_confirmresv(int sd, resource_resv *resv, const char *location, unsigned lon
 struct batch_status *
 send_selstat(int sd, struct attropl *attrib, struct attrl *rattrib, char *extend)
 {
-	return pbs_selstat(sd, attrib, rattrib, extend);
+	struct batch_status *bs;
+
+	if (replay_active())
+		return replay_reply("job");
+
+	reap_run_job_acks(0);
+	bs = pbs_selstat(sd, attrib, rattrib, extend);
+	capture_reply("job", bs);
+	return bs;
 }
 
 /**
@@ -220,7 +297,15 @@ send_selstat(int sd, struct attropl *attrib, struct attrl *rattrib, char *extend
 struct batch_status *
 send_statvnode(int sd, char *id, struct attrl *attrib, char *extend)
 {
-	return pbs_statvnode(sd, id, attrib, extend);
+	struct batch_status *bs;
+
+	if (replay_active())
+		return replay_reply("node");
+
+	reap_run_job_acks(0);
+	bs = pbs_statvnode(sd, id, attrib, extend);
+	capture_reply("node", bs);
+	return bs;
 }
 
 /**
@@ -237,7 +322,15 @@ send_statvnode(int sd, char *id, struct attrl *attrib, char *extend)
 struct batch_status *
 send_statsched(int sd, struct attrl *attrib, char *extend)
 {
-	return pbs_statsched(sd, attrib, extend);
+	struct batch_status *bs;
+
+	if (replay_active())
+		return replay_reply("sched");
+
+	reap_run_job_acks(0);
+	bs = pbs_statsched(sd, attrib, extend);
+	capture_reply("sched", bs);
+	return bs;
 }
 
 /**
@@ -255,7 +348,15 @@ send_statsched(int sd, struct attrl *attrib, char *extend)
 struct batch_status *
 send_statqueue(int sd, char *id, struct attrl *attrib, char *extend)
 {
-	return pbs_statque(sd, id, attrib, extend);
+	struct batch_status *bs;
+
+	if (replay_active())
+		return replay_reply("queue");
+
+	reap_run_job_acks(0);
+	bs = pbs_statque(sd, id, attrib, extend);
+	capture_reply("queue", bs);
+	return bs;
 }
 
 /**
@@ -272,7 +373,15 @@ send_statqueue(int sd, char *id, struct attrl *attrib, char *extend)
 struct batch_status *
 send_statserver(int sd, struct attrl *attrib, char *extend)
 {
-	return pbs_statserver(sd, attrib, extend);
+	struct batch_status *bs;
+
+	if (replay_active())
+		return replay_reply("server");
+
+	reap_run_job_acks(0);
+	bs = pbs_statserver(sd, attrib, extend);
+	capture_reply("server", bs);
+	return bs;
 }
 
 /**
@@ -290,7 +399,15 @@ send_statserver(int sd, struct attrl *attrib, char *extend)
 struct batch_status *
 send_statrsc(int sd, char *id, struct attrl *attrib, char *extend)
 {
-	return pbs_statrsc(sd, id, attrib, extend);
+	struct batch_status *bs;
+
+	if (replay_active())
+		return replay_reply("rsc");
+
+	reap_run_job_acks(0);
+	bs = pbs_statrsc(sd, id, attrib, extend);
+	capture_reply("rsc", bs);
+	return bs;
 }
 
 /**
@@ -308,5 +425,13 @@ send_statrsc(int sd, char *id, struct attrl *attrib, char *extend)
 struct batch_status *
 send_statresv(int sd, char *id, struct attrl *attrib, char *extend)
 {
-	return pbs_statresv(sd, id, attrib, extend);
+	struct batch_status *bs;
+
+	if (replay_active())
+		return replay_reply("resv");
+
+	reap_run_job_acks(0);
+	bs = pbs_statresv(sd, id, attrib, extend);
+	capture_reply("resv", bs);
+	return bs;
 }
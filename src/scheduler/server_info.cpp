@@ -109,6 +109,7 @@
 #include <signal.h>
 #include <sys/wait.h>
 #include <algorithm>
+#include <chrono>
 #include <exception>
 
 #include "pbs_entlim.h"
@@ -144,6 +145,9 @@
 #include "hook.h"
 #include "libpbs.h"
 #include "libutil.h"
+#include "state_feed.h"
+#include "cycle_prof.h"
+#include "obj_pool.h"
 #ifdef NAS
 #include "site_code.h"
 #endif
@@ -174,6 +178,7 @@ extern char **environ;
 server_info *
 query_server(status *pol, int pbs_sd)
 {
+	prof_timer timer(PROF_QUERY_SERVER);
 	struct batch_status *server;   /* info about the server */
 	struct batch_status *bs_resvs; /* batch status of the reservations */
 	server_info *sinfo;	       /* scheduler internal form of server info */
@@ -199,6 +204,9 @@ query_server(status *pol, int pbs_sd)
 		return NULL;
 	}
 
+	/* pick up the change sequence for the incremental queries of the cycle */
+	feed_begin_cycle(pbs_sd, server);
+
 	/* convert batch_status structure into server_info structure */
 	if ((sinfo = query_server_info(pol, server)) == NULL) {
 		pbs_statfree(server);
@@ -236,14 +244,13 @@ query_server(status *pol, int pbs_sd)
 		pbs_statfree(server);
 		sinfo->fstree = NULL;
 		delete sinfo;
-		pbs_statfree(bs_resvs);
+		feed_release(bs_resvs);
 		return NULL;
 	}
 
 	/* sort the nodes before we filter them down to more useful lists */
 	if (!policy->node_sort->empty())
-		qsort(sinfo->nodes, sinfo->num_nodes, sizeof(node_info *),
-		      multi_node_sort);
+		sort_node_list(sinfo->nodes, sinfo->num_nodes);
 
 	/* get the queues */
 	sinfo->queues = query_queues(policy, pbs_sd, sinfo);
@@ -251,7 +258,7 @@ query_server(status *pol, int pbs_sd)
 		pbs_statfree(server);
 		sinfo->fstree = NULL;
 		delete sinfo;
-		pbs_statfree(bs_resvs);
+		feed_release(bs_resvs);
 		return NULL;
 	}
 
@@ -286,7 +293,7 @@ query_server(status *pol, int pbs_sd)
 			if (ret_val == 0) {
 				sinfo->fstree = NULL;
 				delete sinfo;
-				pbs_statfree(bs_resvs);
+				feed_release(bs_resvs);
 				return NULL;
 			}
 		}
@@ -294,7 +301,7 @@ query_server(status *pol, int pbs_sd)
 
 	/* get reservations, if any - NOTE: will set sinfo -> num_resvs */
 	sinfo->resvs = query_reservations(pbs_sd, sinfo, bs_resvs);
-	pbs_statfree(bs_resvs);
+	feed_release(bs_resvs);
 
 	if (create_server_arrays(sinfo) == 0) { /* bad stuff happened */
 		sinfo->fstree = NULL;
@@ -442,6 +449,8 @@ query_server(status *pol, int pbs_sd)
 
 	pbs_statfree(server);
 
+	feed_log_cycle();
+
 	return sinfo;
 }
 
@@ -779,6 +788,33 @@ query_server_dyn_res(server_info *sinfo)
 	return 0;
 }
 
+/**
+ * @brief
+ * 		add_to_resource_index - add a resource just linked into a list
+ *		to the list's index
+ *
+ * @param[in]	reslist	-	head of the resource list
+ * @param[in]	res	-	the resource linked into the list
+ *
+ * @return	void
+ */
+static void
+add_to_resource_index(schd_resource *reslist, schd_resource *res)
+{
+	if (reslist->index == NULL || res->def == NULL)
+		return;
+
+	if (res->def->id >= 0 && res->def->id < reslist->index_len) {
+		if (reslist->index[res->def->id] == NULL)
+			reslist->index[res->def->id] = res;
+	} else {
+		/* can't be looked up by id, fall back to searching the list */
+		free(reslist->index);
+		reslist->index = NULL;
+		reslist->index_len = 0;
+	}
+}
+
 /**
  * @brief
  * 		try and find a resource by resdef, and if it is not
@@ -813,8 +849,10 @@ find_alloc_resource(schd_resource *resplist, resdef *def)
 		resp->type = def->type;
 		resp->name = def->name.c_str();
 
-		if (prev != NULL)
+		if (prev != NULL) {
 			prev->next = resp;
+			add_to_resource_index(resplist, resp);
+		}
 	}
 
 	return resp;
@@ -851,8 +889,10 @@ find_alloc_resource_by_str(schd_resource *resplist, const char *name)
 		if ((resp = create_resource(name, NULL, RF_NONE)) == NULL)
 			return NULL;
 
-		if (prev != NULL)
+		if (prev != NULL) {
 			prev->next = resp;
+			add_to_resource_index(resplist, resp);
+		}
 	}
 
 	return resp;
@@ -901,6 +941,9 @@ find_resource_by_str(schd_resource *reslist, const std::string &name)
  * @brief
  * 		find resource by resource definition
  *
+ * @par
+ *		If the list is indexed, this is a single load from the index.
+ *
  * @param 	reslist - 	resource list to search
  * @param 	def 	- 	resource definition to search for
  *
@@ -915,6 +958,9 @@ find_resource(schd_resource *reslist, resdef *def)
 	if (reslist == NULL || def == NULL)
 		return NULL;
 
+	if (reslist->index != NULL && def->id >= 0 && def->id < reslist->index_len)
+		return reslist->index[def->id];
+
 	resp = reslist;
 
 	while (resp != NULL && resp->def != def)
@@ -923,6 +969,60 @@ find_resource(schd_resource *reslist, resdef *def)
 	return resp;
 }
 
+/**
+ * @brief
+ * 		index_resource_list - index a resource list by resdef id
+ *
+ * @par
+ *		The index is kept on the head of the list.  It is kept up to date
+ *		by find_alloc_resource() and find_alloc_resource_by_str(), and
+ *		carried over by the dup_*resource_list() functions.  Code which
+ *		links resources into an indexed list by hand must index it again.
+ *
+ * @param[in]	reslist	-	the resource list to index
+ *
+ * @return	int
+ * @retval	1	: success
+ * @retval	0	: error
+ *
+ * @par MT-Safe:	yes
+ */
+int
+index_resource_list(schd_resource *reslist)
+{
+	schd_resource *resp;
+	int len;
+
+	if (reslist == NULL)
+		return 0;
+
+	len = allres.size();
+	if (reslist->index == NULL || reslist->index_len != len) {
+		free(reslist->index);
+		reslist->index_len = 0;
+		if ((reslist->index = static_cast<schd_resource **>(malloc(len * sizeof(schd_resource *)))) == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			return 0;
+		}
+		reslist->index_len = len;
+	}
+	memset(reslist->index, 0, len * sizeof(schd_resource *));
+
+	for (resp = reslist; resp != NULL; resp = resp->next) {
+		if (resp->def == NULL || resp->def->id < 0 || resp->def->id >= len) {
+			/* can't be looked up by id, fall back to searching the list */
+			free(reslist->index);
+			reslist->index = NULL;
+			reslist->index_len = 0;
+			return 1;
+		}
+		if (reslist->index[resp->def->id] == NULL)
+			reslist->index[resp->def->id] = resp;
+	}
+
+	return 1;
+}
+
 /**
  * @brief	free the svr_to_psets map
  * 		Note: this won't be needed once we convert node_partition to a class
@@ -1087,7 +1187,9 @@ free_resource(schd_resource *resp)
 	if (resp->str_assigned != NULL)
 		free(resp->str_assigned);
 
-	free(resp);
+	free(resp->index);
+
+	obj_pool<schd_resource>::release(resp);
 }
 
 // Init function
@@ -1179,12 +1281,12 @@ new_resource()
 {
 	schd_resource *resp; /* the new resource */
 
-	if ((resp = static_cast<schd_resource *>(calloc(1, sizeof(schd_resource)))) == NULL) {
+	if ((resp = obj_pool<schd_resource>::alloc()) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
 		return NULL;
 	}
 
-	/* member type zero'd by calloc() */
+	/* member type zero'd by obj_pool */
 
 	resp->name = NULL;
 	resp->next = NULL;
@@ -1194,6 +1296,8 @@ new_resource()
 	resp->indirect_res = NULL;
 	resp->str_avail = NULL;
 	resp->str_assigned = NULL;
+	resp->index = NULL;
+	resp->index_len = 0;
 	resp->assigned = RES_DEFAULT_ASSN;
 	resp->avail = RES_DEFAULT_AVAIL;
 
@@ -1347,6 +1451,7 @@ add_resource_list(status *policy, schd_resource *r1, schd_resource *r2, unsigned
 				if (end_r1->next == NULL)
 					return 0;
 				end_r1 = end_r1->next;
+				add_to_resource_index(r1, end_r1);
 			}
 		} else if (cur_r1->type.is_consumable) {
 			if ((flags & ADD_AVAIL_ASSIGNED)) {
@@ -1387,6 +1492,7 @@ add_resource_list(status *policy, schd_resource *r1, schd_resource *r2, unsigned
 							;
 					end_r1->next = nres;
 					end_r1 = nres;
+					add_to_resource_index(r1, nres);
 				} else {
 					nres = false_res();
 					if (nres == NULL)
@@ -1585,16 +1691,13 @@ update_server_on_run(status *policy, server_info *sinfo,
 
 				resv_nodes = resresv->job->resv->resv->resv_nodes;
 				num_resv_nodes = count_array(resv_nodes);
-				qsort(resv_nodes, num_resv_nodes, sizeof(node_info *),
-				      multi_node_sort);
+				sort_node_list(resv_nodes, num_resv_nodes);
 			} else {
-				qsort(sinfo->nodes, sinfo->num_nodes, sizeof(node_info *),
-				      multi_node_sort);
+				sort_node_list(sinfo->nodes, sinfo->num_nodes);
 
 				if (sinfo->nodes != sinfo->unassoc_nodes) {
 					auto num_unassoc = count_array(sinfo->unassoc_nodes);
-					qsort(sinfo->unassoc_nodes, num_unassoc, sizeof(node_info *),
-					      multi_node_sort);
+					sort_node_list(sinfo->unassoc_nodes, num_unassoc);
 				}
 			}
 		}
@@ -2004,6 +2107,8 @@ check_resv_running_on_node(resource_resv *resv, const void *arg)
 // Copy constructor
 server_info::server_info(const server_info &osinfo)
 {
+	auto start = std::chrono::steady_clock::now();
+
 	init_server_info();
 	if (osinfo.fstree != NULL)
 		fstree = new fairshare_head(*osinfo.fstree);
@@ -2164,7 +2269,7 @@ server_info::server_info(const server_info &osinfo)
 		nodes[i]->np_arr =
 			copy_node_partition_ptr_array(osinfo.nodes[i]->np_arr, nodepart);
 		if (calendar != NULL)
-			nodes[i]->node_events = dup_te_lists(osinfo.nodes[i]->node_events, calendar->next_event);
+			nodes[i]->node_events = dup_te_lists(osinfo.nodes[i]->node_events, calendar);
 	}
 	buckets = dup_node_bucket_array(osinfo.buckets, this);
 	/* Now that all job information has been created, time to associate
@@ -2190,6 +2295,11 @@ server_info::server_info(const server_info &osinfo)
 
 	/* Copy the map of server psets */
 	dup_server_psets(osinfo.svr_to_psets);
+
+	log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SERVER, LOG_DEBUG, __func__,
+		   "Server duplicated: %d nodes, %d jobs, %d reservations in %.6fs",
+		   num_nodes, sc.total, num_resvs,
+		   std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
 }
 
 /**
@@ -2221,6 +2331,9 @@ dup_resource_list(schd_resource *res)
 		prev = nres;
 	}
 
+	if (res != NULL && res->index != NULL)
+		index_resource_list(head);
+
 	return head;
 }
 /**
@@ -2283,6 +2396,9 @@ dup_selective_resource_list(schd_resource *res, std::unordered_set<resdef *> &de
 			}
 		}
 	}
+	if (res != NULL && res->index != NULL)
+		index_resource_list(head);
+
 	return head;
 }
 
@@ -2325,6 +2441,9 @@ dup_ind_resource_list(schd_resource *res)
 		prev = nres;
 	}
 
+	if (res != NULL && res->index != NULL)
+		index_resource_list(head);
+
 	return head;
 }
 
@@ -2709,6 +2828,8 @@ update_universe_on_end(status *policy, resource_resv *resresv, const char *job_s
 				/* Since a new resource was added to resdef_to_check, the meta data needs to be recreated.
 				 * This will happen on the next call to node_partition_update()
 				 */
+				for (int i = 0; sinfo->nodes[i] != NULL; i++)
+					mark_node_partitions_stale(sinfo->nodes[i]);
 				if (sinfo->allpart != NULL) {
 					free_resource_list(sinfo->allpart->res);
 					sinfo->allpart->res = NULL;
@@ -2724,8 +2845,10 @@ update_universe_on_end(status *policy, resource_resv *resresv, const char *job_s
 	}
 
 	if (resresv->ninfo_arr != NULL) {
-		for (int i = 0; resresv->ninfo_arr[i] != NULL; i++)
+		for (int i = 0; resresv->ninfo_arr[i] != NULL; i++) {
 			update_node_on_end(resresv->ninfo_arr[i], resresv, job_state);
+			mark_node_partitions_stale(resresv->ninfo_arr[i]);
+		}
 	}
 
 	update_server_on_end(policy, sinfo, qinfo, resresv, job_state);
@@ -2820,6 +2943,7 @@ update_universe_on_run_helper(status *policy, int pbs_sd, resource_resv *rr, uns
 		bool sort_nodepart = false;
 		for (auto n : rr->nspec_arr) {
 			update_node_on_run(n, rr, &old_state);
+			mark_node_partitions_stale(n->ninfo);
 			if (n->ninfo->np_arr != NULL) {
 				node_partition **npar = n->ninfo->np_arr;
 				for (int j = 0; npar[j] != NULL; j++) {
@@ -88,6 +88,11 @@ schd_resource *find_resource_by_str(schd_resource *reslist, const std::string &n
  */
 schd_resource *find_resource(schd_resource *reslist, resdef *def);
 
+/*
+ *	index_resource_list - index a resource list by resdef id
+ */
+int index_resource_list(schd_resource *reslist);
+
 /*
  *      free_resource - free a resource struct
  */
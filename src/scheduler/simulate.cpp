@@ -56,6 +56,8 @@
  * 	find_timed_event()
  * 	perform_event()
  * 	exists_run_event()
+ * 	start_time_check_due()
+ * 	start_time_lower_bound()
  * 	calc_run_time()
  * 	create_event_list()
  * 	create_events()
@@ -91,6 +93,9 @@
 #include <errno.h>
 #include <log.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "simulate.h"
 #include "data_types.h"
 #include "resource_resv.h"
@@ -108,6 +113,8 @@
 #include "globals.h"
 #include "check.h"
 #include "buckets.h"
+#include "cycle_prof.h"
+#include "multi_threading.h"
 #ifdef NAS /* localmod 030 */
 #include "site_code.h"
 #endif /* localmod 030 */
@@ -561,6 +568,166 @@ find_timed_event(timed_event *te_list, time_t event_time)
 	return find_timed_event(te_list, "", 0, TIMED_NOEVENT, event_time);
 }
 
+/**
+ * @brief
+ * 		is event a before event b in the calendar
+ *
+ * @param[in]	a	-	first event
+ * @param[in]	b	-	second event
+ *
+ * @return	int
+ * @retval	1	: a comes before b
+ * @retval	0	: a is b or comes after it
+ */
+static int
+event_before(timed_event *a, timed_event *b)
+{
+	timed_event *e;
+
+	if (a->event_time != b->event_time)
+		return a->event_time < b->event_time;
+
+	for (e = a->next; e != NULL && e->event_time == a->event_time; e = e->next)
+		if (e == b)
+			return 1;
+
+	return 0;
+}
+
+/**
+ * @brief
+ * 		find a timed_event in a calendar starting at an event.
+ *		Works like find_timed_event(), but looks the name up in the
+ *		calendar's name index instead of walking the calendar.
+ *
+ * @param[in]	calendar	- the calendar to search
+ * @param[in]	from		- event of the calendar to start searching at
+ * @param[in]	name		- name of timed_event to search or "" to ignore
+ * @param[in]	ignore_disabled - ignore disabled events
+ * @param[in]	event_type	- event_type or TIMED_NOEVENT to ignore
+ * @param[in]	event_time	- time or 0 to ignore
+ *
+ * @return	found timed_event
+ * @retval	NULL	: not found or on error
+ */
+timed_event *
+find_calendar_event(event_list *calendar, timed_event *from, const std::string &name, int ignore_disabled,
+		    enum timed_event_types event_type, time_t event_time)
+{
+	timed_event *found = NULL;
+
+	if (calendar == NULL || from == NULL)
+		return NULL;
+
+	if (name.empty())
+		return find_timed_event(from, name, ignore_disabled, event_type, event_time);
+
+	auto range = calendar->by_name.equal_range(name);
+	for (auto it = range.first; it != range.second; it++) {
+		timed_event *te = it->second;
+
+		if (ignore_disabled && te->disabled)
+			continue;
+		if (event_type != TIMED_NOEVENT && te->event_type != event_type)
+			continue;
+		if (event_time != 0 && te->event_time != event_time)
+			continue;
+		if (event_before(te, from))
+			continue;
+		if (found == NULL || event_before(te, found))
+			found = te;
+	}
+
+	return found;
+}
+
+/**
+ * @brief
+ * 		link a timed_event into a calendar and its indexes
+ *
+ * @par
+ *		Events are sorted by time.  If there are other events at the
+ *		same time, an end event goes before them and any other event
+ *		goes after them (@see add_timed_event()).
+ *
+ * @param[in]	calendar	- the calendar
+ * @param[in]	te		- the event to link in
+ *
+ * @return	void
+ */
+static void
+insert_calendar_event(event_list *calendar, timed_event *te)
+{
+	timed_event *before = NULL; /* te goes right before this event */
+	timed_event *after = NULL;  /* te goes right after this event */
+	auto it = calendar->by_time.find(te->event_time);
+
+	if (it != calendar->by_time.end()) {
+		if (te->event_type == TIMED_END_EVENT) {
+			before = it->second.first;
+			it->second.first = te;
+		} else {
+			after = it->second.second;
+			it->second.second = te;
+		}
+	} else {
+		auto next = calendar->by_time.upper_bound(te->event_time);
+		if (next != calendar->by_time.end())
+			before = next->second.first;
+		else if (!calendar->by_time.empty())
+			after = calendar->by_time.rbegin()->second.second;
+		calendar->by_time.emplace_hint(next, te->event_time, std::make_pair(te, te));
+	}
+
+	if (before != NULL) {
+		te->prev = before->prev;
+		te->next = before;
+		if (before->prev != NULL)
+			before->prev->next = te;
+		else
+			calendar->events = te;
+		before->prev = te;
+	} else if (after != NULL) {
+		te->prev = after;
+		te->next = after->next;
+		if (after->next != NULL)
+			after->next->prev = te;
+		after->next = te;
+	} else {
+		te->prev = NULL;
+		te->next = NULL;
+		calendar->events = te;
+	}
+
+	calendar->by_name.emplace(te->name, te);
+}
+
+/**
+ * @brief
+ * 		build the indexes of a calendar from its event list
+ *
+ * @param[in]	calendar	- the calendar
+ *
+ * @return	void
+ */
+static void
+index_calendar(event_list *calendar)
+{
+	timed_event *te;
+
+	calendar->by_time.clear();
+	calendar->by_name.clear();
+
+	for (te = calendar->events; te != NULL; te = te->next) {
+		auto it = calendar->by_time.find(te->event_time);
+		if (it == calendar->by_time.end())
+			calendar->by_time.emplace_hint(calendar->by_time.end(), te->event_time, std::make_pair(te, te));
+		else
+			it->second.second = te;
+		calendar->by_name.emplace(te->name, te);
+	}
+}
+
 /**
  * @brief
  * 		takes a timed_event and performs any actions
@@ -693,6 +860,156 @@ exists_resv_event(event_list *calendar, time_t end)
 	return 0;
 }
 
+/**
+ * @brief
+ * 		should calc_run_time() check if the resresv can run after an event
+ *		was simulated?  Only events which may have freed resources or changed
+ *		policy are worth a check.
+ *
+ * @param[in]	sinfo	-	the universe being simulated
+ * @param[in]	resresv	-	the resresv to find the start time of
+ * @param[in]	simret	-	return of the last simulate_events()
+ *
+ * @return	bool
+ */
+static bool
+start_time_check_due(server_info *sinfo, resource_resv *resresv, unsigned int simret)
+{
+	auto desc = describe_simret(simret);
+
+	return desc > 0 || (desc == 0 && policy_change_info(sinfo, resresv));
+}
+
+/**
+ * @brief
+ * 		find the earliest time the calendar could free enough resources on
+ *		the nodes for a job to fit.  What is free on the nodes now is added
+ *		to what every end event frees.  Run events are not taken off, so the
+ *		sum is never less than what is really free, and no check made before
+ *		the time returned can find the job its nodes.  Only the consumable
+ *		resources of the job's select spec which every node sets are summed.
+ *		The nodes and events are read on the worker threads.
+ *
+ * @param[in]	sinfo	-	the universe being simulated, as it is now
+ * @param[in]	resresv	-	the job to find the start time of
+ *
+ * @return	time_t
+ * @retval	the earliest time a check may fit
+ * @retval	0	: any time may fit
+ */
+static time_t
+start_time_lower_bound(server_info *sinfo, resource_resv *resresv)
+{
+	std::vector<resdef *> defs;
+	std::vector<sch_resource_t> need;
+	std::vector<sch_resource_t> avail;
+	std::vector<timed_event *> ends;
+	status *policy = sinfo->policy;
+	int nres;
+	int grain;
+	int nchunks;
+
+	if (!resresv->is_job || resresv->select == NULL || resresv->job->queue == NULL ||
+	    resresv->job->queue->resv != NULL || sinfo->nodes == NULL || sinfo->num_nodes == 0)
+		return 0;
+
+	for (auto te = get_next_event(sinfo->calendar); te != NULL; te = te->next) {
+		if (te->event_type == TIMED_END_EVENT)
+			ends.push_back(te);
+	}
+	if (ends.size() < SIM_BOUND_MIN_EVENTS)
+		return 0;
+
+	for (int i = 0; resresv->select->chunks[i] != NULL; i++) {
+		chunk *chk = resresv->select->chunks[i];
+
+		for (auto req = chk->req; req != NULL; req = req->next) {
+			if (!req->type.is_consumable || policy->resdef_to_check.find(req->def) == policy->resdef_to_check.end() ||
+			    conf.ignore_res.find(req->name) != conf.ignore_res.end())
+				continue;
+			auto it = std::find(defs.begin(), defs.end(), req->def);
+			if (it == defs.end()) {
+				defs.push_back(req->def);
+				need.push_back(0);
+				it = defs.end() - 1;
+			}
+			need[it - defs.begin()] += req->amount * chk->num_chunks;
+		}
+	}
+	if (defs.empty())
+		return 0;
+	nres = defs.size();
+
+	/* a resource unset or infinite on a node puts no bound on the job */
+	grain = mt_grainsize(sinfo->num_nodes);
+	nchunks = (sinfo->num_nodes + grain - 1) / grain;
+	std::vector<sch_resource_t> free_now(static_cast<size_t>(nchunks) * nres, 0);
+	std::vector<char> unbounded(static_cast<size_t>(nchunks) * nres, 0);
+	parallel_for(TS_START_TIME_BOUND, sinfo->num_nodes, grain, [&](int sidx, int eidx, int chunk) {
+		for (int i = sidx; i <= eidx; i++) {
+			for (int r = 0; r < nres; r++) {
+				auto res = find_resource(sinfo->nodes[i]->res, defs[r]);
+
+				if (res == NULL || res->orig_str_avail == NULL) {
+					unbounded[chunk * nres + r] = 1;
+					continue;
+				}
+				if (res->indirect_res != NULL)
+					res = res->indirect_res;
+				if (res->avail == SCHD_INFINITY_RES)
+					unbounded[chunk * nres + r] = 1;
+				else if (res->avail > res->assigned)
+					free_now[chunk * nres + r] += res->avail - res->assigned;
+			}
+		}
+	});
+
+	std::vector<sch_resource_t> freed(ends.size() * nres, 0);
+	parallel_for(TS_START_TIME_BOUND, ends.size(), mt_grainsize(ends.size()), [&](int sidx, int eidx, int chunk) {
+		for (int e = sidx; e <= eidx; e++) {
+			auto rr = static_cast<resource_resv *>(ends[e]->event_ptr);
+
+			for (auto ns : rr->nspec_arr) {
+				for (int r = 0; r < nres; r++) {
+					auto req = find_resource_req(ns->resreq, defs[r]);
+					if (req != NULL)
+						freed[static_cast<size_t>(e) * nres + r] += req->amount;
+				}
+			}
+		}
+	});
+
+	avail.assign(nres, 0);
+	for (int c = 0; c < nchunks; c++) {
+		for (int r = 0; r < nres; r++) {
+			if (unbounded[c * nres + r])
+				need[r] = 0;
+			avail[r] += free_now[c * nres + r];
+		}
+	}
+
+	/* leave room for rounding in the sums */
+	auto may_fit = [&]() {
+		for (int r = 0; r < nres; r++) {
+			if (avail[r] + avail[r] * 1e-9 < need[r])
+				return false;
+		}
+		return true;
+	};
+
+	if (may_fit())
+		return 0;
+	for (size_t e = 0; e < ends.size(); e++) {
+		for (int r = 0; r < nres; r++)
+			avail[r] += freed[e * nres + r];
+		if ((e + 1 == ends.size() || ends[e + 1]->event_time != ends[e]->event_time) && may_fit())
+			return ends[e]->event_time;
+	}
+
+	/* it never fits, but still check after the last event to learn why */
+	return ends.back()->event_time;
+}
+
 /**
  * @brief
  * 		calculate the run time of a resresv through simulation of
@@ -713,6 +1030,7 @@ exists_resv_event(event_list *calendar, time_t end)
 time_t
 calc_run_time(const std::string &name, server_info *sinfo, int flags)
 {
+	prof_timer timer(PROF_CALENDAR);
 	time_t event_time = (time_t) 0; /* time of the simulated event */
 	event_list *calendar;		/* calendar we are simulating in */
 	resource_resv *resresv;		/* the resource resv to find star time for */
@@ -726,6 +1044,9 @@ calc_run_time(const std::string &name, server_info *sinfo, int flags)
 	std::vector<nspec *> nspec_arr;
 	unsigned int ok_flags = NO_ALLPART;
 	queue_info *qinfo = NULL;
+	time_t earliest = 0; /* checks before this time can not fit */
+	bool bounded = false;
+	long skipped = 0;
 
 	if (name.empty() || sinfo == NULL)
 		return (time_t) -1;
@@ -754,10 +1075,18 @@ calc_run_time(const std::string &name, server_info *sinfo, int flags)
 		 * because it's being simulated/updated in simulate_events()
 		 */
 
-		auto desc = describe_simret(ret);
-		if (desc > 0 || (desc == 0 && policy_change_info(sinfo, resresv))) {
-			clear_schd_error(err);
-			nspec_arr = is_ok_to_run(sinfo->policy, sinfo, qinfo, resresv, ok_flags, err);
+		if (start_time_check_due(sinfo, resresv, ret)) {
+			if (event_time < earliest)
+				skipped++;
+			else {
+				clear_schd_error(err);
+				nspec_arr = is_ok_to_run(sinfo->policy, sinfo, qinfo, resresv, ok_flags, err);
+				/* it does not fit now, skip the checks before it could */
+				if (nspec_arr.empty() && !bounded) {
+					bounded = true;
+					earliest = start_time_lower_bound(sinfo, resresv);
+				}
+			}
 		}
 
 		if (nspec_arr.empty()) /* event can not run */
@@ -770,6 +1099,10 @@ calc_run_time(const std::string &name, server_info *sinfo, int flags)
 #endif /* localmod 030 */
 	} while (nspec_arr.empty() && !(ret & (TIMED_NOEVENT | TIMED_ERROR)));
 
+	if (skipped > 0)
+		log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_DEBUG, resresv->name,
+			   "Start time search skipped %ld checks before enough resources could be free", skipped);
+
 #ifdef NAS /* localmod 030 */
 	if (check_for_cycle_interrupt(0) || (ret & TIMED_ERROR)) {
 #else
@@ -842,7 +1175,7 @@ create_event_list(server_info *sinfo)
 	if (elist == NULL)
 		return NULL;
 
-	elist->events = create_events(sinfo);
+	create_events(sinfo, elist);
 
 	elist->next_event = elist->events;
 	elist->first_run_event = find_timed_event(elist->events, TIMED_RUN_EVENT);
@@ -854,18 +1187,20 @@ create_event_list(server_info *sinfo)
 
 /**
  * @brief
- *		create_events - creates an timed_event list from running jobs
- *			    and confirmed reservations
+ *		create_events - adds events for running jobs and confirmed
+ *			    reservations to a calendar
  *
  * @param[in] sinfo - server universe to act upon
+ * @param[in,out] elist - the calendar to add the events to
  *
- * @return	timed_event list
+ * @return	int
+ * @retval	1	: success
+ * @retval	0	: error, the calendar is left empty
  *
  */
-timed_event *
-create_events(server_info *sinfo)
+int
+create_events(server_info *sinfo, event_list *elist)
 {
-	timed_event *events = NULL;
 	timed_event *te = NULL;
 	resource_resv **all = NULL;
 	int errflag = 0;
@@ -900,7 +1235,7 @@ create_events(server_info *sinfo)
 				errflag++;
 				break;
 			}
-			events = add_timed_event(events, te);
+			insert_calendar_event(elist, te);
 		}
 
 		if (sinfo->use_hard_duration)
@@ -912,7 +1247,7 @@ create_events(server_info *sinfo)
 			errflag++;
 			break;
 		}
-		events = add_timed_event(events, te);
+		insert_calendar_event(elist, te);
 	}
 
 	/* for nodes that are in state=sleep add a timed event */
@@ -925,19 +1260,22 @@ create_events(server_info *sinfo)
 				errflag++;
 				break;
 			}
-			events = add_timed_event(events, te);
+			insert_calendar_event(elist, te);
 		}
 	}
 
 	/* A malloc error was encountered, free all allocated memory and return */
 	if (errflag > 0) {
-		free_timed_event_list(events);
+		free_timed_event_list(elist->events);
+		elist->events = NULL;
+		elist->by_time.clear();
+		elist->by_name.clear();
 		free(all_resresv_copy);
 		return 0;
 	}
 
 	free(all_resresv_copy);
-	return events;
+	return 1;
 }
 
 /**
@@ -952,7 +1290,7 @@ new_event_list()
 {
 	event_list *elist;
 
-	if ((elist = static_cast<event_list *>(malloc(sizeof(event_list)))) == NULL) {
+	if ((elist = new event_list()) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
 		return NULL;
 	}
@@ -998,12 +1336,13 @@ dup_event_list(event_list *oelist, server_info *nsinfo)
 			free_event_list(nelist);
 			return NULL;
 		}
+		index_calendar(nelist);
 	}
 
 	if (oelist->next_event != NULL) {
-		nelist->next_event = find_timed_event(nelist->events, oelist->next_event->name,
-						      oelist->next_event->event_type,
-						      oelist->next_event->event_time);
+		nelist->next_event = find_calendar_event(nelist, nelist->events, oelist->next_event->name, 0,
+							 oelist->next_event->event_type,
+							 oelist->next_event->event_time);
 		if (nelist->next_event == NULL) {
 			log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_SCHED, LOG_WARNING,
 				  oelist->next_event->name, "can't find next event in duplicated list");
@@ -1014,8 +1353,8 @@ dup_event_list(event_list *oelist, server_info *nsinfo)
 
 	if (oelist->first_run_event != NULL) {
 		nelist->first_run_event =
-			find_timed_event(nelist->events, oelist->first_run_event->name, TIMED_RUN_EVENT,
-					 oelist->first_run_event->event_time);
+			find_calendar_event(nelist, nelist->events, oelist->first_run_event->name, 0, TIMED_RUN_EVENT,
+					    oelist->first_run_event->event_time);
 		if (nelist->first_run_event == NULL) {
 			log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_SCHED, LOG_WARNING, oelist->first_run_event->name,
 				  "can't find first run event event in duplicated list");
@@ -1040,7 +1379,7 @@ free_event_list(event_list *elist)
 		return;
 
 	free_timed_event_list(elist->events);
-	free(elist);
+	delete elist;
 }
 
 /**
@@ -1146,23 +1485,24 @@ free_te_list(te_list *tel)
 /*
  * @brief te_list copy constructor
  * @param[in] ote - te_list to copy
- * @param[in] new_timed_even_list - new timed events
+ * @param[in] new_calendar - calendar of the new timed events
  *
  * @return copied te_list
  */
 te_list *
-dup_te_list(te_list *ote, timed_event *new_timed_event_list)
+dup_te_list(te_list *ote, event_list *new_calendar)
 {
 	te_list *nte;
 
-	if (ote == NULL || new_timed_event_list == NULL)
+	if (ote == NULL || new_calendar == NULL || new_calendar->next_event == NULL)
 		return NULL;
 
 	nte = new_te_list();
 	if (nte == NULL)
 		return NULL;
 
-	nte->event = find_timed_event(new_timed_event_list, ote->event->name, ote->event->event_type, ote->event->event_time);
+	nte->event = find_calendar_event(new_calendar, new_calendar->next_event, ote->event->name, 0,
+					 ote->event->event_type, ote->event->event_time);
 
 	return nte;
 }
@@ -1170,24 +1510,24 @@ dup_te_list(te_list *ote, timed_event *new_timed_event_list)
 /*
  * @brief copy constructor for a list of te_list structures
  * @param[in] ote - te_list to copy
- * @param[in] new_timed_even_list - new timed events
+ * @param[in] new_calendar - calendar of the new timed events
  *
  * @return copied te_list list
  */
 
 te_list *
-dup_te_lists(te_list *ote, timed_event *new_timed_event_list)
+dup_te_lists(te_list *ote, event_list *new_calendar)
 {
 	te_list *nte;
 	te_list *end_te = NULL;
 	te_list *cur;
 	te_list *nte_head = NULL;
 
-	if (ote == NULL || new_timed_event_list == NULL)
+	if (ote == NULL || new_calendar == NULL || new_calendar->next_event == NULL)
 		return NULL;
 
 	for (cur = ote; cur != NULL; cur = cur->next) {
-		nte = dup_te_list(cur, new_timed_event_list);
+		nte = dup_te_list(cur, new_calendar);
 		if (nte == NULL) {
 			free_te_list(nte_head);
 			return NULL;
@@ -1440,7 +1780,7 @@ add_event(event_list *calendar, timed_event *te)
 	if (calendar->events == NULL)
 		events_is_null = 1;
 
-	calendar->events = add_timed_event(calendar->events, te);
+	insert_calendar_event(calendar, te);
 
 	/* empty event list - the new event is the only event */
 	if (events_is_null)
@@ -1452,10 +1792,8 @@ add_event(event_list *calendar, timed_event *te)
 		if (te->event_time > current_time) {
 			if (te->event_time < calendar->next_event->event_time)
 				calendar->next_event = te;
-			else if (te->event_time == calendar->next_event->event_time) {
-				calendar->next_event =
-					find_timed_event(calendar->events, te->event_time);
-			}
+			else if (te->event_time == calendar->next_event->event_time)
+				calendar->next_event = calendar->by_time[te->event_time].first;
 		}
 	}
 	/* if next_event == NULL, then we've simulated to the end. */
@@ -1550,8 +1888,27 @@ delete_event(server_info *sinfo, timed_event *e)
 	if (calendar->next_event == e)
 		calendar->next_event = e->next;
 
+	/* there are no run events before the first one */
 	if (calendar->first_run_event == e)
-		calendar->first_run_event = find_timed_event(calendar->events, TIMED_RUN_EVENT);
+		calendar->first_run_event = find_timed_event(e->next, TIMED_RUN_EVENT);
+
+	auto it = calendar->by_time.find(e->event_time);
+	if (it != calendar->by_time.end()) {
+		if (it->second.first == e && it->second.second == e)
+			calendar->by_time.erase(it);
+		else if (it->second.first == e)
+			it->second.first = e->next;
+		else if (it->second.second == e)
+			it->second.second = e->prev;
+	}
+
+	auto range = calendar->by_name.equal_range(e->name);
+	for (auto n = range.first; n != range.second; n++) {
+		if (n->second == e) {
+			calendar->by_name.erase(n);
+			break;
+		}
+	}
 
 	if (e->prev == NULL)
 		calendar->events = e->next;
@@ -139,6 +139,14 @@ timed_event *find_timed_event(timed_event *te_list, enum timed_event_types event
 timed_event *find_timed_event(timed_event *te_list, const std::string &name, enum timed_event_types event_type, time_t event_time);
 timed_event *find_timed_event(timed_event *te_list, time_t event_time);
 
+/*
+ *	find_calendar_event - find a timed_event in a calendar by name
+ *			      through the calendar's name index
+ */
+timed_event *
+find_calendar_event(event_list *calendar, timed_event *from, const std::string &name, int ignore_disabled,
+		    enum timed_event_types event_type, time_t event_time);
+
 /*
  *      next_event - move an event_list to the next event and return it
  *
@@ -190,15 +198,15 @@ int exists_run_event_on_node(node_info *ninf, time_t end);
 int exists_resv_event(event_list *calendar, time_t end);
 
 /*
- *      create_events - creates an timed_event list from running jobs
- *                          and confirmed reservations
+ *      create_events - adds events for running jobs and confirmed
+ *                      reservations to a calendar
  *
  *        \param sinfo - server universe to act upon
- *        \param flags -
+ *        \param elist - the calendar to add to
  *
- *        \return timed_event list
+ *        \return 1 on success, 0 on error
  */
-timed_event *create_events(server_info *sinfo);
+int create_events(server_info *sinfo, event_list *elist);
 
 /*
  * new_event_list() - event_list constructor
@@ -442,8 +450,8 @@ generic_sim(event_list *calendar, unsigned int event_mask, time_t end, int defau
 
 te_list *new_te_list();
 
-te_list *dup_te_list(te_list *ote, timed_event *new_timed_event_list);
-te_list *dup_te_lists(te_list *ote, timed_event *new_timed_event_list);
+te_list *dup_te_list(te_list *ote, event_list *new_calendar);
+te_list *dup_te_lists(te_list *ote, event_list *new_calendar);
 
 void free_te_list(te_list *tel);
 
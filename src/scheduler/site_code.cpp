@@ -1592,7 +1592,7 @@ site_set_job_share(resource_resv *resresv)
 	sh_amt *		sh_amts;
 	struct shr_type *	stp;
 
-	if (resresv == NULL || (select = resresv->select) == NULL)
+	if (resresv == NULL || (select = resresv->select.get()) == NULL)
 		return;
 	if (!resresv->is_job || (job = resresv->job) == NULL)
 		return;
@@ -2166,6 +2166,7 @@ site_vnode_inherit(node_info ** nodes)
 				prev->next = cur;
 			}
 		}
+		index_resource_list(ninfo->res);
 	}
 }
 
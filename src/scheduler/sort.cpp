@@ -67,6 +67,8 @@
  * 	cmp_node_host()
  * 	cmp_aoe()
  * 	cmp_job_preemption_time_asc()
+ * 	sort_job_list()
+ * 	sort_node_list()
  * 	sort_jobs()
  * 	swapfunc()
  * 	med3()
@@ -77,6 +79,7 @@
 
 #include "check.h"
 #include "constant.h"
+#include "cycle_prof.h"
 #include "data_types.h"
 #include "fairshare.h"
 #include "fifo.h"
@@ -87,16 +90,24 @@
 #include "resource_resv.h"
 #include "server_info.h"
 #include "sort.h"
+#include "multi_threading.h"
+#include <algorithm>
+#include <cmath>
 #include <errno.h>
 #include <log.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
 
 #ifdef NAS
 #include "site_code.h"
 #endif
 
+/* sign bit of a sort key */
+#define SORT_KEY_SIGN (1ULL << 63)
+
 /**
  * @brief
  *		compare two new numerical resource numbers for a descending sort
@@ -1116,6 +1127,234 @@ cmp_resv_state(const void *r1, const void *r2)
 		return 0;
 }
 
+/**
+ * @brief	map a double onto an unsigned integer of the same order
+ *
+ * @param[in]	v	-	the value, not a NaN
+ *
+ * @return	uint64_t
+ */
+static inline uint64_t
+key_from_double(double v)
+{
+	uint64_t bits;
+
+	if (v == 0)
+		v = 0; /* -0 and 0 compare equal */
+	memcpy(&bits, &v, sizeof(bits));
+	return (bits & SORT_KEY_SIGN) ? ~bits : (bits | SORT_KEY_SIGN);
+}
+
+/**
+ * @brief	map a signed integer onto an unsigned integer of the same order
+ */
+static inline uint64_t
+key_from_ll(long long v)
+{
+	return static_cast<uint64_t>(v) ^ SORT_KEY_SIGN;
+}
+
+/**
+ * @brief	reorder an array by its rows of keys, compared in order
+ *
+ * @param[in,out]	arr	-	the array
+ * @param[in]	n	-	number of elements in arr
+ * @param[in]	width	-	number of keys per element
+ * @param[in]	keys	-	n rows of width keys
+ *
+ * @return	void
+ */
+template <typename T>
+static void
+sort_by_keys(T **arr, int n, int width, const std::vector<uint64_t> &keys)
+{
+	std::vector<int> idx(n);
+	std::vector<T *> tmp(arr, arr + n);
+
+	for (int i = 0; i < n; i++)
+		idx[i] = i;
+
+	std::sort(idx.begin(), idx.end(), [&](int a, int b) {
+		const uint64_t *ka = &keys[static_cast<size_t>(a) * width];
+		const uint64_t *kb = &keys[static_cast<size_t>(b) * width];
+
+		for (int k = 0; k < width; k++)
+			if (ka[k] != kb[k])
+				return ka[k] < kb[k];
+		return false;
+	});
+
+	for (int i = 0; i < n; i++)
+		arr[i] = tmp[idx[i]];
+}
+
+/**
+ * @brief
+ * 		sort jobs into the order of cmp_sort() by computing each job's
+ *		sort keys once instead of on every comparison
+ *
+ * @par
+ *		The keys are, in order: runnable state, preemption priority,
+ *		time preempted, formula value, the usage/share ratio at each
+ *		level of the fairshare tree, the job_sort_keys, qrank and rank.
+ *		The rank is unique, so there are no ties and the order is the
+ *		same as sorting with cmp_sort().
+ *
+ * @param[in,out]	jobs	-	the jobs
+ * @param[in]	num_jobs	-	number of jobs
+ *
+ * @return	bool
+ * @retval	true	: the jobs are sorted
+ * @retval	false	: the jobs can't be keyed (e.g. fairshare entities at
+ *			  different depths of the tree), use cmp_sort()
+ */
+static bool
+sort_jobs_by_key(resource_resv **jobs, int num_jobs)
+{
+	bool fair_share = false;
+	size_t depth = 0;
+	int width;
+
+	for (int i = 0; i < num_jobs; i++)
+		if (jobs[i] == NULL || jobs[i]->job == NULL)
+			return false;
+
+#ifndef NAS /* localmod 041 */
+	fair_share = jobs[0]->server->policy->fair_share;
+#endif /* localmod 041 */
+	/* compare_path() stops at the shorter of two paths */
+	if (fair_share) {
+		for (int i = 0; i < num_jobs; i++) {
+			group_info *ginfo = jobs[i]->job->ginfo;
+
+			if (ginfo == NULL || (i > 0 && ginfo->gpath.size() != depth))
+				return false;
+			depth = ginfo->gpath.size();
+		}
+	}
+
+	width = 4 + depth + cstat.sort_by->size() + 2;
+	std::vector<uint64_t> keys(static_cast<size_t>(num_jobs) * width);
+	std::vector<char> has_nan(num_jobs, 0);
+
+	parallel_for(TS_SORT_KEYS, num_jobs, mt_grainsize(num_jobs), [&](int sidx, int eidx, int chunk) {
+		for (int i = sidx; i <= eidx; i++) {
+			resource_resv *r = jobs[i];
+			uint64_t *k = &keys[static_cast<size_t>(i) * width];
+
+			*k++ = in_runnable_state(r) ? 0 : 1;
+			*k++ = ~static_cast<uint64_t>(r->job->preempt);
+			*k++ = (r->job->time_preempted == UNSPECIFIED) ? UINT64_MAX : key_from_ll(r->job->time_preempted);
+			if (std::isnan(r->job->formula_value))
+				has_nan[i] = 1;
+			*k++ = key_from_double(-r->job->formula_value);
+
+			if (fair_share) {
+				/* everything below a group with no share has no share
+				 * either, so compare_path() stops at the first such level
+				 */
+				bool no_share = false;
+
+				for (auto g : r->job->ginfo->gpath) {
+					if (no_share || g->tree_percentage <= 0) {
+						no_share = true;
+						*k++ = UINT64_MAX;
+					} else {
+						double ratio = g->temp_usage / g->tree_percentage;
+
+						if (std::isnan(ratio))
+							has_nan[i] = 1;
+						*k++ = key_from_double(ratio);
+					}
+				}
+			}
+
+			for (const auto &si : *cstat.sort_by) {
+				sch_resource_t v = find_resresv_amount(r, si.res_name, si.def);
+
+				if (std::isnan(v))
+					has_nan[i] = 1;
+				*k++ = key_from_double(si.order == ASC ? v : -v);
+			}
+			*k++ = key_from_ll(r->qrank);
+			*k++ = key_from_ll(r->rank);
+		}
+	});
+
+	for (int i = 0; i < num_jobs; i++)
+		if (has_nan[i])
+			return false;
+
+	sort_by_keys(jobs, num_jobs, width, keys);
+	return true;
+}
+
+/**
+ * @brief
+ * 		sort an array of jobs in the order of cmp_sort()
+ *
+ * @param[in,out]	jobs	-	the jobs
+ * @param[in]	num_jobs	-	number of jobs
+ *
+ * @return	void
+ */
+void
+sort_job_list(resource_resv **jobs, int num_jobs)
+{
+	if (jobs == NULL || num_jobs < 2)
+		return;
+
+	if (!sort_jobs_by_key(jobs, num_jobs))
+		qsort(jobs, num_jobs, sizeof(resource_resv *), cmp_sort);
+}
+
+/**
+ * @brief
+ * 		sort an array of nodes in the order of multi_node_sort(), by
+ *		computing each node's sort keys once
+ *
+ * @param[in,out]	nodes	-	the nodes
+ * @param[in]	num_nodes	-	number of nodes
+ *
+ * @return	void
+ */
+void
+sort_node_list(node_info **nodes, int num_nodes)
+{
+	int width;
+
+	if (nodes == NULL || num_nodes < 2)
+		return;
+
+	width = cstat.node_sort->size() + 1;
+	std::vector<uint64_t> keys(static_cast<size_t>(num_nodes) * width);
+	std::vector<char> has_nan(num_nodes, 0);
+
+	parallel_for(TS_SORT_KEYS, num_nodes, mt_grainsize(num_nodes), [&](int sidx, int eidx, int chunk) {
+		for (int i = sidx; i <= eidx; i++) {
+			uint64_t *k = &keys[static_cast<size_t>(i) * width];
+
+			for (const auto &si : *cstat.node_sort) {
+				sch_resource_t v = find_node_amount(nodes[i], si.res_name, si.def, si.res_type);
+
+				if (std::isnan(v))
+					has_nan[i] = 1;
+				*k++ = key_from_double(si.order == ASC ? v : -v);
+			}
+			*k++ = key_from_ll(nodes[i]->rank);
+		}
+	});
+
+	for (int i = 0; i < num_nodes; i++) {
+		if (has_nan[i]) {
+			qsort(nodes, num_nodes, sizeof(node_info *), multi_node_sort);
+			return;
+		}
+	}
+
+	sort_by_keys(nodes, num_nodes, width, keys);
+}
+
 /**
  * @brief
  * 		sort_jobs - This function sorts all jobs according to their preemption
@@ -1132,6 +1371,7 @@ cmp_resv_state(const void *r1, const void *r2)
 void
 sort_jobs(status *policy, server_info *sinfo)
 {
+	prof_timer timer(PROF_SORT_JOBS);
 	/** sort jobs in such a way that Higher Priority jobs come on top
 	 * followed by preempted jobs and then normal jobs
 	 */
@@ -1146,8 +1386,7 @@ sort_jobs(status *policy, server_info *sinfo)
 			 */
 			for (auto qinfo : sinfo->queues) {
 				if (qinfo->sc.total > 0) {
-					qsort(qinfo->jobs, qinfo->sc.total,
-					      sizeof(resource_resv *), cmp_sort);
+					sort_job_list(qinfo->jobs, qinfo->sc.total);
 				}
 			}
 			for (auto qinfo : sinfo->queues) {
@@ -1160,24 +1399,23 @@ sort_jobs(status *policy, server_info *sinfo)
 		}
 		/** Sort on entire complex **/
 		else if (!policy->by_queue && !policy->round_robin) {
-			qsort(sinfo->jobs, count_array(sinfo->jobs), sizeof(resource_resv *), cmp_sort);
+			sort_job_list(sinfo->jobs, count_array(sinfo->jobs));
 		}
 	} else if (policy->by_queue) {
 		for (auto qinfo : sinfo->queues) {
-			qsort(qinfo->jobs, count_array(qinfo->jobs), sizeof(resource_resv *), cmp_sort);
+			sort_job_list(qinfo->jobs, count_array(qinfo->jobs));
 		}
-		qsort(sinfo->jobs, count_array(sinfo->jobs), sizeof(resource_resv *), cmp_sort);
+		sort_job_list(sinfo->jobs, count_array(sinfo->jobs));
 	} else if (policy->round_robin) {
 		if (sinfo->queue_list != NULL) {
 			int queue_list_size = count_array(sinfo->queue_list);
 			for (int i = 0; i < queue_list_size; i++) {
 				int queue_index_size = count_array(sinfo->queue_list[i]);
 				for (int j = 0; j < queue_index_size; j++) {
-					qsort(sinfo->queue_list[i][j]->jobs, count_array(sinfo->queue_list[i][j]->jobs),
-					      sizeof(resource_resv *), cmp_sort);
+					sort_job_list(sinfo->queue_list[i][j]->jobs, count_array(sinfo->queue_list[i][j]->jobs));
 				}
 			}
 		}
 	} else
-		qsort(sinfo->jobs, count_array(sinfo->jobs), sizeof(resource_resv *), cmp_sort);
+		sort_job_list(sinfo->jobs, count_array(sinfo->jobs));
 }
@@ -183,6 +183,16 @@ int cmp_preemption(resource_resv *r1, resource_resv *r2);
  */
 int cmp_resv_state(const void *r1, const void *r2);
 
+/*
+ * sort_job_list - sort an array of jobs in the order of cmp_sort()
+ */
+void sort_job_list(resource_resv **jobs, int num_jobs);
+
+/*
+ * sort_node_list - sort an array of nodes in the order of multi_node_sort()
+ */
+void sort_node_list(node_info **nodes, int num_nodes);
+
 /*
  * sort_jobs - This function sorts all jobs according to their preemption
  *             priority, preempted time and fairshare.
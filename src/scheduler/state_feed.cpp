@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file    state_feed.cpp
+ *
+ * @brief
+ * 		state_feed.cpp - incremental server to scheduler state feed
+ *
+ *	The server hands out a change sequence number in its status.  Each
+ *	status query made through feed_query() carries the sequence the
+ *	scheduler last acknowledged for that query ("D<seq>" in the extend
+ *	field).  The server then only sends the attributes of the objects that
+ *	changed since, and sends the unchanged objects with no attributes.
+ *	The attributes of the unchanged objects are moved over from the reply
+ *	cached for the previous cycle, so the callers still see a full reply.
+ *
+ * Functions included are:
+ * 	feed_begin_cycle()
+ * 	feed_query()
+ * 	feed_release()
+ * 	feed_log_cycle()
+ * 	feed_reset()
+ *
+ */
+#include <pbs_config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include <pbs_error.h>
+#include <pbs_ifl.h>
+#include <log.h>
+#include "state_feed.h"
+#include "data_types.h"
+#include "globals.h"
+
+/* reply of one query, kept across cycles */
+struct feed_entry {
+	struct batch_status *bs; /* merged reply, owned by the feed */
+	unsigned long long seq;	 /* change sequence the reply is current as of */
+};
+
+static std::unordered_map<std::string, feed_entry> feed_cache;
+static unsigned long long feed_seq = 0; /* change sequence of this cycle, 0 if off */
+static int feed_cycles = 0;		/* cycles since the last full resync */
+
+/* counters for the cycle log */
+static int delta_fetches;
+static int full_fetches;
+static int objs_reused;
+static int objs_refreshed;
+
+/**
+ * @brief
+ *		feed_begin_cycle - start a new cycle of the incremental state feed
+ *
+ * @par
+ *		Picks up the change sequence from the server's batch_status.  If
+ *		the server does not hand one out, or the feed is turned off, all
+ *		queries of the cycle are full queries.  Every state_feed_resync
+ *		cycles the cache is dropped to force a full resync.
+ *
+ * @param[in]	pbs_sd	-	connection to the server
+ * @param[in]	server	-	batch_status of the server
+ *
+ * @return	void
+ */
+void
+feed_begin_cycle(int pbs_sd, struct batch_status *server)
+{
+	struct attrl *attrp;
+	unsigned long long seq = 0;
+
+	delta_fetches = 0;
+	full_fetches = 0;
+	objs_reused = 0;
+	objs_refreshed = 0;
+
+	/* a capture needs every object in full, so it can be replayed on its own */
+	if (pbs_sd == clust_primary_sock && conf.state_feed_resync > 0 &&
+	    conf.capture_file.empty() && server != NULL) {
+		for (attrp = server->attribs; attrp != NULL; attrp = attrp->next) {
+			if (!strcmp(attrp->name, ATTR_change_sequence)) {
+				seq = strtoull(attrp->value, NULL, 10);
+				break;
+			}
+		}
+	}
+
+	if (seq == 0 || seq < feed_seq || ++feed_cycles >= conf.state_feed_resync) {
+		feed_reset();
+		feed_cycles = 0;
+	}
+
+	feed_seq = seq;
+}
+
+/**
+ * @brief
+ *		feed_query - query the server for the objects changed since the
+ *		last cycle and merge them with the cached copies
+ *
+ * @par
+ *		If an object comes back without attributes and there is no cached
+ *		copy of it, the reply can't be merged and a full query is made.
+ *		The returned batch_status must be released with feed_release().
+ *
+ * @param[in]	pbs_sd	-	connection to the server
+ * @param[in]	key	-	unique name of the query (e.g. "jobs:workq")
+ * @param[in]	extend	-	extend string of the query
+ * @param[in]	fetch	-	function making the query
+ *
+ * @return	struct batch_status *
+ * @retval	the merged reply
+ * @retval	NULL	: no objects or error (pbs_errno set)
+ */
+struct batch_status *
+feed_query(int pbs_sd, const std::string &key, const char *extend, const feed_fetch_func &fetch)
+{
+	struct batch_status *bs;
+	struct batch_status *cur;
+	std::string ext;
+	unsigned long long since = 0;
+	int reused = 0;
+	int refreshed = 0;
+	bool cached;
+	bool miss = false;
+
+	if (feed_seq == 0 || pbs_sd != clust_primary_sock)
+		return fetch(const_cast<char *>(extend));
+
+	if (extend != NULL)
+		ext = extend;
+
+	auto it = feed_cache.find(key);
+	cached = it != feed_cache.end();
+	if (cached) {
+		since = it->second.seq;
+		ext += "D" + std::to_string(since);
+	}
+
+	bs = fetch(const_cast<char *>(ext.c_str()));
+
+	if (cached) {
+		if (bs != NULL) {
+			std::unordered_map<std::string, struct batch_status *> old;
+
+			for (cur = it->second.bs; cur != NULL; cur = cur->next)
+				old[cur->name] = cur;
+
+			for (cur = bs; cur != NULL; cur = cur->next) {
+				if (cur->attribs != NULL) {
+					refreshed++;
+					continue;
+				}
+				auto o = old.find(cur->name);
+				if (o == old.end() || o->second->attribs == NULL) {
+					miss = true;
+					break;
+				}
+				cur->attribs = o->second->attribs;
+				o->second->attribs = NULL;
+				reused++;
+			}
+		}
+		pbs_statfree(it->second.bs);
+		feed_cache.erase(it);
+
+		if (!miss) {
+			delta_fetches++;
+			objs_reused += reused;
+			objs_refreshed += refreshed;
+		} else {
+			log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SERVER, LOG_DEBUG, __func__,
+				   "Unable to merge delta reply for %s, doing a full query", key.c_str());
+			pbs_statfree(bs);
+			bs = fetch(const_cast<char *>(extend));
+		}
+	}
+
+	if (!cached || miss) {
+		full_fetches++;
+		for (cur = bs; cur != NULL; cur = cur->next)
+			objs_refreshed++;
+	}
+
+	if (bs != NULL)
+		feed_cache[key] = {bs, feed_seq};
+
+	return bs;
+}
+
+/**
+ * @brief
+ *		feed_release - release a batch_status returned by feed_query()
+ *
+ * @par
+ *		Replies kept for the next cycle are left alone, all others are freed.
+ *
+ * @param[in]	bs	-	batch_status to release
+ *
+ * @return	void
+ */
+void
+feed_release(struct batch_status *bs)
+{
+	if (bs == NULL)
+		return;
+
+	for (const auto &e : feed_cache)
+		if (e.second.bs == bs)
+			return;
+
+	pbs_statfree(bs);
+}
+
+/**
+ * @brief
+ *		feed_log_cycle - log the delta/full fetch counts of the cycle
+ *
+ * @return	void
+ */
+void
+feed_log_cycle(void)
+{
+	if (feed_seq == 0)
+		return;
+
+	log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SERVER, LOG_DEBUG, "state_feed",
+		   "Server state queried with %d delta and %d full fetches: %d objects reused, %d refreshed",
+		   delta_fetches, full_fetches, objs_reused, objs_refreshed);
+}
+
+/**
+ * @brief
+ *		feed_reset - drop all cached server state
+ *
+ * @return	void
+ */
+void
+feed_reset(void)
+{
+	for (auto &e : feed_cache)
+		pbs_statfree(e.second.bs);
+	feed_cache.clear();
+	feed_seq = 0;
+}
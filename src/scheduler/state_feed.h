@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+#ifndef _STATE_FEED_H
+#define _STATE_FEED_H
+
+#include <functional>
+#include <string>
+#include <pbs_ifl.h>
+
+/* fetches a batch_status from the server with the given extend string */
+typedef std::function<struct batch_status *(char *extend)> feed_fetch_func;
+
+/*
+ *	feed_begin_cycle - start a new cycle of the incremental state feed
+ *			   from the server's batch_status
+ */
+void feed_begin_cycle(int pbs_sd, struct batch_status *server);
+
+/*
+ *	feed_query - query the server for the objects changed since the last
+ *		     cycle and merge them with the cached copies
+ */
+struct batch_status *feed_query(int pbs_sd, const std::string &key, const char *extend, const feed_fetch_func &fetch);
+
+/*
+ *	feed_release - release a batch_status returned by feed_query()
+ */
+void feed_release(struct batch_status *bs);
+
+/*
+ *	feed_log_cycle - log the delta/full fetch counts of the cycle
+ */
+void feed_log_cycle(void);
+
+/*
+ *	feed_reset - drop all cached server state
+ */
+void feed_reset(void);
+
+#endif /* _STATE_FEED_H */
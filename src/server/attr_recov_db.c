@@ -156,6 +156,57 @@ encode_attr_db(attribute_def *padef, attribute *pattr, int numattr, pbs_db_attr_
 	return 0;
 }
 
+/**
+ * @brief
+ *	Take note of the attributes encode_attr_db() would save, for a save
+ *	which is put off.  Their modify flag is cleared as if they were saved,
+ *	so code looking for attributes modified since the last save behaves
+ *	the same.
+ *
+ * @param[in]	padef - Address of parent's attribute definition array
+ * @param[in]	pattr - Address of the parent objects attribute array
+ * @param[in]	numattr - Number of attributes in the list
+ * @param[in]	all  - Take all attributes
+ *
+ */
+void
+defer_attr_db(attribute_def *padef, attribute *pattr, int numattr, int all)
+{
+	int i;
+
+	for (i = 0; i < numattr; i++) {
+		if (!((pattr + i)->at_flags & ATR_VFLAG_MODIFY))
+			continue;
+
+		if ((((padef + i)->at_flags & ATR_DFLAG_NOSAVM) == 0) || all) {
+			(pattr + i)->at_flags &= ~ATR_VFLAG_MODIFY;
+			(pattr + i)->at_flags |= ATR_VFLAG_DBSAVE;
+		}
+	}
+}
+
+/**
+ * @brief
+ *	Mark the attributes noted by defer_attr_db() modified again, so the
+ *	next encode_attr_db() saves them
+ *
+ * @param[in]	pattr - Address of the parent objects attribute array
+ * @param[in]	numattr - Number of attributes in the list
+ *
+ */
+void
+restore_attr_db(attribute *pattr, int numattr)
+{
+	int i;
+
+	for (i = 0; i < numattr; i++) {
+		if ((pattr + i)->at_flags & ATR_VFLAG_DBSAVE) {
+			(pattr + i)->at_flags &= ~ATR_VFLAG_DBSAVE;
+			(pattr + i)->at_flags |= ATR_VFLAG_MODIFY;
+		}
+	}
+}
+
 /**
  * @brief
  *	Decode the list of attributes from the database to the regular attribute structure
@@ -41,6 +41,9 @@
 
 #include "job.h"
 
+/* called after every change of job state, set by the server to keep its job indexes */
+void (*job_state_hook)(job *pjob) = NULL;
+
 /**
  * @brief	Get attribute of job based on given attr index
  *
@@ -308,8 +311,11 @@ get_jattr_priv_encoded(const job *pjob, int attr_idx)
 void
 set_job_state(job *pjob, char val)
 {
-	if (pjob != NULL)
+	if (pjob != NULL) {
 		set_attr_c(get_jattr(pjob, JOB_ATR_state), val, SET);
+		if (job_state_hook != NULL)
+			job_state_hook(pjob);
+	}
 }
 
 /**
@@ -359,6 +359,11 @@ job_alloc(void)
 	pj->ji_prunreq = NULL;
 	pj->ji_pmt_preq = NULL;
 	CLEAR_HEAD(pj->ji_svrtask);
+	CLEAR_LINK(pj->ji_dirtylink);
+	CLEAR_LINK(pj->ji_statelink);
+	CLEAR_LINK(pj->ji_qstatelink);
+	CLEAR_LINK(pj->ji_ownerlink);
+	CLEAR_LINK(pj->ji_arraylink);
 	CLEAR_HEAD(pj->ji_rejectdest);
 	pj->ji_terminated = 0;
 	pj->ji_deletehistory = 0;
@@ -500,6 +505,10 @@ job_free(job *pj)
 
 		free_job_work_tasks(pj);
 
+		/* the job is gone, so is any save of it still pending */
+		job_save_db_cancel(pj);
+		job_index_remove(pj);
+
 		/* free any bad destination structs */
 
 		bp = (badplace *) GET_NEXT(pj->ji_rejectdest);
@@ -1671,6 +1680,7 @@ resv_alloc(char *resvid)
 	}
 
 	CLEAR_LINK(resvp->ri_allresvs);
+	CLEAR_LINK(resvp->ri_dirtylink);
 	CLEAR_HEAD(resvp->ri_svrtask);
 	CLEAR_HEAD(resvp->ri_rejectdest);
 	resvp->newobj = 1;
@@ -1723,6 +1733,8 @@ resv_free(resc_resv *presv)
 	char *dot = NULL;
 	char *resvid = presv->ri_qs.ri_resvID;
 
+	resv_save_db_cancel(presv);
+
 	/* remove any malloc working attribute space */
 
 	for (i = 0; i < (int) RESV_ATR_LAST; i++)
@@ -0,0 +1,698 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file	job_index.c
+ *
+ * @brief
+ * 		Secondary indexes over the jobs known to the Server.
+ *
+ * @par
+ *		Besides svr_alljobs and the per queue qu_jobs lists, every enqueued
+ *		job is linked into a list by job state (server wide and per queue),
+ *		a list by owner and, for Array Jobs, the list of array parents.
+ *		The lists are kept current by svr_enquejob(), svr_dequejob() and
+ *		set_job_state(), through job_state_hook.
+ *
+ *		job_index_plan() uses them to hand req_selectjobs() and
+ *		req_stat_job() the smallest set of jobs that can still satisfy a
+ *		request.  The caller applies the full selection to each candidate,
+ *		so an index only needs to yield a superset of the matching jobs.
+ *		Candidates are returned in queue rank order, the order in which
+ *		svr_alljobs and qu_jobs hold them.
+ *
+ * Included public functions are:
+ *	job_index_init()
+ *	job_index_add()
+ *	job_index_remove()
+ *	job_index_unqueue()
+ *	job_index_swap()
+ *	job_index_plan()
+ */
+
+#include <pbs_config.h> /* the master config generated by configure */
+
+#define STAT_CNTL 1
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include "libpbs.h"
+#include <string.h>
+#include "server_limits.h"
+#include "list_link.h"
+#include "attribute.h"
+#include "resource.h"
+#include "server.h"
+#include "credential.h"
+#include "batch_request.h"
+#include "job.h"
+#include "queue.h"
+#include "pbs_error.h"
+#include "log.h"
+#include "pbs_idx.h"
+#include "svrfunc.h"
+
+/* states which state_char2int() does not know share the last list */
+#define JOB_IDX_OTHER PBS_NUMJOBSTATE
+
+/*
+ * an index is used only if it visits at most 1/JOB_IDX_MIN_GAIN of the jobs
+ * a walk of the list would, gathering and sorting its jobs costs more per job
+ */
+#define JOB_IDX_MIN_GAIN 2
+
+enum index_plan {
+	PLAN_WALK,  /* walk qu_jobs or svr_alljobs */
+	PLAN_STATE, /* state lists */
+	PLAN_OWNER, /* owner lists */
+	PLAN_ARRAY  /* array parents */
+};
+
+struct owner_jobs {
+	pbs_list_head oj_jobs;	       /* jobs of this owner */
+	int oj_count;		       /* # of jobs in oj_jobs */
+	char oj_name[PBS_MAXUSER + 1]; /* user part of job_owner */
+};
+
+/* Global Data Items */
+
+extern struct server server;
+
+/* Private Data */
+
+static pbs_list_head svr_jobstidx[JOB_IDX_NSTATE]; /* jobs by state */
+static int svr_jobstct[JOB_IDX_NSTATE];		   /* # of jobs in each list */
+static pbs_list_head svr_arrayjobs;		   /* array parents */
+static int svr_arrayct;				   /* # of array parents */
+static void *owners_idx;			   /* owner name to struct owner_jobs */
+static int svr_noowner_ct;			   /* # of jobs without an owner list */
+static unsigned long long job_enqseq;		   /* order of svr_enquejob() calls */
+
+/**
+ * @brief
+ * 		state_list - map a job state letter to its state list
+ *
+ * @param[in]	state	-	job state letter
+ *
+ * @return	index into the state lists
+ */
+static int
+state_list(char state)
+{
+	int i;
+
+	i = state_char2int(state);
+	if (i == -1)
+		return JOB_IDX_OTHER;
+	return i;
+}
+
+/**
+ * @brief
+ * 		is_indexed - is the job linked into the indexes
+ *
+ * @param[in]	pjob	-	pointer to job
+ *
+ * @return	int
+ * @retval	1	: job is indexed
+ * @retval	0	: job is not indexed
+ */
+static int
+is_indexed(job *pjob)
+{
+	return (pjob->ji_statelink.ll_next != &pjob->ji_statelink);
+}
+
+/**
+ * @brief
+ * 		owner_name - copy the user part of the job owner
+ *
+ * @param[in]	owner	-	job owner, "user@host"
+ * @param[out]	name	-	user name, PBS_MAXUSER + 1 long
+ *
+ * @return	int
+ * @retval	0	: name set
+ * @retval	-1	: no owner, or user name too long
+ */
+static int
+owner_name(char *owner, char *name)
+{
+	int i;
+
+	if (owner == NULL)
+		return -1;
+	for (i = 0; owner[i] != '\0' && owner[i] != '@'; i++) {
+		if (i == PBS_MAXUSER)
+			return -1;
+		name[i] = owner[i];
+	}
+	name[i] = '\0';
+	return 0;
+}
+
+/**
+ * @brief
+ * 		find_owner_jobs - find the owner list for a user
+ *
+ * @param[in]	name	-	user name
+ *
+ * @return	struct owner_jobs *
+ * @retval	NULL	: no jobs for the user
+ */
+static struct owner_jobs *
+find_owner_jobs(char *name)
+{
+	struct owner_jobs *poj = NULL;
+
+	if (pbs_idx_find(owners_idx, (void **) &name, (void **) &poj, NULL) != PBS_IDX_RET_OK)
+		return NULL;
+	return poj;
+}
+
+/**
+ * @brief
+ * 		job_index_state - move a job to the state list of its current state
+ *		Installed as job_state_hook, so it runs on every set_job_state().
+ *
+ * @param[in,out]	pjob	-	pointer to job
+ *
+ * @return	void
+ */
+static void
+job_index_state(job *pjob)
+{
+	int st;
+
+	if (!is_indexed(pjob))
+		return;
+	st = state_list(get_job_state(pjob));
+	if (st == pjob->ji_idxstate)
+		return;
+
+	delete_link(&pjob->ji_statelink);
+	svr_jobstct[pjob->ji_idxstate]--;
+	append_link(&svr_jobstidx[st], &pjob->ji_statelink, pjob);
+	svr_jobstct[st]++;
+
+	if (pjob->ji_idxque != NULL) {
+		delete_link(&pjob->ji_qstatelink);
+		pjob->ji_idxque->qu_jobstct[pjob->ji_idxstate]--;
+		append_link(&pjob->ji_idxque->qu_jobstidx[st], &pjob->ji_qstatelink, pjob);
+		pjob->ji_idxque->qu_jobstct[st]++;
+	}
+	pjob->ji_idxstate = st;
+}
+
+/**
+ * @brief
+ * 		job_index_init - set up the job indexes, called before any job
+ *		is recovered
+ *
+ * @return	int
+ * @retval	0	: success
+ * @retval	-1	: failure
+ */
+int
+job_index_init(void)
+{
+	int i;
+
+	for (i = 0; i < JOB_IDX_NSTATE; i++) {
+		CLEAR_HEAD(svr_jobstidx[i]);
+		svr_jobstct[i] = 0;
+	}
+	CLEAR_HEAD(svr_arrayjobs);
+	svr_arrayct = 0;
+	svr_noowner_ct = 0;
+
+	if ((owners_idx = pbs_idx_create(0, 0)) == NULL)
+		return -1;
+	job_state_hook = job_index_state;
+	return 0;
+}
+
+/**
+ * @brief
+ * 		job_index_add - add a job to the indexes, called as the job is
+ *		linked into svr_alljobs.
+ *
+ * @param[in,out]	pjob	-	pointer to job, ji_qhdr already set if the
+ *					job has a queue
+ *
+ * @return	void
+ */
+void
+job_index_add(job *pjob)
+{
+	char name[PBS_MAXUSER + 1];
+	struct owner_jobs *poj;
+	int st;
+
+	if (is_indexed(pjob))
+		job_index_remove(pjob);
+
+	pjob->ji_enqseq = ++job_enqseq;
+
+	st = state_list(get_job_state(pjob));
+	pjob->ji_idxstate = st;
+	append_link(&svr_jobstidx[st], &pjob->ji_statelink, pjob);
+	svr_jobstct[st]++;
+
+	pjob->ji_idxque = pjob->ji_qhdr;
+	if (pjob->ji_idxque != NULL) {
+		append_link(&pjob->ji_idxque->qu_jobstidx[st], &pjob->ji_qstatelink, pjob);
+		pjob->ji_idxque->qu_jobstct[st]++;
+	}
+
+	pjob->ji_idxowner = NULL;
+	if (owner_name(get_jattr_str(pjob, JOB_ATR_job_owner), name) == 0) {
+		poj = find_owner_jobs(name);
+		if (poj == NULL && (poj = calloc(1, sizeof(struct owner_jobs))) != NULL) {
+			CLEAR_HEAD(poj->oj_jobs);
+			strcpy(poj->oj_name, name);
+			if (pbs_idx_insert(owners_idx, poj->oj_name, poj) != PBS_IDX_RET_OK) {
+				free(poj);
+				poj = NULL;
+			}
+		}
+		if (poj != NULL) {
+			append_link(&poj->oj_jobs, &pjob->ji_ownerlink, pjob);
+			poj->oj_count++;
+			pjob->ji_idxowner = poj;
+		}
+	}
+	if (pjob->ji_idxowner == NULL)
+		svr_noowner_ct++;
+
+	if (get_jattr_long(pjob, JOB_ATR_array)) {
+		append_link(&svr_arrayjobs, &pjob->ji_arraylink, pjob);
+		svr_arrayct++;
+	}
+}
+
+/**
+ * @brief
+ * 		job_index_remove - remove a job from the indexes
+ *
+ * @param[in,out]	pjob	-	pointer to job
+ *
+ * @return	void
+ */
+void
+job_index_remove(job *pjob)
+{
+	struct owner_jobs *poj;
+
+	if (!is_indexed(pjob))
+		return;
+
+	delete_link(&pjob->ji_statelink);
+	svr_jobstct[pjob->ji_idxstate]--;
+	job_index_unqueue(pjob);
+
+	if ((poj = pjob->ji_idxowner) != NULL) {
+		delete_link(&pjob->ji_ownerlink);
+		if (--poj->oj_count == 0) {
+			pbs_idx_delete(owners_idx, poj->oj_name);
+			free(poj);
+		}
+		pjob->ji_idxowner = NULL;
+	} else
+		svr_noowner_ct--;
+
+	if (pjob->ji_arraylink.ll_next != &pjob->ji_arraylink) {
+		delete_link(&pjob->ji_arraylink);
+		svr_arrayct--;
+	}
+}
+
+/**
+ * @brief
+ * 		job_index_unqueue - remove a job from the state lists of its queue,
+ *		the job stays in the server wide indexes.
+ *
+ * @param[in,out]	pjob	-	pointer to job
+ *
+ * @return	void
+ */
+void
+job_index_unqueue(job *pjob)
+{
+	if (pjob->ji_idxque == NULL)
+		return;
+	delete_link(&pjob->ji_qstatelink);
+	pjob->ji_idxque->qu_jobstct[pjob->ji_idxstate]--;
+	pjob->ji_idxque = NULL;
+}
+
+/**
+ * @brief
+ * 		job_index_swap - exchange the enqueue order of two jobs whose
+ *		queue rank and list positions have been swapped.
+ *
+ * @param[in,out]	pjob1	-	pointer to first job
+ * @param[in,out]	pjob2	-	pointer to second job
+ *
+ * @return	void
+ */
+void
+job_index_swap(job *pjob1, job *pjob2)
+{
+	unsigned long long seq;
+
+	seq = pjob1->ji_enqseq;
+	pjob1->ji_enqseq = pjob2->ji_enqseq;
+	pjob2->ji_enqseq = seq;
+}
+
+/**
+ * @brief
+ * 		plan_states - work out which state lists may hold selected jobs
+ *
+ * @param[in]	psel	-	selection list
+ * @param[in]	dosubjobs	-	as passed to select_job()
+ * @param[in]	dohistjobs	-	include history jobs
+ * @param[out]	mask	-	set to 1 for each state list to use
+ *
+ * @return	int
+ * @retval	1	: the state lists may narrow the search, the caller
+ *			  weighs their size against a walk
+ * @retval	0	: every job may be selected
+ */
+static int
+plan_states(struct select_list *psel, int dosubjobs, int dohistjobs, char *mask)
+{
+	char *pc;
+	int restricted = 0;
+	int i;
+
+	memset(mask, 0, JOB_IDX_NSTATE);
+
+	/* with subjobs the state of an array parent is not checked */
+	for (; psel && dosubjobs == 0; psel = psel->sl_next) {
+		if (psel->sl_atindx != JOB_ATR_state || psel->sl_op != EQ)
+			continue;
+		if ((pc = psel->sl_attr.at_val.at_str) == NULL)
+			continue;
+		for (; *pc; pc++) {
+			mask[state_list(*pc)] = 1;
+			/* suspended jobs are running jobs with a suspended substate */
+			if (*pc == JOB_STATE_LTR_SUSPENDED)
+				mask[state_list(JOB_STATE_LTR_RUNNING)] = 1;
+		}
+		restricted = 1;
+		break;
+	}
+
+	if (!restricted) {
+		if (dohistjobs)
+			return 0;
+		/* every live state: the history jobs are skipped, which pays
+		 * when job history holds most of the jobs
+		 */
+		for (i = 0; i < JOB_IDX_NSTATE; i++)
+			mask[i] = 1;
+	}
+	if (!dohistjobs) {
+		mask[state_list(JOB_STATE_LTR_FINISHED)] = 0;
+		mask[state_list(JOB_STATE_LTR_MOVED)] = 0;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief
+ * 		plan_owners - find the owner lists that may hold selected jobs
+ *
+ * @par
+ *		select_job() matches the owner with acl_check(), so only a list
+ *		of plain "user" or "user@host" entries narrows the search; a
+ *		default allow ("+") or a wildcard user does not.
+ *
+ * @param[in]	psel	-	selection list
+ * @param[out]	powners	-	malloc-ed array of owner lists, may be NULL
+ * @param[out]	pnowners	-	number of entries in *powners
+ *
+ * @return	int
+ * @retval	1	: the owner lists narrow the search
+ * @retval	0	: every job may be selected
+ */
+static int
+plan_owners(struct select_list *psel, struct owner_jobs ***powners, int *pnowners)
+{
+	struct array_strings *pas;
+	struct owner_jobs *poj;
+	char name[PBS_MAXUSER + 1];
+	char *pstr;
+	int i;
+	int j;
+
+	*powners = NULL;
+	*pnowners = 0;
+#ifdef HOST_ACL_DEFAULT_ALL
+	/* acl_check() then lets any user through by default */
+	return 0;
+#endif
+	if (svr_noowner_ct > 0)
+		return 0;
+
+	for (; psel; psel = psel->sl_next) {
+		if (psel->sl_atindx == JOB_ATR_userlst)
+			break;
+	}
+	if (psel == NULL || !is_attr_set(&psel->sl_attr))
+		return 0;
+	pas = psel->sl_attr.at_val.at_arst;
+	if (pas == NULL || pas->as_usedptr == 0)
+		return 0;
+
+	for (i = 0; i < pas->as_usedptr; i++) {
+		pstr = pas->as_string[i];
+		if (*pstr == '-')
+			continue; /* a deny entry selects nothing */
+		if (*pstr == '+')
+			pstr++;
+		if (*pstr == '\0' || *pstr == '@')
+			return 0;
+	}
+
+	*powners = malloc((unsigned int) pas->as_usedptr * sizeof(struct owner_jobs *));
+	if (*powners == NULL)
+		return 0;
+
+	for (i = 0; i < pas->as_usedptr; i++) {
+		pstr = pas->as_string[i];
+		if (*pstr == '-')
+			continue;
+		if (*pstr == '+')
+			pstr++;
+		if (owner_name(pstr, name) != 0 || (poj = find_owner_jobs(name)) == NULL)
+			continue;
+		for (j = 0; j < *pnowners; j++) {
+			if ((*powners)[j] == poj)
+				break;
+		}
+		if (j == *pnowners)
+			(*powners)[(*pnowners)++] = poj;
+	}
+	return 1;
+}
+
+/**
+ * @brief
+ * 		plan_array - does the selection only take array parents
+ *
+ * @param[in]	psel	-	selection list
+ *
+ * @return	int
+ * @retval	1	: only jobs with "array" True can be selected
+ * @retval	0	: otherwise
+ */
+static int
+plan_array(struct select_list *psel)
+{
+	for (; psel; psel = psel->sl_next) {
+		if (psel->sl_atindx == JOB_ATR_array && psel->sl_op == EQ &&
+		    is_attr_set(&psel->sl_attr) && psel->sl_attr.at_val.at_long)
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief
+ * 		cmp_qorder - order jobs as svr_enquejob() links them, by queue rank
+ *		and then by the order in which they were enqueued.
+ *
+ * @return	int
+ */
+static int
+cmp_qorder(const void *a, const void *b)
+{
+	job *pj1 = *(job **) a;
+	job *pj2 = *(job **) b;
+	long long r1 = get_jattr_ll(pj1, JOB_ATR_qrank);
+	long long r2 = get_jattr_ll(pj2, JOB_ATR_qrank);
+
+	if (r1 != r2)
+		return (r1 < r2) ? -1 : 1;
+	if (pj1->ji_enqseq != pj2->ji_enqseq)
+		return (pj1->ji_enqseq < pj2->ji_enqseq) ? -1 : 1;
+	return 0;
+}
+
+/**
+ * @brief
+ * 		job_index_plan - choose the cheapest way to find the jobs of a
+ *		select or status request.
+ *
+ * @par
+ *		The cost of each index which applies to the request is the number
+ *		of jobs it holds; that is compared with the number of jobs in the
+ *		queue, or the server, which a plain walk of qu_jobs or svr_alljobs
+ *		would visit.  An index is used only if it is selective, i.e. it
+ *		visits at most 1/JOB_IDX_MIN_GAIN of those jobs.  Its jobs are then
+ *		returned sorted into list order, otherwise the caller walks the
+ *		list.
+ *
+ * @param[in]	pque	-	queue to search, NULL for the whole server
+ * @param[in]	psel	-	selection list, may be NULL
+ * @param[in]	dosubjobs	-	as passed to select_job()
+ * @param[in]	dohistjobs	-	include history jobs
+ * @param[out]	pjobs	-	malloc-ed array of candidate jobs, may be NULL
+ *				if there are none
+ * @param[out]	pcount	-	number of candidate jobs
+ *
+ * @return	int
+ * @retval	1	: *pjobs holds every job which may match
+ * @retval	0	: walk the full list instead
+ */
+int
+job_index_plan(pbs_queue *pque, struct select_list *psel, int dosubjobs, int dohistjobs, job ***pjobs, int *pcount)
+{
+	char mask[JOB_IDX_NSTATE];
+	struct owner_jobs **owners = NULL;
+	int nowners = 0;
+	enum index_plan plan = PLAN_WALK;
+	int best;
+	int cost;
+	int i;
+	int n = 0;
+	job *pjob;
+	job **jobs;
+
+	*pjobs = NULL;
+	*pcount = 0;
+	if (owners_idx == NULL)
+		return 0;
+
+	/* the most jobs an index may hold and still be worth using */
+	best = (pque ? pque->qu_numjobs : server.sv_qs.sv_numjobs) / JOB_IDX_MIN_GAIN + 1;
+
+	if (plan_states(psel, dosubjobs, dohistjobs, mask)) {
+		for (cost = 0, i = 0; i < JOB_IDX_NSTATE; i++) {
+			if (mask[i])
+				cost += pque ? pque->qu_jobstct[i] : svr_jobstct[i];
+		}
+		if (cost < best) {
+			best = cost;
+			plan = PLAN_STATE;
+		}
+	}
+	if (plan_owners(psel, &owners, &nowners)) {
+		for (cost = 0, i = 0; i < nowners; i++)
+			cost += owners[i]->oj_count;
+		if (cost < best) {
+			best = cost;
+			plan = PLAN_OWNER;
+		}
+	}
+	if (plan_array(psel) && svr_arrayct < best) {
+		best = svr_arrayct;
+		plan = PLAN_ARRAY;
+	}
+
+	if (plan == PLAN_WALK) {
+		free(owners);
+		return 0; /* no index is selective enough to beat walking the list */
+	}
+
+	if (best > 0) {
+		jobs = malloc((unsigned int) best * sizeof(job *));
+		if (jobs == NULL) {
+			free(owners);
+			return 0;
+		}
+	} else
+		jobs = NULL;
+
+	if (plan == PLAN_STATE) {
+		for (i = 0; i < JOB_IDX_NSTATE; i++) {
+			if (!mask[i])
+				continue;
+			if (pque) {
+				for (pjob = (job *) GET_NEXT(pque->qu_jobstidx[i]); pjob && n < best; pjob = (job *) GET_NEXT(pjob->ji_qstatelink))
+					jobs[n++] = pjob;
+			} else {
+				for (pjob = (job *) GET_NEXT(svr_jobstidx[i]); pjob && n < best; pjob = (job *) GET_NEXT(pjob->ji_statelink))
+					jobs[n++] = pjob;
+			}
+		}
+	} else if (plan == PLAN_OWNER) {
+		for (i = 0; i < nowners; i++) {
+			for (pjob = (job *) GET_NEXT(owners[i]->oj_jobs); pjob && n < best; pjob = (job *) GET_NEXT(pjob->ji_ownerlink)) {
+				if (pque == NULL || pjob->ji_idxque == pque)
+					jobs[n++] = pjob;
+			}
+		}
+	} else {
+		for (pjob = (job *) GET_NEXT(svr_arrayjobs); pjob && n < best; pjob = (job *) GET_NEXT(pjob->ji_arraylink)) {
+			if (pque == NULL || pjob->ji_idxque == pque)
+				jobs[n++] = pjob;
+		}
+	}
+	free(owners);
+
+	if (n > 1)
+		qsort(jobs, n, sizeof(job *), cmp_qorder);
+	*pjobs = jobs;
+	*pcount = n;
+	return 1;
+}
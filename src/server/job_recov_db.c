@@ -58,6 +58,7 @@
 #include "job.h"
 #include "reservation.h"
 #include "queue.h"
+#include "server.h"
 #include "log.h"
 #include "pbs_nodes.h"
 #include "svrfunc.h"
@@ -66,6 +67,7 @@
 #include "pbs_db.h"
 
 #define MAX_SAVE_TRIES 3
+#define DB_SAVE_BATCH_MAX 1000 /* pending saves which force a flush */
 
 extern void *svr_db_conn;
 extern int server_init_type;
@@ -79,6 +81,18 @@ extern time_t time_now;
 job *recov_job_cb(pbs_db_obj_info_t *dbobj, int *refreshed);
 resc_resv *recov_resv_cb(pbs_db_obj_info_t *dbobj, int *refreshed);
 
+/* jobs and reservations with a save to the database pending */
+static pbs_list_head dirty_jobs = {&dirty_jobs, &dirty_jobs, NULL};
+static pbs_list_head dirty_resvs = {&dirty_resvs, &dirty_resvs, NULL};
+static int dirty_count = 0;
+static int in_flush = 0;
+
+/* counters reported in the db_save_stats server attribute */
+static long flush_count = 0;
+static int flush_last_depth = 0;
+static double flush_last_ms = 0.0;
+static double flush_max_ms = 0.0;
+
 /**
  * @brief
  *		convert job structure to DB format
@@ -216,7 +230,7 @@ db_to_job(job *pjob, pbs_db_job_info_t *dbjob)
 
 /**
  * @brief
- *		Save job to database
+ *		Save job to database now
  *
  * @param[in]	pjob - The job to save
  *
@@ -226,8 +240,8 @@ db_to_job(job *pjob, pbs_db_job_info_t *dbjob)
  * @retval	 1 - Jobid clash, retry with new jobid
  *
  */
-int
-job_save_db(job *pjob)
+static int
+job_save_db_now(job *pjob)
 {
 	pbs_db_job_info_t dbjob = {{0}};
 	pbs_db_obj_info_t obj;
@@ -240,6 +254,7 @@ job_save_db(job *pjob)
 	old_mtime = get_jattr_long(pjob, JOB_ATR_mtime);
 	old_flags = (get_jattr(pjob, JOB_ATR_mtime))->at_flags;
 
+	restore_attr_db(pjob->ji_wattr, JOB_ATR_LAST);
 	if ((savetype = job_to_db(pjob, &dbjob)) == -1)
 		goto done;
 
@@ -274,6 +289,59 @@ done:
 	return (rc);
 }
 
+/**
+ * @brief
+ *		Save job to database
+ *
+ * @par
+ *		A new job is inserted right away, its submitter waits on it.
+ *		Changes to a known job are put off until db_save_flush(), which
+ *		saves every pending change in one transaction.  A job changed
+ *		several times before that is saved once.
+ *
+ * @param[in]	pjob - The job to save
+ *
+ * @return      Error code
+ * @retval	 0 - Success
+ * @retval	-1 - Failure
+ * @retval	 1 - Jobid clash, retry with new jobid
+ *
+ */
+int
+job_save_db(job *pjob)
+{
+	if (pjob->newobj)
+		return job_save_db_now(pjob);
+
+	/* stamp mtime and clear the modify flags now, as a save would */
+	set_jattr_l_slim(pjob, JOB_ATR_mtime, time_now, SET);
+	defer_attr_db(job_attr_def, pjob->ji_wattr, JOB_ATR_LAST, check_job_state(pjob, JOB_STATE_LTR_FINISHED));
+
+	if (pjob->ji_dirtylink.ll_next == &pjob->ji_dirtylink) {
+		append_link(&dirty_jobs, &pjob->ji_dirtylink, pjob);
+		if (++dirty_count >= DB_SAVE_BATCH_MAX)
+			db_save_flush();
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *		Forget a pending save of a job which is going away
+ *
+ * @param[in]	pjob - The job
+ *
+ */
+void
+job_save_db_cancel(job *pjob)
+{
+	if (pjob->ji_dirtylink.ll_next != &pjob->ji_dirtylink) {
+		delete_link(&pjob->ji_dirtylink);
+		dirty_count--;
+	}
+}
+
 /**
  * @brief
  *	Utility function called inside job_recov_db
@@ -426,7 +494,7 @@ db_to_resv(resc_resv *presv, pbs_db_resv_info_t *dbresv)
 
 /**
  * @brief
- *	Save resv to database
+ *	Save resv to database now
  *
  * @param[in]	presv - The resv to save
  * @param[in]   updatetype:
@@ -440,8 +508,8 @@ db_to_resv(resc_resv *presv, pbs_db_resv_info_t *dbresv)
  * @retval	 1 - resvid clash, retry with new resvid
  *
  */
-int
-resv_save_db(resc_resv *presv)
+static int
+resv_save_db_now(resc_resv *presv)
 {
 	pbs_db_resv_info_t dbresv = {{0}};
 	pbs_db_obj_info_t obj;
@@ -456,6 +524,7 @@ resv_save_db(resc_resv *presv)
 	old_mtime = get_attr_l(mtime);
 	old_flags = mtime->at_flags;
 
+	restore_attr_db(presv->ri_wattr, RESV_ATR_LAST);
 	if ((savetype = resv_to_db(presv, &dbresv)) == -1)
 		goto done;
 
@@ -489,6 +558,135 @@ done:
 	return (rc);
 }
 
+/**
+ * @brief
+ *	Save resv to database
+ *
+ * @par
+ *	A new resv is inserted right away, changes to a known one are put off
+ *	until db_save_flush(), like job_save_db() does.
+ *
+ * @param[in]	presv - The resv to save
+ *
+ * @return      Error code
+ * @retval	 0 - Success
+ * @retval	-1 - Failure
+ * @retval	 1 - resvid clash, retry with new resvid
+ *
+ */
+int
+resv_save_db(resc_resv *presv)
+{
+	if (presv->newobj)
+		return resv_save_db_now(presv);
+
+	set_rattr_l_slim(presv, RESV_ATR_mtime, time_now, SET);
+	defer_attr_db(resv_attr_def, presv->ri_wattr, RESV_ATR_LAST, 0);
+
+	if (presv->ri_dirtylink.ll_next == &presv->ri_dirtylink) {
+		append_link(&dirty_resvs, &presv->ri_dirtylink, presv);
+		if (++dirty_count >= DB_SAVE_BATCH_MAX)
+			db_save_flush();
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *	Forget a pending save of a resv which is going away
+ *
+ * @param[in]	presv - The resv
+ *
+ */
+void
+resv_save_db_cancel(resc_resv *presv)
+{
+	if (presv->ri_dirtylink.ll_next != &presv->ri_dirtylink) {
+		delete_link(&presv->ri_dirtylink);
+		dirty_count--;
+	}
+}
+
+/**
+ * @brief
+ *	Save all pending job and resv changes to the database in one
+ *	transaction, so they cost one commit instead of one each.
+ *
+ * @par
+ *	The server calls this before it waits for requests, which bounds how
+ *	long a change stays unsaved.  It is also the barrier for anything
+ *	which needs the database current, e.g. shutdown or failover.
+ *
+ */
+void
+db_save_flush(void)
+{
+	job *pjob;
+	resc_resv *presv;
+	struct timespec begin;
+	struct timespec end;
+	int depth = dirty_count;
+	int trx;
+
+	if (dirty_count == 0 || in_flush)
+		return;
+	in_flush = 1;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	/* without a transaction every save commits on its own, as before */
+	trx = (pbs_db_begin_trx(svr_db_conn) == 0);
+
+	while ((pjob = (job *) GET_NEXT(dirty_jobs)) != NULL) {
+		delete_link(&pjob->ji_dirtylink);
+		dirty_count--;
+		job_save_db_now(pjob);
+	}
+	while ((presv = (resc_resv *) GET_NEXT(dirty_resvs)) != NULL) {
+		delete_link(&presv->ri_dirtylink);
+		dirty_count--;
+		resv_save_db_now(presv);
+	}
+
+	if (trx && pbs_db_end_trx(svr_db_conn, 1) != 0) {
+		char *conn_db_err = NULL;
+
+		pbs_db_get_errmsg(PBS_DB_ERR, &conn_db_err);
+		log_errf(PBSE_INTERNAL, __func__, "Failed to commit %d saves %s", depth, conn_db_err ? conn_db_err : "");
+		free(conn_db_err);
+		panic_stop_db();
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	in_flush = 0;
+
+	flush_count++;
+	flush_last_depth = depth;
+	flush_last_ms = (end.tv_sec - begin.tv_sec) * 1000.0 + (end.tv_nsec - begin.tv_nsec) / 1e6;
+	if (flush_last_ms > flush_max_ms)
+		flush_max_ms = flush_last_ms;
+
+	log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SERVER, LOG_DEBUG, __func__,
+		   "Saved %d pending objects in %.3f ms", depth, flush_last_ms);
+}
+
+/**
+ * @brief
+ *	update_db_save_stats - update the 'db_save_stats' server attribute
+ *	with the number of saves pending and the depth and commit time of
+ *	the flushes done by db_save_flush()
+ */
+void
+update_db_save_stats(void)
+{
+	char buf[BUF_SIZE];
+
+	snprintf(buf, sizeof(buf), "Pending:%d Flushes:%ld Last_Depth:%d Last_Commit_ms:%.3f Max_Commit_ms:%.3f",
+		 dirty_count, flush_count, flush_last_depth, flush_last_ms, flush_max_ms);
+	set_sattr_str_slim(SVR_ATR_db_save_stats, buf, NULL);
+}
+
 /**
  * @brief
  *	Recover resv from database
@@ -289,6 +289,8 @@ initialize_pbsnode(struct pbsnode *pnode, char *pname, int ntype)
 	pnode->nd_nsn = 0;
 	pnode->nd_nsnfree = 0;
 	pnode->nd_svrflags = 0;
+	pnode->nd_chgseq = 0;
+	pnode->nd_stathash = 0;
 	pnode->nd_ncpus = 1;
 	pnode->nd_psn = NULL;
 	pnode->nd_hostname = NULL;
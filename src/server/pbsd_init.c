@@ -708,6 +708,10 @@ pbsd_init(int type)
 		log_err(-1, __func__, "Creating jobs index failed!");
 		return (-1);
 	}
+	if (job_index_init() != 0) {
+		log_err(-1, __func__, "Creating job state and owner indexes failed!");
+		return (-1);
+	}
 
 	server.sv_qs.sv_numjobs = 0;
 
@@ -123,6 +123,7 @@ extern int chk_and_update_db_svrhost();
 
 /* External data items */
 extern pbs_list_head svr_requests;
+extern pbs_list_head svr_deferred_stats;
 extern char *msg_err_malloc;
 extern int pbs_failover_active;
 
@@ -227,6 +228,7 @@ net_down_handler(void *data)
 		tpp_network_up = 0;
 		/* now loop and set all nodes to down */
 		log_event(PBSEVENT_ERROR | PBSEVENT_FORCE, PBS_EVENTCLASS_SERVER, LOG_ALERT, __func__, "marking all nodes unknown");
+		stat_cache_invalidate();
 		mark_nodes_unknown(1);
 	}
 }
@@ -289,6 +291,9 @@ do_tpp(int stream)
 	void is_request(int, int);
 	void stream_eof(int, int, char *);
 
+	/* whatever a MOM sends changes the state of its nodes or jobs */
+	stat_cache_invalidate();
+
 	DIS_tpp_funcs();
 	proto = disrsi(stream, &ret);
 	if (ret != DIS_SUCCESS) {
@@ -854,6 +859,8 @@ main(int argc, char **argv)
 	}
 
 	CLEAR_HEAD(svr_requests);
+	CLEAR_HEAD(svr_deferred_stats);
+	dispatch_task_hook = stat_cache_invalidate; /* tasks change what status replies hold */
 	CLEAR_HEAD(task_list_immed);
 	CLEAR_HEAD(task_list_interleave);
 	CLEAR_HEAD(task_list_timed);
@@ -1394,11 +1401,21 @@ main(int argc, char **argv)
 		if (reap_child_flag)
 			reap_child();
 
+		/* commit the job and resv changes made so far before waiting */
+		db_save_flush();
+
+		/* don't sleep while status requests are waiting to be answered */
+		if (GET_NEXT(svr_deferred_stats) != NULL)
+			waittime = 0;
+
 		/* wait for a request and process it */
 		if (wait_request(waittime, priority_context) != 0) {
 			log_err(-1, msg_daemonname, "wait_requst failed");
 		}
 
+		/* then answer the status requests held back during that pass */
+		(void) serve_deferred_stats();
+
 		if (reap_child_flag)  /* check again incase signal arrived */
 			reap_child(); /* before they were blocked          */
 
@@ -1421,6 +1438,8 @@ main(int argc, char **argv)
 	}
 	DBPRT(("Server out of main loop, state is %ld\n", state))
 
+	db_save_flush();
+
 	/* set the current seq id to the last id before final save */
 	server.sv_qs.sv_lastid = server.sv_qs.sv_jobidnumber;
 	svr_save_db(&server); /* final recording of server */
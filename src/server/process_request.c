@@ -58,6 +58,7 @@
  *	set_to_non_blocking()
  *	clear_non_blocking()
  *	dispatch_request()
+ *	serve_deferred_stats()
  *	close_client()
  *	alloc_br()
  *	close_quejob()
@@ -113,6 +114,9 @@
 /* global data items */
 
 pbs_list_head svr_requests;
+#ifndef PBS_MOM
+pbs_list_head svr_deferred_stats; /* client status requests not yet served */
+#endif
 
 extern struct server server;
 extern pbs_list_head svr_newjobs;
@@ -133,6 +137,9 @@ static void freebr_manage(struct rq_manage *);
 static void freebr_cpyfile(struct rq_cpyfile *);
 static void freebr_cpyfile_cred(struct rq_cpyfile_cred *);
 static void close_quejob(int sfds);
+#ifndef PBS_MOM
+static int defer_stat_request(conn_t *, struct batch_request *);
+#endif
 
 /**
  * @brief
@@ -689,6 +696,10 @@ process_request(int sfds)
 		}
 	}
 
+	/* status from clients is served after the other requests of this pass */
+	if (defer_stat_request(conn, request))
+		return;
+
 #else /* THIS CODE FOR MOM ONLY */
 
 	/* check connecting host against allowed list of ok clients */
@@ -783,6 +794,124 @@ clear_non_blocking(conn_t *conn)
 		conn->cn_sockflgs = 0;
 	}
 }
+
+/**
+ * @brief
+ *		close_deferred_stat - close function for a connection with a
+ *		deferred status request, the request is dropped unanswered.
+ *
+ * @param[in]	sfds	- socket being closed
+ */
+static void
+close_deferred_stat(int sfds)
+{
+	struct batch_request *preq;
+
+	for (preq = (struct batch_request *) GET_NEXT(svr_deferred_stats); preq;
+	     preq = (struct batch_request *) GET_NEXT(preq->rq_statlink)) {
+		if (preq->rq_conn == sfds)
+			preq->rq_conn = -1;
+	}
+}
+
+/**
+ * @brief
+ *		defer_stat_request - move a status request from a client behind
+ *		the other requests of the same pass
+ *
+ * @par
+ *		Status and select requests from commands do not change anything,
+ *		but on a busy server enough of them arrive together to hold up
+ *		the job submissions, run requests and scheduler traffic which
+ *		wait_request() found ready in the same pass.  Those are
+ *		dispatched first; the status requests are queued on
+ *		svr_deferred_stats and answered by serve_deferred_stats().
+ *
+ * @par
+ *		This only changes the order in which requests are served.  The
+ *		status requests are still served one at a time on the main loop,
+ *		and each takes as long as it did before; nothing runs alongside
+ *		them.
+ *
+ * @param[in]	conn	- connection the request arrived on
+ * @param[in]	preq	- the request
+ *
+ * @return	int
+ * @retval	1	- request queued
+ * @retval	0	- dispatch the request now
+ */
+static int
+defer_stat_request(conn_t *conn, struct batch_request *preq)
+{
+	switch (preq->rq_type) {
+		case PBS_BATCH_StatusJob:
+		case PBS_BATCH_StatusQue:
+		case PBS_BATCH_StatusNode:
+		case PBS_BATCH_StatusResv:
+		case PBS_BATCH_StatusSvr:
+		case PBS_BATCH_SelectJobs:
+		case PBS_BATCH_SelStat:
+			break;
+		default:
+			return 0;
+	}
+
+	/* schedulers are not kept waiting, nor is a connection with its own close function */
+	if (preq->prot != PROT_TCP || conn->cn_origin != CONN_UNKNOWN ||
+	    (conn->cn_oncl != NULL && conn->cn_oncl != close_deferred_stat))
+		return 0;
+
+	net_add_close_func(conn->cn_sock, close_deferred_stat);
+	append_link(&svr_deferred_stats, &preq->rq_statlink, preq);
+	return 1;
+}
+
+/**
+ * @brief
+ *		serve_deferred_stats - dispatch the status requests held back by
+ *		defer_stat_request(), oldest first, on the main loop.
+ *
+ * @par
+ *		At least one request is served per call; after that, serving
+ *		stops once PBS_DEFER_STAT_MSEC have been spent so that requests
+ *		arriving in the next pass get their turn before the rest of a
+ *		long backlog.
+ *
+ * @return	int
+ * @retval	1	- requests are still waiting
+ * @retval	0	- none left
+ */
+int
+serve_deferred_stats(void)
+{
+	struct batch_request *preq;
+	struct timeval start;
+	struct timeval now;
+	conn_t *conn;
+	long elapsed;
+
+	gettimeofday(&start, NULL);
+	while ((preq = (struct batch_request *) GET_NEXT(svr_deferred_stats)) != NULL) {
+		delete_link(&preq->rq_statlink);
+
+		if (preq->rq_conn == -1) {
+			/* client went away while waiting */
+			free_br(preq);
+		} else {
+			conn = get_conn(preq->rq_conn);
+			if (conn != NULL && conn->cn_oncl == close_deferred_stat)
+				net_add_close_func(preq->rq_conn, NULL);
+			time_now = time(NULL);
+			dispatch_request(preq->rq_conn, preq);
+		}
+
+		gettimeofday(&now, NULL);
+		elapsed = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000;
+		if (elapsed >= PBS_DEFER_STAT_MSEC)
+			break;
+	}
+	return (GET_NEXT(svr_deferred_stats) != NULL);
+}
 #endif /* !PBS_MOM */
 
 /**
@@ -817,6 +946,12 @@ dispatch_request(int sfds, struct batch_request *request)
 		}
 	}
 
+#ifndef PBS_MOM
+	/* anything but a status query from a command may change what a status reply holds */
+	if (conn == NULL || conn->cn_origin != CONN_UNKNOWN || !stat_cache_readonly(request->rq_type))
+		stat_cache_invalidate();
+#endif
+
 	switch (request->rq_type) {
 
 		case PBS_BATCH_QueueJob:
@@ -1274,6 +1409,7 @@ alloc_br(int type)
 		memset((void *) req, (int) 0, sizeof(struct batch_request));
 		req->rq_type = type;
 		CLEAR_LINK(req->rq_link);
+		CLEAR_LINK(req->rq_statlink);
 		req->rq_conn = -1;    /* indicate not connected */
 		req->rq_orgconn = -1; /* indicate not connected */
 		req->rq_time = time_now;
@@ -1313,6 +1449,7 @@ copy_br(struct batch_request *src)
 
 	req->rq_type = src->rq_type;
 	CLEAR_LINK(req->rq_link);
+	CLEAR_LINK(req->rq_statlink);
 	req->rq_conn = src->rq_conn;
 	req->rq_orgconn = src->rq_orgconn;
 	req->rq_time = src->rq_time;
@@ -1553,6 +1690,11 @@ void
 free_br(struct batch_request *preq)
 {
 	delete_link(&preq->rq_link);
+	delete_link(&preq->rq_statlink);
+#ifndef PBS_MOM
+	if (preq->rq_statcache != NULL)
+		stat_cache_release(preq);
+#endif
 	reply_free(&preq->rq_reply);
 
 	if (preq->rq_parentbr) {
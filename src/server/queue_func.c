@@ -80,6 +80,7 @@
 #include "pbs_nodes.h"
 #include "pbs_sched.h"
 #include "pbs_idx.h"
+#include "svrfunc.h"
 
 /* Global Data */
 
@@ -119,6 +120,8 @@ que_alloc(char *name)
 	pq->newobj = 1;
 	CLEAR_HEAD(pq->qu_jobs);
 	CLEAR_LINK(pq->qu_link);
+	for (i = 0; i < JOB_IDX_NSTATE; i++)
+		CLEAR_HEAD(pq->qu_jobstidx[i]);
 
 	snprintf(pq->qu_qs.qu_name, sizeof(pq->qu_qs.qu_name), "%s", name);
 	if (pbs_idx_insert(queues_idx, pq->qu_qs.qu_name, pq) != PBS_IDX_RET_OK) {
@@ -240,6 +243,7 @@ que_purge(pbs_queue *pque)
 			while (pjob) {
 				nxpjob = (job *) GET_NEXT(pjob->ji_jobque);
 				delete_link(&pjob->ji_jobque);
+				job_index_unqueue(pjob);
 				--pque->qu_numjobs;
 				if (state_num != -1)
 					--pque->qu_njstate[state_num];
@@ -218,7 +218,12 @@ dis_reply_write(int sfds, struct batch_request *preq)
 		pbs_tcp_errno = 0;
 		DIS_tcp_funcs(); /* setup for DIS over tcp */
 
-		rc = encode_DIS_reply(sfds, preply);
+#ifndef PBS_MOM
+		if (preq->rq_statcache != NULL)
+			rc = stat_cache_encode(sfds, preq);
+		else
+#endif
+			rc = encode_DIS_reply(sfds, preply);
 	}
 
 	if (rc == 0) {
@@ -362,7 +367,15 @@ reply_send(struct batch_request *request)
 		 * Otherwise, the reply is to be sent to a remote client
 		 */
 		if (rc == PBSE_NONE) {
+#ifndef PBS_MOM
+			/* the client may act on the reply, commit what the request changed first */
+			db_save_flush();
+#endif
 			rc = dis_reply_write(sfds, request);
+#ifndef PBS_MOM
+			if (rc == PBSE_NONE && request->rq_statcache != NULL)
+				stat_cache_store(request);
+#endif
 		}
 	}
 
@@ -1605,7 +1605,9 @@ mgr_sched_set(struct batch_request *preq)
 
 	plist = (svrattrl *) GET_NEXT(preq->rq_ind.rq_manager.rq_attr);
 	while (plist) {
-		if (strcmp(plist->al_atopl.name, ATTR_scheduling)) {
+		/* the scheduler's own profile report doesn't need a reconfigure */
+		if (strcmp(plist->al_atopl.name, ATTR_scheduling) &&
+		    strcmp(plist->al_atopl.name, ATTR_last_cycle_profile)) {
 			only_scheduling = 0;
 		}
 		/*
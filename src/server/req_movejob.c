@@ -251,6 +251,7 @@ req_orderjob(struct batch_request *req)
 	} else {
 		swap_link(&pjob1->ji_jobque, &pjob2->ji_jobque);
 		swap_link(&pjob1->ji_alljobs, &pjob2->ji_alljobs);
+		job_index_swap(pjob1, pjob2);
 	}
 
 	/* need to update disk copy of both jobs to save new order */
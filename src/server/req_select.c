@@ -331,6 +331,12 @@ req_selectjobs(struct batch_request *preq)
 	int rc;
 	struct select_list *selistp;
 	pbs_sched *psched;
+	u_Long since;
+	int delta;
+	job **cands = NULL;
+	int ncands = 0;
+	int icand = 0;
+	int indexed;
 
 	if (preq->rq_extend != NULL) {
 		/*
@@ -370,6 +376,9 @@ req_selectjobs(struct batch_request *preq)
 	if (psched != NULL && psched == dflt_scheduler && !scheduler_jobs_stat)
 		scheduler_jobs_stat = 1;
 
+	/* a scheduler may ask only for the jobs changed since its last query */
+	delta = get_stat_delta(preq, &since);
+
 	plist = (svrattrl *) GET_NEXT(preq->rq_ind.rq_select.rq_selattr);
 	rc = build_selist(plist, preq->rq_perm, &selistp, &pque, &bad, &pstate);
 	if (rc != 0) {
@@ -390,8 +399,14 @@ req_selectjobs(struct batch_request *preq)
 	pselx = &preply->brp_un.brp_select;
 	preply->brp_count = 0;
 
-	/* now start checking for jobs that match the selection criteria */
-	if (pque)
+	/*
+	 * now start checking for jobs that match the selection criteria,
+	 * either from the jobs an index says may match or from all of them
+	 */
+	indexed = job_index_plan(pque, selistp, dosubjobs, dohistjobs, &cands, &ncands);
+	if (indexed)
+		pjob = (ncands > 0) ? cands[0] : NULL;
+	else if (pque)
 		pjob = (job *) GET_NEXT(pque->qu_jobs);
 	else
 		pjob = (job *) GET_NEXT(svr_alljobs);
@@ -431,8 +446,10 @@ req_selectjobs(struct batch_request *preq)
 							if (pstate == 0 || chk_job_statenum(sjst, pstate)) {
 								if (preply->brp_count >= MAX_JOBS_PER_REPLY) {
 									rc = reply_send_status_part(preq);
-									if (rc != PBSE_NONE)
+									if (rc != PBSE_NONE) {
+										free(cands);
 										return;
+									}
 									preply->brp_count = 0;
 								}
 								rc = status_subjob(pjob, preq, plist, i, &preply->brp_un.brp_status, &bad, 0);
@@ -445,21 +462,29 @@ req_selectjobs(struct batch_request *preq)
 						rc = status_job(pjob, preq, plist, &preply->brp_un.brp_status, &bad, 0);
 						if (rc && rc != PBSE_PERM)
 							goto out;
+						if (rc == 0 && delta)
+							status_delta((struct brp_status *) GET_PRIOR(preply->brp_un.brp_status), since,
+								     &pjob->ji_chgseq, &pjob->ji_stathash);
 					}
 				}
 			}
 		}
-		if (pque)
+		if (indexed)
+			pjob = (++icand < ncands) ? cands[icand] : NULL;
+		else if (pque)
 			pjob = (job *) GET_NEXT(pjob->ji_jobque);
 		else
 			pjob = (job *) GET_NEXT(pjob->ji_alljobs);
 		if (preq->rq_type != PBS_BATCH_SelectJobs && preply->brp_count >= MAX_JOBS_PER_REPLY && pjob) {
 			rc = reply_send_status_part(preq);
-			if (rc != PBSE_NONE)
+			if (rc != PBSE_NONE) {
+				free(cands);
 				return;
+			}
 		}
 	}
 out:
+	free(cands);
 	free_sellist(selistp);
 	if (rc)
 		req_reject(rc, 0, preq);
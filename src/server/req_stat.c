@@ -297,6 +297,14 @@ req_stat_job(struct batch_request *preq)
 	int rc = 0;
 	int type = 0;
 	char *pnxtjid = NULL;
+	job **cands = NULL;
+	int ncands = 0;
+	int icand = 0;
+	int indexed = 0;
+
+	/* a repeated query may be answered from the status cache */
+	if (stat_cache_reply(preq))
+		return;
 
 	/* check for any extended flag in the batch request. 't' for
 	 * the sub jobs. If 'x' is there, then check if the server is
@@ -382,20 +390,33 @@ req_stat_job(struct batch_request *preq)
 		return;
 
 	} else {
-		pjob = (job *) GET_NEXT(type == 2 ? pque->qu_jobs : svr_alljobs);
+		/* without history jobs, the state lists may skip most of the list */
+		if (!dohistjobs)
+			indexed = job_index_plan(pque, NULL, dosubjobs, dohistjobs, &cands, &ncands);
+		if (indexed)
+			pjob = (ncands > 0) ? cands[0] : NULL;
+		else
+			pjob = (job *) GET_NEXT(type == 2 ? pque->qu_jobs : svr_alljobs);
 		while (pjob) {
 			rc = do_stat_of_a_job(preq, pjob, dohistjobs, dosubjobs);
 			if (rc != PBSE_NONE) {
+				free(cands);
 				req_reject(rc, bad, preq);
 				return;
 			}
-			pjob = (job *) GET_NEXT(type == 2 ? pjob->ji_jobque : pjob->ji_alljobs);
+			if (indexed)
+				pjob = (++icand < ncands) ? cands[icand] : NULL;
+			else
+				pjob = (job *) GET_NEXT(type == 2 ? pjob->ji_jobque : pjob->ji_alljobs);
 			if (preply->brp_count >= MAX_JOBS_PER_REPLY && pjob) {
 				rc = reply_send_status_part(preq);
-				if (rc != PBSE_NONE)
+				if (rc != PBSE_NONE) {
+					free(cands);
 					return;
+				}
 			}
 		}
+		free(cands);
 	}
 
 	if (rc && rc != PBSE_PERM)
@@ -423,6 +444,10 @@ req_stat_que(struct batch_request *preq)
 	int rc = 0;
 	int type = 0;
 
+	/* a repeated query may be answered from the status cache */
+	if (stat_cache_reply(preq))
+		return;
+
 	/*
 	 * first, validate the name of the requested object, either
 	 * a queue, or null for all queues
@@ -495,6 +520,7 @@ status_que(pbs_queue *pque, struct batch_request *preq, pbs_list_head *pstathd)
 	long total_jobs;
 	int rc = 0;
 	attribute *qattr;
+	u_Long since;
 
 	if ((preq->rq_perm & ATR_DFLAG_RDACC) == 0)
 		return (PBSE_PERM);
@@ -530,6 +556,8 @@ status_que(pbs_queue *pque, struct batch_request *preq, pbs_list_head *pstathd)
 	if (status_attrib(pal, que_attr_idx, que_attr_def, pque->qu_attr, QA_ATR_LAST,
 			  preq->rq_perm, &pstat->brp_attr, &bad))
 		rc = PBSE_NOATTR;
+	else if (get_stat_delta(preq, &since))
+		status_delta(pstat, since, &pque->qu_chgseq, &pque->qu_stathash);
 
 	if (is_attr_set(qattr))
 		free_attr(que_attr_def, qattr, QA_ATR_JobsByState);
@@ -557,6 +585,10 @@ req_stat_node(struct batch_request *preq)
 	int type = 0;
 	int i;
 
+	/* a repeated query may be answered from the status cache */
+	if (stat_cache_reply(preq))
+		return;
+
 	/*
 	 * first, check that the server indeed has a list of nodes
 	 * and if it does, validate the name of the requested object--
@@ -636,6 +668,7 @@ status_node(struct pbsnode *pnode, struct batch_request *preq, pbs_list_head *ps
 	struct brp_status *pstat;
 	svrattrl *pal;
 	unsigned long old_nd_state = VNODE_UNAVAILABLE;
+	u_Long since;
 
 	if (pnode->nd_state & INUSE_DELETED) /*node no longer valid*/
 		return (0);
@@ -682,6 +715,8 @@ status_node(struct pbsnode *pnode, struct batch_request *preq, pbs_list_head *ps
 	pal = (svrattrl *) GET_NEXT(preq->rq_ind.rq_status.rq_attr);
 
 	rc = status_nodeattrib(pal, pnode, ND_ATR_LAST, preq->rq_perm, &pstat->brp_attr, &bad);
+	if (rc == 0 && get_stat_delta(preq, &since))
+		status_delta(pstat, since, &pnode->nd_chgseq, &pnode->nd_stathash);
 
 	/*reverting back the state*/
 
@@ -739,11 +774,16 @@ req_stat_svr(struct batch_request *preq)
 	struct brp_status *pstat;
 	conn_t *conn;
 
+	/* a repeated query may be answered from the status cache */
+	if (stat_cache_reply(preq))
+		return;
+
 	/* update count and state counts from sv_numjobs and sv_jobstates */
 	set_sattr_l_slim(SVR_ATR_TotalJobs, server.sv_qs.sv_numjobs, SET);
 	update_state_ct(get_sattr(SVR_ATR_JobsByState), server.sv_jobstates, &svr_attr_def[SVR_ATR_JobsByState]);
 
 	update_license_ct();
+	update_db_save_stats();
 
 	conn = get_conn(preq->rq_conn);
 	if (!conn) {
@@ -753,6 +793,8 @@ req_stat_svr(struct batch_request *preq)
 	if (conn->cn_origin == CONN_SCHED_PRIMARY) {
 		/* Request is from sched so update "has_runjob_hook" */
 		update_isrunhook(get_sattr(SVR_ATR_has_runjob_hook));
+		/* and hand out the current change sequence for delta queries */
+		set_attr_ll(get_sattr(SVR_ATR_change_sequence), (long long) stat_chgseq(), SET);
 	}
 
 	/* allocate a reply structure and a status sub-structure */
@@ -944,6 +986,10 @@ req_stat_resv(struct batch_request *preq)
 	int rc = 0;
 	int type = 0;
 
+	/* a repeated query may be answered from the status cache */
+	if (stat_cache_reply(preq))
+		return;
+
 	/*
 	 * first, validate the name sent in the request.
 	 * This is either the ID of a specific reservation
@@ -1009,6 +1055,7 @@ status_resv(resc_resv *presv, struct batch_request *preq, pbs_list_head *pstathd
 {
 	struct brp_status *pstat;
 	svrattrl *pal;
+	u_Long since;
 
 	if ((preq->rq_perm & ATR_DFLAG_RDACC) == 0)
 		return (PBSE_PERM);
@@ -1036,10 +1083,12 @@ status_resv(resc_resv *presv, struct batch_request *preq, pbs_list_head *pstathd
 	pal = (svrattrl *) GET_NEXT(preq->rq_ind.rq_status.rq_attr);
 
 	if (status_attrib(pal, resv_attr_idx, resv_attr_def, presv->ri_wattr,
-			  RESV_ATR_LAST, preq->rq_perm, &pstat->brp_attr, &bad) == 0)
-		return (0);
-	else
+			  RESV_ATR_LAST, preq->rq_perm, &pstat->brp_attr, &bad) != 0)
 		return (PBSE_NOATTR);
+
+	if (get_stat_delta(preq, &since))
+		status_delta(pstat, since, &presv->ri_chgseq, &presv->ri_stathash);
+	return (0);
 }
 
 /**
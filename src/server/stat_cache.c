@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file	stat_cache.c
+ *
+ * @brief
+ * 		Cache of whole status replies for repeated identical queries.
+ *
+ * @par
+ *		status_job() and status_attrib() already keep the encoded form of
+ *		each attribute, but every status request still builds the reply
+ *		list and DIS encodes it.  When many commands (monitoring tools,
+ *		web portals) poll with the same query, the reply for one of them
+ *		is kept as the DIS encoded bytes of each part sent, keyed by the
+ *		request type, object id, extension, attribute list and the user,
+ *		host and permissions of the requestor.  An identical query is then
+ *		answered by writing those bytes again.
+ *
+ *		A cached reply is only good for the generation it was built in.
+ *		The generation is advanced by stat_cache_invalidate(), which is
+ *		called for every request other than a status query from a
+ *		command, every Inter-Server message from a MOM and every work
+ *		task dispatched; those are what change the Server's objects.
+ *		Replies also expire after PBS_STAT_CACHE_TTL seconds, to bound the
+ *		age of any value computed at status time.
+ *
+ *		Requests from schedulers are never answered from the cache, their
+ *		status requests also maintain the change sequences of the objects.
+ *
+ * Included public functions are:
+ *	stat_cache_invalidate()
+ *	stat_cache_readonly()
+ *	stat_cache_reply()
+ *	stat_cache_encode()
+ *	stat_cache_store()
+ *	stat_cache_release()
+ */
+
+#include <pbs_config.h> /* the master config generated by configure */
+
+#include <sys/types.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "libpbs.h"
+#include "dis.h"
+#include "server_limits.h"
+#include "list_link.h"
+#include "attribute.h"
+#include "server.h"
+#include "net_connect.h"
+#include "credential.h"
+#include "batch_request.h"
+#include "job.h"
+#include "pbs_error.h"
+#include "log.h"
+#include "svrfunc.h"
+
+struct stat_cache_ent {
+	char *ce_key;	    /* identifies the query */
+	u_Long ce_gen;	    /* generation the reply was built in */
+	time_t ce_time;	    /* when the reply was built */
+	int ce_cached;	    /* in stat_cache[], else owned by a request */
+	char *ce_data;	    /* encoded parts, back to back */
+	size_t ce_len;	    /* bytes in ce_data */
+	size_t ce_size;	    /* bytes allocated to ce_data */
+	size_t *ce_partlen; /* length of each part */
+	int ce_nparts;	    /* number of parts */
+};
+
+/* Global Data Items */
+
+extern time_t time_now;
+
+static struct stat_cache_ent *stat_cache[PBS_STAT_CACHE_SLOTS];
+static int stat_cache_used = 0; /* any slot filled */
+static u_Long stat_cache_gen = 0;
+
+/**
+ * @brief
+ *		free_ent - free a cache entry
+ *
+ * @param[in]	pent	- the entry
+ */
+static void
+free_ent(struct stat_cache_ent *pent)
+{
+	if (pent == NULL)
+		return;
+	free(pent->ce_key);
+	free(pent->ce_data);
+	free(pent->ce_partlen);
+	free(pent);
+}
+
+/**
+ * @brief
+ *		stat_cache_invalidate - start a new generation, dropping every
+ *		cached reply.
+ *
+ * @par
+ *		Called whenever the Server's objects may have changed.
+ */
+void
+stat_cache_invalidate(void)
+{
+	int i;
+
+	stat_cache_gen++;
+	if (stat_cache_used) {
+		for (i = 0; i < PBS_STAT_CACHE_SLOTS; i++) {
+			free_ent(stat_cache[i]);
+			stat_cache[i] = NULL;
+		}
+		stat_cache_used = 0;
+	}
+}
+
+/**
+ * @brief
+ *		stat_cache_readonly - does a request of this type leave the
+ *		Server's objects unchanged?
+ *
+ * @param[in]	type	- batch request type
+ *
+ * @return	int
+ * @retval	1	- read only
+ * @retval	0	- may change objects
+ */
+int
+stat_cache_readonly(int type)
+{
+	switch (type) {
+		case PBS_BATCH_StatusJob:
+		case PBS_BATCH_StatusQue:
+		case PBS_BATCH_StatusNode:
+		case PBS_BATCH_StatusResv:
+		case PBS_BATCH_StatusSvr:
+		case PBS_BATCH_StatusSched:
+		case PBS_BATCH_StatusHook:
+		case PBS_BATCH_StatusRsc:
+		case PBS_BATCH_SelectJobs:
+		case PBS_BATCH_SelStat:
+		case PBS_BATCH_LocateJob:
+		case PBS_BATCH_Disconnect:
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief
+ *		make_key - build the string identifying a status query
+ *
+ * @param[in]	preq	- the status request
+ *
+ * @return	char *
+ * @retval	malloc-ed key
+ * @retval	NULL	- out of memory
+ */
+static char *
+make_key(struct batch_request *preq)
+{
+	svrattrl *pal;
+	char *id;
+	char *ext;
+	char *key;
+	size_t len;
+	size_t n;
+
+	id = preq->rq_ind.rq_status.rq_id ? preq->rq_ind.rq_status.rq_id : "";
+	ext = preq->rq_extend ? preq->rq_extend : "";
+
+	len = strlen(preq->rq_user) + strlen(preq->rq_host) + strlen(id) + strlen(ext) + 32;
+	for (pal = (svrattrl *) GET_NEXT(preq->rq_ind.rq_status.rq_attr); pal;
+	     pal = (svrattrl *) GET_NEXT(pal->al_link))
+		len += pal->al_nameln + pal->al_rescln + 2;
+
+	if ((key = malloc(len)) == NULL)
+		return NULL;
+	n = sprintf(key, "%d:%d:%s@%s:%s:%s:", preq->rq_type, preq->rq_perm,
+		    preq->rq_user, preq->rq_host, ext, id);
+	for (pal = (svrattrl *) GET_NEXT(preq->rq_ind.rq_status.rq_attr); pal;
+	     pal = (svrattrl *) GET_NEXT(pal->al_link))
+		n += sprintf(key + n, ",%s.%s", pal->al_name, pal->al_resc ? pal->al_resc : "");
+	return key;
+}
+
+/**
+ * @brief
+ *		stat_cache_reply - answer a status query from the cache if an
+ *		identical one was answered in this generation.
+ *
+ * @par
+ *		Called at the start of the status request functions.  On a miss,
+ *		the request is set up so that its reply is recorded as it is
+ *		sent, see stat_cache_encode() and stat_cache_store().
+ *
+ * @param[in]	preq	- the status request
+ *
+ * @return	int
+ * @retval	1	- reply sent (or failed), the request is freed
+ * @retval	0	- build the reply as usual
+ */
+int
+stat_cache_reply(struct batch_request *preq)
+{
+	conn_t *conn;
+	struct stat_cache_ent *pent;
+	char *key;
+	int i;
+
+	if (preq->prot != PROT_TCP || preq->rq_conn < 0 || preq->rq_statcache != NULL)
+		return 0;
+	conn = get_conn(preq->rq_conn);
+	if (conn == NULL || conn->cn_origin != CONN_UNKNOWN)
+		return 0;
+
+	if ((key = make_key(preq)) == NULL)
+		return 0;
+
+	for (i = 0; i < PBS_STAT_CACHE_SLOTS; i++) {
+		pent = stat_cache[i];
+		if (pent == NULL || strcmp(pent->ce_key, key) != 0)
+			continue;
+		if (pent->ce_gen != stat_cache_gen || time_now - pent->ce_time >= PBS_STAT_CACHE_TTL) {
+			free_ent(pent);
+			stat_cache[i] = NULL;
+			break;
+		}
+		free(key);
+		preq->rq_statcache = pent;
+		(void) reply_send(preq);
+		return 1;
+	}
+
+	/* not cached, record the reply as it goes out */
+	if ((pent = calloc(1, sizeof(struct stat_cache_ent))) == NULL) {
+		free(key);
+		return 0;
+	}
+	pent->ce_key = key;
+	pent->ce_gen = stat_cache_gen;
+	pent->ce_time = time_now;
+	preq->rq_statcache = pent;
+	return 0;
+}
+
+/**
+ * @brief
+ *		stat_cache_encode - encode (part of) the reply to a status request
+ *		which is being cached or answered from the cache.
+ *
+ * @par
+ *		Used by dis_reply_write() in place of encode_DIS_reply().  A cached
+ *		reply is written out part by part, the caller flushes the last.
+ *		Otherwise the reply is encoded and a copy of the encoded bytes is
+ *		added to the entry being recorded; if memory runs out the
+ *		recording is abandoned but the reply is still sent.
+ *
+ * @param[in]	sfds	- connection socket
+ * @param[in]	preq	- the status request
+ *
+ * @return	int
+ * @retval	0	- success
+ * @retval	!0	- DIS error
+ */
+int
+stat_cache_encode(int sfds, struct batch_request *preq)
+{
+	struct stat_cache_ent *pent = preq->rq_statcache;
+	size_t *partlen;
+	char *data;
+	size_t len;
+	char *pc;
+	int rc;
+	int i;
+
+	if (pent->ce_cached) {
+		pc = pent->ce_data;
+		for (i = 0; i < pent->ce_nparts; i++) {
+			if (dis_puts(sfds, pc, pent->ce_partlen[i]) != (int) pent->ce_partlen[i])
+				return DIS_PROTO;
+			pc += pent->ce_partlen[i];
+			if (i < pent->ce_nparts - 1 && dis_flush(sfds) != 0)
+				return DIS_PROTO;
+		}
+		return DIS_SUCCESS;
+	}
+
+	if ((rc = encode_DIS_reply(sfds, &preq->rq_reply)) != DIS_SUCCESS)
+		return rc;
+
+	len = dis_peek_writebuf(sfds, &data);
+	if (pent->ce_len + len > pent->ce_size) {
+		pc = realloc(pent->ce_data, pent->ce_len + len);
+		if (pc == NULL)
+			goto abandon;
+		pent->ce_data = pc;
+		pent->ce_size = pent->ce_len + len;
+	}
+	partlen = realloc(pent->ce_partlen, (pent->ce_nparts + 1) * sizeof(size_t));
+	if (partlen == NULL)
+		goto abandon;
+	pent->ce_partlen = partlen;
+	memcpy(pent->ce_data + pent->ce_len, data, len);
+	pent->ce_len += len;
+	pent->ce_partlen[pent->ce_nparts++] = len;
+	return DIS_SUCCESS;
+
+abandon:
+	free_ent(pent);
+	preq->rq_statcache = NULL;
+	return DIS_SUCCESS;
+}
+
+/**
+ * @brief
+ *		stat_cache_store - keep the reply just sent for a status request
+ *
+ * @par
+ *		Only a successful reply built in the current generation is kept.
+ *		It takes a free slot, or the slot of the oldest reply.
+ *
+ * @param[in]	preq	- the status request, its reply has been sent
+ */
+void
+stat_cache_store(struct batch_request *preq)
+{
+	struct stat_cache_ent *pent = preq->rq_statcache;
+	int slot = 0;
+	int i;
+
+	if (pent->ce_cached)
+		return;
+	if (preq->rq_reply.brp_code != PBSE_NONE || pent->ce_gen != stat_cache_gen || pent->ce_nparts == 0)
+		return;
+
+	for (i = 0; i < PBS_STAT_CACHE_SLOTS; i++) {
+		if (stat_cache[i] == NULL) {
+			slot = i;
+			break;
+		}
+		if (stat_cache[i]->ce_time < stat_cache[slot]->ce_time)
+			slot = i;
+	}
+	free_ent(stat_cache[slot]);
+	pent->ce_cached = 1;
+	stat_cache[slot] = pent;
+	stat_cache_used = 1;
+	preq->rq_statcache = NULL;
+}
+
+/**
+ * @brief
+ *		stat_cache_release - detach a request from the cache, freeing the
+ *		reply recorded for it if that was not kept.
+ *
+ * @param[in]	preq	- the request being freed
+ */
+void
+stat_cache_release(struct batch_request *preq)
+{
+	if (!preq->rq_statcache->ce_cached)
+		free_ent(preq->rq_statcache);
+	preq->rq_statcache = NULL;
+}
@@ -50,12 +50,16 @@
  *	status_attrib()
  *	status_job()
  *	status_subjob()
+ *	stat_chgseq()
+ *	status_delta()
+ *	get_stat_delta()
  *
  */
 #include <sys/types.h>
 #include <stdlib.h>
 #include "libpbs.h"
 #include <ctype.h>
+#include <string.h>
 #include <time.h>
 #include "server_limits.h"
 #include "list_link.h"
@@ -72,9 +76,12 @@
 #include "svrfunc.h"
 #include "pbs_ifl.h"
 #include "ifl_internal.h"
+#include "pbs_sched.h"
 
 /* Global Data Items: */
 
+u_Long svr_chgseq = 0; /* last change sequence handed out to an object */
+
 extern attribute_def job_attr_def[];
 extern int resc_access_perm; /* see encode_resc() in attr_fn_resc.c */
 extern struct server server;
@@ -486,3 +493,110 @@ status_subjob(job *pjob, struct batch_request *preq, svrattrl *pal, int subj, pb
 
 	return (rc);
 }
+
+/**
+ * @brief
+ *		stat_chgseq - return the current change sequence of the server.
+ *
+ * @par
+ *		The sequence is seeded from the clock the first time it is used so
+ *		that it keeps increasing across a server restart.  A scheduler which
+ *		sees the sequence go backwards will fall back to a full query.
+ *
+ * @return	u_Long
+ * @retval	current change sequence
+ */
+u_Long
+stat_chgseq(void)
+{
+	if (svr_chgseq == 0)
+		svr_chgseq = ((u_Long) time_now) << 20;
+	return svr_chgseq;
+}
+
+/**
+ * @brief
+ *		status_delta - decide whether a status reply entry changed since
+ *		the sequence the scheduler acknowledged.
+ *
+ * @par
+ *		The encoded attribute list of the entry is hashed and compared
+ *		with the hash of the last status of the object.  If it differs,
+ *		the object is given a new change sequence.  If the object has not
+ *		changed since 'since', its attribute list is dropped, which tells
+ *		the scheduler to reuse the copy it already holds.
+ *
+ *		Only call this for requests get_stat_delta() finds come from a
+ *		scheduler.  Other clients see only the attributes they may read,
+ *		and hashing their replies would give every object a new change
+ *		sequence.
+ *
+ * @param[in,out]	pstat	-	status reply entry for the object
+ * @param[in]		since	-	change sequence acknowledged by the scheduler
+ * @param[in,out]	pchgseq	-	change sequence of the object
+ * @param[in,out]	phash	-	hash of the last status of the object
+ *
+ * @return	int
+ * @retval	1	: attributes dropped, object unchanged
+ * @retval	0	: attributes kept
+ */
+int
+status_delta(struct brp_status *pstat, u_Long since, u_Long *pchgseq, u_Long *phash)
+{
+	svrattrl *pal;
+	u_Long hash = 14695981039346656037ULL;
+	int i;
+
+	for (pal = (svrattrl *) GET_NEXT(pstat->brp_attr); pal; pal = (svrattrl *) GET_NEXT(pal->al_link)) {
+		for (i = 0; i < pal->al_nameln; i++)
+			hash = (hash ^ (unsigned char) pal->al_name[i]) * 1099511628211ULL;
+		for (i = 0; i < pal->al_rescln; i++)
+			hash = (hash ^ (unsigned char) pal->al_resc[i]) * 1099511628211ULL;
+		for (i = 0; i < pal->al_valln; i++)
+			hash = (hash ^ (unsigned char) pal->al_value[i]) * 1099511628211ULL;
+	}
+
+	if (*pchgseq == 0 || *phash != hash) {
+		(void) stat_chgseq();
+		*pchgseq = ++svr_chgseq;
+		*phash = hash;
+	}
+
+	if (since == 0 || *pchgseq > since)
+		return 0;
+
+	free_attrlist(&pstat->brp_attr);
+	return 1;
+}
+
+/**
+ * @brief
+ *		get_stat_delta - find whether a status request comes from a
+ *		scheduler and the change sequence it acknowledged in the extend
+ *		field ("D<seq>").
+ *
+ * @par
+ *		Only the primary connection of a scheduler takes part in the
+ *		change feed.  All other clients always get the full status, and
+ *		their replies do not change the objects' change sequences.
+ *
+ * @param[in]	preq	-	status request
+ * @param[out]	since	-	acknowledged change sequence, 0 for a full status
+ *
+ * @return	int
+ * @retval	1	: the request comes from a scheduler, call status_delta()
+ * @retval	0	: any other client
+ */
+int
+get_stat_delta(struct batch_request *preq, u_Long *since)
+{
+	char *p;
+
+	*since = 0;
+	if (find_sched_from_sock(preq->rq_conn, CONN_SCHED_PRIMARY) == NULL)
+		return 0;
+	if (preq->rq_extend != NULL && (p = strchr(preq->rq_extend, 'D')) != NULL)
+		*since = strTouL(p + 1, NULL, 10);
+
+	return 1;
+}
@@ -233,6 +233,7 @@ svr_enquejob(job *pjob, char *selectspec)
 					return PBSE_INTERNAL;
 				}
 				append_link(&svr_alljobs, &pjob->ji_alljobs, pjob);
+				job_index_add(pjob);
 			}
 			server.sv_qs.sv_numjobs++;
 			if (state_num != -1)
@@ -297,6 +298,7 @@ svr_enquejob(job *pjob, char *selectspec)
 		insert_link(&pjcur->ji_jobque, &pjob->ji_jobque, pjob,
 			    LINK_INSET_AFTER);
 	}
+	job_index_add(pjob);
 
 	/* update counts: queue and queue by state */
 
@@ -461,6 +463,7 @@ svr_dequejob(job *pjob)
 
 		delete_link(&pjob->ji_alljobs);
 		delete_link(&pjob->ji_unlicjobs);
+		job_index_remove(pjob);
 		if (pbs_idx_delete(jobs_idx, pjob->ji_qs.ji_jobid) != PBS_IDX_RET_OK)
 			log_joberr(PBSE_INTERNAL, __func__, "Failed to delete job from index", pjob->ji_qs.ji_jobid);
 		if (--server.sv_qs.sv_numjobs < 0)
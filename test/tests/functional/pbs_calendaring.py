@@ -228,3 +228,72 @@ class TestCalendaring(TestFunctional):
         est_time = job3[0]['estimated.start_time']
         est_time = time.mktime(time.strptime(est_time, '%c'))
         self.assertAlmostEqual(end_time, est_time, delta=1)
+
+    def get_topjob_estimates(self, nthreads, jids):
+        """
+        Restart the scheduler with nthreads worker threads, run a cycle,
+        and return the estimated start time and exec_vnode of each job
+        """
+        self.du.set_pbs_config(self.scheduler.hostname,
+                               confs={'PBS_SCHED_THREADS': nthreads})
+        self.scheduler.restart()
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match("Leaving Scheduling Cycle", starttime=t)
+
+        estimates = {}
+        for jid in jids:
+            job = self.server.status(JOB, ['estimated.start_time',
+                                           'estimated.exec_vnode'], id=jid)
+            estimates[jid] = (job[0].get('estimated.start_time'),
+                              job[0].get('estimated.exec_vnode'))
+        return estimates
+
+    def test_topjob_estimates_deterministic(self):
+        """
+        Test that the start times and vnodes estimated for many top jobs
+        are the same whether the scheduler runs with one or many threads
+        """
+        self.scheduler.set_sched_config({'strict_ordering': 'true all'})
+        self.server.manager(MGR_CMD_SET, SCHED,
+                            {'opt_backfill_fuzzy': 'off'})
+        self.server.manager(MGR_CMD_SET, SERVER, {'backfill_depth': 50})
+        a = {'resources_available.ncpus': 2}
+        self.mom.create_vnodes(a, 40, sharednode=False)
+
+        # Fill the vnodes with jobs which end at different times
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        for i in range(80):
+            wt = 3600 + (i % 13) * 300
+            a = {'Resource_List.select': '1:ncpus=1',
+                 'Resource_List.walltime': wt}
+            j = Job(TEST_USER, attrs=a)
+            j.set_sleep_time(wt)
+            self.server.submit(j)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'True'})
+        self.server.expect(JOB, {'job_state=R': 80})
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        jids = []
+        for i in range(50):
+            a = {'Resource_List.select': '%d:ncpus=%d' % (i % 7 + 1,
+                                                         i % 2 + 1),
+                 'Resource_List.walltime': 600 + (i % 5) * 600}
+            j = Job(TEST_USER, attrs=a)
+            jids.append(self.server.submit(j))
+
+        est1 = self.get_topjob_estimates(1, jids)
+        t = time.time()
+        est2 = self.get_topjob_estimates(4, jids)
+        # The full cluster frees too little for the first checks
+        self.scheduler.log_match(
+            "Start time search skipped", starttime=t)
+        self.du.unset_pbs_config(self.scheduler.hostname,
+                                 confs=['PBS_SCHED_THREADS'])
+        self.scheduler.restart()
+
+        for jid in jids:
+            self.assertIsNotNone(est1[jid][0],
+                                 "%s has no estimated start time" % jid)
+            self.assertEqual(est1[jid], est2[jid],
+                             "Estimates of %s differ between runs" % jid)
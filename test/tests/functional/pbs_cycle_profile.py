@@ -0,0 +1,148 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+
+import json
+from tests.functional import *
+
+
+class TestCycleProfile(TestFunctional):
+    """
+    Test the scheduler's cycle profiler
+    """
+    phases = ['query_server', 'sort_jobs', 'create_placement_sets',
+              'bucket_match', 'is_ok_to_run', 'calendar', 'run_job']
+
+    def setUp(self):
+        TestFunctional.setUp(self)
+        a = {'resources_available.ncpus': 2}
+        self.server.manager(MGR_CMD_SET, NODE, a, self.mom.shortname)
+        self.scheduler.set_sched_config({'cycle_profile': 'true'})
+        self.prof_file = os.path.join(
+            os.path.dirname(self.scheduler.sched_config_file),
+            'cycle_prof.json')
+
+    def run_profiled_cycle(self):
+        """
+        Run a cycle which runs one job and leaves one for the calendar
+        and return the last report in cycle_prof.json
+        """
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        self.server.manager(MGR_CMD_SET, SERVER, {'backfill_depth': 1})
+        j1 = Job(TEST_USER, {'Resource_List.ncpus': 2,
+                             'Resource_List.walltime': 100})
+        j1id = self.server.submit(j1)
+        j2 = Job(TEST_USER, {'Resource_List.ncpus': 2,
+                             'Resource_List.walltime': 100})
+        j2id = self.server.submit(j2)
+        s = self.server.status(SCHED, 'last_cycle_profile', id='default')
+        old = s[0].get('last_cycle_profile')
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {'job_state': 'R'}, id=j1id)
+        self.server.expect(JOB, 'estimated.start_time', op=SET, id=j2id)
+        # the file is written before the attribute is set
+        if old is None:
+            self.server.expect(SCHED, 'last_cycle_profile', op=SET,
+                               id='default')
+        else:
+            self.server.expect(SCHED, {'last_cycle_profile': old}, op=NE,
+                               id='default')
+
+        ret = self.du.cat(self.scheduler.hostname, self.prof_file,
+                          sudo=True)
+        self.assertEqual(ret['rc'], 0)
+        return json.loads(ret['out'][-1])
+
+    def test_cycle_profile_report(self):
+        """
+        Test that a profiled cycle reports every phase to cycle_prof.json
+        and to the scheduler's last_cycle_profile attribute
+        """
+        prof = self.run_profiled_cycle()
+        for p in self.phases:
+            self.assertIn(p, prof['phases'])
+            self.assertGreaterEqual(prof['phases'][p]['total'],
+                                    prof['phases'][p]['self'])
+        self.assertGreaterEqual(prof['phases']['run_job']['calls'], 1)
+        self.assertGreaterEqual(prof['phases']['calendar']['calls'], 1)
+        self.assertIn('calendar;is_ok_to_run', prof['stacks'])
+        self.assertGreaterEqual(prof['cycle'],
+                                prof['phases']['query_server']['total'])
+
+        s = self.server.status(SCHED, 'last_cycle_profile', id='default')
+        attr = json.loads(s[0]['last_cycle_profile'])
+        self.assertEqual(sorted(attr['phases'].keys()), sorted(self.phases))
+        self.assertNotIn('stacks', attr)
+
+    def test_cycle_profile_publish_interval(self):
+        """
+        Test that last_cycle_profile is not set again by a cycle run
+        within a minute of the one which set it
+        """
+        self.run_profiled_cycle()
+        s = self.server.status(SCHED, 'last_cycle_profile', id='default')
+        old = s[0]['last_cycle_profile']
+        ret = self.du.cat(self.scheduler.hostname, self.prof_file,
+                          sudo=True)
+        nreports = len(ret['out'])
+
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match("Cycle profile:", starttime=t)
+        self.server.expect(SCHED, {'last_cycle_profile': old},
+                           id='default')
+        ret = self.du.cat(self.scheduler.hostname, self.prof_file,
+                          sudo=True)
+        self.assertEqual(ret['rc'], 0)
+        self.assertEqual(len(ret['out']), nreports + 1)
+
+    def test_cycle_profile_off(self):
+        """
+        Test that nothing is reported when cycle_profile is off
+        """
+        self.scheduler.set_sched_config({'cycle_profile': 'false'})
+        self.du.rm(self.scheduler.hostname, self.prof_file, sudo=True,
+                   force=True)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        j = Job(TEST_USER, {'Resource_List.ncpus': 1})
+        jid = self.server.submit(j)
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid)
+        self.assertFalse(self.du.isfile(self.scheduler.hostname,
+                                        self.prof_file, sudo=True))
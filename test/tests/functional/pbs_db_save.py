@@ -0,0 +1,66 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+from tests.functional import *
+
+
+class TestDbSave(TestFunctional):
+    """
+    Test that job changes saved to the database in batches are committed
+    before the request that made them is acknowledged
+    """
+
+    def test_qhold_durable_before_reply(self):
+        """
+        A hold acknowledged to the client survives a server crash right
+        after the reply, and the flush shows up in db_save_stats
+        """
+        a = {'scheduling': 'False'}
+        self.server.manager(MGR_CMD_SET, SERVER, a)
+        jid = self.server.submit(Job(TEST_USER))
+        self.server.holdjob(jid, USER_HOLD)
+        self.server.stop('-KILL')
+        self.server.start()
+        self.server.expect(JOB, {'job_state': 'H',
+                                 'Hold_Types': 'u'}, id=jid)
+
+        self.server.alterjob(jid, {ATTR_N: 'renamed'})
+        self.server.expect(SERVER, {'db_save_stats': (MATCH_RE,
+                                    'Flushes:[1-9][0-9]* Last_Depth:[1-9]')},
+                           max_attempts=5)
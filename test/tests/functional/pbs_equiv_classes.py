@@ -2127,3 +2127,56 @@ else:
                 break
         self.assertTrue(found, "%s didn't found in any sched cycle" % jidh)
         self.assertIn(jid2.split('.')[0], sched_cycle.sched_job_run)
+
+    def test_verdict_carried_over(self):
+        """
+        Test that when nothing changed since the last cycle, a class which
+        could not run for lack of resources is turned away without a node
+        search, and that it is tried again once a job ends
+        """
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        jids = self.submit_jobs(10)
+
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {'job_state=R': 8})
+        self.server.expect(JOB, {'job_state=Q': 2})
+
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match(
+            "Carried the can-not-run verdicts of 1 equivalence classes",
+            starttime=t)
+        self.server.expect(JOB, {'job_state=Q': 2})
+
+        self.server.delete(jids[0], wait=True)
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match("Carried the can-not-run verdicts",
+                                 starttime=t, existence=False,
+                                 max_attempts=2)
+        self.server.expect(JOB, {'job_state=R': 8})
+        self.server.expect(JOB, {'job_state=Q': 1})
+
+    def test_verdict_dropped_on_node_queue_change(self):
+        """
+        Test that a class which could not run because its nodes belonged
+        to another queue is tried again once the node leaves that queue
+        """
+        a = {'queue_type': 'execution', 'started': 't', 'enabled': 't'}
+        self.server.manager(MGR_CMD_CREATE, QUEUE, a, id='workq2')
+        vn = self.mom.shortname
+        self.server.manager(MGR_CMD_SET, NODE, {'queue': 'workq2'}, id=vn)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        self.submit_jobs(2)
+
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {'job_state=Q': 2})
+
+        self.server.manager(MGR_CMD_UNSET, NODE, 'queue', id=vn)
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match("Carried the can-not-run verdicts of 1",
+                                 starttime=t, existence=False,
+                                 max_attempts=2)
+        self.server.expect(JOB, {'job_state=R': 2})
@@ -378,6 +378,36 @@ class TestFairshare(TestFunctional):
         self.assertEqual(fs_usage, 1,
                          "Fairshare usage %d not equal to 1" % fs_usage)
 
+    def test_fairshare_decay_multiple_periods(self):
+        """
+        Test that when several decay periods have passed since the last
+        cycle, the usage is decayed once for each period that passed
+        """
+        self.scheduler.set_sched_config({'fair_share': 'True'})
+        self.server.manager(MGR_CMD_SET, SCHED, {'log_events': 4095})
+        self.scheduler.add_to_resource_group(TEST_USER, 10, 'root', 50)
+        self.scheduler.fairshare.set_fairshare_usage(TEST_USER, 2 ** 20)
+        self.scheduler.set_sched_config({"fairshare_decay_time": "00:00:02"})
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'True'})
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        fs = self.scheduler.fairshare.query_fairshare(name=str(TEST_USER))
+        usage_before = int(fs.usage)
+
+        t = time.time()
+        time.sleep(7)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'True'})
+
+        m = self.scheduler.log_match(
+            r"Decaying Fairshare Tree (\d+) time\(s\)", regexp=True,
+            starttime=t)
+        ndecays = int(re.search(r"Tree (\d+) time", m[1]).group(1))
+        self.assertGreaterEqual(ndecays, 3)
+
+        fs = self.scheduler.fairshare.query_fairshare(name=str(TEST_USER))
+        expected = max(usage_before // (2 ** ndecays), 1)
+        self.assertEqual(int(fs.usage), expected)
+
     def test_fairshare_topjob(self):
         """
         Test that jobs are run in the augmented fairshare order after a topjob
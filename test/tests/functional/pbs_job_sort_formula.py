@@ -72,3 +72,37 @@ class TestJobSortFormula(TestFunctional):
             self.assertEqual(job.split('.')[0], c.political_order[i])
 
         self.server.expect(JOB, {'job_state=R': 2})
+
+    def test_job_sort_formula_native_and_python(self):
+        """
+        Test that a formula evaluated natively gives the same values as
+        the same formula evaluated through Python
+        """
+        a = {'resources_available.ncpus': 4}
+        self.server.manager(MGR_CMD_SET, NODE, a, self.mom.shortname)
+        self.server.manager(MGR_CMD_SET, SCHED, {'log_events': 2047})
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        j1 = Job(TEST_USER, attrs={'Resource_List.ncpus': 1,
+                                   'Resource_List.walltime': 100})
+        jid1 = self.server.submit(j1)
+        j2 = Job(TEST_USER, attrs={'Resource_List.ncpus': 2,
+                                   'Resource_List.walltime': 200})
+        jid2 = self.server.submit(j2)
+
+        formula = 'ncpus**2 - ncpus // 2 % 3 + -walltime / 100'
+        # max() can only be evaluated through Python
+        for f, how in [(formula, 'natively'),
+                       ('max(%s, -1000)' % formula, 'through Python')]:
+            t = time.time()
+            self.server.manager(MGR_CMD_SET, SCHED,
+                                {'job_sort_formula': f}, runas=ROOT_USER)
+            self.scheduler.run_scheduling_cycle()
+            self.scheduler.log_match('Formula will be evaluated ' + how,
+                                     starttime=t)
+            self.scheduler.log_match(jid1 + ';Formula Evaluation = 0',
+                                     starttime=t)
+            self.scheduler.log_match(jid2 + ';Formula Evaluation = 1',
+                                     starttime=t)
+            self.server.manager(MGR_CMD_UNSET, SCHED, 'job_sort_formula',
+                                runas=ROOT_USER)
@@ -84,3 +84,48 @@ class TestNodesQueues(TestFunctional):
                          nodes[1] == self.vn[2]) or
                         (nodes[0] == self.vn[1] and
                          nodes[1] == self.vn[3]))
+
+    def test_placement_sets_kept(self):
+        """
+        Test that placement sets are kept across cycles, that only those
+        whose nodes changed are summed again, and that jobs are still
+        placed by the kept sets
+        """
+        self.scheduler.set_sched_config({'log_filter': 0})
+        self.server.manager(MGR_CMD_SET, SCHED, {'log_events': 2047})
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        self.scheduler.run_scheduling_cycle()
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        m = self.scheduler.log_match(
+            r"Kept the meta data of (\d+) of \1 placement sets",
+            regexp=True, starttime=t)
+        kept = int(re.search(r"of (\d+) placement", m[1]).group(1))
+        self.assertGreater(kept, 0)
+
+        a = {'Resource_List.select': '2:ncpus=4',
+             'Resource_List.place': 'vscatter', 'queue': 'workq2'}
+        j = Job(TEST_USER, attrs=a)
+        jid = self.server.submit(j)
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, 'exec_vnode', id=jid, op=SET)
+        nodes = j.get_vnodes(j.exec_vnode)
+        self.assertTrue(sorted(nodes) in ([self.vn[0], self.vn[2]],
+                                          [self.vn[1], self.vn[3]]))
+
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        m = self.scheduler.log_match(
+            r"Kept the meta data of (\d+) of (\d+) placement sets",
+            regexp=True, starttime=t)
+        n = re.search(r"of (\d+) of (\d+) placement", m[1])
+        self.assertLess(int(n.group(1)), int(n.group(2)))
+
+        # The other pset of workq2 is still free, the used one is full
+        j2 = Job(TEST_USER, attrs=a)
+        jid2 = self.server.submit(j2)
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, 'exec_vnode', id=jid2, op=SET)
+        nodes2 = j2.get_vnodes(j2.exec_vnode)
+        self.assertTrue(set(nodes).isdisjoint(nodes2))
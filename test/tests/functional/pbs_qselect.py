@@ -110,3 +110,51 @@ class TestQselect(TestFunctional):
         self.assertNotEqual(ret, None)
         self.assertIn('err', ret)
         self.assertIn('qselect: illegal -t value', ret['err'])
+
+    def test_qselect_state_and_owner_order(self):
+        """
+        Check that selecting by state or by owner returns the same jobs,
+        in the same queue order, as the full list of jobs
+        """
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        jids = []
+        for user in [TEST_USER, TEST_USER1, TEST_USER, TEST_USER1]:
+            jids.append(self.server.submit(Job(user)))
+        self.server.holdjob(jids[1])
+        self.server.expect(JOB, {'job_state': 'H'}, id=jids[1])
+        self.server.orderjob(jids[0], jids[2])
+
+        order = [jids[2], jids[1], jids[0], jids[3]]
+        self.assertEqual(self.server.select(), order)
+        self.assertEqual(self.server.select({'job_state': 'Q'}),
+                         [jids[2], jids[0], jids[3]])
+        self.assertEqual(self.server.select({'job_state': 'H'}), [jids[1]])
+        self.assertEqual(self.server.select({ATTR_u: str(TEST_USER)}),
+                         [jids[2], jids[0]])
+        self.assertEqual(self.server.select({ATTR_u: str(TEST_USER1),
+                                             'job_state': 'Q'}),
+                         [jids[3]])
+
+    def test_stat_live_jobs_among_history(self):
+        """
+        Check that when history jobs are most of the jobs, status and
+        select without -x return the live jobs in queue order
+        """
+        self.server.manager(MGR_CMD_SET, SERVER,
+                            {'job_history_enable': 'True'})
+        done = []
+        for _ in range(5):
+            j = Job(TEST_USER)
+            j.set_sleep_time(1)
+            done.append(self.server.submit(j))
+        for jid in done:
+            self.server.expect(JOB, {'job_state': 'F'}, id=jid,
+                               extend='x')
+
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        live = [self.server.submit(Job(TEST_USER)) for _ in range(2)]
+        self.server.orderjob(live[0], live[1])
+
+        stat = self.server.status(JOB, 'job_state')
+        self.assertEqual([s['id'] for s in stat], [live[1], live[0]])
+        self.assertEqual(self.server.select(), [live[1], live[0]])
@@ -157,3 +157,26 @@ class TestQstat(TestFunctional):
                                       % re.escape(self.mom.shortname),
                                       qstat_out), None, "The exec host does"
                             " not contain the task slot number")
+
+    def test_qstat_repeated_after_change(self):
+        """
+        Test that repeating the same qstat -f right after a change
+        reports the change, and that repeating it with nothing changed
+        gives the same output.
+        """
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        j = Job(TEST_USER, attrs={ATTR_N: 'before'})
+        jid = self.server.submit(j)
+        qstat_cmd = [os.path.join(self.server.pbs_conf['PBS_EXEC'],
+                                  'bin', 'qstat'), '-f', jid]
+        first = self.du.run_cmd(self.server.hostname, cmd=qstat_cmd)
+        second = self.du.run_cmd(self.server.hostname, cmd=qstat_cmd)
+        self.assertEqual(first['rc'], 0)
+        self.assertEqual(first['out'], second['out'])
+
+        self.server.alterjob(jid, {ATTR_N: 'after'})
+        third = self.du.run_cmd(self.server.hostname, cmd=qstat_cmd)
+        self.assertEqual(third['rc'], 0)
+        qstat_out = '\n'.join(third['out'])
+        self.assertIn('Job_Name = after', qstat_out)
+        self.assertNotIn('Job_Name = before', qstat_out)
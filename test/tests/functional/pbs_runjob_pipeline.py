@@ -0,0 +1,120 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+from tests.functional import *
+
+
+class TestRunjobPipeline(TestFunctional):
+    """
+    Test pipelining of acknowledged runjob requests
+    (sched_config runjob_pipeline_depth)
+    """
+
+    hook_txt = """
+import pbs
+
+if pbs.event().job.id in %s:
+    pbs.event().reject("rejected by pipeline test")
+pbs.event().accept()
+"""
+
+    def setUp(self):
+        TestFunctional.setUp(self)
+        a = {'resources_available.ncpus': 4}
+        self.server.manager(MGR_CMD_SET, NODE, a, self.mom.shortname)
+        a = {'scheduling': 'False', 'job_run_wait': 'runjob_hook'}
+        self.server.manager(MGR_CMD_SET, SCHED, a, id='default')
+
+    def submit_jobs(self, n):
+        jids = []
+        for _ in range(n):
+            j = Job(TEST_USER, {'Resource_List.ncpus': 1})
+            jids.append(self.server.submit(j))
+        return jids
+
+    def test_pipelined_runjob_rejects(self):
+        """
+        With 4 runjob requests allowed in flight, the scheduler places
+        4 jobs on 4 ncpus before reading any acknowledgement.  The jobs
+        the runjob hook rejects stay queued with a comment and the others
+        run.  A rejection does not hold the job, so it is first in line
+        for the ncpus in the next cycle.
+        """
+        self.scheduler.set_sched_config({'runjob_pipeline_depth': 4})
+        jids = self.submit_jobs(6)
+        rejected = [jids[0], jids[2], jids[4], jids[5]]
+        hk_attrs = {'event': 'runjob', 'enabled': 'True'}
+        self.server.create_import_hook('rj', hk_attrs,
+                                       self.hook_txt % rejected)
+
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {'job_state': 'R'}, id=jids[1])
+        self.server.expect(JOB, {'job_state': 'R'}, id=jids[3])
+        # The last 2 jobs only fit on the ncpus the first 2 rejected jobs
+        # handed back, so their rejections show those ncpus were reused
+        # in the same cycle
+        for jid in rejected:
+            self.server.expect(JOB, {'job_state': 'Q'}, id=jid)
+            self.server.expect(JOB, {'comment': (MATCH_RE, 'Failed to run')},
+                               id=jid)
+            self.scheduler.log_match(jid + ';.*Failed to run',
+                                     regexp=True)
+
+        self.server.delete_hook('rj')
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {'job_state': 'R'}, id=jids[0])
+        self.server.expect(JOB, {'job_state': 'R'}, id=jids[2])
+        self.server.expect(JOB, {'job_state': 'Q'}, id=jids[4])
+        self.server.expect(JOB, {'job_state': 'Q'}, id=jids[5])
+
+    def test_pipelined_reject_frees_ncpus(self):
+        """
+        The ncpus of a job the runjob hook rejects inside the pipelined
+        window go to the next job in the same cycle
+        """
+        self.scheduler.set_sched_config({'runjob_pipeline_depth': 4})
+        jids = self.submit_jobs(5)
+        hk_attrs = {'event': 'runjob', 'enabled': 'True'}
+        self.server.create_import_hook('rj', hk_attrs,
+                                       self.hook_txt % [jids[0]])
+
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {'job_state': 'Q'}, id=jids[0])
+        for jid in jids[1:]:
+            self.server.expect(JOB, {'job_state': 'R'}, id=jid)
@@ -0,0 +1,102 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+
+
+
+from tests.functional import *
+
+
+class TestSortKeys(TestFunctional):
+    """
+    Test that jobs and nodes are sorted by their sort keys
+    """
+
+    def test_job_sort_key_order(self):
+        """
+        Submit jobs with ties on the first job_sort_key and check that
+        they are considered in the order of all of the keys, then in
+        submission order
+        """
+        a = {'resources_available.ncpus': 1}
+        self.server.manager(MGR_CMD_SET, NODE, a, self.mom.shortname)
+        a = {'job_sort_key': ['"ncpus HIGH" ALL', '"walltime LOW" ALL']}
+        self.scheduler.set_sched_config(a)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        jobs = []
+        walltimes = [300, 100, 200, 100, 300, 200]
+        for i in range(12):
+            ncpus = i % 3 + 1
+            walltime = walltimes[i % len(walltimes)]
+            j = Job(TEST_USER, {'Resource_List.ncpus': ncpus,
+                                'Resource_List.walltime': walltime})
+            jid = self.server.submit(j)
+            jobs.append((-ncpus, walltime, i, jid.split('.')[0]))
+
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'True'})
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        c = self.scheduler.cycles(lastN=1)[0]
+        order = [j[3] for j in sorted(jobs)]
+        self.assertEqual(order, c.political_order[:len(order)])
+
+    def test_node_sort_key_order(self):
+        """
+        Check that a scattered job runs on the nodes with the highest
+        sort_priority
+        """
+        a = {'resources_available.ncpus': 1}
+        self.mom.create_vnodes(a, 6)
+        priorities = [20, 60, 10, 50, 40, 30]
+        for i, p in enumerate(priorities):
+            vn = self.mom.shortname + '[%d]' % i
+            self.server.manager(MGR_CMD_SET, NODE, {'priority': p}, id=vn)
+        a = {'node_sort_key': '"sort_priority HIGH" ALL'}
+        self.scheduler.set_sched_config(a)
+
+        j = Job(TEST_USER, {'Resource_List.select': '3:ncpus=1',
+                            'Resource_List.place': 'scatter'})
+        jid = self.server.submit(j)
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid)
+
+        self.server.status(JOB, 'exec_vnode', id=jid)
+        vnodes = j.get_vnodes(j.exec_vnode)
+        expected = [self.mom.shortname + '[%d]' % i for i in (1, 3, 4)]
+        self.assertEqual(sorted(vnodes), sorted(expected))
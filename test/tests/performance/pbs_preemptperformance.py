@@ -637,6 +637,135 @@ class TestPreemptPerformance(TestPerformance):
         self.logger.info('#' * 80)
         self.perf_test_result(time_diff, "preempt_time_soft_limits", "sec")
 
+    def preempt_time(self, jid_highp):
+        """
+        Return the seconds between the scheduler considering jid_highp and
+        running it
+        """
+        search_str = jid_highp + ";Considering job to run"
+        (_, str1) = self.scheduler.log_match(search_str,
+                                             id=jid_highp, n='ALL',
+                                             max_attempts=1, interval=2)
+        search_str = jid_highp + ";Job run"
+        (_, str2) = self.scheduler.log_match(search_str,
+                                             id=jid_highp, n='ALL',
+                                             max_attempts=1, interval=2)
+        epoch1 = self.lu.convert_date_time(str1.split(";")[0])
+        epoch2 = self.lu.convert_date_time(str2.split(";")[0])
+        return epoch2 - epoch1
+
+    def submit_highp(self, a):
+        """
+        Create the high priority queue and submit a job with attributes a
+        to it
+        """
+        qname = 'highp'
+        q = {'queue_type': 'execution', 'priority': '200',
+             'started': 'True', 'enabled': 'True'}
+        self.server.manager(MGR_CMD_CREATE, QUEUE, q, qname)
+        a[ATTR_q] = qname
+        j = Job(TEST_USER, attrs=a)
+        j.set_sleep_time(3000)
+        return self.server.submit(j)
+
+    @timeout(7200)
+    @tags('sched', 'scheduling_policy')
+    def test_preempt_nodes_10k_running(self):
+        """
+        Run 10000 low priority jobs on 1250 vnodes.  The high priority job
+        needs a non-consumable resource only the vnode of the first job
+        has, so every running job is a candidate and the scheduler has to
+        find the one on the right vnode.
+        """
+        a = {'type': 'string', 'flag': 'h'}
+        self.server.manager(MGR_CMD_CREATE, RSC, a, id='qlist')
+
+        a = {ATTR_rescavail + ".qlist": "list1",
+             ATTR_rescavail + ".ncpus": "8"}
+        self.mom.create_vnodes(
+            a, 1250, self.mom, additive=True, fname="vnodedef1")
+
+        a = {ATTR_rescavail + ".qlist": "list2",
+             ATTR_rescavail + ".ncpus": "1"}
+        self.mom.create_vnodes(
+            a, 1, self.mom, additive=True, fname="vnodedef2")
+
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        self.scheduler.add_resource('qlist')
+
+        a = {ATTR_l + '.select': '1:ncpus=1:qlist=list2'}
+        j = Job(TEST_USER, attrs=a)
+        j.set_sleep_time(3000)
+        jid = self.server.submit(j)
+        time.sleep(1)
+
+        a = {ATTR_l + '.select': '1:ncpus=1:qlist=list1', ATTR_J: '1-10000'}
+        j = Job(TEST_USER, attrs=a)
+        j.set_sleep_time(3000)
+        self.server.submit(j)
+
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'True'})
+        self.server.expect(JOB, {'job_state=R': 10001}, extend='t',
+                           interval=20, offset=15)
+
+        a = {ATTR_l + '.select': '1:ncpus=1:qlist=list2'}
+        jid_highp = self.submit_highp(a)
+
+        self.server.expect(JOB, {ATTR_state: 'R'}, id=jid_highp, interval=10)
+        self.server.expect(JOB, {ATTR_state: (MATCH_RE, 'S|Q')}, id=jid)
+
+        time_diff = self.preempt_time(jid_highp)
+        self.logger.info('#' * 80)
+        res_str = "RESULT: PREEMPTION TOOK: " + str(time_diff) + " SECONDS"
+        self.logger.info(res_str)
+        self.logger.info('#' * 80)
+        self.perf_test_result(time_diff, "preempt_time_nodes_10k_running",
+                              "sec")
+
+    @timeout(7200)
+    @tags('sched', 'scheduling_policy')
+    def test_preempt_server_resc_10k_running(self):
+        """
+        Run 10000 low priority jobs which each use 1 of a server level
+        resource.  The high priority job needs 2000 of it, so 2000 jobs
+        have to be preempted.
+        """
+        a = {'type': 'long', 'flag': 'q'}
+        self.server.manager(MGR_CMD_CREATE, RSC, a, id='foo')
+
+        a = {ATTR_rescavail + ".ncpus": "8"}
+        self.mom.create_vnodes(
+            a, 1250, additive=True, fname="vnodedef1")
+
+        a = {ATTR_rescavail + ".foo": 10000, 'scheduling': 'False'}
+        self.server.manager(MGR_CMD_SET, SERVER, a)
+        self.scheduler.add_resource('foo')
+
+        a = {ATTR_l + '.select': '1:ncpus=1', ATTR_l + '.foo': 1,
+             ATTR_J: '1-10000'}
+        j = Job(TEST_USER, attrs=a)
+        j.set_sleep_time(3000)
+        self.server.submit(j)
+
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'True'})
+        self.server.expect(JOB, {'job_state=R': 10000}, extend='t',
+                           interval=20, offset=15)
+
+        a = {ATTR_l + '.select': '1:ncpus=1', ATTR_l + '.foo': 2000}
+        jid_highp = self.submit_highp(a)
+
+        self.server.expect(JOB, {ATTR_state: 'R'}, id=jid_highp, interval=10)
+        self.server.expect(JOB, {'job_state=S': 2000}, extend='t',
+                           interval=10)
+
+        time_diff = self.preempt_time(jid_highp)
+        self.logger.info('#' * 80)
+        res_str = "RESULT: PREEMPTION TOOK: " + str(time_diff) + " SECONDS"
+        self.logger.info(res_str)
+        self.logger.info('#' * 80)
+        self.perf_test_result(time_diff,
+                              "preempt_time_server_resc_10k_running", "sec")
+
     def tearDown(self):
         TestPerformance.tearDown(self)
         self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
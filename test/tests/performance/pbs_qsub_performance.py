@@ -37,6 +37,8 @@
 # "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
 # subject to Altair's trademark licensing policies.
 
+import signal
+import subprocess
 from tests.performance import *
 
 
@@ -98,3 +100,45 @@ class TestQsubPerformance(TestPerformance):
                               "submission_time_without_env", "sec")
         self.perf_test_result(sub_time_with_env,
                               "submission_time_with_env", "sec")
+
+    @timeout(3600)
+    def test_qsub_latency_under_stat_load(self):
+        """
+        This test case does the following
+        1. Submit 1000 jobs
+        2. Start 8 clients running qstat -f in a loop
+        3. Time 100 individual qsub calls while the clients run
+        4. Report the average and maximum qsub latency
+        """
+        if self.submit_jobs() < 0:
+            self.skipTest("could not submit the initial jobs")
+
+        bin_path = os.path.join(self.server.pbs_conf['PBS_EXEC'], 'bin')
+        qstat_loop = 'while true; do %s -f > /dev/null 2>&1; done' % \
+            os.path.join(bin_path, 'qstat')
+        loops = [subprocess.Popen(qstat_loop, shell=True,
+                                  start_new_session=True)
+                 for _ in range(8)]
+        try:
+            time.sleep(5)
+            qsub = os.path.join(bin_path, 'qsub') + ' -- /bin/sleep 100'
+            latencies = []
+            for _ in range(100):
+                start_time = time.time()
+                rc = subprocess.call(qsub, shell=True,
+                                     stdout=subprocess.DEVNULL)
+                latencies.append(time.time() - start_time)
+                self.assertEqual(rc, 0)
+        finally:
+            for p in loops:
+                os.killpg(p.pid, signal.SIGKILL)
+                p.wait()
+
+        avg_latency = round(sum(latencies) * 1000 / len(latencies), 2)
+        max_latency = round(max(latencies) * 1000, 2)
+        self.logger.info("qsub latency under qstat load: avg %s ms, "
+                         "max %s ms" % (avg_latency, max_latency))
+        self.perf_test_result(avg_latency, "qsub_avg_latency_stat_load",
+                              "ms")
+        self.perf_test_result(max_latency, "qsub_max_latency_stat_load",
+                              "ms")
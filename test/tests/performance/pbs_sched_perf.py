@@ -207,6 +207,46 @@ class TestSchedPerf(TestPerformance):
         self.logger.info('#' * 80)
         self.perf_test_result(t, m, "seconds")
 
+    @timeout(7200)
+    def test_bucket_match_100k_nodes(self):
+        """
+        Time cycles of bucket path jobs on 100k vnodes.  The first cycle
+        fills the cluster and the second one has every job fail to find
+        nodes, so both walk bitmaps of 100k nodes.
+        """
+        num_nodes = 100002
+        a = {'resources_available.ncpus': 1, 'resources_available.mem': '8gb'}
+        self.colors = \
+            ['red', 'orange', 'yellow', 'green', 'blue', 'indigo', 'violet']
+        self.server.manager(MGR_CMD_CREATE, RSC,
+                            {'type': 'string', 'flag': 'h'}, id='color')
+        self.mom.create_vnodes(a, num_nodes, sharednode=False,
+                               attrfunc=self.cust_attr_func, expect=False)
+        self.server.expect(NODE, {'state=free': (GE, num_nodes)},
+                           max_attempts=300)
+        self.scheduler.add_resource('color')
+
+        num_jobs = 1400
+        a = {'Resource_List.select': '10:ncpus=1:color=green',
+             'Resource_List.place': 'scatter:excl'}
+        self.submit_jobs(a, num_jobs, wt_start=num_jobs)
+        t1 = self.run_cycle()
+        self.server.expect(JOB, {'job_state=R': num_jobs},
+                           trigger_sched_cycle=False, interval=5,
+                           max_attempts=240)
+
+        a = {'Resource_List.select': '1000:ncpus=1:color=green',
+             'Resource_List.place': 'scatter:excl'}
+        self.submit_jobs(a, num_jobs, wt_start=num_jobs)
+        t2 = self.run_cycle()
+
+        m = 'Bucket cycles on %d vnodes: run %d jobs %.2fs, ' \
+            'fail %d jobs %.2fs' % (num_nodes, num_jobs, t1, num_jobs, t2)
+        self.logger.info('#' * 80)
+        self.logger.info(m)
+        self.logger.info('#' * 80)
+        self.perf_test_result([t1, t2], "bucket_match_100k_vnodes", "sec")
+
     @timeout(3600)
     def test_pset_fuzzy_perf(self):
         """
@@ -0,0 +1,105 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+
+from tests.performance import *
+
+
+class TestSchedSnapshotPerf(TestPerformance):
+
+    """
+    Measure the cost of duplicating the scheduler's view of the universe
+    as the cluster grows
+    """
+
+    def setUp(self):
+        TestPerformance.setUp(self)
+        self.server.manager(MGR_CMD_SET, SCHED, {'log_events': 2047})
+        self.server.manager(MGR_CMD_SET, SERVER, {'backfill_depth': 1})
+
+    def get_dup_time(self, num_nodes):
+        """
+        Fill a cluster of num_nodes vnodes with running jobs, submit a top
+        job which needs the whole cluster, and return the time it took to
+        duplicate the server when the top job was added to the calendar
+        """
+        a = {'resources_available.ncpus': 2, 'resources_available.mem': '8gb'}
+        self.mom.create_vnodes(a, num_nodes, expect=False, sharednode=False)
+        self.server.expect(NODE, {'state=free': num_nodes}, max_attempts=100)
+
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        a = {'Resource_List.select': '1:ncpus=1',
+             'Resource_List.walltime': 3600}
+        for _ in range(num_nodes):
+            j = Job(TEST_USER, attrs=a)
+            j.set_sleep_time(3600)
+            self.server.submit(j)
+
+        a = {'Resource_List.select': '%d:ncpus=2' % num_nodes,
+             'Resource_List.walltime': 3600}
+        j = Job(TEST_USER, attrs=a)
+        jid = self.server.submit(j)
+
+        t = time.time()
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'True'})
+        self.server.expect(JOB, {'job_state=R': num_nodes},
+                           offset=5, interval=10, max_attempts=100)
+        self.server.expect(JOB, 'estimated.start_time', op=SET, id=jid)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        (_, line) = self.scheduler.log_match("Server duplicated: ",
+                                             starttime=t, max_attempts=60,
+                                             interval=2)
+        dup_time = float(line.split(' in ')[-1].rstrip('s'))
+
+        self.server.cleanup_jobs()
+        return dup_time
+
+    @timeout(7200)
+    def test_snapshot_cost_by_cluster_size(self):
+        """
+        Report how long it takes to duplicate the server with 1000, 5000
+        and 10000 busy vnodes
+        """
+        for num_nodes in [1000, 5000, 10000]:
+            dup_time = self.get_dup_time(num_nodes)
+            self.logger.info('%d vnodes: server duplicated in %f seconds' %
+                             (num_nodes, dup_time))
+            self.perf_test_result(dup_time, "server_dup_%d_vnodes" %
+                                  num_nodes, "sec")